@@ -124,6 +124,7 @@ end translateInitFile;
     extern int <%symbolName(modelNamePrefixStr,"checkForAsserts")%>(DATA *data, threadData_t *threadData);
     extern int <%symbolName(modelNamePrefixStr,"function_ZeroCrossingsEquations")%>(DATA *data, threadData_t *threadData);
     extern int <%symbolName(modelNamePrefixStr,"function_ZeroCrossings")%>(DATA *data, threadData_t *threadData, double* gout);
+    extern int <%symbolName(modelNamePrefixStr,"function_ZeroCrossingsSubset")%>(DATA *data, threadData_t *threadData, double* gout, const long* indexes, long n);
     extern int <%symbolName(modelNamePrefixStr,"function_updateRelations")%>(DATA *data, threadData_t *threadData, int evalZeroCross);
     extern int <%symbolName(modelNamePrefixStr,"checkForDiscreteChanges")%>(DATA *data, threadData_t *threadData);
     extern const char* <%symbolName(modelNamePrefixStr,"zeroCrossingDescription")%>(int i, int **out_EquationIndexes);
@@ -941,6 +942,7 @@ template simulationFile(SimCode simCode, String guid, Boolean isModelExchangeFMU
        <%symbolName(modelNamePrefixStr,"checkForAsserts")%>,
        <%symbolName(modelNamePrefixStr,"function_ZeroCrossingsEquations")%>,
        <%symbolName(modelNamePrefixStr,"function_ZeroCrossings")%>,
+       <%symbolName(modelNamePrefixStr,"function_ZeroCrossingsSubset")%>,
        <%symbolName(modelNamePrefixStr,"function_updateRelations")%>,
        <%symbolName(modelNamePrefixStr,"checkForDiscreteChanges")%>,
        <%symbolName(modelNamePrefixStr,"zeroCrossingDescription")%>,
@@ -1043,6 +1045,7 @@ template simulationFileHeader(SimCode simCode)
     #include "simulation/solver/linearSystem.h"
     #include "simulation/solver/nonlinearSystem.h"
     #include "simulation/solver/mixedSystem.h"
+    #include "simulation/solver/parallelSystems.h"
 
     #include <string.h>
 
@@ -3574,17 +3577,22 @@ template functionXXX_systems(list<list<SimEqSystem>> eqs, String name, Text &loo
     funcs //just the one function
   case nFuncs then //2 and more
     let funcNames = eqs |> e hasindex i0 fromindex 0 => 'function<%name%>_system<%i0%>' ; separator=",\n"
-    let head = if Flags.isSet(Flags.PARMODAUTO) then '#pragma omp parallel for private(id) schedule(<%match noProc() case 0 then "dynamic" else "static"%>)'
-    let &varDecls += 'int id;<%\n%>'
+    let &varDecls += if Flags.isSet(Flags.PARMODAUTO) then 'int id;<%\n%>'
 
     let &loop +=
-      /* Text for the loop body that calls the equations */
-      <<
-      <%head%>
-      for(id=0; id<<%nFuncs%>; id++) {
-        function<%name%>_systems[id](data, threadData);
-      }
-      >>
+      if Flags.isSet(Flags.PARMODAUTO) then
+        /* Text for the loop body that calls the equations */
+        <<
+        #pragma omp parallel for private(id) schedule(<%match noProc() case 0 then "dynamic" else "static"%>)
+        for(id=0; id<<%nFuncs%>; id++) {
+          function<%name%>_systems[id](data, threadData);
+        }
+        >>
+      else
+        /* the partitions are independent, the runtime may evaluate them concurrently (-parallelSystems) */
+        <<
+        evaluateParallelSystems(data, threadData, <%nFuncs%>, function<%name%>_systems);
+        >>
     /* Text before the function head */
     <<
     <%funcs%>
@@ -3797,8 +3805,29 @@ template functionZeroCrossing(list<ZeroCrossing> zeroCrossings, list<SimEqSystem
       ;separator="\n")
   let forwardEqs = equationsForZeroCrossings |> eq => equationForward_(eq,contextSimulationNonDiscrete,modelNamePrefix); separator="\n"
 
-  let &varDecls2 = buffer ""
-  let zeroCrossingsCode = zeroCrossingsTpl(zeroCrossings, &varDecls2, &auxFunction)
+  let zeroCrossingsCode = zeroCrossingsTpl(zeroCrossings, modelNamePrefix, &auxFunction)
+  let nZeroCrossings = listLength(zeroCrossings)
+  let loopVarDecl = match zeroCrossings
+             case {} then ""
+             else "long i;"
+  let evalZeroCrossings = match zeroCrossings
+             case {} then ""
+             else
+               <<
+               for(i=0; i<<%nZeroCrossings%>; i++)
+               {
+                 <%symbolName(modelNamePrefix,"zeroCrossingFunctions")%>[i](data, threadData, gout);
+               }
+               >>
+  let evalZeroCrossingsSubset = match zeroCrossings
+             case {} then ""
+             else
+               <<
+               for(i=0; i<n; i++)
+               {
+                 <%symbolName(modelNamePrefix,"zeroCrossingFunctions")%>[indexes[i]](data, threadData, gout);
+               }
+               >>
 
   let resDesc = (zeroCrossings |> ZERO_CROSSING(__) => '"<%Util.escapeModelicaStringToCString(ExpressionDump.printExpStr(relation_))%>"'
     ;separator=",\n")
@@ -3844,14 +3873,29 @@ template functionZeroCrossing(list<ZeroCrossing> zeroCrossings, list<SimEqSystem
     return 0;
   }
 
+  <%zeroCrossingsCode%>
+
   int <%symbolName(modelNamePrefix,"function_ZeroCrossings")%>(DATA *data, threadData_t *threadData, double *gout)
   {
     TRACE_PUSH
-    <%varDecls2%>
+    <%loopVarDecl%>
 
     data->simulationInfo->callStatistics.functionZeroCrossings++;
 
-    <%zeroCrossingsCode%>
+    <%evalZeroCrossings%>
+
+    TRACE_POP
+    return 0;
+  }
+
+  int <%symbolName(modelNamePrefix,"function_ZeroCrossingsSubset")%>(DATA *data, threadData_t *threadData, double *gout, const long *indexes, long n)
+  {
+    TRACE_PUSH
+    <%loopVarDecl%>
+
+    data->simulationInfo->callStatistics.functionZeroCrossings++;
+
+    <%evalZeroCrossingsSubset%>
 
     TRACE_POP
     return 0;
@@ -3859,12 +3903,31 @@ template functionZeroCrossing(list<ZeroCrossing> zeroCrossings, list<SimEqSystem
   >>
 end functionZeroCrossing;
 
-template zeroCrossingsTpl(list<ZeroCrossing> zeroCrossings, Text &varDecls, Text &auxFunction)
- "Generates code for zero crossings."
+template zeroCrossingsTpl(list<ZeroCrossing> zeroCrossings, String modelNamePrefix, Text &auxFunction)
+ "Generates a function for every zero crossing and the table of these functions,
+  so that the root finding can evaluate single zero crossings."
 ::=
-  (zeroCrossings |> ZERO_CROSSING(__) hasindex i0 =>
-    zeroCrossingTpl(i0, relation_, &varDecls, &auxFunction)
-  ;separator="\n";empty)
+  match zeroCrossings
+  case {} then ""
+  else
+    let fncs = (zeroCrossings |> ZERO_CROSSING(__) hasindex i0 =>
+      let &varDecls = buffer ""
+      let code = zeroCrossingTpl(i0, relation_, &varDecls, &auxFunction)
+      <<
+      static void <%symbolName(modelNamePrefix,"zeroCrossing")%>_<%i0%>(DATA *data, threadData_t *threadData, double *gout)
+      {
+        <%varDecls%>
+        <%code%>
+      }
+      >>
+    ;separator="\n\n")
+    <<
+    <%fncs%>
+
+    static void (*const <%symbolName(modelNamePrefix,"zeroCrossingFunctions")%>[])(DATA*, threadData_t*, double*) = {
+      <%zeroCrossings |> ZERO_CROSSING(__) hasindex i0 => '<%symbolName(modelNamePrefix,"zeroCrossing")%>_<%i0%>' ;separator=",\n"%>
+    };
+    >>
 end zeroCrossingsTpl;
 
 
@@ -3875,9 +3938,10 @@ template zeroCrossingTpl(Integer index1, Exp relation, Text &varDecls, Text &aux
   case exp as RELATION(__) then
     let &preExp = buffer ""
     let e1 = daeExp(exp, contextZeroCross, &preExp, &varDecls, &auxFunction)
+    let value = zeroCrossingValueTpl(exp, e1, &preExp, &varDecls, &auxFunction)
     <<
     <%preExp%>
-    gout[<%index1%>] = (<%e1%>) ? 1 : -1;
+    gout[<%index1%>] = <%value%>;
     >>
   case (exp1 as LBINARY(__)) then
     let &preExp = buffer ""
@@ -3932,6 +3996,26 @@ template zeroCrossingTpl(Integer index1, Exp relation, Text &varDecls, Text &aux
     error(sourceInfo(), ' UNKNOWN ZERO CROSSING for <%index1%>')
 end zeroCrossingTpl;
 
+template zeroCrossingValueTpl(Exp relation, Text res, Text &preExp, Text &varDecls, Text &auxFunction)
+ "Generates the value of a relation zero crossing. For relations of reals the
+  magnitude is the distance of the operands, so the root finding can interpolate;
+  the sign always tells whether the relation holds."
+::=
+  match relation
+  case rel as RELATION(optionExpisASUB=NONE()) then
+    let isReal = if isRealType(typeof(rel.exp1)) then (if isRealType(typeof(rel.exp2)) then 'true' else '') else ''
+    if isReal then
+      let e1 = daeExp(rel.exp1, contextZeroCross, &preExp, &varDecls, &auxFunction)
+      let e2 = daeExp(rel.exp2, contextZeroCross, &preExp, &varDecls, &auxFunction)
+      match rel.operator
+      case LESS(__) case LESSEQ(__) then 'ZEROCROSSING_VALUE(<%res%>, (<%e2%>) - (<%e1%>))'
+      case GREATER(__) case GREATEREQ(__) then 'ZEROCROSSING_VALUE(<%res%>, (<%e1%>) - (<%e2%>))'
+      else '(<%res%>) ? 1 : -1'
+      end match
+    else '(<%res%>) ? 1 : -1'
+  else '(<%res%>) ? 1 : -1'
+end zeroCrossingValueTpl;
+
 template functionRelations(list<ZeroCrossing> relations, String modelNamePrefix) "template functionRelations
   Generates function in simulation file.
   This is a helper of template simulationFile."
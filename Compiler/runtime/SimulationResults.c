@@ -1,4 +1,6 @@
 #include "read_matlab4.h"
+#include "read_omz.h"
+#include "read_wall.h"
 #include "write_matlab4.h"
 #include <stdint.h>
 #include <string.h>
@@ -24,9 +26,11 @@ typedef enum {
   UNKNOWN_PLOT=0,
   MATLAB4,
   PLT,
-  CSV
+  CSV,
+  OMZ,
+  WALL
 } PlotFormat;
-const char *PlotFormatStr[] = {"Unknown","MATLAB4","PLT","CSV"};
+const char *PlotFormatStr[] = {"Unknown","MATLAB4","PLT","CSV","OMZ","WALL"};
 
 typedef struct {
   PlotFormat curFormat;
@@ -37,6 +41,8 @@ typedef struct {
   ModelicaMatReader matReader;
   FILE *pltReader;
   struct csv_data *csvReader;
+  OMZReader omzReader;
+  WallReader wallReader;
 } SimulationResult_Globals;
 
 static SimulationResult_Globals simresglob = {
@@ -50,6 +56,8 @@ static void SimulationResultsImpl__close(SimulationResult_Globals* simresglob)
   case MATLAB4: omc_free_matlab4_reader(&simresglob->matReader); break;
   case PLT: fclose(simresglob->pltReader); break;
   case CSV: omc_free_csv_reader(simresglob->csvReader); simresglob->csvReader=NULL; break;
+  case OMZ: omc_free_omz_reader(&simresglob->omzReader); break;
+  case WALL: omc_free_wall_reader(&simresglob->wallReader); break;
   default: break;
   }
   simresglob->curFormat = UNKNOWN_PLOT;
@@ -82,6 +90,8 @@ static PlotFormat SimulationResultsImpl__openFile(const char *filename, Simulati
   else if (0 == strcmp(filename+len-4, ".mat")) format = MATLAB4;
   else if (0 == strcmp(filename+len-4, ".plt")) format = PLT;
   else if (0 == strcmp(filename+len-4, ".csv")) format = CSV;
+  else if (0 == strcmp(filename+len-4, ".omz")) format = OMZ;
+  else if (0 == strcmp(filename+len-5, ".wall")) format = WALL;
   else {
     msg[0] = filename;
     c_add_message(NULL,-1, ErrorType_scripting, ErrorLevel_error, gettext("Unknown result-file suffix of file '%s'"), msg, 1);
@@ -111,6 +121,20 @@ static PlotFormat SimulationResultsImpl__openFile(const char *filename, Simulati
       return UNKNOWN_PLOT;
     }
     break;
+  case OMZ:
+    if (0!=(msg[0]=omc_new_omz_reader(filename,&simresglob->omzReader))) {
+      msg[1] = filename;
+      c_add_message(NULL,-1, ErrorType_scripting, ErrorLevel_error, gettext("Failed to open simulation result %s: %s"), msg, 2);
+      return UNKNOWN_PLOT;
+    }
+    break;
+  case WALL:
+    if (0!=(msg[0]=omc_new_wall_reader(filename,&simresglob->wallReader))) {
+      msg[1] = filename;
+      c_add_message(NULL,-1, ErrorType_scripting, ErrorLevel_error, gettext("Failed to open simulation result %s: %s"), msg, 2);
+      return UNKNOWN_PLOT;
+    }
+    break;
   default:
     msg[0] = filename;
     c_add_message(NULL,-1, ErrorType_scripting, ErrorLevel_error, gettext("Failed to open simulation result %s"), msg, 1);
@@ -157,6 +181,50 @@ static double SimulationResultsImpl__val(const char *filename, const char *varna
     }
     return res;
   }
+  case OMZ: {
+    ModelicaMatVariable_t *var;
+    if (0 == (var=omc_omz_find_var(&simresglob->omzReader,varname))) {
+      msg[1] = varname;
+      msg[0] = filename;
+      c_add_message(NULL,-1, ErrorType_scripting, ErrorLevel_error, gettext("%s not found in %s\n"), msg, 2);
+      return NAN;
+    }
+    if (omc_omz_val(&res,&simresglob->omzReader,var,timeStamp)) {
+      char buf[64],buf2[64],buf3[64];
+      snprintf(buf,60,"%g",timeStamp);
+      snprintf(buf2,60,"%g",omc_omz_startTime(&simresglob->omzReader));
+      snprintf(buf3,60,"%g",omc_omz_stopTime(&simresglob->omzReader));
+      msg[3] = varname;
+      msg[2] = buf;
+      msg[1] = buf2;
+      msg[0] = buf3;
+      c_add_message(NULL,-1, ErrorType_scripting, ErrorLevel_error, gettext("%s not defined at time %s (startTime=%s, stopTime=%s)."), msg, 4);
+      return NAN;
+    }
+    return res;
+  }
+  case WALL: {
+    ModelicaMatVariable_t *var;
+    if (0 == (var=omc_wall_find_var(&simresglob->wallReader,varname))) {
+      msg[1] = varname;
+      msg[0] = filename;
+      c_add_message(NULL,-1, ErrorType_scripting, ErrorLevel_error, gettext("%s not found in %s\n"), msg, 2);
+      return NAN;
+    }
+    if (omc_wall_val(&res,&simresglob->wallReader,var,timeStamp)) {
+      char buf[64],buf2[64],buf3[64];
+      snprintf(buf,60,"%g",timeStamp);
+      snprintf(buf2,60,"%g",omc_wall_startTime(&simresglob->wallReader));
+      snprintf(buf3,60,"%g",omc_wall_stopTime(&simresglob->wallReader));
+      msg[3] = varname;
+      msg[2] = buf;
+      msg[1] = buf2;
+      msg[0] = buf3;
+      c_add_message(NULL,-1, ErrorType_scripting, ErrorLevel_error, gettext("%s not defined at time %s (startTime=%s, stopTime=%s)."), msg, 4);
+      return NAN;
+    }
+    return res;
+  }
   case PLT: {
     char *strToFind = (char*) malloc(strlen(varname)+30);
     char line[255];
@@ -212,6 +280,12 @@ static int SimulationResultsImpl__readSimulationResultSize(const char *filename,
   case MATLAB4: {
     return simresglob->matReader.nrows;
   }
+  case OMZ: {
+    return simresglob->omzReader.nrows;
+  }
+  case WALL: {
+    return simresglob->wallReader.nrows;
+  }
   case PLT: {
     size = read_ptolemy_dataset_size(filename);
     msg[0] = filename;
@@ -264,6 +338,24 @@ static void* SimulationResultsImpl__readVars(const char *filename, int readParam
     }
     return res;
   }
+  case OMZ: {
+    int i;
+    for (i=simresglob->omzReader.nall-1; i>=0; i--) {
+      if (readParameters || !simresglob->omzReader.allInfo[i].isParam) {
+        res = mmc_mk_cons(makeOMCStyle(simresglob->omzReader.allInfo[i].name, omcStyle),res);
+      }
+    }
+    return res;
+  }
+  case WALL: {
+    int i;
+    for (i=simresglob->wallReader.nall-1; i>=0; i--) {
+      if (readParameters || !simresglob->wallReader.allInfo[i].isParam) {
+        res = mmc_mk_cons(makeOMCStyle(simresglob->wallReader.allInfo[i].name, omcStyle),res);
+      }
+    }
+    return res;
+  }
   case PLT: {
     return read_ptolemy_variables(filename /* Assume it is in OMC style */);
   }
@@ -312,6 +404,38 @@ static void* SimulationResultsImpl__readVarsFilterAliases(const char *filename,
     free(vars);
     return res;
   }
+  case OMZ: {
+    void *res = mmc_mk_nil();
+    int i;
+    int *params = (int*) calloc(simresglob->omzReader.nparam+1,sizeof(int));
+    int *vars = (int*) calloc(simresglob->omzReader.nsignals+1,sizeof(int));
+    for (i=simresglob->omzReader.nall-1; i>=0; i--) {
+      ModelicaMatVariable_t *var = &simresglob->omzReader.allInfo[i];
+      int *seen = var->isParam ? params : vars;
+      if (0 >= var->index || seen[var->index]) continue; /* Negated aliases always have a real variable, so skip it */
+      seen[var->index] = 1;
+      res = mmc_mk_cons(mmc_mk_scon(var->name),res);
+    }
+    free(params);
+    free(vars);
+    return res;
+  }
+  case WALL: {
+    void *res = mmc_mk_nil();
+    int i;
+    int *params = (int*) calloc(simresglob->wallReader.nparam+1,sizeof(int));
+    int *vars = (int*) calloc(simresglob->wallReader.nsignals+1,sizeof(int));
+    for (i=simresglob->wallReader.nall-1; i>=0; i--) {
+      ModelicaMatVariable_t *var = &simresglob->wallReader.allInfo[i];
+      int *seen = var->isParam ? params : vars;
+      if (0 >= var->index || seen[var->index]) continue; /* Negated aliases always have a real variable, so skip it */
+      seen[var->index] = 1;
+      res = mmc_mk_cons(mmc_mk_scon(var->name),res);
+    }
+    free(params);
+    free(vars);
+    return res;
+  }
   default: return SimulationResultsImpl__readVars(filename, 0, 0, simresglob);
   }
 }
@@ -339,6 +463,19 @@ static void* SimulationResultsImpl__readDataset(const char *filename, void *vars
     }
     if (suggestReadAllVars) {
       omc_matlab4_read_all_vals(&simresglob->matReader);
+    } else {
+      /* Read all requested variables in a single pass over the file */
+      void *v;
+      int nvars = 0;
+      int *indexes = (int*) malloc(listLength(vars)*sizeof(int));
+      for (v = vars; MMC_NILHDR != MMC_GETHDR(v); v = MMC_CDR(v)) {
+        mat_var = omc_matlab4_find_var(&simresglob->matReader,MMC_STRINGDATA(MMC_CAR(v)));
+        if (mat_var != NULL && !mat_var->isParam) {
+          indexes[nvars++] = mat_var->index;
+        }
+      }
+      omc_matlab4_read_vals_multi(&simresglob->matReader, nvars, indexes, NULL);
+      free(indexes);
     }
     while (MMC_NILHDR != MMC_GETHDR(vars)) {
       var = MMC_STRINGDATA(MMC_CAR(vars));
@@ -362,6 +499,78 @@ static void* SimulationResultsImpl__readDataset(const char *filename, void *vars
     }
     return res;
   }
+  case OMZ: {
+    ModelicaMatVariable_t *omz_var;
+    OMZReader *reader = &simresglob->omzReader;
+    if (dimsize == 0) {
+      dimsize = reader->nrows;
+    } else if (reader->nrows != dimsize) {
+      fprintf(stderr, "dimsize: %d, rows %d\n", dimsize, reader->nrows);
+      c_add_message(NULL,-1, ErrorType_scripting, ErrorLevel_error, gettext("readDataset(...): Expected and actual dimension sizes do not match."), NULL, 0);
+      return NULL;
+    }
+    while (MMC_NILHDR != MMC_GETHDR(vars)) {
+      var = MMC_STRINGDATA(MMC_CAR(vars));
+      vars = MMC_CDR(vars);
+      omz_var = omc_omz_find_var(reader,var);
+      vals = NULL;
+      if (omz_var != NULL && !omz_var->isParam) {
+        vals = omc_omz_read_vals(reader,omz_var->index);
+      }
+      if (omz_var == NULL || (!omz_var->isParam && vals == NULL)) {
+        msg[0] = runningTestsuite ? SystemImpl__basename(filename) : filename;
+        msg[1] = var;
+        c_add_message(NULL,-1, ErrorType_scripting, ErrorLevel_error, gettext("Could not read variable %s in file %s."), msg, 2);
+        return NULL;
+      }
+      col=mmc_mk_nil();
+      if (omz_var->isParam) {
+        double value;
+        omc_omz_val(&value,reader,omz_var,0.0);
+        for (i=0;i<dimsize;i++) col=mmc_mk_cons(mmc_mk_rcon(value),col);
+      } else {
+        for (i=0;i<dimsize;i++) col=mmc_mk_cons(mmc_mk_rcon(vals[i]),col);
+      }
+      res = mmc_mk_cons(col,res);
+    }
+    return res;
+  }
+  case WALL: {
+    ModelicaMatVariable_t *wall_var;
+    WallReader *reader = &simresglob->wallReader;
+    if (dimsize == 0) {
+      dimsize = reader->nrows;
+    } else if (reader->nrows != dimsize) {
+      fprintf(stderr, "dimsize: %d, rows %d\n", dimsize, reader->nrows);
+      c_add_message(NULL,-1, ErrorType_scripting, ErrorLevel_error, gettext("readDataset(...): Expected and actual dimension sizes do not match."), NULL, 0);
+      return NULL;
+    }
+    while (MMC_NILHDR != MMC_GETHDR(vars)) {
+      var = MMC_STRINGDATA(MMC_CAR(vars));
+      vars = MMC_CDR(vars);
+      wall_var = omc_wall_find_var(reader,var);
+      vals = NULL;
+      if (wall_var != NULL && !wall_var->isParam) {
+        vals = omc_wall_read_vals(reader,wall_var->index);
+      }
+      if (wall_var == NULL || (!wall_var->isParam && vals == NULL)) {
+        msg[0] = runningTestsuite ? SystemImpl__basename(filename) : filename;
+        msg[1] = var;
+        c_add_message(NULL,-1, ErrorType_scripting, ErrorLevel_error, gettext("Could not read variable %s in file %s."), msg, 2);
+        return NULL;
+      }
+      col=mmc_mk_nil();
+      if (wall_var->isParam) {
+        double value;
+        omc_wall_val(&value,reader,wall_var,0.0);
+        for (i=0;i<dimsize;i++) col=mmc_mk_cons(mmc_mk_rcon(value),col);
+      } else {
+        for (i=0;i<dimsize;i++) col=mmc_mk_cons(mmc_mk_rcon(vals[i]),col);
+      }
+      res = mmc_mk_cons(col,res);
+    }
+    return res;
+  }
   case PLT: {
     return read_ptolemy_dataset(filename,vars,dimsize);
   }
@@ -392,6 +601,169 @@ static void* SimulationResultsImpl__readDataset(const char *filename, void *vars
   }
 }
 
+/* Reads the given variables as plain arrays of dimsize values, without
+ * building MetaModelica lists. The columns are malloc'ed and free'd by the
+ * caller; a variable that cannot be read gets a NULL column and reporting it
+ * is left to the caller. Returns the number of rows, or -1 on failure.
+ */
+static int SimulationResultsImpl__readDataColumns(const char *filename, int nvars, char **vars, int dimsize, int suggestReadAllVars, SimulationResult_Globals* simresglob, double **cols)
+{
+  const char *msg[1] = {""};
+  double *vals;
+  int i,j;
+  for (i=0; i<nvars; i++) {
+    cols[i] = NULL;
+  }
+  if (UNKNOWN_PLOT == SimulationResultsImpl__openFile(filename,simresglob)) {
+    return -1;
+  }
+  switch (simresglob->curFormat) {
+  case MATLAB4: {
+    ModelicaMatReader *reader = &simresglob->matReader;
+    ModelicaMatVariable_t **matVars;
+    int *indexes, nindexes = 0;
+    if (dimsize == 0) {
+      dimsize = reader->nrows;
+    } else if (reader->nrows != dimsize) {
+      fprintf(stderr, "dimsize: %d, rows %d\n", dimsize, reader->nrows);
+      c_add_message(NULL,-1, ErrorType_scripting, ErrorLevel_error, gettext("readDataset(...): Expected and actual dimension sizes do not match."), NULL, 0);
+      return -1;
+    }
+    matVars = (ModelicaMatVariable_t**) malloc(nvars*sizeof(ModelicaMatVariable_t*));
+    indexes = (int*) malloc(nvars*sizeof(int));
+    for (i=0; i<nvars; i++) {
+      matVars[i] = omc_matlab4_find_var(reader,vars[i]);
+      if (matVars[i] != NULL && !matVars[i]->isParam) {
+        indexes[nindexes++] = matVars[i]->index;
+      }
+    }
+    /* Read all requested variables in a single pass over the file */
+    if (suggestReadAllVars) {
+      omc_matlab4_read_all_vals(reader);
+    } else {
+      omc_matlab4_read_vals_multi(reader, nindexes, indexes, NULL);
+    }
+    for (i=0; i<nvars; i++) {
+      if (matVars[i] == NULL) {
+        continue;
+      }
+      if (matVars[i]->isParam) {
+        double value = reader->params[abs(matVars[i]->index)-1];
+        if (matVars[i]->index < 0) {
+          value = -value;
+        }
+        cols[i] = (double*) malloc(dimsize*sizeof(double));
+        for (j=0; j<dimsize; j++) {
+          cols[i][j] = value;
+        }
+      } else if ((vals = omc_matlab4_read_vals(reader,matVars[i]->index))) {
+        cols[i] = (double*) malloc(dimsize*sizeof(double));
+        memcpy(cols[i], vals, dimsize*sizeof(double));
+      }
+    }
+    free(indexes);
+    free(matVars);
+    return dimsize;
+  }
+  case OMZ: {
+    OMZReader *reader = &simresglob->omzReader;
+    if (dimsize == 0) {
+      dimsize = reader->nrows;
+    } else if (reader->nrows != dimsize) {
+      fprintf(stderr, "dimsize: %d, rows %d\n", dimsize, reader->nrows);
+      c_add_message(NULL,-1, ErrorType_scripting, ErrorLevel_error, gettext("readDataset(...): Expected and actual dimension sizes do not match."), NULL, 0);
+      return -1;
+    }
+    for (i=0; i<nvars; i++) {
+      ModelicaMatVariable_t *omz_var = omc_omz_find_var(reader,vars[i]);
+      if (omz_var == NULL) {
+        continue;
+      }
+      if (omz_var->isParam) {
+        double value;
+        omc_omz_val(&value,reader,omz_var,0.0);
+        cols[i] = (double*) malloc(dimsize*sizeof(double));
+        for (j=0; j<dimsize; j++) {
+          cols[i][j] = value;
+        }
+      } else if ((vals = omc_omz_read_vals(reader,omz_var->index))) {
+        cols[i] = (double*) malloc(dimsize*sizeof(double));
+        memcpy(cols[i], vals, dimsize*sizeof(double));
+      }
+    }
+    return dimsize;
+  }
+  case WALL: {
+    WallReader *reader = &simresglob->wallReader;
+    if (dimsize == 0) {
+      dimsize = reader->nrows;
+    } else if (reader->nrows != dimsize) {
+      fprintf(stderr, "dimsize: %d, rows %d\n", dimsize, reader->nrows);
+      c_add_message(NULL,-1, ErrorType_scripting, ErrorLevel_error, gettext("readDataset(...): Expected and actual dimension sizes do not match."), NULL, 0);
+      return -1;
+    }
+    for (i=0; i<nvars; i++) {
+      ModelicaMatVariable_t *wall_var = omc_wall_find_var(reader,vars[i]);
+      if (wall_var == NULL) {
+        continue;
+      }
+      if (wall_var->isParam) {
+        double value;
+        omc_wall_val(&value,reader,wall_var,0.0);
+        cols[i] = (double*) malloc(dimsize*sizeof(double));
+        for (j=0; j<dimsize; j++) {
+          cols[i][j] = value;
+        }
+      } else if ((vals = omc_wall_read_vals(reader,wall_var->index))) {
+        cols[i] = (double*) malloc(dimsize*sizeof(double));
+        memcpy(cols[i], vals, dimsize*sizeof(double));
+      }
+    }
+    return dimsize;
+  }
+  case CSV: {
+    if (dimsize == 0 && simresglob->csvReader) {
+      dimsize = simresglob->csvReader->numsteps;
+    }
+    for (i=0; i<nvars; i++) {
+      vals = simresglob->csvReader ? read_csv_dataset(simresglob->csvReader,vars[i]) : NULL;
+      if (vals) {
+        cols[i] = (double*) malloc(dimsize*sizeof(double));
+        memcpy(cols[i], vals, dimsize*sizeof(double));
+      }
+    }
+    return dimsize;
+  }
+  case PLT: {
+    if (dimsize == 0) {
+      dimsize = read_ptolemy_dataset_size(filename);
+    }
+    /* The ptolemy reader scans the file for every variable anyway */
+    for (i=0; i<nvars; i++) {
+      void *col, *dataset = read_ptolemy_dataset(filename,mmc_mk_cons(mmc_mk_scon(vars[i]),mmc_mk_nil()),dimsize);
+      if (dataset == NULL || MMC_NILHDR == MMC_GETHDR(dataset)) {
+        continue;
+      }
+      cols[i] = (double*) malloc(dimsize*sizeof(double));
+      /* The list holds the values in reverse order */
+      j = dimsize;
+      for (col = MMC_CAR(dataset); MMC_NILHDR != MMC_GETHDR(col) && j > 0; col = MMC_CDR(col)) {
+        cols[i][--j] = mmc_prim_get_real(MMC_CAR(col));
+      }
+      if (j != 0) {
+        free(cols[i]);
+        cols[i] = NULL;
+      }
+    }
+    return dimsize;
+  }
+  default:
+    msg[0] = PlotFormatStr[simresglob->curFormat];
+    c_add_message(NULL,-1, ErrorType_scripting, ErrorLevel_error, gettext("readDataSet() not implemented for plot format: %s\n"), msg, 1);
+    return -1;
+  }
+}
+
 static inline int failedToWriteToFile(const char *file)
 {
   c_add_message(NULL,-1, ErrorType_scripting, ErrorLevel_error, gettext("Failed to write to file %s."), &file, 1);
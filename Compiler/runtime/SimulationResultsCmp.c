@@ -34,6 +34,7 @@
 #include <errno.h>
 #include <string.h>
 #include <assert.h>
+#include <pthread.h>
 
 #include "systemimpl.h"
 
@@ -159,7 +160,11 @@ static char almostEqualWithDefaultTolerance(double a, double b)
   return almostEqualRelativeAndAbs(a,b,DOUBLEEQUAL_REL,DOUBLEEQUAL_TOTAL);
 }
 
-static unsigned int cmpData(int isResultCmp, char* varname, DataField *time, DataField *reftime, DataField *data, DataField *refdata, double reltol, double abstol, DiffDataField *ddf, char **cmpdiffvars, unsigned int vardiffindx, int keepEqualResults, void **diffLst, const char *prefix)
+/* Compares one variable; the differing points are appended to ddf.
+ * Returns 1 if the variable differs from the reference.
+ * Only touches its arguments, so variables can be compared in parallel.
+ */
+static char cmpData(int isResultCmp, char* varname, DataField *time, DataField *reftime, DataField *data, DataField *refdata, double reltol, double abstol, DiffDataField *ddf, int keepEqualResults, const char *prefix)
 {
   unsigned int i,j,k,j_event;
   double t,tr,d,dr,err,d_left,d_right,dr_left,dr_right,t_event;
@@ -470,13 +475,6 @@ static unsigned int cmpData(int isResultCmp, char* varname, DataField *time, Dat
       }
     }
   }
-  if (isdifferent) {
-    cmpdiffvars[vardiffindx] = varname;
-    vardiffindx++;
-    if (!isResultCmp) {
-      *diffLst = mmc_mk_cons(mmc_mk_scon(varname),*diffLst);
-    }
-  }
   if (fout) {
     fclose(fout);
   }
@@ -486,30 +484,34 @@ static unsigned int cmpData(int isResultCmp, char* varname, DataField *time, Dat
   if (fname) {
     free(fname);
   }
-  return vardiffindx;
+  return isdifferent;
 }
 
-static int writeLogFile(const char *filename,DiffDataField *ddf,const char *f,const char *reff,double reltol,double abstol)
+/* The difference log is written while the variables are merged, so the
+ * differing points of a variable are free'd as soon as it is compared. */
+static FILE* openLogFile(const char *filename,const char *f,const char *reff,double reltol,double abstol)
 {
   FILE* fout;
-  unsigned int i;
-  /* fprintf(stderr, "writeLogFile: %s\n",filename); */
+  /* fprintf(stderr, "openLogFile: %s\n",filename); */
   fout = fopen(filename, "w");
   if (!fout)
-    return -1;
+    return NULL;
 
   fprintf(fout, "\"Generated by OpenModelica\";;;;;\n");
   fprintf(fout, "\"Compared Files\";;;\"absolute tolerance\";%.15g;relative tolerance;%.15g\n",abstol,reltol);
   fprintf(fout, "\"%s\";;;;;;\n",f);
   fprintf(fout, "\"%s\";;;;;;\n",reff);
   fprintf(fout, "\"Name\";\"Time\";\"DataPoint\";\"RefTime\";\"RefDataPoint\";\"absolute error\";\"relative error\";interpolate;\n");
+  return fout;
+}
+
+static void writeLogData(FILE *fout,DiffDataField *ddf)
+{
+  unsigned int i;
   for (i=0;i<ddf->n;i++){
     fprintf(fout, "%s;%.15g;%.15g;%.15g;%.15g;%.15g;%.15g;%c;\n",ddf->data[i].name,ddf->data[i].time,ddf->data[i].data,ddf->data[i].timeref,ddf->data[i].dataref,
       fabs(ddf->data[i].data-ddf->data[i].dataref),fabs((ddf->data[i].data-ddf->data[i].dataref)/ddf->data[i].dataref),ddf->data[i].interpolate);
   }
-  fclose(fout);
-  /* fprintf(stderr, "writeLogFile: %s finished\n",filename); */
-  return 0;
 }
 
 static const char* getTimeVarName(void *vars) {
@@ -528,25 +530,206 @@ static const char* getTimeVarName(void *vars) {
 
 #include "SimulationResultsCmpTubes.c"
 
+/* Number of variables read in one pass over the result files */
+#define CMP_BLOCK_SIZE 64
+/* Maximum number of variables read but not yet merged into the result */
+#define CMP_MAX_PENDING 256
+#define CMP_MAX_THREADS 16
+
+typedef struct {
+  char *var;        /* the name as given by the caller */
+  char *name;       /* the name without quotes, as looked up in the files */
+  DataField data;
+  DataField dataref;
+  DiffDataField ddf;
+  char *html;
+  char failed;      /* 1 if the reference could not be read, 2 if the actual data could not be read,
+                     * 3 if there was not enough memory to compare them */
+  char isdifferent;
+  char done;
+} CmpTask;
+
+/* The variables are compared by a pool of worker threads while the main
+ * thread reads the next block of columns. Workers only touch their own task;
+ * the results are merged on the main thread in the order of the variables,
+ * so the messages, the log and the returned list do not depend on the
+ * scheduling.
+ */
+typedef struct {
+  int isResultCmp;
+  int isHtml;
+  int keepEqualResults;
+  double reltol, abstol, reltolDiffMaxMin, rangeDelta;
+  const char *prefix;
+  DataField *time, *timeref;
+  CmpTask *tasks;
+  unsigned int nready; /* the data of the tasks below nready has been read */
+  unsigned int next;   /* the next task to be compared */
+  int stop;
+  int nthreads;
+  pthread_t *threads;
+  pthread_mutex_t mutex;
+  pthread_cond_t work;
+  pthread_cond_t done;
+  tubeArena arena;     /* scratch space when comparing on the calling thread */
+} CmpPool;
+
+static void cmpRunTask(CmpPool *pool, CmpTask *task, tubeArena *arena)
+{
+  /* the tubes need the scratch space of the arena */
+  if (!task->failed && (pool->isHtml || !pool->isResultCmp) && !tubeArenaReserve(arena, pool->timeref->n)) {
+    task->failed = 3;
+    task->isdifferent = 1;
+  }
+  if (!task->failed) {
+    if (pool->isHtml) {
+      task->isdifferent = cmpDataTubes(arena,pool->isResultCmp,task->var,pool->time,pool->timeref,&task->data,&task->dataref,pool->reltol,pool->rangeDelta,pool->reltolDiffMaxMin,&task->ddf,pool->keepEqualResults,pool->prefix,1,&task->html);
+    } else if (pool->isResultCmp) {
+      task->isdifferent = cmpData(pool->isResultCmp,task->var,pool->time,pool->timeref,&task->data,&task->dataref,pool->reltol,pool->abstol,&task->ddf,pool->keepEqualResults,pool->prefix);
+    } else {
+      task->isdifferent = cmpDataTubes(arena,pool->isResultCmp,task->var,pool->time,pool->timeref,&task->data,&task->dataref,pool->reltol,pool->rangeDelta,pool->reltolDiffMaxMin,&task->ddf,pool->keepEqualResults,pool->prefix,0,0);
+    }
+  }
+  /* The columns are not needed any more */
+  if (task->data.data) free(task->data.data);
+  if (task->dataref.data) free(task->dataref.data);
+  task->data.data = NULL;
+  task->dataref.data = NULL;
+}
+
+static void* cmpWorkerThread(void *arg)
+{
+  CmpPool *pool = (CmpPool*) arg;
+  tubeArena arena = {NULL,NULL,0};
+  while (1) {
+    CmpTask *task;
+    pthread_mutex_lock(&pool->mutex);
+    while (pool->next >= pool->nready && !pool->stop) {
+      pthread_cond_wait(&pool->work, &pool->mutex);
+    }
+    if (pool->next >= pool->nready) {
+      pthread_mutex_unlock(&pool->mutex);
+      break;
+    }
+    task = pool->tasks + pool->next++;
+    pthread_mutex_unlock(&pool->mutex);
+    cmpRunTask(pool, task, &arena);
+    pthread_mutex_lock(&pool->mutex);
+    task->done = 1;
+    pthread_cond_signal(&pool->done);
+    pthread_mutex_unlock(&pool->mutex);
+  }
+  tubeArenaFree(&arena);
+  return NULL;
+}
+
+static void cmpStartPool(CmpPool *pool, int nthreads)
+{
+  int i;
+  pool->nthreads = 0;
+  pool->threads = NULL;
+  if (nthreads < 2) {
+    return;
+  }
+  pthread_mutex_init(&pool->mutex,NULL);
+  pthread_cond_init(&pool->work,NULL);
+  pthread_cond_init(&pool->done,NULL);
+  pool->threads = (pthread_t*) GC_malloc(sizeof(pthread_t)*nthreads);
+  for (i=0; i<nthreads; i++) {
+    if (GC_pthread_create(&pool->threads[i],NULL,cmpWorkerThread,pool)) {
+      break;
+    }
+    pool->nthreads++;
+  }
+  if (pool->nthreads == 0) {
+    /* Compare the variables on the calling thread */
+    pthread_mutex_destroy(&pool->mutex);
+    pthread_cond_destroy(&pool->work);
+    pthread_cond_destroy(&pool->done);
+    GC_free(pool->threads);
+    pool->threads = NULL;
+  }
+}
+
+static void cmpStopPool(CmpPool *pool)
+{
+  int i;
+  tubeArenaFree(&pool->arena);
+  if (pool->nthreads == 0) {
+    return;
+  }
+  pthread_mutex_lock(&pool->mutex);
+  pool->stop = 1;
+  pthread_cond_broadcast(&pool->work);
+  pthread_mutex_unlock(&pool->mutex);
+  for (i=0; i<pool->nthreads; i++) {
+    GC_pthread_join(pool->threads[i], NULL);
+  }
+  pthread_mutex_destroy(&pool->mutex);
+  pthread_cond_destroy(&pool->work);
+  pthread_cond_destroy(&pool->done);
+  GC_free(pool->threads);
+}
+
+/* Makes the tasks below nready available to the workers */
+static void cmpPublishTasks(CmpPool *pool, unsigned int nready)
+{
+  if (pool->nthreads == 0) {
+    pool->nready = nready;
+    return;
+  }
+  pthread_mutex_lock(&pool->mutex);
+  pool->nready = nready;
+  pthread_cond_broadcast(&pool->work);
+  pthread_mutex_unlock(&pool->mutex);
+}
+
+/* Returns the given task once it is compared; NULL if it is still pending
+ * and wait is 0. Without workers, the task is compared right away.
+ */
+static CmpTask* cmpWaitTask(CmpPool *pool, unsigned int i, int wait)
+{
+  CmpTask *task = pool->tasks + i;
+  int done;
+  if (pool->nthreads == 0) {
+    if (!task->done) {
+      cmpRunTask(pool, task, &pool->arena);
+      task->done = 1;
+    }
+    return task;
+  }
+  pthread_mutex_lock(&pool->mutex);
+  while (wait && !task->done) {
+    pthread_cond_wait(&pool->done, &pool->mutex);
+  }
+  done = task->done;
+  pthread_mutex_unlock(&pool->mutex);
+  return done ? task : NULL;
+}
+
 /* Common, huge function, for both result comparison and result diff */
 void* SimulationResultsCmp_compareResults(int isResultCmp, int runningTestsuite, const char *filename, const char *reffilename, const char *resultfilename, double reltol, double abstol, double reltolDiffMaxMin, double rangeDelta, void *vars, int keepEqualResults, int *success, int isHtml, char **htmlOut)
 {
   char **cmpvars=NULL;
   char **cmpdiffvars=NULL;
+  char **names=NULL;
+  double *cols[CMP_BLOCK_SIZE], *colsref[CMP_BLOCK_SIZE];
   unsigned int vardiffindx=0;
   unsigned int ncmpvars = 0;
   unsigned int ngetfailedvars = 0;
+  unsigned int ndiffpoints = 0;
+  unsigned int merged = 0;
   void *allvars,*allvarsref,*res;
-  unsigned int i,size,size_ref,len,j,k;
-  char *var,*var1,*var2;
-  DataField time,timeref,data,dataref;
-  DiffDataField ddf;
+  unsigned int i,size,size_ref,len,j,k,start,end;
+  int rows,rowsref,nthreads;
+  char *var;
+  DataField time,timeref;
+  CmpTask *tasks=NULL,*task;
+  CmpPool pool;
+  FILE *logFile = NULL;
   const char *msg[2] = {"",""};
   const char *timeVarName, *timeVarNameRef;
   int suggestReadAll=0;
-  ddf.data=NULL;
-  ddf.n=0;
-  ddf.n_max=0;
   len = 1;
 
   /* open files */
@@ -617,87 +800,112 @@ void* SimulationResultsCmp_compareResults(int isResultCmp, int runningTestsuite,
     "File[%d]=%f\n",timeref.n,timeref.data[timeref.n-1],time.n,time.data[time.n-1]);
     c_add_message(NULL,-1, ErrorType_scripting, ErrorLevel_warning, buf, NULL, 0);
   }
-  var1=NULL;
-  var2=NULL;
-  /* compare vars */
-  /* fprintf(stderr, "compare vars\n"); */
+  /* the names as they are looked up in the files */
+  tasks = (CmpTask*) calloc(ncmpvars, sizeof(CmpTask));
+  names = (char**) GC_malloc(sizeof(char*)*ncmpvars);
   for (i=0;i<ncmpvars;i++) {
     var = cmpvars[i];
     len = strlen(var);
-    if (var1) {
-      free(var1);
-      var1 = NULL;
-    }
-    var1 = (char*) GC_malloc(len+10);
+    names[i] = (char*) GC_malloc_atomic(len+1);
     k = 0;
     for (j=0;j<len;j++) {
       if (var[j] !='\"' ) {
-        var1[k] = var[j];
+        names[i][k] = var[j];
         k +=1;
       }
     }
-    var1[k] = 0;
-    /* fprintf(stderr, "compare var: %s\n",var); */
-    /* check if in ref_file */
-    dataref = getData(var1,reffilename,size_ref,suggestReadAll,&simresglob_ref,runningTestsuite);
-    if (dataref.n==0) {
-      if (dataref.data) {
-        free(dataref.data);
+    names[i][k] = 0;
+    tasks[i].var = var;
+    tasks[i].name = names[i];
+  }
+  if (isResultCmp) {
+    logFile = openLogFile(resultfilename,filename,reffilename,reltol,abstol);
+  }
+
+  memset(&pool, 0, sizeof(CmpPool));
+  pool.isResultCmp = isResultCmp;
+  pool.isHtml = isHtml;
+  pool.keepEqualResults = keepEqualResults;
+  pool.reltol = reltol;
+  pool.abstol = abstol;
+  pool.reltolDiffMaxMin = reltolDiffMaxMin;
+  pool.rangeDelta = rangeDelta;
+  pool.prefix = resultfilename;
+  pool.time = &time;
+  pool.timeref = &timeref;
+  pool.tasks = tasks;
+  nthreads = System_numProcessors();
+  if (nthreads > CMP_MAX_THREADS) nthreads = CMP_MAX_THREADS;
+  if (nthreads > ncmpvars) nthreads = ncmpvars;
+  cmpStartPool(&pool, nthreads);
+
+  /* compare vars */
+  /* fprintf(stderr, "compare vars\n"); */
+  for (start=0;start<ncmpvars;start=end) {
+    end = start + CMP_BLOCK_SIZE < ncmpvars ? start + CMP_BLOCK_SIZE : ncmpvars;
+    /* read the whole block in a single pass over each file */
+    rowsref = SimulationResultsImpl__readDataColumns(reffilename,end-start,names+start,size_ref,suggestReadAll,&simresglob_ref,colsref);
+    rows = SimulationResultsImpl__readDataColumns(filename,end-start,names+start,size,suggestReadAll,&simresglob_c,cols);
+    for (i=start;i<end;i++) {
+      task = tasks+i;
+      task->dataref.data = colsref[i-start];
+      task->dataref.n = rowsref > 0 ? rowsref : 0;
+      task->data.data = cols[i-start];
+      task->data.n = rows > 0 ? rows : 0;
+      task->failed = !task->dataref.data || !task->dataref.n ? 1 : !task->data.data || !task->data.n ? 2 : 0;
+    }
+    cmpPublishTasks(&pool, end);
+
+    /* merge the compared variables in order; wait if too many are pending */
+    while (merged < end && (task = cmpWaitTask(&pool, merged, end == ncmpvars || end-merged > CMP_MAX_PENDING))) {
+      merged++;
+      if (task->failed == 3) {
+        /* not compared, it counts as different */
+        msg[0] = task->var;
+        c_add_message(NULL,-1, ErrorType_scripting, ErrorLevel_error, gettext("Not enough memory to compare variable %s."), msg, 1);
+      } else if (task->failed) {
+        const char *failedfile = task->failed == 1 ? reffilename : filename;
+        msg[0] = runningTestsuite ? SystemImpl__basename(failedfile) : failedfile;
+        if ((task->failed == 1 ? task->dataref.n : task->data.n) > 0) {
+          /* the file was read, but the variable is not in it */
+          msg[1] = task->name;
+          c_add_message(NULL,-1, ErrorType_scripting, ErrorLevel_error, gettext("Could not read variable %s in file %s."), msg, 2);
+        }
+        msg[1] = task->var;
+        c_add_message(NULL,-1, ErrorType_scripting, ErrorLevel_warning, gettext("Get data of variable %s from file %s failed!\n"), msg, 2);
+        ngetfailedvars++;
+        continue;
+      }
+      if (task->isdifferent) {
+        cmpdiffvars[vardiffindx++] = task->var;
+        if (!isResultCmp) {
+          res = mmc_mk_cons(mmc_mk_scon(task->var),res);
+        }
       }
-      if (var1) {
-        GC_free(var1);
-        var1 = NULL;
+      if (task->html) {
+        *htmlOut = task->html;
       }
-      msg[0] = runningTestsuite ? SystemImpl__basename(reffilename) : reffilename;
-      msg[1] = var;
-      c_add_message(NULL,-1, ErrorType_scripting, ErrorLevel_warning, gettext("Get data of variable %s from file %s failed!\n"), msg, 2);
-      ngetfailedvars++;
-      continue;
-    }
-    /*  check if in file */
-    data = getData(var1,filename,size,suggestReadAll,&simresglob_c,runningTestsuite);
-    if (data.n==0)  {
-      if (data.data) {
-        free(data.data);
+      if (logFile) {
+        writeLogData(logFile,&task->ddf);
       }
-      if (var1) {
-        GC_free(var1);
-        var1 = NULL;
+      ndiffpoints += task->ddf.n;
+      if (task->ddf.data) {
+        free(task->ddf.data);
+        task->ddf.data = NULL;
       }
-      msg[0] = runningTestsuite ? SystemImpl__basename(filename) : filename;
-      msg[1] = var;
-      c_add_message(NULL,-1, ErrorType_scripting, ErrorLevel_warning, gettext("Get data of variable %s from file %s failed!\n"), msg, 2);
-      ngetfailedvars++;
-      continue;
-    }
-    /* compare */
-    if (isHtml) {
-      vardiffindx = cmpDataTubes(isResultCmp,var,&time,&timeref,&data,&dataref,reltol,rangeDelta,reltolDiffMaxMin,&ddf,cmpdiffvars,vardiffindx,keepEqualResults,&res,resultfilename,1,htmlOut);
-    } else if (isResultCmp) {
-      vardiffindx = cmpData(isResultCmp,var,&time,&timeref,&data,&dataref,reltol,abstol,&ddf,cmpdiffvars,vardiffindx,keepEqualResults,&res,resultfilename);
-    } else {
-      vardiffindx = cmpDataTubes(isResultCmp,var,&time,&timeref,&data,&dataref,reltol,rangeDelta,reltolDiffMaxMin,&ddf,cmpdiffvars,vardiffindx,keepEqualResults,&res,resultfilename,0,0);
-    }
-    /* free */
-    if (dataref.data) {
-      free(dataref.data);
-    }
-    if (data.data) {
-      free(data.data);
-    }
-    if (var1) {
-      GC_free(var1);
-      var1 = NULL;
     }
   }
+  cmpStopPool(&pool);
 
   if (isResultCmp) {
-    if (writeLogFile(resultfilename,&ddf,filename,reffilename,reltol,abstol)) {
+    if (logFile) {
+      fclose(logFile);
+    } else {
       c_add_message(NULL,-1, ErrorType_scripting, ErrorLevel_warning, gettext("Cannot write to the difference (.csv) file!\n"), msg, 0);
     }
 
-    if ((ddf.n > 0) || (ngetfailedvars > 0) || vardiffindx > 0){
-      /* fprintf(stderr, "diff: %d\n",ddf.n); */
+    if ((ndiffpoints > 0) || (ngetfailedvars > 0) || vardiffindx > 0){
+      /* fprintf(stderr, "diff: %d\n",ndiffpoints); */
       /* for (i=0;i<vardiffindx;i++)
       fprintf(stderr, "diffVar: %s\n",cmpdiffvars[i]); */
       for (i=0;i<vardiffindx;i++){
@@ -710,13 +918,12 @@ void* SimulationResultsCmp_compareResults(int isResultCmp, int runningTestsuite,
     }
   } else {
     if (success) {
-      *success = ((ddf.n == 0) && (vardiffindx == 0));
+      *success = ((ndiffpoints == 0) && (vardiffindx == 0));
     }
   }
 
-  // if (var1) free(var1);
-  // if (var2) free(var2);
-  if (ddf.data) free(ddf.data);
+  if (tasks) free(tasks);
+  if (names) GC_free(names);
   if (cmpvars) GC_free(cmpvars);
   if (time.data) free(time.data);
   if (timeref.data) free(timeref.data);
@@ -727,4 +934,3 @@ void* SimulationResultsCmp_compareResults(int isResultCmp, int runningTestsuite,
 
   return res;
 }
-
@@ -75,15 +75,118 @@ typedef struct {
   size_t countLow,countHigh,length;
 } privates;
 
+/* The series of the tube comparison of one variable */
+enum {
+  TUBE_TIME = 0, /* private copy of the reference time; calculateTubes moves jumps apart */
+  TUBE_MH,
+  TUBE_ML,
+  TUBE_XHIGH,
+  TUBE_XLOW,
+  TUBE_YHIGH,
+  TUBE_YLOW,
+  TUBE_CALIBRATED,
+  TUBE_HIGH,
+  TUBE_LOW,
+  TUBE_ERROR,
+  TUBE_NUM_VALUES
+};
+#define TUBE_NUM_INDEXES 4
+
+/* Scratch space for comparing one variable at a time. The buffers only
+ * grow, so comparing many signals of similar length does not allocate
+ * after the first one. Every comparison thread has its own arena.
+ */
+typedef struct {
+  double *values;
+  int *indexes;
+  size_t capacity;
+} tubeArena;
+
+/* makes room for series of the given length; returns 0 if out of memory */
+static int tubeArenaReserve(tubeArena *arena, size_t length)
+{
+  if (length <= arena->capacity) {
+    return 1;
+  }
+  free(arena->values);
+  free(arena->indexes);
+  arena->capacity = length + length/4;
+  arena->values = (double*) malloc(TUBE_NUM_VALUES*arena->capacity*sizeof(double));
+  arena->indexes = (int*) malloc(TUBE_NUM_INDEXES*arena->capacity*sizeof(int));
+  if (!arena->values || !arena->indexes) {
+    free(arena->values);
+    free(arena->indexes);
+    arena->values = NULL;
+    arena->indexes = NULL;
+    arena->capacity = 0;
+    return 0;
+  }
+  return 1;
+}
+
+static inline double* tubeArenaValues(tubeArena *arena, int series)
+{
+  return arena->values + series*arena->capacity;
+}
+
+static void tubeArenaFree(tubeArena *arena)
+{
+  free(arena->values);
+  free(arena->indexes);
+  arena->values = NULL;
+  arena->indexes = NULL;
+  arena->capacity = 0;
+}
+
 static inline int intmax(int a, int b) {
   return a>b ? a : b;
 }
 
+/* fmax and fmin (a NaN argument is ignored) as plain comparisons, which
+ * the compiler can turn into vector instructions instead of library calls */
+static inline double tubeMax(double a, double b) {
+  return (a > b || b != b) ? a : b;
+}
+
+static inline double tubeMin(double a, double b) {
+  return (a < b || b != b) ? a : b;
+}
+
+/* almostEqualRelativeAndAbs(a,b,0,xabstol), inlined for the time axis */
+static inline int sameTime(double a, double b, double xabstol)
+{
+  double diff = fabs(a - b);
+  return diff <= xabstol || diff == 0;
+}
+
+/* The minimum and maximum of y, using independent accumulators */
+static void minMaxKernel(const double *y, size_t length, double *min, double *max)
+{
+  double mn[4], mx[4];
+  size_t i, k;
+  for (k=0; k<4; k++) {
+    mn[k] = mx[k] = y[0];
+  }
+  for (i=1; i+4<=length; i+=4) {
+    for (k=0; k<4; k++) {
+      mx[k] = tubeMax(y[i+k], mx[k]);
+      mn[k] = tubeMin(y[i+k], mn[k]);
+    }
+  }
+  for (; i<length; i++) {
+    mx[0] = tubeMax(y[i], mx[0]);
+    mn[0] = tubeMin(y[i], mn[0]);
+  }
+  *max = tubeMax(tubeMax(mx[0], mx[1]), tubeMax(mx[2], mx[3]));
+  *min = tubeMin(tubeMin(mn[0], mn[1]), tubeMin(mn[2], mn[3]));
+}
+
 static void generateHighTube(privates *priv, double *x, double *y)
 {
   int index = priv->countHigh - 1;
   double m1 = priv->mh[index];
   double m2 = priv->mh[index - 1];
+  double S2 = priv->S * priv->S;
   priv->slopeDif = fabs(m1 - m2);    // (3.2.6.2)
 
   if ((priv->slopeDif == 0) || ((priv->slopeDif < 2e-15 * fmax(fabs(m1), fabs(m2))) && (priv->i0h[priv->countHigh - 1] - priv->i1h[priv->countHigh - 2] < 100))) {
@@ -106,16 +209,18 @@ static void generateHighTube(privates *priv, double *x, double *y)
     priv->mh[index - 1] = (y3 - y4) / (x3 - x4);
 
   } else { /* If difference is too big:  ( 3.2.6.4) */
-    priv->xHigh[index] = priv->x2 - (priv->delta * (m1 + m2) / (sqrt((m2 * m2) + (priv->S * priv->S)) + sqrt((m1 * m1) + (priv->S * priv->S))));
+    /* m1 stays the same from here on */
+    double r1 = sqrt((m1 * m1) + S2), r2 = sqrt((m2 * m2) + S2);
+    priv->xHigh[index] = priv->x2 - (priv->delta * (m1 + m2) / (r2 + r1));
     if (m1 * m2 < 0) {
-      priv->yHigh[index] = priv->y2 + (priv->delta * (m1 * sqrt((m2 * m2) + (priv->S * priv->S)) - m2 * sqrt((m1 * m1) + (priv->S * priv->S)))) / (m1 - m2);
+      priv->yHigh[index] = priv->y2 + (priv->delta * (m1 * r2 - m2 * r1)) / (m1 - m2);
     } else {
-      priv->yHigh[index] = priv->y2 + (priv->S * priv->S * priv->delta * (m1 + m2) / (m1 * sqrt((m2 * m2) + (priv->S * priv->S)) + m2 * sqrt((m1 * m1) + (priv->S * priv->S))));
+      priv->yHigh[index] = priv->y2 + (S2 * priv->delta * (m1 + m2) / (m1 * r2 + m2 * r1));
     }
 
     if ((priv->xHigh[index] == priv->xHigh[index - 1]) && (priv->yHigh[index] != priv->yHigh[index - 1])) {
       priv->xHigh[index] = priv->xHigh[index - 1] + priv->xMinStep;
-      priv->yHigh[index] = priv->y2 + m1 * (priv->xHigh[index] - priv->x2) + priv->delta * sqrt((m1 * m1) + (priv->S * priv->S));
+      priv->yHigh[index] = priv->y2 + m1 * (priv->xHigh[index] - priv->x2) + priv->delta * r1;
       priv->mh[index - 1] = (priv->yHigh[index] - priv->yHigh[index - 1]) / priv->xMinStep;
     }
 
@@ -132,14 +237,14 @@ static void generateHighTube(privates *priv, double *x, double *y)
       if (index == 0) {
         double x3 = x[0];
         priv->xHigh[index] = x3 - priv->delta;
-        priv->yHigh[index] = priv->y2 + m1 * (priv->xHigh[index] - priv->x2) + priv->delta * sqrt((m1 * m1) + (priv->S * priv->S));
+        priv->yHigh[index] = priv->y2 + m1 * (priv->xHigh[index] - priv->x2) + priv->delta * r1;
       } else { /* if it is not the first:  (3.2.6.7.3.5.2.) */
         double x3 = priv->xHigh[index - 1];
         double y3 = priv->yHigh[index - 1];
         m2 = priv->mh[index - 1];
 
-        priv->xHigh[index] = (m2 * x3 - m1 * priv->x2 + priv->y2 - y3 + priv->delta * sqrt((m1 * m1) + (priv->S * priv->S))) / (m2 - m1);
-        priv->yHigh[index] = (m2 * m1 * (x3 - priv->x2) + m2 * (priv->y2 + priv->delta * sqrt((m1 * m1) + (priv->S * priv->S))) - m1 * y3) / (m2 - m1);
+        priv->xHigh[index] = (m2 * x3 - m1 * priv->x2 + priv->y2 - y3 + priv->delta * r1) / (m2 - m1);
+        priv->yHigh[index] = (m2 * m1 * (x3 - priv->x2) + m2 * (priv->y2 + priv->delta * r1) - m1 * y3) / (m2 - m1);
       }
     }
   }
@@ -150,6 +255,7 @@ static void generateLowTube(privates *priv, double *x, double *y)
   int index = priv->countLow - 1; /* = _li0l.Count - 1 = _li1l.Count - 1 = xLow.Count - 1 = yLow.Count - 1 > 0 */
   double m1 = priv->ml[index];
   double m2 = priv->ml[index - 1];
+  double S2 = priv->S * priv->S;
   priv->slopeDif = fabs(m1 - m2);
 
   if ((priv->slopeDif == 0) || ((priv->slopeDif < 2e-15 * fmax(fabs(m1), fabs(m2))) && (priv->i0l[priv->countLow - 1] - priv->i1l[priv->countLow - 2] < 100))) {
@@ -164,16 +270,17 @@ static void generateLowTube(privates *priv, double *x, double *y)
 
     priv->ml[index - 1] = (y3 - y4) / (x3 - x4);
   } else {
-    priv->xLow[index] = priv->x2 + (priv->delta * (m1 + m2) / (sqrt((m2 * m2) + (priv->S * priv->S)) + sqrt((m1 * m1) + (priv->S * priv->S))));
+    double r1 = sqrt((m1 * m1) + S2), r2 = sqrt((m2 * m2) + S2);
+    priv->xLow[index] = priv->x2 + (priv->delta * (m1 + m2) / (r2 + r1));
     if (m1 * m2 < 0) {
-      priv->yLow[index] = priv->y2 - (priv->delta * (m1 * sqrt((m2 * m2) + (priv->S * priv->S)) - m2 * sqrt((m1 * m1) + (priv->S * priv->S)))) / (m1 - m2);
+      priv->yLow[index] = priv->y2 - (priv->delta * (m1 * r2 - m2 * r1)) / (m1 - m2);
     } else {
-      priv->yLow[index] = priv->y2 - (priv->S * priv->S * priv->delta * (m1 + m2) / (m1 * sqrt((m2 * m2) + (priv->S * priv->S)) + m2 * sqrt((m1 * m1) + (priv->S * priv->S))));
+      priv->yLow[index] = priv->y2 - (S2 * priv->delta * (m1 + m2) / (m1 * r2 + m2 * r1));
     }
 
     if ((priv->xLow[index] == priv->xLow[index - 1]) && (priv->yLow[index] != priv->yLow[index - 1])) {
       priv->xLow[index] = priv->xLow[index - 1] + priv->xMinStep;
-      priv->yLow[index] = priv->y2 + m1 * (priv->xLow[index] - priv->x2) - priv->delta * sqrt((m1 * m1) + (priv->S * priv->S));
+      priv->yLow[index] = priv->y2 + m1 * (priv->xLow[index] - priv->x2) - priv->delta * r1;
       priv->ml[index - 1] = (priv->yLow[index] - priv->yLow[index - 1]) / priv->xMinStep;
     }
 
@@ -187,22 +294,22 @@ static void generateLowTube(privates *priv, double *x, double *y)
       if (index == 0) {
         double x3 = x[0];
         priv->xLow[index] = x3 - priv->delta;
-        priv->yLow[index] = priv->y2 + m1 * (priv->xLow[index] - priv->x2) - priv->delta * sqrt((m1 * m1) + (priv->S * priv->S));
+        priv->yLow[index] = priv->y2 + m1 * (priv->xLow[index] - priv->x2) - priv->delta * r1;
       } else {
         double x3 = priv->xLow[index - 1];
         double y3 = priv->yLow[index - 1];
         m2 = priv->ml[index - 1];
-        priv->xLow[index] = (m2 * x3 - m1 * priv->x2 + priv->y2 - y3 - priv->delta * sqrt((m1 * m1) + (priv->S * priv->S))) / (m2 - m1);
-        priv->yLow[index] = (m2 * m1 * (x3 - priv->x2) + m2 * (priv->y2 - priv->delta * sqrt((m1 * m1) + (priv->S * priv->S))) - m1 * y3) / (m2 - m1);
+        priv->xLow[index] = (m2 * x3 - m1 * priv->x2 + priv->y2 - y3 - priv->delta * r1) / (m2 - m1);
+        priv->yLow[index] = (m2 * m1 * (x3 - priv->x2) + m2 * (priv->y2 - priv->delta * r1) - m1 * y3) / (m2 - m1);
       }
     }
   }
 }
 
-static privates* skipCalculateTubes(double *x, double *y, size_t length)
+/* The tubes are the curve itself */
+static void skipCalculateTubes(privates *priv, tubeArena *arena, double *x, double *y, size_t length)
 {
-  privates *priv = (privates*) GC_malloc(sizeof(privates));
-
+  memset(priv, 0, sizeof(privates));
   /* set tStart and tStop */
   priv->length = length;
   priv->tStart = x[0];
@@ -211,18 +318,20 @@ static privates* skipCalculateTubes(double *x, double *y, size_t length)
   priv->xMinStep = ((priv->tStop - priv->tStart) + fabs(priv->tStart)) * priv->xRelEps;
   priv->countLow = length;
   priv->countHigh = length;
-  priv->yHigh = (double*)GC_malloc_atomic(sizeof(double)*length);
-  priv->yLow  = (double*)GC_malloc_atomic(sizeof(double)*length);
+  priv->xHigh = x;
+  priv->xLow = x;
+  priv->yHigh = tubeArenaValues(arena, TUBE_YHIGH);
+  priv->yLow  = tubeArenaValues(arena, TUBE_YLOW);
   memcpy(priv->yHigh, y, length * sizeof(double));
   memcpy(priv->yLow, y, length * sizeof(double));
-  return priv;
+  minMaxKernel(y, length, &priv->min, &priv->max);
 }
 
-/* This method generates tubes around a given curve */
-static privates* calculateTubes(double *x, double *y, size_t length, double r)
+/* This method generates tubes around a given curve; x is modified */
+static void calculateTubes(privates *priv, tubeArena *arena, double *x, double *y, size_t length, double r)
 {
-  privates *priv = (privates*) GC_malloc(sizeof(privates));
   int i;
+  memset(priv, 0, sizeof(privates));
   /* set tStart and tStop */
   priv->length = length;
   priv->tStart = x[0];
@@ -233,30 +342,24 @@ static privates* calculateTubes(double *x, double *y, size_t length, double r)
   priv->countHigh = 0;
 
   /* Initialize lists (upper tube) */
-  priv->mh  = (double*)GC_malloc_atomic(sizeof(double)*length);
-  priv->i0h = (int*)GC_malloc_atomic(sizeof(int)*length);
-  priv->i1h = (int*)GC_malloc_atomic(sizeof(int)*length);
+  priv->mh  = tubeArenaValues(arena, TUBE_MH);
+  priv->i0h = arena->indexes;
+  priv->i1h = arena->indexes + arena->capacity;
   /* Initialize lists (lower tube) */
-  priv->ml  = (double*)GC_malloc_atomic(sizeof(double)*length);
-  priv->i0l = (int*)GC_malloc_atomic(sizeof(int)*length);
-  priv->i1l = (int*)GC_malloc_atomic(sizeof(int)*length);
+  priv->ml  = tubeArenaValues(arena, TUBE_ML);
+  priv->i0l = arena->indexes + 2*arena->capacity;
+  priv->i1l = arena->indexes + 3*arena->capacity;
 
-  priv->xHigh = (double*)GC_malloc_atomic(sizeof(double)*length);
-  priv->xLow  = (double*)GC_malloc_atomic(sizeof(double)*length);
-  priv->yHigh = (double*)GC_malloc_atomic(sizeof(double)*length);
-  priv->yLow  = (double*)GC_malloc_atomic(sizeof(double)*length);
+  priv->xHigh = tubeArenaValues(arena, TUBE_XHIGH);
+  priv->xLow  = tubeArenaValues(arena, TUBE_XLOW);
+  priv->yHigh = tubeArenaValues(arena, TUBE_YHIGH);
+  priv->yLow  = tubeArenaValues(arena, TUBE_YLOW);
 
   /* calculate the tubes delta */
   priv->delta = r * (priv->tStop - priv->tStart);
 
   /* calculate S */
-  priv->max = y[0];
-  priv->min = y[0];
-
-  for (i = 1; i < length; i++) {
-    priv->max = fmax(y[i],priv->max);
-    priv->min = fmin(y[i],priv->min);
-  }
+  minMaxKernel(y, length, &priv->min, &priv->max);
   priv->S = fabs(4 * (priv->max - priv->min) / (fabs(priv->tStop - priv->tStart)));
 
   if (priv->S < 0.0004 / fabs(priv->tStop - priv->tStart)) {
@@ -352,26 +455,25 @@ static privates* calculateTubes(double *x, double *y, size_t length, double r)
   priv->xLow[priv->countLow] = priv->x2 + priv->delta;
   priv->yLow[priv->countLow] = priv->y1 + priv->currentSlope * (priv->x2 + priv->delta - priv->x1);
   priv->countLow++;
-  return priv;
 }
 
 static inline double linearInterpolation(double x, double x0, double x1, double y0, double y1, double xabstol)
 {
-  if (almostEqualRelativeAndAbs(x0,x,0,xabstol)) { //prevent NaN -> division by zero
+  if (sameTime(x0,x,xabstol)) { //prevent NaN -> division by zero
     return y0;
-  } else if (almostEqualRelativeAndAbs(x1,x,0,xabstol)) { //prevent NaN -> division by zero
+  } else if (sameTime(x1,x,xabstol)) { //prevent NaN -> division by zero
     return y1;
-  } else if (almostEqualRelativeAndAbs(x1,x0,0,xabstol)) { //prevent NaN -> division by zero
+  } else if (sameTime(x1,x0,xabstol)) { //prevent NaN -> division by zero
     return y0;
   } else {
     return y0 + (((y1 - y0) / (x1 - x0)) * (x - x0)); // linear interpolation of the source value at the target moment in time
   }
 }
 
-/* Calibrate the target time+value pair onto the source timeline */
-static double* calibrateValues(double* sourceTimeLine, double* targetTimeLine, double* targetValues, size_t *nsource, size_t ntarget, double xabstol)
+/* Calibrate the target time+value pair onto the source timeline.
+ * The walk over both timelines is a merge, so it stays scalar. */
+static double* calibrateValues(double* interpolatedValues, double* sourceTimeLine, double* targetTimeLine, double* targetValues, size_t *nsource, size_t ntarget, double xabstol)
 {
-  double* interpolatedValues;
   int j, i;
   double x0, x1, y0, y1;
   size_t n;
@@ -381,7 +483,6 @@ static double* calibrateValues(double* sourceTimeLine, double* targetTimeLine, d
   }
 
   n = *nsource;
-  interpolatedValues = (double*) GC_malloc_atomic(sizeof(double)*n);
 
   j = 1;
   for (i = 0; i < n; i++) {
@@ -400,13 +501,13 @@ static double* calibrateValues(double* sourceTimeLine, double* targetTimeLine, d
       j++;
       x1 = targetTimeLine[j];
       y1 = targetValues[j];
-      if (almostEqualRelativeAndAbs(x1,x,0,xabstol)) {
+      if (sameTime(x1,x,xabstol)) {
         break;
       }
     }
     x0 = targetTimeLine[j - 1];
     y0 = targetValues[j - 1];
-    if (i && almostEqualRelativeAndAbs(sourceTimeLine[i-1],x0,0,xabstol) && almostEqualRelativeAndAbs(x0,x1,0,xabstol)) {
+    if (i && sameTime(sourceTimeLine[i-1],x0,xabstol) && sameTime(x0,x1,xabstol)) {
       /* Previous value was the left limit of the event; use the right limit! */
       interpolatedValues[i] = y1;
     } else {
@@ -580,11 +681,11 @@ static void addRelativeTolerance(double *targetValues, double *sourceValues, siz
   int i;
   if (direction > 0) {
     for (i=0; i<length; i++) {
-      targetValues[i] = fmax(sourceValues[i] + fmax(fabs(sourceValues[i]*reltol),abstol), targetValues[i]);
+      targetValues[i] = tubeMax(sourceValues[i] + tubeMax(fabs(sourceValues[i]*reltol),abstol), targetValues[i]);
     }
   } else {
     for (i=0; i<length; i++) {
-      targetValues[i] = fmin(sourceValues[i] - fmax(fabs(sourceValues[i]*reltol),abstol), targetValues[i]);
+      targetValues[i] = tubeMin(sourceValues[i] - tubeMax(fabs(sourceValues[i]*reltol),abstol), targetValues[i]);
     }
   }
 }
@@ -600,15 +701,22 @@ static void assertMonotonic(addTargetEventTimesRes series)
   }
 }
 
-/* Return NULL if there were no errors */
-static double* validate(int n, addTargetEventTimesRes ref, double *low, double *high, double *calibrated_values, double reltol, double abstol, double xabstol)
+/* Fills error with the distance of the calibrated values to the tube (NaN
+ * at events, where the tube is narrowed around the reference instead).
+ * Returns the number of points outside the tube.
+ */
+static int validate(int n, addTargetEventTimesRes ref, double *low, double *high, double *calibrated_values, double reltol, double abstol, double xabstol, double *error)
 {
-  double *error = GC_malloc_atomic(n * sizeof(double));
   int isdifferent = 0;
   int i,lastStepError = 1;
+  /* Without branches, so it can be vectorized; the events are fixed below */
+  for (i=0; i<n; i++) {
+    double below = low[i] - calibrated_values[i];
+    double above = calibrated_values[i] - high[i];
+    error[i] = below > 0 ? below : (above > 0 ? above : 0);
+  }
   for (i=0; i<n; i++) {
-    int thisStepError = 0;
-    int isEvent = (i && almostEqualRelativeAndAbs(ref.time[i],ref.time[i-1],0,xabstol)) || (i+1<n && almostEqualRelativeAndAbs(ref.time[i],ref.time[i+1],0,xabstol));
+    int isEvent = (i && sameTime(ref.time[i],ref.time[i-1],xabstol)) || (i+1<n && sameTime(ref.time[i],ref.time[i+1],xabstol));
     if (isEvent) {
       double refv = ref.values[i];
       double val = calibrated_values[i];
@@ -617,29 +725,19 @@ static double* validate(int n, addTargetEventTimesRes ref, double *low, double *
       high[i] = (lastStepError ? refv : fmax(refv,val)) + tol;
       low[i] = (lastStepError ? refv : fmin(refv,val)) - tol;
       error[i] = NAN;
-    } else {
-      error[i] = 0;
-      thisStepError=lastStepError;
-      if (calibrated_values[i] < low[i]) {
-        error[i] = low[i]-calibrated_values[i];
-        isdifferent++;
-        thisStepError=1;
-      } else if (calibrated_values[i] > high[i]) {
-        error[i] = calibrated_values[i]-high[i];
-        isdifferent++;
-        thisStepError=1;
-      }
+      lastStepError = 0;
+    } else if (error[i] != 0) {
+      isdifferent++;
+      lastStepError = 1;
     }
-    lastStepError = thisStepError;
-  }
-  if (isdifferent) {
-    return error;
   }
-  return NULL;
+  return isdifferent;
 }
 
-static unsigned int cmpDataTubes(int isResultCmp, char* varname, DataField *time, DataField *reftime, DataField *data, DataField *refdata, double reltol, double rangeDelta, double reltolDiffMaxMin, DiffDataField *ddf, char **cmpdiffvars, unsigned int vardiffindx, int keepEqualResults, void **diffLst, const char *prefix, int isHtml, char **htmlOut)
+/* the arena has to be reserved for reftime->n points by the caller */
+static char cmpDataTubes(tubeArena *arena, int isResultCmp, char* varname, DataField *time, DataField *reftime, DataField *data, DataField *refdata, double reltol, double rangeDelta, double reltolDiffMaxMin, DiffDataField *ddf, int keepEqualResults, const char *prefix, int isHtml, char **htmlOut)
 {
+  char isdifferent;
   int withTubes = 0 == rangeDelta;
   FILE *fout = NULL;
   char *fname = NULL;
@@ -648,7 +746,7 @@ static unsigned int cmpDataTubes(int isResultCmp, char* varname, DataField *time
   double xabstol = (reftime->data[reftime->n-1]-reftime->data[0])*(withTubes ? rangeDelta : 1e-3) / fmax(time->n,reftime->n);
   /* Calculate the tubes without additional events added */
   addTargetEventTimesRes ref,actual,actualoriginal;
-  privates *priv=NULL;
+  privates tubes, *priv=&tubes;
   size_t n,maxn;
   double *calibrated_values=NULL, *high=NULL, *low=NULL, *error=NULL,maxPlusTol,minMinusTol,abstol;
 
@@ -665,15 +763,21 @@ static unsigned int cmpDataTubes(int isResultCmp, char* varname, DataField *time
   /* actual = removeUneventfulPoints(actual, reltol*reltol, xabstol); */
   /* assertMonotonic(ref); */
   /* assertMonotonic(actual); */
-  priv = withTubes ? skipCalculateTubes(ref.time,ref.values,ref.size) : calculateTubes(ref.time,ref.values,ref.size,rangeDelta);
+  if (withTubes) {
+    skipCalculateTubes(priv,arena,ref.time,ref.values,ref.size);
+  } else {
+    /* The reference time is shared by all variables; calculateTubes moves its jumps apart */
+    ref.time = memcpy(tubeArenaValues(arena, TUBE_TIME), reftime->data, ref.size*sizeof(double));
+    calculateTubes(priv,arena,ref.time,ref.values,ref.size,rangeDelta);
+  }
   /* ref = mergeTimelines(ref,actual,xabstol); */
   /* assertMonotonic(ref); */
   n = ref.size;
-  calibrated_values = calibrateValues(ref.time,actual.time,actual.values,&n,actual.size,xabstol);
+  calibrated_values = calibrateValues(tubeArenaValues(arena, TUBE_CALIBRATED),ref.time,actual.time,actual.values,&n,actual.size,xabstol);
   maxPlusTol = priv->max + fabs(priv->max) * reltol;
   minMinusTol = priv->min - fabs(priv->min) * reltol;
-  high = calibrateValues(ref.time,priv->xHigh,priv->yHigh,&n,priv->countHigh,xabstol);
-  low  = calibrateValues(ref.time,priv->xLow,priv->yLow,&n,priv->countLow,xabstol);
+  high = calibrateValues(tubeArenaValues(arena, TUBE_HIGH),ref.time,priv->xHigh,priv->yHigh,&n,priv->countHigh,xabstol);
+  low  = calibrateValues(tubeArenaValues(arena, TUBE_LOW),ref.time,priv->xLow,priv->yLow,&n,priv->countLow,xabstol);
   /* If all values in the reference are ~0 (and the same)... Allow reltolDiffMaxMin^2 as tolerance
    * Maybe we should just treat it differently though
    * Like not creating a tubes and simply check that the other file also has only identical points close to this
@@ -681,7 +785,10 @@ static unsigned int cmpDataTubes(int isResultCmp, char* varname, DataField *time
   abstol = (priv->max-priv->min == 0 && priv->max < reltolDiffMaxMin*reltolDiffMaxMin) ? reltolDiffMaxMin*reltolDiffMaxMin : fabs((priv->max-priv->min)*reltolDiffMaxMin);
   addRelativeTolerance(high,ref.values,n,reltol,abstol,1);
   addRelativeTolerance(low ,ref.values,n,reltol,abstol,-1);
-  error = validate(n,ref,low,high,calibrated_values,reltol,abstol,xabstol);
+  error = tubeArenaValues(arena, TUBE_ERROR);
+  if (!validate(n,ref,low,high,calibrated_values,reltol,abstol,xabstol,error)) {
+    error = NULL;
+  }
   if (isHtml ) {
 #if _XOPEN_SOURCE >= 700 || _POSIX_C_SOURCE >= 200809L
     size_t html_size=0;
@@ -771,13 +878,7 @@ static unsigned int cmpDataTubes(int isResultCmp, char* varname, DataField *time
     }
     fputs(isHtml ? "],\n" : "\n", fout);
   }
-  if (error) {
-    cmpdiffvars[vardiffindx] = varname;
-    vardiffindx++;
-    if (!isResultCmp) {
-      *diffLst = mmc_mk_cons(mmc_mk_scon(varname),*diffLst);
-    }
-  }
+  isdifferent = error != NULL;
   if (fout) {
     if (isHtml) {
 fprintf(fout, "{title: '%s',\n"
@@ -804,24 +905,6 @@ fprintf(fout, "{title: '%s',\n"
       free(html);
     }
   }
-  /* Tell the GC some variables have been free'd */
-  if (error) GC_free(error);
   if (fname) GC_free(fname);
-  GC_free(low);
-  GC_free(high);
-  if (withTubes) {
-    GC_free(priv->mh);
-    GC_free(priv->i0h);
-    GC_free(priv->i1h);
-    GC_free(priv->ml);
-    GC_free(priv->i0l);
-    GC_free(priv->i1l);
-    GC_free(priv->xHigh);
-    GC_free(priv->xLow);
-  }
-  GC_free(priv->yHigh);
-  GC_free(priv->yLow);
-  GC_free(priv);
-  GC_free(calibrated_values);
-  return vardiffindx;
+  return isdifferent;
 }
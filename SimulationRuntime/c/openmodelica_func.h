@@ -188,6 +188,18 @@ int (*function_ZeroCrossingsEquations)(DATA *data, threadData_t*);
  */
 int (*function_ZeroCrossings)(DATA *data, threadData_t*, double* gout);
 
+/*! \fn function_ZeroCrossingsSubset
+ *
+ *  This function evaluates only the zero crossings with the given indexes;
+ *  the other elements of gout are not changed
+ *
+ *  \param [ref] [data]
+ *  \param [ref] [gout]
+ *  \param [in]  [indexes]
+ *  \param [in]  [n] number of indexes
+ */
+int (*function_ZeroCrossingsSubset)(DATA *data, threadData_t*, double* gout, const long* indexes, long n);
+
 /*! \fn function_updateRelations
  *
  *  This function evaluates current continuous relations.
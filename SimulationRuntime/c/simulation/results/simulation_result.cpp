@@ -30,6 +30,47 @@
 
 #include "simulation_result.h"
 
+#include <stdlib.h>
+
+/* collects the indexes of the stored variables and aliases of one type */
+template<typename VAR, typename ALIAS>
+static void sim_result_collect(sim_result_indexes *indexes, long nVars, const VAR *vars, long nAliases, const ALIAS *alias, enum SIM_RESULT_ALIASES aliases, int isBoolean)
+{
+  long i, n;
+
+  indexes->vars = (long*) malloc((nVars+1)*sizeof(long));
+  for(i = 0, n = 0; i < nVars; i++) if(!vars[i].filterOutput)
+    indexes->vars[n++] = i;
+  indexes->nVars = n;
+
+  indexes->aliases = (long*) malloc((nAliases+1)*sizeof(long));
+  indexes->aliasSource = (long*) malloc((nAliases+1)*sizeof(long));
+  indexes->aliasParameter = (char*) malloc(nAliases+1);
+  indexes->aliasNegate = (char*) malloc(nAliases+1);
+  for(i = 0, n = 0; i < nAliases; i++) if(!alias[i].filterOutput)
+  {
+    switch(aliases)
+    {
+    case SIM_RESULT_ALIASES_NONE:
+      continue;
+    case SIM_RESULT_ALIASES_NEGATED_BOOLEANS:
+      if(!isBoolean || !alias[i].negate) continue;
+      break;
+    case SIM_RESULT_ALIASES_VARIABLES:
+      if(alias[i].aliasType == 1) continue;
+      break;
+    case SIM_RESULT_ALIASES_ALL:
+      break;
+    }
+    indexes->aliases[n] = i;
+    indexes->aliasSource[n] = alias[i].aliasType == 2 ? -1 : alias[i].nameID;
+    indexes->aliasParameter[n] = alias[i].aliasType == 1;
+    indexes->aliasNegate[n] = alias[i].negate != 0;
+    n++;
+  }
+  indexes->nAliases = n;
+}
+
 extern "C" {
 
 static void sim_result_doNothing(simulation_result* self, DATA *data, threadData_t *threadData)
@@ -48,4 +89,83 @@ simulation_result sim_result = {
   sim_result_doNothing, /* free */
 };
 
+static void sim_result_freeIndexes(sim_result_indexes *indexes)
+{
+  free(indexes->vars);
+  free(indexes->aliases);
+  free(indexes->aliasSource);
+  free(indexes->aliasParameter);
+  free(indexes->aliasNegate);
+}
+
+void sim_result_initGather(sim_result_gather *gather, const MODEL_DATA *modelData, int cpuTime, enum SIM_RESULT_ALIASES aliases)
+{
+  gather->cpuTime = cpuTime;
+  sim_result_collect(&gather->real, modelData->nVariablesReal, modelData->realVarsData, modelData->nAliasReal, modelData->realAlias, aliases, 0);
+  sim_result_collect(&gather->integer, modelData->nVariablesInteger, modelData->integerVarsData, modelData->nAliasInteger, modelData->integerAlias, aliases, 0);
+  sim_result_collect(&gather->boolean, modelData->nVariablesBoolean, modelData->booleanVarsData, modelData->nAliasBoolean, modelData->booleanAlias, aliases, 1);
+  sim_result_collect(&gather->string, modelData->nVariablesString, modelData->stringVarsData, modelData->nAliasString, modelData->stringAlias, aliases == SIM_RESULT_ALIASES_NEGATED_BOOLEANS ? SIM_RESULT_ALIASES_NONE : aliases, 0);
+  gather->rowSize = 1 + (cpuTime ? 1 : 0)
+                  + gather->real.nVars + gather->integer.nVars + gather->boolean.nVars
+                  + gather->real.nAliases + gather->integer.nAliases + gather->boolean.nAliases;
+}
+
+void sim_result_freeGather(sim_result_gather *gather)
+{
+  sim_result_freeIndexes(&gather->real);
+  sim_result_freeIndexes(&gather->integer);
+  sim_result_freeIndexes(&gather->boolean);
+  sim_result_freeIndexes(&gather->string);
+}
+
+void sim_result_gatherRow(const sim_result_gather *gather, const DATA *data, double cpuTimeValue, double *row)
+{
+  const SIMULATION_DATA *sData = data->localData[0];
+  const SIMULATION_INFO *sInfo = data->simulationInfo;
+  const double *realVars = sData->realVars;
+  const modelica_integer *integerVars = sData->integerVars;
+  const modelica_boolean *booleanVars = sData->booleanVars;
+  const sim_result_indexes *ix;
+  long i;
+
+  *row++ = sData->timeValue;
+  if(gather->cpuTime)
+    *row++ = cpuTimeValue;
+
+  /* the variables are plain gathers */
+  ix = &gather->real;
+  for(i = 0; i < ix->nVars; i++)
+    row[i] = realVars[ix->vars[i]];
+  row += ix->nVars;
+  ix = &gather->integer;
+  for(i = 0; i < ix->nVars; i++)
+    row[i] = (double) integerVars[ix->vars[i]];
+  row += ix->nVars;
+  ix = &gather->boolean;
+  for(i = 0; i < ix->nVars; i++)
+    row[i] = (double) booleanVars[ix->vars[i]];
+  row += ix->nVars;
+
+  ix = &gather->real;
+  for(i = 0; i < ix->nAliases; i++)
+  {
+    double value = ix->aliasSource[i] < 0 ? sData->timeValue : ix->aliasParameter[i] ? sInfo->realParameter[ix->aliasSource[i]] : realVars[ix->aliasSource[i]];
+    row[i] = ix->aliasNegate[i] ? -value : value;
+  }
+  row += ix->nAliases;
+  ix = &gather->integer;
+  for(i = 0; i < ix->nAliases; i++)
+  {
+    modelica_integer value = ix->aliasParameter[i] ? sInfo->integerParameter[ix->aliasSource[i]] : integerVars[ix->aliasSource[i]];
+    row[i] = (double) (ix->aliasNegate[i] ? -value : value);
+  }
+  row += ix->nAliases;
+  ix = &gather->boolean;
+  for(i = 0; i < ix->nAliases; i++)
+  {
+    modelica_boolean value = ix->aliasParameter[i] ? sInfo->booleanParameter[ix->aliasSource[i]] : booleanVars[ix->aliasSource[i]];
+    row[i] = ix->aliasNegate[i] ? (value ? 0.0 : 1.0) : (double) value;
+  }
+}
+
 }
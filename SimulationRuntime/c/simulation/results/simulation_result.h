@@ -51,6 +51,44 @@ typedef struct simulation_result {
 
 extern simulation_result sim_result;
 
+/* Which aliases sim_result_gatherRow stores after the variables */
+enum SIM_RESULT_ALIASES {
+  SIM_RESULT_ALIASES_NONE = 0,
+  SIM_RESULT_ALIASES_NEGATED_BOOLEANS, /* only negated boolean aliases; the format refers to the other ones */
+  SIM_RESULT_ALIASES_VARIABLES,        /* aliases of variables and time */
+  SIM_RESULT_ALIASES_ALL               /* also aliases of parameters */
+};
+
+/* The variables and aliases of one type that are stored in the result file */
+typedef struct sim_result_indexes {
+  long nVars;
+  long *vars;           /* indexes of the stored variables */
+  long nAliases;
+  long *aliases;        /* indexes of the stored aliases */
+  long *aliasSource;    /* index of the aliased variable or parameter; -1 for time */
+  char *aliasParameter; /* the alias refers to a parameter */
+  char *aliasNegate;
+} sim_result_indexes;
+
+/* Compact index lists of everything that ends up in the result file. They are
+ * computed once after the variable filter was applied, so that the cost of
+ * emitting a time point only depends on the number of stored variables.
+ */
+typedef struct sim_result_gather {
+  int cpuTime;
+  sim_result_indexes real, integer, boolean, string;
+  long rowSize; /* number of values written by sim_result_gatherRow */
+} sim_result_gather;
+
+void sim_result_initGather(sim_result_gather *gather, const MODEL_DATA *modelData, int cpuTime, enum SIM_RESULT_ALIASES aliases);
+void sim_result_freeGather(sim_result_gather *gather);
+
+/* Stores the current time point in row:
+ *   time, [cpu time], reals, integers, booleans, real aliases, integer aliases, boolean aliases
+ * Strings are not part of the row.
+ */
+void sim_result_gatherRow(const sim_result_gather *gather, const DATA *data, double cpuTimeValue, double *row);
+
 #ifdef __cplusplus
 }
 #endif /* cplusplus */
@@ -41,23 +41,59 @@
 #include "util/omc_error.h"
 #include "simulation_result_csv.h"
 #include "util/rtclock.h"
+#include "util/omc_dtoa.h"
+#include "meta/meta_modelica.h"
 
 #include <stdio.h>
 #include <errno.h>
 #include <string.h>
 #include <time.h>
+#include <stdlib.h>
 
 extern "C" {
 
+typedef struct csv_data {
+  FILE *fout;
+  sim_result_gather gather;
+  double *row;
+  char *line; /* one formatted row, written with a single fwrite */
+  size_t lineSize;
+} csv_data;
+
+/* makes room for n more characters in the line buffer */
+static char* csv_reserve(csv_data *csvData, char *pos, size_t n)
+{
+  size_t used = pos - csvData->line;
+  if(used + n > csvData->lineSize) {
+    csvData->lineSize = 2*(used + n);
+    csvData->line = (char*) realloc(csvData->line, csvData->lineSize);
+    if(!csvData->line) {
+      throwStreamPrint(NULL, "Error allocating a line of %lu characters for the csv result file", (unsigned long) csvData->lineSize);
+    }
+  }
+  return csvData->line + used;
+}
+
+static char* csv_string(csv_data *csvData, char *pos, modelica_string str)
+{
+  size_t len = MMC_STRLEN(str);
+  pos = csv_reserve(csvData, pos, len + 3);
+  *pos++ = '"';
+  memcpy(pos, MMC_STRINGDATA(str), len);
+  pos += len;
+  *pos++ = '"';
+  *pos++ = ',';
+  return pos;
+}
+
 void omc_csv_emit(simulation_result *self, DATA *data, threadData_t *threadData)
 {
-  FILE *fout = (FILE*) self->storage;
-  const char* format = "%.16g,";
-  const char* formatint = "%i,";
-  const char* formatbool = "%i,";
-  const char* formatstring = "\"%s\",";
-  int i;
-  modelica_real value = 0;
+  csv_data *csvData = (csv_data*) self->storage;
+  const sim_result_gather *gather = &csvData->gather;
+  const double *row = csvData->row;
+  long nValues = 1 + (self->cpuTime ? 1 : 0) + gather->real.nVars + gather->integer.nVars + gather->boolean.nVars;
+  long i;
+  char *pos;
   double cpuTimeValue = 0;
   rt_tick(SIM_TIMER_OUTPUT);
 
@@ -65,50 +101,29 @@ void omc_csv_emit(simulation_result *self, DATA *data, threadData_t *threadData)
   cpuTimeValue = rt_accumulated(SIM_TIMER_TOTAL);
   rt_tick(SIM_TIMER_TOTAL);
 
-  fprintf(fout, format, data->localData[0]->timeValue);
-  if(self->cpuTime)
-    fprintf(fout, format, cpuTimeValue);
-  for(i = 0; i < data->modelData->nVariablesReal; i++) if(!data->modelData->realVarsData[i].filterOutput)
-    fprintf(fout, format, (data->localData[0])->realVars[i]);
-  for(i = 0; i < data->modelData->nVariablesInteger; i++) if(!data->modelData->integerVarsData[i].filterOutput)
-    fprintf(fout, formatint, (data->localData[0])->integerVars[i]);
-  for(i = 0; i < data->modelData->nVariablesBoolean; i++) if(!data->modelData->booleanVarsData[i].filterOutput)
-    fprintf(fout, formatbool, (data->localData[0])->booleanVars[i]);
-  for(i = 0; i < data->modelData->nVariablesString; i++) if(!data->modelData->stringVarsData[i].filterOutput)
-    fprintf(fout, formatstring, (data->localData[0])->stringVars[i]);
-
-  for(i = 0; i < data->modelData->nAliasReal; i++) if(!data->modelData->realAlias[i].filterOutput && data->modelData->realAlias[i].aliasType != 1) {
-    if (data->modelData->realAlias[i].aliasType == 2) {
-      value = (data->localData[0])->timeValue;
-    } else {
-      value = (data->localData[0])->realVars[data->modelData->realAlias[i].nameID];
-    }
-    if (data->modelData->realAlias[i].negate) {
-      fprintf(fout, format, -value);
-    } else {
-      fprintf(fout, format, value);
-    }
-  }
-  for(i = 0; i < data->modelData->nAliasInteger; i++) if(!data->modelData->integerAlias[i].filterOutput && data->modelData->integerAlias[i].aliasType != 1) {
-    if (data->modelData->integerAlias[i].negate) {
-      fprintf(fout, formatint, -(data->localData[0])->integerVars[data->modelData->integerAlias[i].nameID]);
-    } else {
-      fprintf(fout, formatint, (data->localData[0])->integerVars[data->modelData->integerAlias[i].nameID]);
-    }
+  sim_result_gatherRow(gather, data, cpuTimeValue, csvData->row);
+
+  /* time, cpu time and the variables; the buffer always has room for all numbers */
+  pos = csvData->line;
+  for(i = 0; i < nValues; i++) {
+    pos += omc_dtoa_shortest(*row++, pos);
+    *pos++ = ',';
   }
-  for(i = 0; i < data->modelData->nAliasBoolean; i++) if(!data->modelData->booleanAlias[i].filterOutput && data->modelData->booleanAlias[i].aliasType != 1) {
-    if (data->modelData->booleanAlias[i].negate) {
-      fprintf(fout, formatbool, (data->localData[0])->booleanVars[data->modelData->booleanAlias[i].nameID]==1?0:1);
-    } else {
-      fprintf(fout, formatbool, (data->localData[0])->booleanVars[data->modelData->booleanAlias[i].nameID]);
-    }
+  for(i = 0; i < gather->string.nVars; i++)
+    pos = csv_string(csvData, pos, (data->localData[0])->stringVars[gather->string.vars[i]]);
+
+  /* the aliases */
+  pos = csv_reserve(csvData, pos, (gather->rowSize - nValues) * (OMC_DTOA_BUFFER_SIZE+1));
+  for(i = nValues; i < gather->rowSize; i++) {
+    pos += omc_dtoa_shortest(*row++, pos);
+    *pos++ = ',';
   }
-  for(i = 0; i < data->modelData->nAliasString; i++) if(!data->modelData->stringAlias[i].filterOutput && data->modelData->stringAlias[i].aliasType != 1) {
+  for(i = 0; i < gather->string.nAliases; i++) {
     /* there would no negation of a string happen */
-    fprintf(fout, formatstring, (data->localData[0])->stringVars[data->modelData->stringAlias[i].nameID]);
+    pos = csv_string(csvData, pos, (data->localData[0])->stringVars[gather->string.aliasSource[i]]);
   }
-  fseek(fout, -1, SEEK_CUR); // removes the eol comma separator
-  fprintf(fout, "\n");
+  pos[-1] = '\n'; // replaces the eol comma separator
+  fwrite(csvData->line, 1, pos - csvData->line, csvData->fout);
   rt_accumulate(SIM_TIMER_OUTPUT);
 }
 
@@ -144,14 +159,34 @@ void omc_csv_init(simulation_result *self, DATA *data, threadData_t *threadData)
     fprintf(fout, format, mData->stringAlias[i].info.name);
   fseek(fout, -1, SEEK_CUR); // removes the eol comma separator
   fprintf(fout,"\n");
-  self->storage = fout;
+
+  csv_data *csvData = new csv_data;
+  csvData->fout = fout;
+  sim_result_initGather(&csvData->gather, mData, self->cpuTime, SIM_RESULT_ALIASES_VARIABLES);
+  csvData->row = new double[csvData->gather.rowSize];
+  csvData->lineSize = csvData->gather.rowSize * (OMC_DTOA_BUFFER_SIZE+1) + 1;
+  csvData->line = (char*) malloc(csvData->lineSize);
+  if(!csvData->line) {
+    size_t lineSize = csvData->lineSize;
+    fclose(fout);
+    sim_result_freeGather(&csvData->gather);
+    delete[] csvData->row;
+    delete csvData;
+    throwStreamPrint(threadData, "Error allocating a line of %lu characters for the csv result file", (unsigned long) lineSize);
+  }
+  self->storage = csvData;
 }
 
 void omc_csv_free(simulation_result *self, DATA *data, threadData_t *threadData)
 {
-  FILE *fout = (FILE*) self->storage;
+  csv_data *csvData = (csv_data*) self->storage;
   rt_tick(SIM_TIMER_OUTPUT);
-  fclose(fout);
+  fclose(csvData->fout);
+  sim_result_freeGather(&csvData->gather);
+  delete[] csvData->row;
+  free(csvData->line);
+  delete csvData;
+  self->storage = NULL;
   rt_accumulate(SIM_TIMER_OUTPUT);
 }
 
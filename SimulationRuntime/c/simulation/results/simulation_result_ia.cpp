@@ -39,11 +39,17 @@
  * A message with ID=2 contains the number of Real, Integer, Boolean and String variables together with their names.
  * A message with ID=4 contains all the values (same order as for ID=2: Real, Integer, Boolean, String).
  * A message with ID=6 indicates that the simulation is completed.
+ *
+ * The ID=4 messages are written into a ring of preallocated buffers and sent
+ * by a background thread, -iaBatch time points per socket write. If the
+ * client cannot keep up, -iaPolicy decides whether the simulation waits for
+ * it or whether time points are dropped or decimated.
  */
 
 #include "util/omc_error.h"
 #include "simulation_result_ia.h"
 #include "util/rtclock.h"
+#include "simulation/options.h"
 
 #include <fstream>
 #include <iostream>
@@ -52,19 +58,65 @@
 #include <utility>
 #include <cstring>
 #include <cstdlib>
+#include <cerrno>
+#include <climits>
 #include <stdint.h>
 #include <assert.h>
+#include <pthread.h>
 #include "../simulation_runtime.h"
 #include "meta/meta_modelica.h"
 
+#define IA_NUM_BUFFERS 8        /* number of message buffers in the ring */
+#define IA_MAX_DECIMATION 1024  /* send at least every n-th time point */
+#define IA_HEADER_SIZE (sizeof(char)+sizeof(unsigned int))
+
+enum IA_POLICY {
+  IA_POLICY_BLOCK = 0,
+  IA_POLICY_DROP,
+  IA_POLICY_DECIMATE
+};
+
+typedef struct ia_buffer
+{
+  char *data;
+  size_t size;     /* bytes of complete messages */
+  size_t capacity;
+  unsigned int npoints;
+} ia_buffer;
+
 typedef struct IA_DATA
 {
   unsigned int nReal;
   unsigned int nInteger;
   unsigned int nBoolean;
   unsigned int nString;
+  sim_result_gather gather;
+  double *row;
+
+  unsigned int fixedSize; /* size of an ID=4 message without the strings */
+  unsigned int batch;     /* time points per socket write */
+  enum IA_POLICY policy;
+  ia_buffer buffers[IA_NUM_BUFFERS];
+  unsigned int curBuffer;     /* buffer which is filled by emit() */
+  unsigned int headBuffer;    /* next buffer sent by the sender thread */
+  unsigned int queuedBuffers; /* number of buffers waiting for the sender thread */
+  unsigned int decimation;    /* only every decimation-th time point is stored */
+  unsigned int skip;          /* time points to skip until the next stored one */
+  bool lastSkipped;           /* the last time point was decimated */
+  unsigned int lastSize;      /* size of the last message in the current buffer */
+  unsigned long sentPoints;
+  unsigned long droppedPoints;
+  bool useThread;
+  bool stopSender;
+  pthread_t sender;
+  pthread_mutex_t mutex;
+  pthread_cond_t queueCond;
 } IA_DATA;
 
+static void ia_startSender(IA_DATA *iaData);
+static void ia_stopSender(IA_DATA *iaData);
+static void ia_submitBuffer(IA_DATA *iaData, bool flush);
+
 void ia_init(simulation_result *self, DATA *data, threadData_t *threadData)
 {
   TRACE_PUSH
@@ -195,6 +247,47 @@ void ia_init(simulation_result *self, DATA *data, threadData_t *threadData)
   communicateMsg(2, msgSIZE, msgDATA);
   delete[] msgDATA;
 
+  sim_result_initGather(&iaData->gather, mData, 0, SIM_RESULT_ALIASES_VARIABLES);
+  iaData->row = new double[iaData->gather.rowSize];
+
+  iaData->batch = 1;
+  if(omc_flag[FLAG_IA_BATCH]) {
+    char *endptr;
+    long batch;
+    errno = 0;
+    batch = strtol(omc_flagValue[FLAG_IA_BATCH], &endptr, 10);
+    if(errno || *endptr != 0 || endptr == omc_flagValue[FLAG_IA_BATCH] || batch < 1 || batch > INT_MAX) {
+      throwStreamPrint(threadData, "-iaBatch takes a positive integer argument (got '%s')", omc_flagValue[FLAG_IA_BATCH]);
+    }
+    iaData->batch = (unsigned int) batch;
+  }
+  iaData->policy = IA_POLICY_BLOCK;
+  if(omc_flag[FLAG_IA_POLICY]) {
+    if(0 == strcmp(omc_flagValue[FLAG_IA_POLICY], "block")) {
+      iaData->policy = IA_POLICY_BLOCK;
+    } else if(0 == strcmp(omc_flagValue[FLAG_IA_POLICY], "drop")) {
+      iaData->policy = IA_POLICY_DROP;
+    } else if(0 == strcmp(omc_flagValue[FLAG_IA_POLICY], "decimate")) {
+      iaData->policy = IA_POLICY_DECIMATE;
+    } else {
+      throwStreamPrint(threadData, "-iaPolicy=%s is unknown, use block, drop or decimate", omc_flagValue[FLAG_IA_POLICY]);
+    }
+  }
+
+  /* the buffers only grow if the strings get longer */
+  iaData->fixedSize = iaData->nReal*sizeof(modelica_real) + iaData->nInteger*sizeof(modelica_integer) + iaData->nBoolean*sizeof(modelica_boolean);
+  for(i=0; i<IA_NUM_BUFFERS; i++)
+  {
+    iaData->buffers[i].capacity = iaData->batch * (IA_HEADER_SIZE + iaData->fixedSize + iaData->nString*16);
+    iaData->buffers[i].data = (char*) malloc(iaData->buffers[i].capacity);
+    iaData->buffers[i].size = 0;
+    iaData->buffers[i].npoints = 0;
+    if(!iaData->buffers[i].data) {
+      throwStreamPrint(threadData, "Cannot allocate memory");
+    }
+  }
+  ia_startSender(iaData);
+
   TRACE_POP
 }
 
@@ -203,92 +296,104 @@ void ia_emit(simulation_result *self, DATA *data, threadData_t *threadData)
   TRACE_PUSH
   rt_tick(SIM_TIMER_OUTPUT);
 
-  int i;
-  const IA_DATA *iaData = (IA_DATA*)self->storage;
+  long i;
+  IA_DATA *iaData = (IA_DATA*)self->storage;
+  const sim_result_gather *gather = &iaData->gather;
+  const double *row = iaData->row;
+  const double *realAliases, *integerAliases, *booleanAliases;
 
-  // count string length
-  unsigned int strLength = 0;
-  for(i=0; i<data->modelData->nVariablesString; i++) if(!data->modelData->stringVarsData[i].filterOutput) {
-    strLength += MMC_STRLEN(data->localData[0]->stringVars[i]) + 1;
-  }
-  for(i=0; i<data->modelData->nAliasString; i++) if(!data->modelData->stringAlias[i].filterOutput && data->modelData->stringAlias[i].aliasType != 1) {
-    strLength += MMC_STRLEN(data->localData[0]->stringVars[data->modelData->stringAlias[i].nameID]) + 1;
+  if(iaData->skip > 0)
+  {
+    /* decimated because the client is too slow */
+    iaData->skip--;
+    iaData->droppedPoints++;
+    iaData->lastSkipped = true;
+    rt_accumulate(SIM_TIMER_OUTPUT);
+    TRACE_POP
+    return;
   }
+  iaData->skip = iaData->decimation - 1;
+  iaData->lastSkipped = false;
 
-  unsigned int msgSIZE = iaData->nReal*sizeof(modelica_real) + iaData->nInteger*sizeof(modelica_integer) + iaData->nBoolean*sizeof(modelica_boolean) + strLength;
-  char* msgDATA = new char[msgSIZE];
-  unsigned int offset = 0;
+  sim_result_gatherRow(gather, data, 0, iaData->row);
+  realAliases = row + 1 + gather->real.nVars + gather->integer.nVars + gather->boolean.nVars;
+  integerAliases = realAliases + gather->real.nAliases;
+  booleanAliases = integerAliases + gather->integer.nAliases;
 
-  // time
-  memcpy(msgDATA+offset, &(data->localData[0]->timeValue), sizeof(modelica_real)); offset += sizeof(modelica_real);
-  for(i=0; i<data->modelData->nVariablesReal; i++) if(!data->modelData->realVarsData[i].filterOutput)
-  {
-    memcpy(msgDATA+offset, &(data->localData[0]->realVars[i]), sizeof(modelica_real)); offset += sizeof(modelica_real);
+  // count string length
+  unsigned int strLength = 0;
+  for(i=0; i<gather->string.nVars; i++) {
+    strLength += MMC_STRLEN(data->localData[0]->stringVars[gather->string.vars[i]]) + 1;
+  }
+  for(i=0; i<gather->string.nAliases; i++) {
+    strLength += MMC_STRLEN(data->localData[0]->stringVars[gather->string.aliasSource[i]]) + 1;
   }
 
-  modelica_real value = 0;
-  for(i=0; i<data->modelData->nAliasReal; i++) if(!data->modelData->realAlias[i].filterOutput && data->modelData->realAlias[i].aliasType != 1)
+  unsigned int msgSIZE = iaData->fixedSize + strLength;
+  ia_buffer *buffer = &iaData->buffers[iaData->curBuffer];
+  if(buffer->size + IA_HEADER_SIZE + msgSIZE > buffer->capacity)
   {
-    if (data->modelData->realAlias[i].aliasType == 2)
-      value = (data->localData[0])->timeValue;
-    else
-      value = (data->localData[0])->realVars[data->modelData->realAlias[i].nameID];
-
-    if (data->modelData->realAlias[i].negate)
-      value *= -1.0;
-
-    memcpy(msgDATA+offset, &value, sizeof(modelica_real)); offset += sizeof(modelica_real);
+    buffer->capacity = 2*(buffer->size + IA_HEADER_SIZE + msgSIZE);
+    buffer->data = (char*) realloc(buffer->data, buffer->capacity);
+    if(!buffer->data) {
+      throwStreamPrint(threadData, "Cannot allocate memory");
+    }
   }
 
+  /* the message is written directly into the buffer */
+  char* msgDATA = buffer->data + buffer->size;
+  const char id = 4;
+  memcpy(msgDATA, &id, sizeof(char));
+  memcpy(msgDATA+sizeof(char), &msgSIZE, sizeof(unsigned int));
+  unsigned int offset = IA_HEADER_SIZE;
 
-  for(i=0; i<data->modelData->nVariablesInteger; i++) if(!data->modelData->integerVarsData[i].filterOutput)
-  {
-    memcpy(msgDATA+offset, &(data->localData[0]->integerVars[i]), sizeof(modelica_integer)); offset += sizeof(modelica_integer);
-  }
+  // time and the reals are contiguous in the gathered row
+  memcpy(msgDATA+offset, row, (1+gather->real.nVars)*sizeof(modelica_real)); offset += (1+gather->real.nVars)*sizeof(modelica_real);
+  row += 1+gather->real.nVars;
+  memcpy(msgDATA+offset, realAliases, gather->real.nAliases*sizeof(modelica_real)); offset += gather->real.nAliases*sizeof(modelica_real);
 
   modelica_integer intValue = 0;
-  for(i=0; i<data->modelData->nAliasInteger; i++) if(!data->modelData->integerAlias[i].filterOutput && data->modelData->integerAlias[i].aliasType != 1)
+  for(i=0; i<gather->integer.nVars; i++)
   {
-    if (data->modelData->integerAlias[i].negate)
-      intValue = -(data->localData[0]->integerVars[data->modelData->integerAlias[i].nameID]);
-    else
-      intValue = data->localData[0]->integerVars[data->modelData->integerAlias[i].nameID];
-
+    intValue = (modelica_integer) *row++;
     memcpy(msgDATA+offset, &intValue, sizeof(modelica_integer)); offset += sizeof(modelica_integer);
   }
-
-
-  for(i=0; i<data->modelData->nVariablesBoolean; i++) if(!data->modelData->booleanVarsData[i].filterOutput)
+  for(i=0; i<gather->integer.nAliases; i++)
   {
-    memcpy(msgDATA+offset, &(data->localData[0]->booleanVars[i]), sizeof(modelica_boolean)); offset += sizeof(modelica_boolean);
+    intValue = (modelica_integer) integerAliases[i];
+    memcpy(msgDATA+offset, &intValue, sizeof(modelica_integer)); offset += sizeof(modelica_integer);
   }
 
   modelica_boolean boolValue;
-  for(i=0; i<data->modelData->nAliasBoolean; i++) if(!data->modelData->booleanAlias[i].filterOutput && data->modelData->booleanAlias[i].aliasType != 1)
+  for(i=0; i<gather->boolean.nVars; i++)
   {
-    if (data->modelData->booleanAlias[i].negate)
-      boolValue = (data->localData[0])->booleanVars[data->modelData->booleanAlias[i].nameID]==1?0:1;
-    else
-      boolValue = (data->localData[0])->booleanVars[data->modelData->booleanAlias[i].nameID];
-
+    boolValue = (modelica_boolean) *row++;
     memcpy(msgDATA+offset, &boolValue, sizeof(modelica_boolean)); offset += sizeof(modelica_boolean);
   }
-
-
-  for(i=0; i<data->modelData->nVariablesString; i++) if(!data->modelData->stringVarsData[i].filterOutput)
+  for(i=0; i<gather->boolean.nAliases; i++)
   {
-    strLength = MMC_STRLEN((data->localData[0])->stringVars[i]) + 1;
-    memcpy(msgDATA+offset, MMC_STRINGDATA((data->localData[0])->stringVars[i]), strLength); offset += strLength;
+    boolValue = (modelica_boolean) booleanAliases[i];
+    memcpy(msgDATA+offset, &boolValue, sizeof(modelica_boolean)); offset += sizeof(modelica_boolean);
   }
 
-  for(i=0; i<data->modelData->nAliasString; i++) if(!data->modelData->stringAlias[i].filterOutput && data->modelData->stringAlias[i].aliasType != 1)
+  for(i=0; i<gather->string.nVars; i++)
+  {
+    modelica_string str = (data->localData[0])->stringVars[gather->string.vars[i]];
+    strLength = MMC_STRLEN(str) + 1;
+    memcpy(msgDATA+offset, MMC_STRINGDATA(str), strLength); offset += strLength;
+  }
+  for(i=0; i<gather->string.nAliases; i++)
   {
-    strLength = MMC_STRLEN((data->localData[0])->stringVars[data->modelData->stringAlias[i].nameID]) + 1;
-    memcpy(msgDATA+offset, MMC_STRINGDATA((data->localData[0])->stringVars[data->modelData->stringAlias[i].nameID]), strLength); offset += strLength;
+    modelica_string str = (data->localData[0])->stringVars[gather->string.aliasSource[i]];
+    strLength = MMC_STRLEN(str) + 1;
+    memcpy(msgDATA+offset, MMC_STRINGDATA(str), strLength); offset += strLength;
   }
 
-  communicateMsg(4, msgSIZE, msgDATA);
-  delete[] msgDATA;
+  assert(offset == IA_HEADER_SIZE + msgSIZE);
+  buffer->size += offset;
+  iaData->lastSize = offset;
+  if(++buffer->npoints >= iaData->batch)
+    ia_submitBuffer(iaData, false);
 
   rt_accumulate(SIM_TIMER_OUTPUT);
   TRACE_POP
@@ -299,9 +404,136 @@ void ia_free(simulation_result *self, DATA *data, threadData_t *threadData)
   TRACE_PUSH
   rt_tick(SIM_TIMER_OUTPUT);
 
-  delete (IA_DATA*)self->storage;
+  IA_DATA *iaData = (IA_DATA*)self->storage;
+  /* the final time point is always sent */
+  if(iaData->lastSkipped)
+  {
+    iaData->skip = 0;
+    iaData->droppedPoints--;
+    ia_emit(self, data, threadData);
+  }
+  ia_submitBuffer(iaData, true);
+  ia_stopSender(iaData);
+  infoStreamPrint(LOG_STATS, 0, "ia result: %lu time points sent, %lu dropped", iaData->sentPoints, iaData->droppedPoints);
+  for(int i=0; i<IA_NUM_BUFFERS; i++)
+    free(iaData->buffers[i].data);
+  sim_result_freeGather(&iaData->gather);
+  delete[] iaData->row;
+  delete iaData;
   communicateMsg(6, 0, 0);
 
   rt_accumulate(SIM_TIMER_OUTPUT);
   TRACE_POP
 }
+
+static void* ia_senderThread(void *arg)
+{
+  IA_DATA *iaData = (IA_DATA*) arg;
+  ia_buffer *buffer;
+
+  pthread_mutex_lock(&iaData->mutex);
+  for(;;)
+  {
+    while(0 == iaData->queuedBuffers && !iaData->stopSender)
+      pthread_cond_wait(&iaData->queueCond, &iaData->mutex);
+    if(0 == iaData->queuedBuffers)
+      break;
+
+    /* the buffer stays queued while it is sent, so emit() cannot reuse it */
+    buffer = &iaData->buffers[iaData->headBuffer];
+    pthread_mutex_unlock(&iaData->mutex);
+    communicateBytes(buffer->size, buffer->data);
+    buffer->size = 0;
+    buffer->npoints = 0;
+    pthread_mutex_lock(&iaData->mutex);
+
+    iaData->headBuffer = (iaData->headBuffer+1) % IA_NUM_BUFFERS;
+    iaData->queuedBuffers--;
+    pthread_cond_broadcast(&iaData->queueCond);
+  }
+  pthread_mutex_unlock(&iaData->mutex);
+  return NULL;
+}
+
+static void ia_startSender(IA_DATA *iaData)
+{
+  iaData->curBuffer = 0;
+  iaData->headBuffer = 0;
+  iaData->queuedBuffers = 0;
+  iaData->decimation = 1;
+  iaData->skip = 0;
+  iaData->lastSkipped = false;
+  iaData->lastSize = 0;
+  iaData->sentPoints = 0;
+  iaData->droppedPoints = 0;
+  iaData->stopSender = false;
+
+  pthread_mutex_init(&iaData->mutex, NULL);
+  pthread_cond_init(&iaData->queueCond, NULL);
+  iaData->useThread = (0 == pthread_create(&iaData->sender, NULL, ia_senderThread, iaData));
+  if(!iaData->useThread)
+  {
+    warningStreamPrint(LOG_STDOUT, 0, "Could not start the ia sender thread, sending the results synchronously.");
+    pthread_cond_destroy(&iaData->queueCond);
+    pthread_mutex_destroy(&iaData->mutex);
+  }
+}
+
+static void ia_stopSender(IA_DATA *iaData)
+{
+  if(!iaData->useThread)
+    return;
+  pthread_mutex_lock(&iaData->mutex);
+  iaData->stopSender = true;
+  pthread_cond_broadcast(&iaData->queueCond);
+  pthread_mutex_unlock(&iaData->mutex);
+  pthread_join(iaData->sender, NULL);
+  pthread_cond_destroy(&iaData->queueCond);
+  pthread_mutex_destroy(&iaData->mutex);
+  iaData->useThread = false;
+}
+
+/* hands the current buffer over to the sender thread. If no other buffer is
+ * free, the policy decides whether to wait for the client or to drop the
+ * time points; flush always waits. */
+static void ia_submitBuffer(IA_DATA *iaData, bool flush)
+{
+  ia_buffer *buffer = &iaData->buffers[iaData->curBuffer];
+
+  if(0 == buffer->npoints)
+    return;
+
+  if(!iaData->useThread)
+  {
+    communicateBytes(buffer->size, buffer->data);
+    iaData->sentPoints += buffer->npoints;
+    buffer->size = 0;
+    buffer->npoints = 0;
+    return;
+  }
+
+  pthread_mutex_lock(&iaData->mutex);
+  if(iaData->queuedBuffers == IA_NUM_BUFFERS-1 && iaData->policy != IA_POLICY_BLOCK && !flush)
+  {
+    /* the client is behind by all other buffers; keep only the newest time point */
+    iaData->droppedPoints += buffer->npoints - 1;
+    memmove(buffer->data, buffer->data + buffer->size - iaData->lastSize, iaData->lastSize);
+    buffer->size = iaData->lastSize;
+    buffer->npoints = 1;
+    if(iaData->policy == IA_POLICY_DECIMATE && iaData->decimation < IA_MAX_DECIMATION)
+      iaData->decimation *= 2;
+    pthread_mutex_unlock(&iaData->mutex);
+    return;
+  }
+
+  iaData->queuedBuffers++;
+  iaData->sentPoints += buffer->npoints;
+  /* the client caught up, send more time points again */
+  if(iaData->queuedBuffers == 1 && iaData->decimation > 1)
+    iaData->decimation /= 2;
+  pthread_cond_broadcast(&iaData->queueCond);
+  while(iaData->queuedBuffers == IA_NUM_BUFFERS)
+    pthread_cond_wait(&iaData->queueCond, &iaData->mutex);
+  iaData->curBuffer = (iaData->curBuffer+1) % IA_NUM_BUFFERS;
+  pthread_mutex_unlock(&iaData->mutex);
+}
@@ -31,6 +31,7 @@
 #include "util/omc_error.h"
 #include "simulation_result_mat.h"
 #include "util/rtclock.h"
+#include "simulation/options.h"
 
 #include <fstream>
 #include <iostream>
@@ -39,16 +40,39 @@
 #include <utility>
 #include <cstring>
 #include <cstdlib>
+#include <cstdio>
 #include <stdint.h>
 #include <assert.h>
+#include <pthread.h>
 
 extern "C" {
 
 typedef std::pair<void*,int> indx_type;
 typedef std::map<int,int> INTMAP;
 
+/* The rows of `data_2' are packed into preallocated blocks by emit() and a
+ * background thread writes the full blocks to the file. The solver thread
+ * only has to wait for the disk if all blocks are queued for writing. */
+#define MAT4_BLOCK_BYTES (1<<20) /* size of one block of time points */
+#define MAT4_NUM_BLOCKS 4        /* number of blocks in the queue */
+
+/* With -matByVariable the time points are written to a temporary file and
+ * `data_2' is transposed from it in chunks of time points of at most this
+ * size, so results which are larger than the main memory can be transposed
+ * as well. */
+#define MAT4_TRANSPOSE_BYTES (64<<20)
+
+typedef struct mat_block {
+  double *values;
+  unsigned int nrows; /* number of time points stored in values */
+} mat_block;
+
 typedef struct mat_data {
   std::ofstream fp;
+  std::ofstream tmpFp;  /* time points, if they are transposed at the end */
+  std::string tmpFilename;
+  std::ofstream *rowFp; /* file the time points are written to */
+  bool byVariable;      /* binNormal instead of binTrans layout */
   std::ofstream::pos_type data1HdrPos; /* position of data_1 matrix's header in a file */
   std::ofstream::pos_type data2HdrPos; /* position of data_2 matrix's header in a file */
   unsigned long ntimepoints; /* count of how many time emits() was called */
@@ -64,17 +88,41 @@ typedef struct mat_data {
 
   unsigned int negatedboolaliases;
   int numVars;
+
+  /* buffered writing of `data_2' */
+  sim_result_gather gather;
+  unsigned int rowSize;   /* number of doubles per time point */
+  unsigned int blockRows; /* number of time points per block */
+  mat_block blocks[MAT4_NUM_BLOCKS];
+  unsigned int curBlock;     /* block which is filled by emit() */
+  unsigned int headBlock;    /* next block written by the writer thread */
+  unsigned int queuedBlocks; /* number of blocks waiting for the writer thread */
+  unsigned int maxQueued;    /* largest backlog of the writer thread */
+  double stallTime;          /* time emit() waited for a free block */
+  bool useThread;
+  bool stopWriter;
+  bool writeError;
+  pthread_t writer;
+  pthread_mutex_t mutex;
+  pthread_cond_t queueCond;
 } mat_data;
 
 static long flattenStrBuf(int dims, const struct VAR_INFO** src, char* &dest, int& longest, int& nstrings, bool fixNames, bool useComment);
 static void mat_writeMatVer4MatrixHeader(simulation_result *self,DATA *data, threadData_t *threadData,const char *name, int rows, int cols, unsigned int size);
 static void mat_writeMatVer4Matrix(simulation_result *self,DATA *data, threadData_t *threadData, const char *name, int rows, int cols, const void *, unsigned int size);
+static void mat_writeMatVer4Table(simulation_result *self,DATA *data, threadData_t *threadData, const char *name, int rows, int cols, const void *, unsigned int size);
+static bool mat_writeTransposedData_2(simulation_result *self, mat_data *matData);
 static void generateDataInfo(simulation_result *self,DATA *data, threadData_t *threadData,int* &dataInfo, int& rows, int& cols, int nVars, int nParams);
 static void generateData_1(DATA *data, threadData_t *threadData, double* &data_1, int& rows, int& cols, double tstart, double tstop);
 
 static int calcDataSize(simulation_result *self,DATA *data);
 static const VAR_INFO** calcDataNames(simulation_result *self,DATA *data,int dataSize);
 
+static void mat4_startWriter(mat_data *matData);
+static void mat4_stopWriter(mat_data *matData);
+static bool mat4_submitBlock(mat_data *matData);
+static bool mat4_flushBlocks(mat_data *matData);
+
 static const struct VAR_INFO timeValName = {0,-1,"time","Simulation time [s]",{"",-1,-1,-1,-1}};
 static const struct VAR_INFO cpuTimeValName = {0,-1,"$cpuTime","cpu time [s]",{"",-1,-1,-1,-1}};
 
@@ -175,12 +223,16 @@ void mat4_writeParameterData(simulation_result *self,DATA *data, threadData_t *t
   double *doubleMatrix = NULL;
   try
   {
+    /* the writer thread must be done with the file before we seek */
+    if(!mat4_flushBlocks(matData)) {
+      throwStreamPrint(threadData, "Error while writing file %s",self->filename);
+    }
     std::ofstream::pos_type remember = matData->fp.tellp();
     matData->fp.seekp(matData->data1HdrPos);
     /* generate `data_1' matrix (with parameter data) */
     generateData_1(data, threadData, doubleMatrix, rows, cols, matData->startTime, matData->stopTime);
     /*  write `data_1' matrix */
-    mat_writeMatVer4Matrix(self,data, threadData,"data_1", cols, rows, doubleMatrix, sizeof(double));
+    mat_writeMatVer4Table(self,data, threadData,"data_1", rows, cols, doubleMatrix, sizeof(double));
     free(doubleMatrix); doubleMatrix = NULL;
     matData->fp.seekp(remember);
   }
@@ -198,7 +250,8 @@ void mat4_init(simulation_result *self,DATA *data, threadData_t *threadData)
   self->storage = matData;
   const MODEL_DATA *mData = data->modelData;
 
-  const char Aclass[] = "A1 bt. ir1 na  Tj  re  ac  nt  so   r   y   ";
+  const char AclassBinTrans[] = "A1 bt. ir1 na  Tj  re  ac  nt  so   r   y   ";
+  const char AclassBinNormal[] = "A1 bt. ir1 na  Nj  oe  rc  mt  ao  lr   y   ";
 
   const struct VAR_INFO** names = NULL;
   const int nParams = mData->nParametersReal + mData->nParametersInteger + mData->nParametersBoolean;
@@ -216,6 +269,8 @@ void mat4_init(simulation_result *self,DATA *data, threadData_t *threadData)
   matData->ntimepoints = 0;
   matData->startTime = data->simulationInfo->startTime;
   matData->stopTime = data->simulationInfo->stopTime;
+  matData->byVariable = omc_flag[FLAG_MAT_BY_VARIABLE];
+  matData->rowFp = &matData->fp;
 
   try {
     /* open file */
@@ -223,25 +278,33 @@ void mat4_init(simulation_result *self,DATA *data, threadData_t *threadData)
     if(!matData->fp) {
       throwStreamPrint(threadData, "Cannot open File %s for writing",self->filename);
     }
+    if(matData->byVariable) {
+      matData->tmpFilename = std::string(self->filename) + ".tmp";
+      matData->tmpFp.open(matData->tmpFilename.c_str(), std::ofstream::binary|std::ofstream::trunc);
+      if(!matData->tmpFp) {
+        throwStreamPrint(threadData, "Cannot open File %s for writing",matData->tmpFilename.c_str());
+      }
+      matData->rowFp = &matData->tmpFp;
+    }
 
     /* write `AClass' matrix */
-    mat_writeMatVer4Matrix(self,data, threadData,"Aclass", 4, 11, Aclass, sizeof(int8_t));
+    mat_writeMatVer4Matrix(self,data, threadData,"Aclass", 4, 11, matData->byVariable ? AclassBinNormal : AclassBinTrans, sizeof(int8_t));
     /* flatten variables' names */
     flattenStrBuf(matData->numVars+nParams, names, stringMatrix, rows, cols, false /* We cannot plot derivatives if we fix the names ... */, false);
     /* write `name' matrix */
-    mat_writeMatVer4Matrix(self,data,threadData,"name", rows, cols, stringMatrix, sizeof(int8_t));
+    mat_writeMatVer4Table(self,data,threadData,"name", cols, rows, stringMatrix, sizeof(int8_t));
     free(stringMatrix); stringMatrix = NULL;
 
     /* flatten variables' comments */
     flattenStrBuf(matData->numVars+nParams, names, stringMatrix, rows, cols, false, true);
     /* write `description' matrix */
-    mat_writeMatVer4Matrix(self,data,threadData,"description", rows, cols, stringMatrix, sizeof(int8_t));
+    mat_writeMatVer4Table(self,data,threadData,"description", cols, rows, stringMatrix, sizeof(int8_t));
     free(stringMatrix); stringMatrix = NULL;
 
     /* generate dataInfo table */
     generateDataInfo(self, data, threadData, intMatrix, rows, cols, matData->numVars, nParams);
     /* write `dataInfo' matrix */
-    mat_writeMatVer4Matrix(self, data, threadData, "dataInfo", cols, rows, intMatrix, sizeof(int32_t));
+    mat_writeMatVer4Table(self, data, threadData, "dataInfo", rows, cols, intMatrix, sizeof(int32_t));
 
     /* remember data1HdrPos */
     matData->data1HdrPos = matData->fp.tellp();
@@ -250,12 +313,19 @@ void mat4_init(simulation_result *self,DATA *data, threadData_t *threadData)
     /* generate `data_1' matrix (with parameter data) */
     generateData_1(data, threadData, doubleMatrix, rows, cols, matData->startTime, matData->stopTime);
     /*  write `data_1' matrix */
-    mat_writeMatVer4Matrix(self,data,threadData,"data_1", cols, rows, doubleMatrix, sizeof(double));
+    mat_writeMatVer4Table(self,data,threadData,"data_1", rows, cols, doubleMatrix, sizeof(double));
 
     /* remember data2HdrPos */
     matData->data2HdrPos = matData->fp.tellp();
     /* write `data_2' header */
-    mat_writeMatVer4MatrixHeader(self,data,threadData,"data_2", matData->r_indx_map.size() + matData->i_indx_map.size() + matData->b_indx_map.size() + matData->negatedboolaliases + 1 /* add one more for timeValue*/ + self->cpuTime, 0, sizeof(double));
+    matData->rowSize = matData->r_indx_map.size() + matData->i_indx_map.size() + matData->b_indx_map.size() + matData->negatedboolaliases + 1 /* add one more for timeValue*/ + self->cpuTime;
+    /* the other aliases refer to the stored variables in dataInfo */
+    sim_result_initGather(&matData->gather, mData, self->cpuTime, SIM_RESULT_ALIASES_NEGATED_BOOLEANS);
+    assert(matData->gather.rowSize == (long)matData->rowSize);
+    if(matData->byVariable)
+      mat_writeMatVer4MatrixHeader(self,data,threadData,"data_2", 0, matData->rowSize, sizeof(double));
+    else
+      mat_writeMatVer4MatrixHeader(self,data,threadData,"data_2", matData->rowSize, 0, sizeof(double));
 
     free(doubleMatrix);
     free(intMatrix);
@@ -263,10 +333,27 @@ void mat4_init(simulation_result *self,DATA *data, threadData_t *threadData)
     intMatrix = NULL;
     matData->fp.flush();
 
+    /* allocate the blocks for `data_2' */
+    matData->blockRows = MAT4_BLOCK_BYTES / (matData->rowSize*sizeof(double));
+    if(matData->blockRows == 0)
+      matData->blockRows = 1;
+    for(int i = 0; i < MAT4_NUM_BLOCKS; i++)
+    {
+      matData->blocks[i].values = (double*) malloc(matData->blockRows*matData->rowSize*sizeof(double));
+      matData->blocks[i].nrows = 0;
+      if(!matData->blocks[i].values) {
+        throwStreamPrint(threadData, "Cannot allocate memory");
+      }
+    }
+    mat4_startWriter(matData);
   }
   catch(...)
   {
     matData->fp.close();
+    if(matData->byVariable) {
+      matData->tmpFp.close();
+      remove(matData->tmpFilename.c_str());
+    }
     free(names); names=NULL;
     free(stringMatrix);
     free(doubleMatrix);
@@ -281,17 +368,35 @@ void mat4_init(simulation_result *self,DATA *data, threadData_t *threadData)
 void mat4_free(simulation_result *self,DATA *data, threadData_t *threadData)
 {
   mat_data *matData = (mat_data*) self->storage;
+  bool transposed = true;
   rt_tick(SIM_TIMER_OUTPUT);
   /* this is a bad programming practice - closing file in destructor,
    * where a proper error reporting can't be done
    * It's ok now; it's not even C++ code :D
    */
   if(matData->fp)
+  {
+    mat4_flushBlocks(matData);
+  }
+  mat4_stopWriter(matData);
+  infoStreamPrint(LOG_STATS, 0, "result file: %lu time points, max. %u of %d blocks queued, %gs waited for the writer", matData->ntimepoints, matData->maxQueued, MAT4_NUM_BLOCKS, matData->stallTime);
+  if(matData->fp && matData->byVariable)
+  {
+    /* the time points are complete, store them variable by variable */
+    matData->tmpFp.close();
+    transposed = mat_writeTransposedData_2(self, matData);
+    remove(matData->tmpFilename.c_str());
+  }
+  /* without the transposed data `data_2' keeps its header without time points */
+  if(matData->fp && transposed)
   {
     try
     {
       matData->fp.seekp(matData->data2HdrPos);
-      mat_writeMatVer4MatrixHeader(self,data,threadData,"data_2", matData->r_indx_map.size() + matData->i_indx_map.size() + matData->b_indx_map.size() + matData->negatedboolaliases + 1 /* add one more for timeValue*/ + self->cpuTime, matData->ntimepoints, sizeof(double));
+      if(matData->byVariable)
+        mat_writeMatVer4MatrixHeader(self,data,threadData,"data_2", matData->ntimepoints, matData->rowSize, sizeof(double));
+      else
+        mat_writeMatVer4MatrixHeader(self,data,threadData,"data_2", matData->rowSize, matData->ntimepoints, sizeof(double));
       matData->fp.close();
     }
     catch (...)
@@ -299,54 +404,165 @@ void mat4_free(simulation_result *self,DATA *data, threadData_t *threadData)
       /* just ignore, we are in destructor */
     }
   }
+  for(int i = 0; i < MAT4_NUM_BLOCKS; i++)
+    free(matData->blocks[i].values);
+  sim_result_freeGather(&matData->gather);
   delete matData;
   self->storage = NULL;
   rt_accumulate(SIM_TIMER_OUTPUT);
+  if(!transposed) {
+    throwStreamPrint(threadData, "Error while transposing the results of file %s", self->filename);
+  }
 }
 
 void mat4_emit(simulation_result *self,DATA *data, threadData_t *threadData)
 {
   mat_data *matData = (mat_data*) self->storage;
-  double datPoint=0;
+  mat_block *block = &matData->blocks[matData->curBlock];
+  double *row = block->values + (size_t)block->nrows*matData->rowSize;
   rt_tick(SIM_TIMER_OUTPUT);
 
   rt_accumulate(SIM_TIMER_TOTAL);
   double cpuTimeValue = rt_accumulated(SIM_TIMER_TOTAL);
   rt_tick(SIM_TIMER_TOTAL);
 
-  /* this is done wrong -- a buffering should be used
-     although ofstream does have some buffering, but it is not enough and
-     not for this purpose */
-  matData->fp.write((char*)&(data->localData[0]->timeValue), sizeof(double));
-  if(self->cpuTime)
-    matData->fp.write((char*)&cpuTimeValue, sizeof(double));
-  for(int i = 0; i < data->modelData->nVariablesReal; i++) if(!data->modelData->realVarsData[i].filterOutput)
-    matData->fp.write((char*)&(data->localData[0]->realVars[i]),sizeof(double));
-  for(int i = 0; i < data->modelData->nVariablesInteger; i++) if(!data->modelData->integerVarsData[i].filterOutput)
-    {
-      datPoint = (double) data->localData[0]->integerVars[i];
-      matData->fp.write((char*)&datPoint,sizeof(double));
-    }
-  for(int i = 0; i < data->modelData->nVariablesBoolean; i++) if(!data->modelData->booleanVarsData[i].filterOutput)
-    {
-      datPoint = (double) data->localData[0]->booleanVars[i];
-      matData->fp.write((char*)&datPoint,sizeof(double));
-    }
-  for(int i = 0; i < data->modelData->nAliasBoolean; i++) if(!data->modelData->booleanAlias[i].filterOutput)
-    {
-      if(data->modelData->booleanAlias[i].negate)
-      {
-        datPoint = (double) (data->localData[0]->booleanVars[data->modelData->booleanAlias[i].nameID]==1?0:1);
-        matData->fp.write((char*)&datPoint,sizeof(double));
-      }
-    }
-  if (!matData->fp) {
+  /* pack the time point into the current block; it is written to the file
+   * by the writer thread once the block is full */
+  sim_result_gatherRow(&matData->gather, data, cpuTimeValue, row);
+  ++block->nrows;
+  ++matData->ntimepoints;
+
+  if(block->nrows == matData->blockRows && !mat4_submitBlock(matData)) {
     throwStreamPrint(threadData, "Error while writing file %s",self->filename);
   }
-  ++matData->ntimepoints;
   rt_accumulate(SIM_TIMER_OUTPUT);
 }
 
+/* writes all time points of a block to the file; returns false on failure */
+static bool mat4_writeBlock(mat_data *matData, mat_block *block)
+{
+  matData->rowFp->write((const char*)block->values, sizeof(double)*matData->rowSize*block->nrows);
+  block->nrows = 0;
+  return !matData->rowFp->fail();
+}
+
+static void* mat4_writerThread(void *arg)
+{
+  mat_data *matData = (mat_data*) arg;
+  mat_block *block;
+  bool ok;
+
+  pthread_mutex_lock(&matData->mutex);
+  for(;;)
+  {
+    while(0 == matData->queuedBlocks && !matData->stopWriter)
+      pthread_cond_wait(&matData->queueCond, &matData->mutex);
+    if(0 == matData->queuedBlocks)
+      break;
+
+    /* the block stays queued while it is written, so emit() cannot reuse it */
+    block = &matData->blocks[matData->headBlock];
+    pthread_mutex_unlock(&matData->mutex);
+    ok = mat4_writeBlock(matData, block);
+    pthread_mutex_lock(&matData->mutex);
+
+    if(!ok)
+      matData->writeError = true;
+    matData->headBlock = (matData->headBlock+1) % MAT4_NUM_BLOCKS;
+    matData->queuedBlocks--;
+    pthread_cond_broadcast(&matData->queueCond);
+  }
+  pthread_mutex_unlock(&matData->mutex);
+  return NULL;
+}
+
+static void mat4_startWriter(mat_data *matData)
+{
+  matData->curBlock = 0;
+  matData->headBlock = 0;
+  matData->queuedBlocks = 0;
+  matData->maxQueued = 0;
+  matData->stallTime = 0.0;
+  matData->stopWriter = false;
+  matData->writeError = false;
+
+  pthread_mutex_init(&matData->mutex, NULL);
+  pthread_cond_init(&matData->queueCond, NULL);
+  matData->useThread = (0 == pthread_create(&matData->writer, NULL, mat4_writerThread, matData));
+  if(!matData->useThread)
+  {
+    warningStreamPrint(LOG_STDOUT, 0, "Could not start the result writer thread, writing the result file synchronously.");
+    pthread_cond_destroy(&matData->queueCond);
+    pthread_mutex_destroy(&matData->mutex);
+  }
+}
+
+static void mat4_stopWriter(mat_data *matData)
+{
+  if(!matData->useThread)
+    return;
+  pthread_mutex_lock(&matData->mutex);
+  matData->stopWriter = true;
+  pthread_cond_broadcast(&matData->queueCond);
+  pthread_mutex_unlock(&matData->mutex);
+  pthread_join(matData->writer, NULL);
+  pthread_cond_destroy(&matData->queueCond);
+  pthread_mutex_destroy(&matData->mutex);
+  matData->useThread = false;
+}
+
+/* hands the current block over to the writer thread and waits until the
+ * next block is free; returns false if writing the file failed */
+static bool mat4_submitBlock(mat_data *matData)
+{
+  mat_block *block = &matData->blocks[matData->curBlock];
+  bool ok;
+
+  if(0 == block->nrows)
+    return !matData->writeError;
+
+  if(!matData->useThread)
+  {
+    if(!mat4_writeBlock(matData, block))
+      matData->writeError = true;
+    return !matData->writeError;
+  }
+
+  pthread_mutex_lock(&matData->mutex);
+  matData->queuedBlocks++;
+  if(matData->queuedBlocks > matData->maxQueued)
+    matData->maxQueued = matData->queuedBlocks;
+  pthread_cond_broadcast(&matData->queueCond);
+  matData->curBlock = (matData->curBlock+1) % MAT4_NUM_BLOCKS;
+  if(matData->queuedBlocks == MAT4_NUM_BLOCKS)
+  {
+    rtclock_t stallClock;
+    rt_ext_tp_tick(&stallClock);
+    while(matData->queuedBlocks == MAT4_NUM_BLOCKS)
+      pthread_cond_wait(&matData->queueCond, &matData->mutex);
+    matData->stallTime += rt_ext_tp_tock(&stallClock);
+  }
+  ok = !matData->writeError;
+  pthread_mutex_unlock(&matData->mutex);
+  return ok;
+}
+
+/* writes all pending time points to the file */
+static bool mat4_flushBlocks(mat_data *matData)
+{
+  bool ok = mat4_submitBlock(matData);
+
+  if(matData->useThread)
+  {
+    pthread_mutex_lock(&matData->mutex);
+    while(matData->queuedBlocks > 0)
+      pthread_cond_wait(&matData->queueCond, &matData->mutex);
+    ok = !matData->writeError;
+    pthread_mutex_unlock(&matData->mutex);
+  }
+  return ok;
+}
+
 /* from an array of string creates flatten 'char*'-array suitable to be
    stored as MAT-file matrix */
 static inline void fixDerInName(char *str, size_t len)
@@ -447,6 +663,97 @@ void mat_writeMatVer4Matrix(simulation_result *self, DATA *data, threadData_t *t
   }
 }
 
+/* writes a matrix which is given row by row; it is stored transposed in the
+ * binTrans layout and as it is in the binNormal layout */
+void mat_writeMatVer4Table(simulation_result *self, DATA *data, threadData_t *threadData, const char *name, int rows, int cols, const void *matrixData, unsigned int size)
+{
+  mat_data *matData = (mat_data*) self->storage;
+  if(!matData->byVariable)
+  {
+    mat_writeMatVer4Matrix(self, data, threadData, name, cols, rows, matrixData, size);
+    return;
+  }
+
+  /* MAT-files are stored column by column */
+  char *columns = (char*) malloc((size_t)size*rows*cols + 1);
+  assertStreamPrint(threadData, 0!=columns, "Cannot allocate memory");
+  for(int r = 0; r < rows; ++r)
+    for(int c = 0; c < cols; ++c)
+      memcpy(columns + ((size_t)c*rows + r)*size, (const char*)matrixData + ((size_t)r*cols + c)*size, size);
+  try
+  {
+    mat_writeMatVer4Matrix(self, data, threadData, name, rows, cols, columns, size);
+  }
+  catch(...)
+  {
+    free(columns);
+    throw;
+  }
+  free(columns);
+}
+
+/* Copies the time points from the temporary file into `data_2' variable by
+ * variable. The temporary file is read once from the start to the end in
+ * chunks of nt time points that fit into MAT4_TRANSPOSE_BYTES; every chunk
+ * is transposed and its part of each column is written to the output file. */
+static bool mat_writeTransposedData_2(simulation_result *self, mat_data *matData)
+{
+  const size_t nrows = matData->ntimepoints;
+  const size_t nvars = matData->rowSize;
+  const std::ofstream::pos_type data2Pos = matData->data2HdrPos + (std::ofstream::off_type)(sizeof(uint32_t)*5 + strlen("data_2") + 1);
+  double *readBuf = matData->blocks[0].values; /* the blocks are not needed any more */
+  size_t readRows = matData->blockRows;
+  size_t nt;
+  double *tile;
+  FILE *in;
+  bool ok = true;
+
+  if(0 == nrows || 0 == nvars)
+    return true;
+
+  nt = MAT4_TRANSPOSE_BYTES / (nvars*sizeof(double));
+  nt = nt < 1 ? 1 : (nt > nrows ? nrows : nt);
+
+  in = fopen(matData->tmpFilename.c_str(), "rb");
+  if(!in)
+    return false;
+  tile = (double*) malloc(nvars*nt*sizeof(double));
+  if(!tile)
+  {
+    fclose(in);
+    return false;
+  }
+
+  for(size_t t0 = 0; ok && t0 < nrows; t0 += nt)
+  {
+    size_t t1 = t0+nt > nrows ? nrows : t0+nt;
+    /* read the time points t0..t1 and transpose them into the tile */
+    for(size_t t = t0; t < t1; t += readRows)
+    {
+      size_t n = t+readRows > t1 ? t1-t : readRows;
+      if(n*nvars != fread(readBuf, sizeof(double), n*nvars, in))
+      {
+        ok = false;
+        break;
+      }
+      for(size_t r = 0; r < n; ++r)
+        for(size_t v = 0; v < nvars; ++v)
+          tile[v*nt + (t-t0) + r] = readBuf[r*nvars + v];
+    }
+    /* write the time points t0..t1 of every column */
+    for(size_t v = 0; ok && v < nvars; ++v)
+    {
+      matData->fp.seekp(data2Pos + (std::ofstream::off_type)((v*nrows + t0)*sizeof(double)));
+      matData->fp.write((const char*)(tile + v*nt), (t1-t0)*sizeof(double));
+      ok = !matData->fp.fail();
+    }
+  }
+
+  free(tile);
+  fclose(in);
+  return ok;
+}
+
 
 void generateDataInfo(simulation_result *self, DATA *data, threadData_t *threadData, int32_t* &dataInfo, int& rows, int& cols, int nVars, int nParams)
 {
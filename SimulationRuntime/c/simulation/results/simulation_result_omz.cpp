@@ -0,0 +1,451 @@
+/*
+ * This file is part of OpenModelica.
+ *
+ * Copyright (c) 1998-CurrentYear, Open Source Modelica Consortium (OSMC),
+ * c/o Linköpings universitet, Department of Computer and Information Science,
+ * SE-58183 Linköping, Sweden.
+ *
+ * All rights reserved.
+ *
+ * THIS PROGRAM IS PROVIDED UNDER THE TERMS OF THE BSD NEW LICENSE OR THE
+ * GPL VERSION 3 LICENSE OR THE OSMC PUBLIC LICENSE (OSMC-PL) VERSION 1.2.
+ * ANY USE, REPRODUCTION OR DISTRIBUTION OF THIS PROGRAM CONSTITUTES
+ * RECIPIENT'S ACCEPTANCE OF THE OSMC PUBLIC LICENSE OR THE GPL VERSION 3,
+ * ACCORDING TO RECIPIENTS CHOICE.
+ *
+ * The OpenModelica software and the OSMC (Open Source Modelica Consortium)
+ * Public License (OSMC-PL) are obtained from OSMC, either from the above
+ * address, from the URLs: http://www.openmodelica.org or
+ * http://www.ida.liu.se/projects/OpenModelica, and in the OpenModelica
+ * distribution. GNU version 3 is obtained from:
+ * http://www.gnu.org/copyleft/gpl.html. The New BSD License is obtained from:
+ * http://www.opensource.org/licenses/BSD-3-Clause.
+ *
+ * This program is distributed WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, EXCEPT AS
+ * EXPRESSLY SET FORTH IN THE BY RECIPIENT SELECTED SUBSIDIARY LICENSE
+ * CONDITIONS OF OSMC-PL.
+ *
+ */
+
+/* The compressed result format trades a little cpu time for much smaller
+ * files; see util/read_omz.h for the layout. */
+
+#include "util/omc_error.h"
+#include "util/read_omz.h"
+#include "simulation_result_omz.h"
+#include "util/rtclock.h"
+
+#include <fstream>
+#include <vector>
+#include <string.h>
+#include <assert.h>
+
+/* maximum number of time points per chunk */
+#define OMZ_CHUNK_ROWS 4096
+/* the encoded columns of a chunk are kept in memory until the chunk is
+ * complete; wide results get fewer rows per chunk to stay below this size */
+#define OMZ_CHUNK_BYTES (16<<20)
+/* largest encoding of one value: a real takes at most 9 bytes, an integer
+ * run of length one at most 1+10 bytes */
+#define OMZ_MAX_VALUE_BYTES 11
+
+extern "C" {
+
+typedef struct omz_column {
+  std::vector<unsigned char> bytes;
+  uint64_t prev;          /* reals: bit pattern of the previous value */
+  unsigned int repeats;   /* reals: unchanged values not yet written */
+  int64_t runValue;       /* integers/booleans: value of the current run */
+  unsigned int runLength; /* integers/booleans: length of the current run */
+} omz_column;
+
+typedef struct omz_chunk {
+  uint64_t offset;
+  uint32_t nrows;
+  double firstTime, lastTime;
+} omz_chunk;
+
+typedef struct omz_data {
+  std::ofstream fp;
+  std::vector<unsigned char> kinds;
+  sim_result_gather gather; /* variables stored as signals */
+  std::vector<omz_column> columns;
+  std::vector<omz_chunk> chunks;
+  uint32_t nrows; /* time points of the current chunk */
+  uint32_t chunkRows; /* time points per chunk */
+  double firstTime, lastTime;
+  uint64_t paramOffset;
+  unsigned long ntimepoints;
+  uint64_t chunkBytes;
+} omz_data;
+
+static void omz_write(std::ofstream &fp, const void *value, size_t size)
+{
+  fp.write((const char*) value, size);
+}
+
+static void omz_write_uint32(std::ofstream &fp, uint32_t value)
+{
+  omz_write(fp, &value, sizeof(uint32_t));
+}
+
+static void omz_write_str(std::ofstream &fp, const char *str)
+{
+  uint32_t len = str ? strlen(str) : 0;
+  omz_write_uint32(fp, len);
+  omz_write(fp, str, len);
+}
+
+static void omz_write_var(std::ofstream &fp, const VAR_INFO *info, bool isParam, int32_t index)
+{
+  unsigned char param = isParam;
+  omz_write_str(fp, info->name);
+  omz_write_str(fp, info->comment);
+  omz_write(fp, &param, 1);
+  omz_write(fp, &index, sizeof(int32_t));
+}
+
+static void omz_put_varint(std::vector<unsigned char> &bytes, uint64_t value)
+{
+  while(value >= 0x80) {
+    bytes.push_back((unsigned char) (value | 0x80));
+    value >>= 7;
+  }
+  bytes.push_back((unsigned char) value);
+}
+
+static void omz_flush_repeats(omz_column &col)
+{
+  if(col.repeats) {
+    col.bytes.push_back(0x80 | (col.repeats-1));
+    col.repeats = 0;
+  }
+}
+
+static void omz_put_real(omz_column &col, double value)
+{
+  uint64_t bits, x;
+  int lead = 0, trail = 0, n;
+
+  memcpy(&bits, &value, sizeof(double));
+  x = bits ^ col.prev;
+  col.prev = bits;
+  if(0 == x) {
+    if(++col.repeats == 128) {
+      omz_flush_repeats(col);
+    }
+    return;
+  }
+  omz_flush_repeats(col);
+  while(0 == ((x >> (56-8*lead)) & 0xFF)) lead++;
+  while(0 == ((x >> (8*trail)) & 0xFF)) trail++;
+  n = 8 - lead - trail;
+  col.bytes.push_back((unsigned char) ((lead << 4) | n));
+  x >>= 8*trail;
+  for(int i = 0; i < n; i++, x >>= 8) {
+    col.bytes.push_back((unsigned char) (x & 0xFF));
+  }
+}
+
+static void omz_flush_run(omz_column &col)
+{
+  if(col.runLength) {
+    omz_put_varint(col.bytes, col.runLength);
+    omz_put_varint(col.bytes, col.runValue < 0 ? ~((uint64_t)col.runValue << 1) : (uint64_t)col.runValue << 1);
+    col.runLength = 0;
+  }
+}
+
+static void omz_put_integer(omz_column &col, int64_t value)
+{
+  if(col.runLength && col.runValue == value) {
+    col.runLength++;
+    return;
+  }
+  omz_flush_run(col);
+  col.runValue = value;
+  col.runLength = 1;
+}
+
+/* write the time points collected so far as one chunk; returns false on failure */
+static bool omz_write_chunk(omz_data *omzData)
+{
+  omz_chunk chunk;
+  uint64_t size;
+  const unsigned char tag = OMZ_RECORD_CHUNK;
+
+  if(0 == omzData->nrows) {
+    return true;
+  }
+  size = sizeof(uint32_t) + 2*sizeof(double) + omzData->columns.size()*sizeof(uint32_t);
+  for(size_t i = 0; i < omzData->columns.size(); i++) {
+    omz_flush_repeats(omzData->columns[i]);
+    omz_flush_run(omzData->columns[i]);
+    size += omzData->columns[i].bytes.size();
+  }
+  /* the record length is stored in 32 bits */
+  if(size > 0xFFFFFFFFu) {
+    return false;
+  }
+
+  chunk.offset = omzData->fp.tellp();
+  chunk.nrows = omzData->nrows;
+  chunk.firstTime = omzData->firstTime;
+  chunk.lastTime = omzData->lastTime;
+  omz_write(omzData->fp, &tag, 1);
+  omz_write_uint32(omzData->fp, (uint32_t) size);
+  omz_write_uint32(omzData->fp, chunk.nrows);
+  omz_write(omzData->fp, &chunk.firstTime, sizeof(double));
+  omz_write(omzData->fp, &chunk.lastTime, sizeof(double));
+  for(size_t i = 0; i < omzData->columns.size(); i++) {
+    omz_write_uint32(omzData->fp, omzData->columns[i].bytes.size());
+  }
+  for(size_t i = 0; i < omzData->columns.size(); i++) {
+    omz_column &col = omzData->columns[i];
+    if(!col.bytes.empty()) {
+      omz_write(omzData->fp, &col.bytes[0], col.bytes.size());
+    }
+    /* every chunk can be decoded on its own */
+    col.bytes.clear();
+    col.prev = 0;
+  }
+  /* a complete chunk survives a crash of the simulation */
+  omzData->fp.flush();
+  omzData->chunks.push_back(chunk);
+  omzData->chunkBytes += size;
+  omzData->nrows = 0;
+  return !omzData->fp.fail();
+}
+
+void omz_writeParameterData(simulation_result *self,DATA *data, threadData_t *threadData)
+{
+  omz_data *omzData = (omz_data*) self->storage;
+  const MODEL_DATA *mData = data->modelData;
+  const SIMULATION_INFO *sInfo = data->simulationInfo;
+  const unsigned char tag = OMZ_RECORD_PARAMETERS;
+  uint32_t nParams = mData->nParametersReal + mData->nParametersInteger + mData->nParametersBoolean;
+  double value;
+
+  rt_tick(SIM_TIMER_OUTPUT);
+  /* chunks are only written as a whole, so the record can go anywhere */
+  omzData->paramOffset = omzData->fp.tellp();
+  omz_write(omzData->fp, &tag, 1);
+  omz_write_uint32(omzData->fp, nParams*sizeof(double));
+  omz_write(omzData->fp, sInfo->realParameter, mData->nParametersReal*sizeof(double));
+  for(long i = 0; i < mData->nParametersInteger; i++) {
+    value = sInfo->integerParameter[i];
+    omz_write(omzData->fp, &value, sizeof(double));
+  }
+  for(long i = 0; i < mData->nParametersBoolean; i++) {
+    value = sInfo->booleanParameter[i];
+    omz_write(omzData->fp, &value, sizeof(double));
+  }
+  omzData->fp.flush();
+  if(omzData->fp.fail()) {
+    rt_accumulate(SIM_TIMER_OUTPUT);
+    throwStreamPrint(threadData, "Error while writing file %s",self->filename);
+  }
+  rt_accumulate(SIM_TIMER_OUTPUT);
+}
+
+void omz_init(simulation_result *self,DATA *data, threadData_t *threadData)
+{
+  static const VAR_INFO timeValName = {0,-1,"time","Simulation time [s]",{"",-1,-1,-1,-1}};
+  static const VAR_INFO cpuTimeValName = {0,-1,"$cpuTime","cpu time [s]",{"",-1,-1,-1,-1}};
+  omz_data *omzData = new omz_data();
+  const MODEL_DATA *mData = data->modelData;
+  const uint32_t nParams = mData->nParametersReal + mData->nParametersInteger + mData->nParametersBoolean;
+  std::vector<int> realSignal(mData->nVariablesReal, 0), integerSignal(mData->nVariablesInteger, 0), booleanSignal(mData->nVariablesBoolean, 0);
+  std::vector<unsigned char> paramKinds;
+  uint32_t nall, nsignals;
+  long i;
+
+  self->storage = omzData;
+  rt_tick(SIM_TIMER_OUTPUT);
+  omzData->nrows = 0;
+  omzData->paramOffset = 0;
+  omzData->ntimepoints = 0;
+  omzData->chunkBytes = 0;
+
+  /* signals: time, cpu time, reals, integers and booleans */
+  sim_result_initGather(&omzData->gather, mData, self->cpuTime, SIM_RESULT_ALIASES_NONE);
+  omzData->kinds.push_back(OMZ_KIND_REAL);
+  if(self->cpuTime)
+    omzData->kinds.push_back(OMZ_KIND_REAL);
+  for(i = 0; i < mData->nVariablesReal; i++) if(!mData->realVarsData[i].filterOutput) {
+    omzData->kinds.push_back(OMZ_KIND_REAL);
+    realSignal[i] = omzData->kinds.size();
+  }
+  for(i = 0; i < mData->nVariablesInteger; i++) if(!mData->integerVarsData[i].filterOutput) {
+    omzData->kinds.push_back(OMZ_KIND_INTEGER);
+    integerSignal[i] = omzData->kinds.size();
+  }
+  for(i = 0; i < mData->nVariablesBoolean; i++) if(!mData->booleanVarsData[i].filterOutput) {
+    omzData->kinds.push_back(OMZ_KIND_BOOLEAN);
+    booleanSignal[i] = omzData->kinds.size();
+  }
+  nsignals = omzData->kinds.size();
+  omzData->chunkRows = OMZ_CHUNK_BYTES / (OMZ_MAX_VALUE_BYTES*nsignals);
+  omzData->chunkRows = omzData->chunkRows < 1 ? 1 : (omzData->chunkRows > OMZ_CHUNK_ROWS ? OMZ_CHUNK_ROWS : omzData->chunkRows);
+  omzData->columns.resize(nsignals);
+  for(i = 0; i < (long)nsignals; i++) {
+    omzData->columns[i].prev = 0;
+    omzData->columns[i].repeats = 0;
+    omzData->columns[i].runValue = 0;
+    omzData->columns[i].runLength = 0;
+  }
+  paramKinds.insert(paramKinds.end(), mData->nParametersReal, OMZ_KIND_REAL);
+  paramKinds.insert(paramKinds.end(), mData->nParametersInteger, OMZ_KIND_INTEGER);
+  paramKinds.insert(paramKinds.end(), mData->nParametersBoolean, OMZ_KIND_BOOLEAN);
+
+  /* aliases of variables which are not stored are dropped (like in the mat-file) */
+  nall = nsignals + nParams;
+  for(i = 0; i < mData->nAliasReal; i++) if(!mData->realAlias[i].filterOutput)
+    nall += mData->realAlias[i].aliasType != 0 || realSignal[mData->realAlias[i].nameID];
+  for(i = 0; i < mData->nAliasInteger; i++) if(!mData->integerAlias[i].filterOutput)
+    nall += mData->integerAlias[i].aliasType == 1 || (mData->integerAlias[i].aliasType == 0 && integerSignal[mData->integerAlias[i].nameID]);
+  for(i = 0; i < mData->nAliasBoolean; i++) if(!mData->booleanAlias[i].filterOutput)
+    nall += mData->booleanAlias[i].aliasType == 1 || (mData->booleanAlias[i].aliasType == 0 && booleanSignal[mData->booleanAlias[i].nameID]);
+
+  try {
+    omzData->fp.open(self->filename, std::ofstream::binary|std::ofstream::trunc);
+    if(!omzData->fp) {
+      throwStreamPrint(threadData, "Cannot open File %s for writing",self->filename);
+    }
+    omz_write(omzData->fp, OMZ_MAGIC, 4);
+    omz_write_uint32(omzData->fp, OMZ_VERSION);
+    omz_write_uint32(omzData->fp, OMZ_BYTE_ORDER);
+    omz_write_uint32(omzData->fp, omzData->chunkRows);
+    omz_write_uint32(omzData->fp, nsignals);
+    omz_write(omzData->fp, &omzData->kinds[0], nsignals);
+    omz_write_uint32(omzData->fp, nParams);
+    if(nParams) {
+      omz_write(omzData->fp, &paramKinds[0], nParams);
+    }
+    omz_write_uint32(omzData->fp, nall);
+
+    /* variables */
+    omz_write_var(omzData->fp, &timeValName, false, 1);
+    if(self->cpuTime)
+      omz_write_var(omzData->fp, &cpuTimeValName, false, 2);
+    for(i = 0; i < mData->nVariablesReal; i++) if(realSignal[i])
+      omz_write_var(omzData->fp, &mData->realVarsData[i].info, false, realSignal[i]);
+    for(i = 0; i < mData->nVariablesInteger; i++) if(integerSignal[i])
+      omz_write_var(omzData->fp, &mData->integerVarsData[i].info, false, integerSignal[i]);
+    for(i = 0; i < mData->nVariablesBoolean; i++) if(booleanSignal[i])
+      omz_write_var(omzData->fp, &mData->booleanVarsData[i].info, false, booleanSignal[i]);
+
+    /* aliases */
+    for(i = 0; i < mData->nAliasReal; i++) if(!mData->realAlias[i].filterOutput) {
+      const DATA_REAL_ALIAS *alias = &mData->realAlias[i];
+      int index = alias->aliasType == 2 ? 1 : alias->aliasType == 1 ? alias->nameID+1 : realSignal[alias->nameID];
+      if(index)
+        omz_write_var(omzData->fp, &alias->info, alias->aliasType == 1, alias->negate ? -index : index);
+    }
+    for(i = 0; i < mData->nAliasInteger; i++) if(!mData->integerAlias[i].filterOutput) {
+      const DATA_INTEGER_ALIAS *alias = &mData->integerAlias[i];
+      int index = alias->aliasType == 1 ? mData->nParametersReal+alias->nameID+1 : alias->aliasType == 0 ? integerSignal[alias->nameID] : 0;
+      if(index)
+        omz_write_var(omzData->fp, &alias->info, alias->aliasType == 1, alias->negate ? -index : index);
+    }
+    for(i = 0; i < mData->nAliasBoolean; i++) if(!mData->booleanAlias[i].filterOutput) {
+      const DATA_BOOLEAN_ALIAS *alias = &mData->booleanAlias[i];
+      int index = alias->aliasType == 1 ? mData->nParametersReal+mData->nParametersInteger+alias->nameID+1 : alias->aliasType == 0 ? booleanSignal[alias->nameID] : 0;
+      if(index)
+        omz_write_var(omzData->fp, &alias->info, alias->aliasType == 1, alias->negate ? -index : index);
+    }
+
+    /* parameters */
+    for(i = 0; i < mData->nParametersReal; i++)
+      omz_write_var(omzData->fp, &mData->realParameterData[i].info, true, i+1);
+    for(i = 0; i < mData->nParametersInteger; i++)
+      omz_write_var(omzData->fp, &mData->integerParameterData[i].info, true, mData->nParametersReal+i+1);
+    for(i = 0; i < mData->nParametersBoolean; i++)
+      omz_write_var(omzData->fp, &mData->booleanParameterData[i].info, true, mData->nParametersReal+mData->nParametersInteger+i+1);
+    if(omzData->fp.fail()) {
+      throwStreamPrint(threadData, "Error while writing file %s",self->filename);
+    }
+
+    for(i = 0; i < (long)nsignals; i++) {
+      omzData->columns[i].bytes.reserve(omzData->chunkRows);
+    }
+  } catch(...) {
+    omzData->fp.close();
+    rt_accumulate(SIM_TIMER_OUTPUT);
+    throw;
+  }
+  rt_accumulate(SIM_TIMER_OUTPUT);
+  omz_writeParameterData(self, data, threadData);
+}
+
+void omz_emit(simulation_result *self,DATA *data, threadData_t *threadData)
+{
+  omz_data *omzData = (omz_data*) self->storage;
+  const SIMULATION_DATA *sData = data->localData[0];
+  omz_column *col = &omzData->columns[0];
+  rt_tick(SIM_TIMER_OUTPUT);
+
+  rt_accumulate(SIM_TIMER_TOTAL);
+  double cpuTimeValue = rt_accumulated(SIM_TIMER_TOTAL);
+  rt_tick(SIM_TIMER_TOTAL);
+
+  if(0 == omzData->nrows)
+    omzData->firstTime = sData->timeValue;
+  omzData->lastTime = sData->timeValue;
+  omz_put_real(*col++, sData->timeValue);
+  if(self->cpuTime)
+    omz_put_real(*col++, cpuTimeValue);
+  for(long i = 0; i < omzData->gather.real.nVars; i++)
+    omz_put_real(*col++, sData->realVars[omzData->gather.real.vars[i]]);
+  for(long i = 0; i < omzData->gather.integer.nVars; i++)
+    omz_put_integer(*col++, sData->integerVars[omzData->gather.integer.vars[i]]);
+  for(long i = 0; i < omzData->gather.boolean.nVars; i++)
+    omz_put_integer(*col++, sData->booleanVars[omzData->gather.boolean.vars[i]]);
+  assert(col == &omzData->columns[0] + omzData->columns.size());
+  ++omzData->ntimepoints;
+
+  if(++omzData->nrows == omzData->chunkRows && !omz_write_chunk(omzData)) {
+    rt_accumulate(SIM_TIMER_OUTPUT);
+    throwStreamPrint(threadData, "Error while writing file %s",self->filename);
+  }
+  rt_accumulate(SIM_TIMER_OUTPUT);
+}
+
+void omz_free(simulation_result *self,DATA *data, threadData_t *threadData)
+{
+  omz_data *omzData = (omz_data*) self->storage;
+  const unsigned char tag = OMZ_RECORD_INDEX;
+  uint64_t indexOffset;
+  uint32_t nchunks;
+
+  rt_tick(SIM_TIMER_OUTPUT);
+  if(omzData->fp && omz_write_chunk(omzData)) {
+    /* the chunk index for random access */
+    nchunks = omzData->chunks.size();
+    indexOffset = omzData->fp.tellp();
+    omz_write(omzData->fp, &tag, 1);
+    omz_write_uint32(omzData->fp, sizeof(uint32_t) + nchunks*(sizeof(uint64_t)+sizeof(uint32_t)+2*sizeof(double)) + sizeof(uint64_t));
+    omz_write_uint32(omzData->fp, nchunks);
+    for(uint32_t i = 0; i < nchunks; i++) {
+      omz_write(omzData->fp, &omzData->chunks[i].offset, sizeof(uint64_t));
+      omz_write_uint32(omzData->fp, omzData->chunks[i].nrows);
+      omz_write(omzData->fp, &omzData->chunks[i].firstTime, sizeof(double));
+      omz_write(omzData->fp, &omzData->chunks[i].lastTime, sizeof(double));
+    }
+    omz_write(omzData->fp, &omzData->paramOffset, sizeof(uint64_t));
+    omz_write(omzData->fp, &indexOffset, sizeof(uint64_t));
+    omz_write(omzData->fp, OMZ_TRAILER_MAGIC, 8);
+  }
+  if(omzData->fp.fail()) {
+    warningStreamPrint(LOG_STDOUT, 0, "Error while writing file %s", self->filename);
+  }
+  omzData->fp.close();
+  infoStreamPrint(LOG_STATS, 0, "result file: %lu time points in %lu chunks, %lu bytes compressed to %lu", omzData->ntimepoints, (unsigned long) omzData->chunks.size(), (unsigned long) (omzData->ntimepoints*omzData->columns.size()*sizeof(double)), (unsigned long) omzData->chunkBytes);
+  sim_result_freeGather(&omzData->gather);
+  delete omzData;
+  self->storage = NULL;
+  rt_accumulate(SIM_TIMER_OUTPUT);
+}
+
+} /* extern C */
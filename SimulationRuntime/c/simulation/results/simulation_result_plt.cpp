@@ -41,6 +41,7 @@
 #include "util/omc_error.h"
 #include "simulation_result_plt.h"
 #include "util/rtclock.h"
+#include "util/omc_dtoa.h"
 
 #include <stdio.h>
 #include <errno.h>
@@ -56,30 +57,13 @@ typedef struct plt_data {
   long maxPoints;
   long dataSize;
   int num_vars;
+  sim_result_gather gather;
 } plt_data;
 
 static void add_result(simulation_result *self,DATA *data,double *data_, long *actualPoints);
 static void deallocResult(plt_data *pltData);
 static void printPltLine(FILE* f, double time, double val);
 
-static int calcDataSize(simulation_result *self,const MODEL_DATA *modelData)
-{
-  int sz = 1, i; /* time */
-  if(self->cpuTime)
-    sz++; /* $cpuTime */
-  for(i = 0; i < modelData->nVariablesReal; i++) if(!modelData->realVarsData[i].filterOutput) sz++;
-  for(i = 0; i < modelData->nVariablesInteger; i++) if(!modelData->integerVarsData[i].filterOutput) sz++;
-  for(i = 0; i < modelData->nVariablesBoolean; i++) if(!modelData->booleanVarsData[i].filterOutput) sz++;
-  /* for(int i = 0; i < modelData->nVariablesString; i++) if(!modelData->stringVarsData[i].filterOutput) sz++; */
-
-  for(i = 0; i < modelData->nAliasReal; i++) if(!modelData->realAlias[i].filterOutput) sz++;
-  for(i = 0; i < modelData->nAliasInteger; i++) if(!modelData->integerAlias[i].filterOutput) sz++;
-  for(i = 0; i < modelData->nAliasBoolean; i++) if(!modelData->booleanAlias[i].filterOutput) sz++;
-  /* for(int i = 0; i < modelData->nAliasString; i++) if(!modelData->stringAlias[i].filterOutput) sz++; */
-
-  return sz;
-}
-
 void plt_emit(simulation_result *self,DATA *data, threadData_t *threadData)
 {
   plt_data *pltData = (plt_data*) self->storage;
@@ -105,83 +89,14 @@ void plt_emit(simulation_result *self,DATA *data, threadData_t *threadData)
 static void add_result(simulation_result *self,DATA *data,double *data_, long *actualPoints)
 {
   plt_data *pltData = (plt_data*) self->storage;
-  const DATA *simData = data;
-  int i;
   double cpuTimeValue = 0;
 
   rt_accumulate(SIM_TIMER_TOTAL);
   cpuTimeValue = rt_accumulated(SIM_TIMER_TOTAL);
   rt_tick(SIM_TIMER_TOTAL);
 
-  {
-    data_[pltData->currentPos++] = simData->localData[0]->timeValue;
-
-    if(self->cpuTime)
-      data_[pltData->currentPos++] = cpuTimeValue;
-
-    /* .. reals .. */
-    for(i = 0; i < simData->modelData->nVariablesReal; i++) {
-      if(!simData->modelData->realVarsData[i].filterOutput) {
-        data_[pltData->currentPos++] = simData->localData[0]->realVars[i];
-      }
-    }
-    /* .. integers .. */
-    for(i = 0; i < simData->modelData->nVariablesInteger; i++) {
-      if(!simData->modelData->integerVarsData[i].filterOutput) {
-        data_[pltData->currentPos++] = simData->localData[0]->integerVars[i];
-      }
-    }
-    /* .. booleans .. */
-    for(i = 0; i < simData->modelData->nVariablesBoolean; i++) {
-      if(!simData->modelData->booleanVarsData[i].filterOutput) {
-        data_[pltData->currentPos++] = simData->localData[0]->booleanVars[i];
-      }
-    }
-    /* .. alias reals .. */
-    for(i = 0; i < simData->modelData->nAliasReal; i++) {
-      if(!simData->modelData->realAlias[i].filterOutput) {
-        double value;
-        if(simData->modelData->realAlias[i].aliasType == 2)
-          value = (simData->localData[0])->timeValue;
-        else if(simData->modelData->realAlias[i].aliasType == 1)
-          value = simData->simulationInfo->realParameter[simData->modelData->realAlias[i].nameID];
-        else
-          value = (simData->localData[0])->realVars[simData->modelData->realAlias[i].nameID];
-        if(simData->modelData->realAlias[i].negate)
-          data_[pltData->currentPos++] = -value;
-        else
-          data_[pltData->currentPos++] = value;
-      }
-    }
-    /* .. alias integers .. */
-    for(i = 0; i < simData->modelData->nAliasInteger; i++) {
-      if(!simData->modelData->integerAlias[i].filterOutput) {
-        modelica_integer value;
-        if(simData->modelData->integerAlias[i].aliasType == 1)
-          value = simData->simulationInfo->integerParameter[simData->modelData->realAlias[i].nameID];
-        else
-          value = (simData->localData[0])->integerVars[simData->modelData->realAlias[i].nameID];
-        if(simData->modelData->integerAlias[i].negate)
-          data_[pltData->currentPos++] = -value;
-        else
-          data_[pltData->currentPos++] = value;
-      }
-    }
-    /* .. alias booleans .. */
-    for(i = 0; i < simData->modelData->nAliasBoolean; i++) {
-      if(!simData->modelData->booleanAlias[i].filterOutput) {
-        modelica_boolean value;
-        if(simData->modelData->integerAlias[i].aliasType == 1)
-          value = simData->simulationInfo->booleanParameter[simData->modelData->realAlias[i].nameID];
-        else
-          value = (simData->localData[0])->booleanVars[simData->modelData->realAlias[i].nameID];
-        if(simData->modelData->booleanAlias[i].negate)
-          data_[pltData->currentPos++] = value==1?0:1;
-        else
-          data_[pltData->currentPos++] = value;
-      }
-    }
-  }
+  sim_result_gatherRow(&pltData->gather, data, cpuTimeValue, data_ + pltData->currentPos);
+  pltData->currentPos += pltData->dataSize;
 
   /*cerr << "  ... done" << endl; */
   (*actualPoints)++;
@@ -202,8 +117,9 @@ void plt_init(simulation_result *self,DATA *data, threadData_t *threadData)
 
   assertStreamPrint(threadData, self->numpoints >= 0, "Automatic output steps not supported in OpenModelica yet. Set numpoints >= 0.");
 
-  pltData->num_vars = calcDataSize(self,data->modelData);
-  pltData->dataSize = calcDataSize(self,data->modelData);
+  sim_result_initGather(&pltData->gather, data->modelData, self->cpuTime, SIM_RESULT_ALIASES_ALL);
+  pltData->num_vars = pltData->gather.rowSize;
+  pltData->dataSize = pltData->gather.rowSize;
   pltData->simulationResultData = (double*)malloc(self->numpoints * pltData->dataSize * sizeof(double));
   if(!pltData->simulationResultData) {
     throwStreamPrint(threadData, "Error allocating simulation result data of size %ld failed",self->numpoints * pltData->dataSize);
@@ -230,8 +146,14 @@ static void deallocResult(plt_data *pltData)
 
 static void printPltLine(FILE* f, double time, double val)
 {
-  /* Double has max 16 digits precision */
-  fprintf(f, "%.16g, %.16g\n", time, val);
+  /* shortest digits that read back to the same doubles */
+  char line[2*OMC_DTOA_BUFFER_SIZE+3];
+  int n = omc_dtoa_shortest(time, line);
+  line[n++] = ',';
+  line[n++] = ' ';
+  n += omc_dtoa_shortest(val, line + n);
+  line[n++] = '\n';
+  fwrite(line, 1, n, f);
 }
 
 /*
@@ -250,6 +172,7 @@ void plt_free(simulation_result *self,DATA *data, threadData_t *threadData)
   if(!f)
   {
     deallocResult(pltData);
+    sim_result_freeGather(&pltData->gather);
     throwStreamPrint(threadData, "Error, couldn't create output file: [%s] because of %s", self->filename, strerror(errno));
   }
 
@@ -278,73 +201,62 @@ void plt_free(simulation_result *self,DATA *data, threadData_t *threadData)
     varn++;
   }
 
-  for(var = 0; var < modelData->nVariablesReal; ++var)
+  for(var = 0; var < pltData->gather.real.nVars; ++var)
   {
-    if(!modelData->realVarsData[var].filterOutput) {
-      fprintf(f, "DataSet: %s\n", modelData->realVarsData[var].info.name);
-      for(i = 0; i < pltData->actualPoints; ++i)
-        printPltLine(f, pltData->simulationResultData[i*pltData->num_vars], pltData->simulationResultData[i*pltData->num_vars + varn]);
-      fprintf(f, "\n");
-      varn++;
-    }
+    fprintf(f, "DataSet: %s\n", modelData->realVarsData[pltData->gather.real.vars[var]].info.name);
+    for(i = 0; i < pltData->actualPoints; ++i)
+      printPltLine(f, pltData->simulationResultData[i*pltData->num_vars], pltData->simulationResultData[i*pltData->num_vars + varn]);
+    fprintf(f, "\n");
+    varn++;
   }
 
-  for(var = 0; var < modelData->nVariablesInteger; ++var)
+  for(var = 0; var < pltData->gather.integer.nVars; ++var)
   {
-    if(!modelData->integerVarsData[var].filterOutput) {
-      fprintf(f, "DataSet: %s\n", modelData->integerVarsData[var].info.name);
-      for(i = 0; i < pltData->actualPoints; ++i)
-        printPltLine(f, pltData->simulationResultData[i*pltData->num_vars], pltData->simulationResultData[i*pltData->num_vars + varn]);
-      fprintf(f, "\n");
-      varn++;
-    }
+    fprintf(f, "DataSet: %s\n", modelData->integerVarsData[pltData->gather.integer.vars[var]].info.name);
+    for(i = 0; i < pltData->actualPoints; ++i)
+      printPltLine(f, pltData->simulationResultData[i*pltData->num_vars], pltData->simulationResultData[i*pltData->num_vars + varn]);
+    fprintf(f, "\n");
+    varn++;
   }
 
-  for(var = 0; var < modelData->nVariablesBoolean; ++var)
+  for(var = 0; var < pltData->gather.boolean.nVars; ++var)
   {
-    if(!modelData->booleanVarsData[var].filterOutput) {
-      fprintf(f, "DataSet: %s\n", modelData->booleanVarsData[var].info.name);
-      for(i = 0; i < pltData->actualPoints; ++i)
-        printPltLine(f, pltData->simulationResultData[i*pltData->num_vars], pltData->simulationResultData[i*pltData->num_vars + varn]);
-      fprintf(f, "\n");
-      varn++;
-    }
+    fprintf(f, "DataSet: %s\n", modelData->booleanVarsData[pltData->gather.boolean.vars[var]].info.name);
+    for(i = 0; i < pltData->actualPoints; ++i)
+      printPltLine(f, pltData->simulationResultData[i*pltData->num_vars], pltData->simulationResultData[i*pltData->num_vars + varn]);
+    fprintf(f, "\n");
+    varn++;
   }
 
-  for(var = 0; var < modelData->nAliasReal; ++var)
+  for(var = 0; var < pltData->gather.real.nAliases; ++var)
   {
-    if(!modelData->realAlias[var].filterOutput) {
-      fprintf(f, "DataSet: %s\n", modelData->realAlias[var].info.name);
-      for(i = 0; i < pltData->actualPoints; ++i)
-        printPltLine(f, pltData->simulationResultData[i*pltData->num_vars], pltData->simulationResultData[i*pltData->num_vars + varn]);
-      fprintf(f, "\n");
-      varn++;
-    }
+    fprintf(f, "DataSet: %s\n", modelData->realAlias[pltData->gather.real.aliases[var]].info.name);
+    for(i = 0; i < pltData->actualPoints; ++i)
+      printPltLine(f, pltData->simulationResultData[i*pltData->num_vars], pltData->simulationResultData[i*pltData->num_vars + varn]);
+    fprintf(f, "\n");
+    varn++;
   }
 
-  for(var = 0; var < modelData->nAliasInteger; ++var)
+  for(var = 0; var < pltData->gather.integer.nAliases; ++var)
   {
-    if(!modelData->integerAlias[var].filterOutput) {
-      fprintf(f, "DataSet: %s\n", modelData->integerAlias[var].info.name);
-      for(i = 0; i < pltData->actualPoints; ++i)
-        printPltLine(f, pltData->simulationResultData[i*pltData->num_vars], pltData->simulationResultData[i*pltData->num_vars + varn]);
-      fprintf(f, "\n");
-      varn++;
-    }
+    fprintf(f, "DataSet: %s\n", modelData->integerAlias[pltData->gather.integer.aliases[var]].info.name);
+    for(i = 0; i < pltData->actualPoints; ++i)
+      printPltLine(f, pltData->simulationResultData[i*pltData->num_vars], pltData->simulationResultData[i*pltData->num_vars + varn]);
+    fprintf(f, "\n");
+    varn++;
   }
 
-  for(var = 0; var < modelData->nAliasBoolean; ++var)
+  for(var = 0; var < pltData->gather.boolean.nAliases; ++var)
   {
-    if(!modelData->booleanAlias[var].filterOutput) {
-      fprintf(f, "DataSet: %s\n", modelData->booleanAlias[var].info.name);
-      for(i = 0; i < pltData->actualPoints; ++i)
-        printPltLine(f, pltData->simulationResultData[i*pltData->num_vars], pltData->simulationResultData[i*pltData->num_vars + varn]);
-      fprintf(f, "\n");
-      varn++;
-    }
+    fprintf(f, "DataSet: %s\n", modelData->booleanAlias[pltData->gather.boolean.aliases[var]].info.name);
+    for(i = 0; i < pltData->actualPoints; ++i)
+      printPltLine(f, pltData->simulationResultData[i*pltData->num_vars], pltData->simulationResultData[i*pltData->num_vars + varn]);
+    fprintf(f, "\n");
+    varn++;
   }
 
   deallocResult(pltData);
+  sim_result_freeGather(&pltData->gather);
   if(fclose(f))
   {
     throwStreamPrint(threadData, "Error, couldn't write to output file %s\n", self->filename);
@@ -28,14 +28,19 @@
  *
  */
 
-/* The recon wall format is optimized for writing */
+/* The recon wall format is optimized for writing. The rows are grouped in
+ * chunks with a time index so that a reader can seek by time or variable;
+ * see util/read_wall.h for the layout. */
 
 #include "util/omc_error.h"
+#include "util/read_wall.h"
 #include "simulation_result_wall.h"
 #include "util/rtclock.h"
 #include "meta/meta_modelica.h"
 
 #include <fstream>
+#include <string>
+#include <vector>
 #include <string.h>
 #include <assert.h>
 
@@ -48,17 +53,74 @@
 #include <arpa/inet.h> /* htonl */
 #endif
 
-#define PARAM_TABLE_NAME "params"
-#define CONT_TABLE_NAME "continuous"
+#define PARAM_TABLE_NAME WALL_PARAM_TABLE
+#define CONT_TABLE_NAME WALL_CONT_TABLE
+
+/* a chunk is complete after this many rows or bytes */
+#define WALL_CHUNK_ROWS 1024
+#define WALL_CHUNK_BYTES (4<<20)
 
 extern "C" {
 
+typedef struct wall_chunk {
+  uint64_t offset; /* file offset of the first row */
+  uint64_t size;
+  uint32_t nrows;
+  double firstTime, lastTime;
+} wall_chunk;
+
 typedef struct wall_storage {
   std::ofstream fp;
   long header_length;
   long data_start;
+  sim_result_gather gather;
+  std::vector<uint32_t> offsets; /* offsets of the numeric signals in a row record */
+  std::vector<char> row; /* row record; the values are filled in place */
+  uint32_t fixedSize;    /* size of a row record without the strings */
+  uint64_t pos;          /* end of the file */
+  uint64_t chunkRecord;  /* offset of the record of the open chunk */
+  wall_chunk chunk;      /* the open chunk, if chunk.nrows > 0 */
+  std::vector<wall_chunk> chunks;
+  uint64_t paramOffset;
 } wall_storage;
 
+static char* pack_uint32(char *p, uint32_t n) {
+  p[0] = (char) (n >> 24);
+  p[1] = (char) (n >> 16);
+  p[2] = (char) (n >> 8);
+  p[3] = (char) n;
+  return p+4;
+}
+
+static char* pack_uint64(char *p, uint64_t n) {
+  p = pack_uint32(p, (uint32_t) (n >> 32));
+  return pack_uint32(p, (uint32_t) n);
+}
+
+static char* pack_header(char *p, unsigned char tag, uint32_t n) {
+  *p++ = (char) tag;
+  return pack_uint32(p, n);
+}
+
+static char* pack_str(char *p, const char *s) {
+  uint32_t len = strlen(s);
+  p = pack_header(p, 0xDB, len);
+  memcpy(p, s, len);
+  return p+len;
+}
+
+static char* pack_int64(char *p, int64_t n) {
+  *p++ = (char) 0xd3;
+  return pack_uint64(p, (uint64_t) n);
+}
+
+static char* pack_double(char *p, double d) {
+  uint64_t bits;
+  memcpy(&bits, &d, sizeof(double));
+  *p++ = (char) 0xcb;
+  return pack_uint64(p, bits);
+}
+
 static void msgpack_obj_header(std::ofstream &fp, int n) {
   static char buffer[1];
   static int32_t ibuffer;
@@ -139,24 +201,29 @@ static void write_alias(std::ofstream &fp, const char *name, const char *sig, bo
   if (negate) { msgpack_str(fp, "t"); msgpack_str(fp, "inv"); }
 }
 
+/* Parameter aliases are always stored; aliases of variables only if both the
+ * alias and the variable pass the output filter. */
+#define WALL_ALIAS_INCLUDED(alias, vars) (include[(int)(alias).aliasType] && \
+  ((alias).aliasType == 1 || (!(alias).filterOutput && ((alias).aliasType == 2 || !(vars)[(alias).nameID].filterOutput))))
+
 static void write_aliases(std::ofstream &fp, MODEL_DATA *modelData, int include[]) {
   const char *sig = NULL;
   msgpack_str(fp, "als");
   int na = 0; // Number of aliases (include time) for this request
   for(long i=0;i<modelData->nAliasReal;i++)
-    na += include[(int)modelData->realAlias[i].aliasType];
+    na += WALL_ALIAS_INCLUDED(modelData->realAlias[i], modelData->realVarsData);
   for(long i=0;i<modelData->nAliasInteger;i++)
-    na += include[(int)modelData->integerAlias[i].aliasType];
+    na += WALL_ALIAS_INCLUDED(modelData->integerAlias[i], modelData->integerVarsData);
   for(long i=0;i<modelData->nAliasBoolean;i++)
-    na += include[(int)modelData->booleanAlias[i].aliasType];
+    na += WALL_ALIAS_INCLUDED(modelData->booleanAlias[i], modelData->booleanVarsData);
   for(long i=0;i<modelData->nAliasString;i++)
-    na += include[(int)modelData->stringAlias[i].aliasType];
+    na += WALL_ALIAS_INCLUDED(modelData->stringAlias[i], modelData->stringVarsData);
 
   msgpack_obj_header(fp, na);
 
   for(long i=0;i<modelData->nAliasReal;i++) {
     DATA_REAL_ALIAS *alias = &modelData->realAlias[i];
-    if (include[(int)alias->aliasType]==0) continue;
+    if (!WALL_ALIAS_INCLUDED(*alias, modelData->realVarsData)) continue;
     if (alias->aliasType==2) sig = "time";
     if (alias->aliasType==1) sig = modelData->realParameterData[alias->nameID].info.name;
     if (alias->aliasType==0) sig = modelData->realVarsData[alias->nameID].info.name;
@@ -165,7 +232,7 @@ static void write_aliases(std::ofstream &fp, MODEL_DATA *modelData, int include[
 
   for(long i=0;i<modelData->nAliasInteger;i++) {
     DATA_INTEGER_ALIAS *alias = &modelData->integerAlias[i];
-    if (include[(int)alias->aliasType]==0) continue;
+    if (!WALL_ALIAS_INCLUDED(*alias, modelData->integerVarsData)) continue;
     if (alias->aliasType==2) sig = "time";
     if (alias->aliasType==1) sig = modelData->integerParameterData[alias->nameID].info.name;
     if (alias->aliasType==0) sig = modelData->integerVarsData[alias->nameID].info.name;
@@ -174,7 +241,7 @@ static void write_aliases(std::ofstream &fp, MODEL_DATA *modelData, int include[
 
   for(long i=0;i<modelData->nAliasBoolean;i++) {
     DATA_BOOLEAN_ALIAS *alias = &modelData->booleanAlias[i];
-    if (include[(int)alias->aliasType]==0) continue;
+    if (!WALL_ALIAS_INCLUDED(*alias, modelData->booleanVarsData)) continue;
     if (alias->aliasType==2) sig = "time";
     if (alias->aliasType==1) sig = modelData->booleanParameterData[alias->nameID].info.name;
     if (alias->aliasType==0) sig = modelData->booleanVarsData[alias->nameID].info.name;
@@ -183,7 +250,7 @@ static void write_aliases(std::ofstream &fp, MODEL_DATA *modelData, int include[
 
   for(long i=0;i<modelData->nAliasString;i++) {
     DATA_STRING_ALIAS *alias = &modelData->stringAlias[i];
-    if (include[(int)alias->aliasType]==0) continue;
+    if (!WALL_ALIAS_INCLUDED(*alias, modelData->stringVarsData)) continue;
     if (alias->aliasType==2) sig = "time";
     if (alias->aliasType==1) sig = modelData->stringParameterData[alias->nameID].info.name;
     if (alias->aliasType==0) sig = modelData->stringVarsData[alias->nameID].info.name;
@@ -232,26 +299,38 @@ static void write_param_table(std::ofstream &fp, MODEL_DATA *modelData) {
           modelData->stringParameterData[i].info.comment);
 }
 
-static void write_cont_table(std::ofstream &fp, MODEL_DATA *modelData) {
-  long nvars = modelData->nVariablesReal+modelData->nVariablesInteger+
-    modelData->nVariablesBoolean+modelData->nVariablesString;
+static void write_cont_table(std::ofstream &fp, MODEL_DATA *modelData, const wall_storage *storage) {
+  const sim_result_gather *gather = &storage->gather;
+  long nvars = gather->real.nVars+gather->integer.nVars+
+    gather->boolean.nVars+gather->string.nVars;
   msgpack_str(fp, "continuous");
   msgpack_obj_header(fp, 4); // params
 
   msgpack_str(fp, "tmeta");
-  msgpack_obj_header(fp, 0); // tmeta
+  msgpack_obj_header(fp, 3); // tmeta
+  msgpack_str(fp, "rowSize");
+  msgpack_int32(fp, gather->string.nVars ? 0 : storage->fixedSize);
+  msgpack_str(fp, "offsets");
+  msgpack_array_header(fp, storage->offsets.size());
+  for(size_t i=0;i<storage->offsets.size();i++)
+    msgpack_int32(fp, storage->offsets[i]);
+  std::string kinds(1+gather->real.nVars, WALL_KIND_REAL);
+  kinds.append(gather->integer.nVars, WALL_KIND_INTEGER);
+  kinds.append(gather->boolean.nVars, WALL_KIND_BOOLEAN);
+  msgpack_str(fp, "kinds");
+  msgpack_str(fp, kinds.c_str());
 
   msgpack_str(fp, "sigs");
   msgpack_array_header(fp, nvars+1);
   msgpack_str(fp, "time");
-  for(long i=0;i<modelData->nVariablesReal;i++)
-    msgpack_str(fp, modelData->realVarsData[i].info.name);
-  for(long i=0;i<modelData->nVariablesInteger;i++)
-    msgpack_str(fp, modelData->integerVarsData[i].info.name);
-  for(long i=0;i<modelData->nVariablesBoolean;i++)
-    msgpack_str(fp, modelData->booleanVarsData[i].info.name);
-  for(long i=0;i<modelData->nVariablesString;i++)
-    msgpack_str(fp, modelData->stringVarsData[i].info.name);
+  for(long i=0;i<gather->real.nVars;i++)
+    msgpack_str(fp, modelData->realVarsData[gather->real.vars[i]].info.name);
+  for(long i=0;i<gather->integer.nVars;i++)
+    msgpack_str(fp, modelData->integerVarsData[gather->integer.vars[i]].info.name);
+  for(long i=0;i<gather->boolean.nVars;i++)
+    msgpack_str(fp, modelData->booleanVarsData[gather->boolean.vars[i]].info.name);
+  for(long i=0;i<gather->string.nVars;i++)
+    msgpack_str(fp, modelData->stringVarsData[gather->string.vars[i]].info.name);
 
   int include[3] = {1, 0, 1};
   write_aliases(fp, modelData, include);
@@ -259,22 +338,39 @@ static void write_cont_table(std::ofstream &fp, MODEL_DATA *modelData) {
   msgpack_str(fp, "vmeta");
   msgpack_obj_header(fp, 1+nvars);
   write_description(fp, "time", "Time");
-  for(long i=0;i<modelData->nVariablesReal;i++)
-    write_description(fp, modelData->realVarsData[i].info.name,
-          modelData->realVarsData[i].info.comment);
-  for(long i=0;i<modelData->nVariablesInteger;i++)
-    write_description(fp, modelData->integerVarsData[i].info.name,
-          modelData->integerVarsData[i].info.comment);
-  for(long i=0;i<modelData->nVariablesBoolean;i++)
-    write_description(fp, modelData->booleanVarsData[i].info.name,
-          modelData->booleanVarsData[i].info.comment);
-  for(long i=0;i<modelData->nVariablesString;i++)
-    write_description(fp, modelData->stringVarsData[i].info.name,
-          modelData->stringVarsData[i].info.comment);
+  for(long i=0;i<gather->real.nVars;i++)
+    write_description(fp, modelData->realVarsData[gather->real.vars[i]].info.name,
+          modelData->realVarsData[gather->real.vars[i]].info.comment);
+  for(long i=0;i<gather->integer.nVars;i++)
+    write_description(fp, modelData->integerVarsData[gather->integer.vars[i]].info.name,
+          modelData->integerVarsData[gather->integer.vars[i]].info.comment);
+  for(long i=0;i<gather->boolean.nVars;i++)
+    write_description(fp, modelData->booleanVarsData[gather->boolean.vars[i]].info.name,
+          modelData->booleanVarsData[gather->boolean.vars[i]].info.comment);
+  for(long i=0;i<gather->string.nVars;i++)
+    write_description(fp, modelData->stringVarsData[gather->string.vars[i]].info.name,
+          modelData->stringVarsData[gather->string.vars[i]].info.comment);
 }
 
-static void write_header(std::ofstream &fp, MODEL_DATA *modelData) {
-  static char buffer[80];
+/* The tables of the time index; they have no aliases or descriptions */
+static void write_index_table(std::ofstream &fp, const char *name, const char **sigs, int nsigs) {
+  msgpack_str(fp, name);
+  msgpack_obj_header(fp, 4);
+  msgpack_str(fp, "tmeta");
+  msgpack_obj_header(fp, 0);
+  msgpack_str(fp, "sigs");
+  msgpack_array_header(fp, nsigs);
+  for(int i=0;i<nsigs;i++)
+    msgpack_str(fp, sigs[i]);
+  msgpack_str(fp, "als");
+  msgpack_obj_header(fp, 0);
+  msgpack_str(fp, "vmeta");
+  msgpack_obj_header(fp, 0);
+}
+
+static void write_header(std::ofstream &fp, MODEL_DATA *modelData, const wall_storage *storage) {
+  static const char *chunkSigs[5] = {"offset", "size", "rows", "firstTime", "lastTime"};
+  static const char *indexSigs[3] = {"chunks", "count", "params"};
 
   msgpack_obj_header(fp, 3); // header
 
@@ -282,14 +378,92 @@ static void write_header(std::ofstream &fp, MODEL_DATA *modelData) {
   msgpack_obj_header(fp, 0); // fmeta
 
   msgpack_str(fp, "tabs");
-  msgpack_obj_header(fp, 2); // tabs
+  msgpack_obj_header(fp, 4); // tabs
   write_param_table(fp, modelData);
-  write_cont_table(fp, modelData);
+  write_cont_table(fp, modelData, storage);
+  write_index_table(fp, WALL_CHUNK_TABLE, chunkSigs, 5);
+  write_index_table(fp, WALL_INDEX_TABLE, indexSigs, 3);
 
   msgpack_str(fp, "objs");
   msgpack_obj_header(fp, 0); // objs
 }
 
+/* Computes the layout of a row record: the numeric values have a fixed size,
+ * so every numeric signal is at the same offset in all rows. */
+static void init_row(wall_storage *storage) {
+  const sim_result_gather *gather = &storage->gather;
+  char *p;
+  uint32_t pos;
+  long i;
+
+  storage->row.resize(4+5+5+strlen(CONT_TABLE_NAME)+5);
+  p = &storage->row[4];
+  p = pack_header(p, 0xDF, 1); // table name
+  p = pack_str(p, CONT_TABLE_NAME);
+  pack_header(p, 0xDD, 1+gather->real.nVars+gather->integer.nVars+gather->boolean.nVars+gather->string.nVars);
+
+  pos = storage->row.size();
+  for(i=0;i<1+gather->real.nVars;i++,pos+=9) storage->offsets.push_back(pos);
+  for(i=0;i<gather->integer.nVars;i++,pos+=5) storage->offsets.push_back(pos);
+  for(i=0;i<gather->boolean.nVars;i++,pos+=1) storage->offsets.push_back(pos);
+  storage->fixedSize = pos;
+  storage->row.resize(pos);
+}
+
+static void write_chunk_record(std::ofstream &fp, const wall_chunk *chunk) {
+  char buffer[WALL_CHUNK_RECORD_SIZE];
+  char *p = pack_uint32(buffer, WALL_CHUNK_RECORD_SIZE-4);
+  p = pack_header(p, 0xDF, 1);
+  p = pack_str(p, WALL_CHUNK_TABLE);
+  p = pack_header(p, 0xDD, 5);
+  p = pack_int64(p, chunk->offset);
+  p = pack_int64(p, chunk->size);
+  p = pack_int64(p, chunk->nrows);
+  p = pack_double(p, chunk->firstTime);
+  p = pack_double(p, chunk->lastTime);
+  assert(p == buffer+WALL_CHUNK_RECORD_SIZE);
+  fp.write(buffer, WALL_CHUNK_RECORD_SIZE);
+}
+
+static void write_index_record(std::ofstream &fp, uint64_t chunks, uint64_t count, uint64_t params) {
+  char buffer[WALL_INDEX_RECORD_SIZE];
+  char *p = pack_uint32(buffer, WALL_INDEX_RECORD_SIZE-4);
+  p = pack_header(p, 0xDF, 1);
+  p = pack_str(p, WALL_INDEX_TABLE);
+  p = pack_header(p, 0xDD, 3);
+  p = pack_int64(p, chunks);
+  p = pack_int64(p, count);
+  p = pack_int64(p, params);
+  assert(p == buffer+WALL_INDEX_RECORD_SIZE);
+  fp.write(buffer, WALL_INDEX_RECORD_SIZE);
+}
+
+/* Writes a placeholder record for a new chunk in front of its first row */
+static void begin_chunk(wall_storage *storage, double time) {
+  storage->chunkRecord = storage->pos;
+  storage->pos += WALL_CHUNK_RECORD_SIZE;
+  storage->chunk.offset = storage->pos;
+  storage->chunk.size = 0;
+  storage->chunk.nrows = 0;
+  storage->chunk.firstTime = time;
+  storage->chunk.lastTime = time;
+  write_chunk_record(storage->fp, &storage->chunk);
+}
+
+/* Fills in the record of the open chunk and flushes it to disk, so the chunk
+ * stays readable if the simulation does not finish */
+static void end_chunk(wall_storage *storage) {
+  if (storage->chunk.nrows == 0) {
+    return;
+  }
+  storage->fp.seekp(storage->chunkRecord);
+  write_chunk_record(storage->fp, &storage->chunk);
+  storage->fp.seekp(storage->pos);
+  storage->fp.flush();
+  storage->chunks.push_back(storage->chunk);
+  storage->chunk.nrows = 0;
+}
+
 /* The purpose of this routine is to do the following (in order):
    - Write ID bytes
    - Write temp header length
@@ -316,12 +490,15 @@ void recon_wall_init(simulation_result *self,DATA *data, threadData_t *threadDat
     /* Fill in empty length info (to be filled in later, after header is written) */
     storage->fp.write(blank_length, 4);
     /* Write header */
-    write_header(storage->fp, data->modelData);
+    sim_result_initGather(&storage->gather, data->modelData, 0, SIM_RESULT_ALIASES_NONE);
+    init_row(storage);
+    write_header(storage->fp, data->modelData, storage);
     storage->data_start = storage->fp.tellp();
     uint32_t sz = storage->data_start-(storage->header_length+4);
     storage->fp.seekp(storage->header_length);
     raw_uint32(storage->fp, sz);
     storage->fp.seekp(storage->data_start);
+    storage->pos = storage->data_start;
   }
   catch(...)
   {
@@ -363,53 +540,68 @@ void recon_wall_writeParameterData(simulation_result *self,DATA *data, threadDat
   std::ofstream &fp = storage->fp;
   MODEL_DATA *modelData = data->modelData;
   const SIMULATION_INFO *sInfo = data->simulationInfo;
+  /* parameter records never split a chunk */
+  end_chunk(storage);
   write_parameter_data(fp, sInfo->startTime, modelData, sInfo);
+  storage->paramOffset = fp.tellp();
   write_parameter_data(fp, sInfo->stopTime, modelData, sInfo);
+  storage->pos = fp.tellp();
 }
 
 void recon_wall_emit(simulation_result *self,DATA *data, threadData_t *threadData)
 {
   wall_storage *storage = (wall_storage *)self->storage;
-  std::ofstream &fp = storage->fp;
-  MODEL_DATA *modelData = data->modelData;
-  const SIMULATION_INFO *sInfo = data->simulationInfo;
-
+  const sim_result_gather *gather = &storage->gather;
+  const SIMULATION_DATA *sData = data->localData[0];
+  std::vector<char> &row = storage->row;
+  char *p;
   long i;
-  long length_pos = fp.tellp();
-  raw_uint32(fp, 0);
 
-  long data_pos = fp.tellp();
-  msgpack_obj_header(fp, 1); // table name
-  msgpack_str(fp, CONT_TABLE_NAME);
-
-  msgpack_array_header(fp, 1+modelData->nVariablesReal+modelData->nVariablesInteger+
-    modelData->nVariablesBoolean+modelData->nVariablesString);
-
-  msgpack_double(fp, data->localData[0]->timeValue);
-  for(i=0;i<modelData->nVariablesReal;i++) {
-    msgpack_double(fp, data->localData[0]->realVars[i]);
+  row.resize(storage->fixedSize);
+  p = &row[storage->offsets[0]];
+  p = pack_double(p, sData->timeValue);
+  for(i=0;i<gather->real.nVars;i++) {
+    p = pack_double(p, sData->realVars[gather->real.vars[i]]);
   }
-  for(i=0;i<modelData->nVariablesInteger;i++) {
-    msgpack_int32(fp, data->localData[0]->integerVars[i]);
+  for(i=0;i<gather->integer.nVars;i++) {
+    *p++ = (char) 0xd2;
+    p = pack_uint32(p, (uint32_t) sData->integerVars[gather->integer.vars[i]]);
   }
-  for(i=0;i<modelData->nVariablesBoolean;i++) {
-    msgpack_boolean(fp, data->localData[0]->booleanVars[i]);
+  for(i=0;i<gather->boolean.nVars;i++) {
+    *p++ = (char) (sData->booleanVars[gather->boolean.vars[i]] ? 0xc3 : 0xc2);
   }
-  for(i=0;i<modelData->nVariablesString;i++) {
-    msgpack_str(fp, MMC_STRINGDATA(data->localData[0]->stringVars[i]));
+  for(i=0;i<gather->string.nVars;i++) {
+    const char *s = MMC_STRINGDATA(sData->stringVars[gather->string.vars[i]]);
+    size_t len = strlen(s), end = row.size();
+    row.resize(end+5+len);
+    pack_str(&row[end], s);
   }
+  pack_uint32(&row[0], row.size()-4);
 
-  long end_pos = fp.tellp();
-  fp.seekp(length_pos);
-  raw_uint32(fp, end_pos-data_pos);
-  fp.seekp(end_pos);
+  if (storage->chunk.nrows == 0) {
+    begin_chunk(storage, sData->timeValue);
+  }
+  storage->fp.write(&row[0], row.size());
+  storage->pos += row.size();
+  storage->chunk.size += row.size();
+  storage->chunk.lastTime = sData->timeValue;
+  if (++storage->chunk.nrows == WALL_CHUNK_ROWS || storage->chunk.size >= WALL_CHUNK_BYTES) {
+    end_chunk(storage);
+  }
 }
 
+/* Writes a copy of all chunk records and the index record at the end */
 void recon_wall_free(simulation_result *self,DATA *data, threadData_t *threadData)
 {
   wall_storage *storage = (wall_storage *)self->storage;
-  storage->fp.close();
   rt_tick(SIM_TIMER_OUTPUT);
+  end_chunk(storage);
+  for(size_t i=0;i<storage->chunks.size();i++) {
+    write_chunk_record(storage->fp, &storage->chunks[i]);
+  }
+  write_index_record(storage->fp, storage->pos, storage->chunks.size(), storage->paramOffset);
+  storage->fp.close();
+  sim_result_freeGather(&storage->gather);
   delete storage;
   self->storage = NULL;
   rt_accumulate(SIM_TIMER_OUTPUT);
@@ -72,6 +72,7 @@
 #include "simulation/results/simulation_result_csv.h"
 #include "simulation/results/simulation_result_mat.h"
 #include "simulation/results/simulation_result_wall.h"
+#include "simulation/results/simulation_result_omz.h"
 #include "simulation/results/simulation_result_ia.h"
 #include "simulation/solver/solver_main.h"
 #include "simulation_info_json.h"
@@ -80,6 +81,7 @@
 #include "simulation/solver/mixedSystem.h"
 #include "simulation/solver/linearSystem.h"
 #include "simulation/solver/nonlinearSystem.h"
+#include "simulation/solver/parallelSystems.h"
 #include "util/rtclock.h"
 #include "omc_config.h"
 #include "simulation/solver/initialization/initialization.h"
@@ -275,6 +277,34 @@ int getNewtonStrategy(int argc, char**argv)
   return NEWTON_NONE;
 }
 
+int getNlsLinearSolver(int argc, char**argv)
+{
+  int i;
+  const char *cflags = omc_flagValue[FLAG_NLS_LS];
+  const string *method = cflags ? new string(cflags) : NULL;
+
+  if(!method)
+    return NLS_LS_DENSE; /* default method */
+
+  for(i=1; i<NLS_LS_MAX; ++i)
+    if(*method == NLS_LS_NAME[i])
+    {
+#ifndef WITH_UMFPACK
+      if(i == NLS_LS_KLU)
+        throwStreamPrint(NULL, "nlsLS=klu is not available, the runtime is compiled without suitesparse.");
+#endif
+      return i;
+    }
+
+  warningStreamPrint(LOG_STDOUT, 1, "unrecognized option -nlsLS=%s, current options are:", method->c_str());
+  for(i=1; i<NLS_LS_MAX; ++i)
+    warningStreamPrint(LOG_STDOUT, 0, "%-18s [%s]", NLS_LS_NAME[i], NLS_LS_DESC[i]);
+  messageClose(LOG_STDOUT);
+  throwStreamPrint(NULL,"see last warning");
+
+  return NLS_LS_UNKNOWN;
+}
+
 /**
  * Read the variable filter and mark variables that should not be part of the result file.
  * This phase is skipped for interactive simulations
@@ -559,6 +589,12 @@ int initializeResultData(DATA* simData, threadData_t *threadData, int cpuTime)
     sim_result.writeParameterData = recon_wall_writeParameterData;
     sim_result.free = recon_wall_free;
     resultFormatHasCheapAliasesAndParameters = 1;
+  } else if(0 == strcmp("omz", simData->simulationInfo->outputFormat)) {
+    sim_result.init = omz_init;
+    sim_result.emit = omz_emit;
+    sim_result.writeParameterData = omz_writeParameterData;
+    sim_result.free = omz_free;
+    resultFormatHasCheapAliasesAndParameters = 1;
   } else if(0 == strcmp("plt", simData->simulationInfo->outputFormat)) {
     sim_result.init = plt_init;
     sim_result.emit = plt_emit;
@@ -741,6 +777,7 @@ int initRuntimeAndSimulation(int argc, char**argv, DATA *data, threadData_t *thr
   data->simulationInfo->nlsMethod = getNonlinearSolverMethod(argc, argv);
   data->simulationInfo->lsMethod = getlinearSolverMethod(argc, argv);
   data->simulationInfo->newtonStrategy = getNewtonStrategy(argc, argv);
+  data->simulationInfo->nlsLinearSolver = getNlsLinearSolver(argc, argv);
   data->simulationInfo->nlsCsvInfomation = omc_flag[FLAG_NLS_INFO];
 
   rt_tick(SIM_TIMER_INIT_XML);
@@ -751,6 +788,7 @@ int initRuntimeAndSimulation(int argc, char**argv, DATA *data, threadData_t *thr
   initializeMixedSystems(data, threadData);
   initializeLinearSystems(data, threadData);
   initializeNonlinearSystems(data, threadData);
+  initializeParallelSystems(data, threadData);
 
   sim_noemit = omc_flag[FLAG_NOEMIT];
 
@@ -822,6 +860,17 @@ void communicateMsg(char id, unsigned int size, const char *data)
 #endif
 }
 
+/* sends messages that are already framed as [ID | SIZE | DATA] */
+void communicateBytes(unsigned int size, const char *data)
+{
+#ifndef NO_INTERACTIVE_DEPENDENCY
+  if(sim_communication_port_open)
+  {
+    sim_communication_port.sendBytes((char*) data, size);
+  }
+#endif
+}
+
 
 /* \brief main function for simulator
  *
@@ -850,6 +899,7 @@ int _main_SimulationRuntime(int argc, char**argv, DATA *data, threadData_t *thre
     freeMixedSystems(data, threadData);        /* free mixed system data */
     freeLinearSystems(data, threadData);       /* free linear system data */
     freeNonlinearSystems(data, threadData);    /* free nonlinear system data */
+    freeParallelSystems(data);                 /* stop the threads of the independent systems */
 
     data->callback->callExternalObjectDestructors(data, threadData);
     deInitializeDataStruc(data);
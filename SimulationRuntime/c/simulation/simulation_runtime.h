@@ -79,6 +79,7 @@ extern void printSimulationStepSize(double in_stepSize, double time);
 
 extern void communicateStatus(const char *phase, double completionPercent);
 extern void communicateMsg(char id, unsigned int size, const char *data);
+extern void communicateBytes(unsigned int size, const char *data);
 
 /* the main function of the simulation runtime!
  * simulation runtime no longer has main, is defined by the generated model code which calls this function.
@@ -98,10 +98,21 @@ bool Socket::send(const std::string &s) const
   return ::send(m_sock, s.c_str(), s.size(), 0) != -1;
 }
 
-// transmit data via TCP
+// transmit data via TCP; send() may write only part of a large buffer
 bool Socket::sendBytes(char* msg, int size) const
 {
-  return ::send(m_sock, msg, size, 0) != -1;
+  while(size > 0)
+  {
+    int sent = ::send(m_sock, msg, size, 0);
+    if(sent == -1)
+    {
+      if(errno == EINTR) continue;
+      return false;
+    }
+    msg += sent;
+    size -= sent;
+  }
+  return true;
 }
 
 int Socket::recv(std::string &s) const
@@ -165,11 +165,18 @@ bool Socket::send(const string &s) const
   }
 }
 
-// transmit data via TCP
+// transmit data via TCP; send() may write only part of a large buffer
 bool Socket::sendBytes(char* msg, int size) const
 {
-  int status = ::send(m_sock, msg, size, 0);
-  return !(status == -1 );
+  while(size > 0)
+  {
+    int status = ::send(m_sock, msg, size, 0);
+    if(status == -1)
+      return false;
+    msg += status;
+    size -= status;
+  }
+  return true;
 }
 
 //receive data via TCP
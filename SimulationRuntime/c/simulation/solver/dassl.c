@@ -31,6 +31,7 @@
 #include <string.h>
 #include <setjmp.h>
 
+#include "omc_config.h"
 #include "openmodelica.h"
 #include "openmodelica_func.h"
 #include "simulation_data.h"
@@ -49,6 +50,10 @@
 #include "simulation/solver/dassl.h"
 #include "meta/meta_modelica.h"
 
+#ifdef WITH_UMFPACK
+#include "suitesparse/Include/klu.h"
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -69,6 +74,16 @@ static const char *dasslJacobianMethodDescStr[DASSL_JAC_MAX] = {"unknown",
                                                        "symbolic jacobian - needs omc compiler flags +generateSymbolicJacobian or +generateSymbolicLinearization."
                                                       };
 
+static const char *dasslLinearSolverStr[DASSL_LS_MAX] = {"unknown",
+                                                "dense",
+                                                "klu"
+                                                };
+
+static const char *dasslLinearSolverDescStr[DASSL_LS_MAX] = {"unknown",
+                                                    "dense LU decomposition inside dassl - default.",
+                                                    "sparse LU decomposition with klu, used as preconditioner of the krylov method."
+                                                   };
+
 /* experimental flag for SKF TLM Master Solver Interface
  *  - it's used with -noEquidistantTimeGrid flag.
  *  - it's set to 1 if the continuous system is evaluated
@@ -115,17 +130,79 @@ void  DDASKR(
     double *rpar,
     int *ipar,
     int (*jac) (double *t, double *y, double *yprime, double *deltaD, double *delta, double *cj, double *h, double *wt, double *rpar, int* ipar),
-    int (*psol) (int *neq, double *t, double *y, double *yprime, double *savr, double *pwk, double *cj, double *wt, double *wp, int *iwp, double *b, double eplin, int* ires, double *rpar, int* ipar),
+    int (*psol) (int *neq, double *t, double *y, double *yprime, double *savr, double *pwk, double *cj, double *wt, double *wp, int *iwp, double *b, double *eplin, int* ires, double *rpar, int* ipar),
     int (*g) (int *neqm, double *t, double *y, double *yp, int *ng, double *gout, double *rpar, int* ipar),
     int *ng,
     int *jroot
 );
 
 static int
-dummy_precondition(int *neq, double *t, double *y, double *yprime, double *savr, double *pwk, double *cj, double *wt, double *wp, int *iwp, double *b, double eplin, int* ires, double *rpar, int* ipar){
+dummy_precondition(int *neq, double *t, double *y, double *yprime, double *savr, double *pwk, double *cj, double *wt, double *wp, int *iwp, double *b, double *eplin, int* ires, double *rpar, int* ipar){
     return 0;
 }
 
+#ifdef WITH_UMFPACK
+/* the pivot order of the last factorization is reused as long as the
+ * estimated reciprocal condition number of the refactorization stays above
+ * this value
+ */
+#define DASSL_KLU_MIN_RCOND 1e-12
+
+/* iteration matrix J - cj*I of the klu linear solver in CSC format */
+typedef struct DASSL_SPARSE_DATA
+{
+  int n;
+  int nnz;
+  int *Ap;
+  int *Ai;
+  double *Ax;
+  unsigned int *map;            /* position in Ax of every element of the sparse pattern */
+  int *diag;                    /* position in Ax of the diagonal element of every column */
+
+  klu_common common;
+  klu_symbolic *symbolic;       /* analysed once, the pattern does not change */
+  klu_numeric *numeric;
+
+  unsigned long nFactor;
+  unsigned long nRefactor;
+} DASSL_SPARSE_DATA;
+
+static DASSL_SPARSE_DATA* allocateSparseData(DATA* data, threadData_t *threadData);
+static void freeSparseData(DASSL_SPARSE_DATA *sparseData);
+static int JacobianSparse(void *res, int *ires, int *neq, double *t, double *y, double *yprime, double *rewt, double *savr, double *wk,
+    double *h, double *cj, double *wp, int *iwp, int *ier, double *rpar, int* ipar);
+static int PreconditionSparse(int *neq, double *t, double *y, double *yprime, double *savr, double *pwk, double *cj, double *wt,
+    double *wp, int *iwp, double *b, double *eplin, int* ier, double *rpar, int* ipar);
+#endif
+
+/* data of a worker of the parallel colored jacobian */
+typedef struct DASSL_JAC_THREAD
+{
+  DATA *data;                   /* own copy of the model data */
+  threadData_t *threadData;
+  double *rpar[3];              /* rpar of functionODE_residual for the copy */
+  double *delta_hh;
+  double *newdelta;
+  int initialized;              /* thread data is set up on the worker thread */
+  int failed;
+} DASSL_JAC_THREAD;
+
+/* one evaluation of the colored jacobian, split into one task per color */
+typedef struct DASSL_JAC_JOB
+{
+  DATA *data;
+  DASSL_DATA *dasslData;
+  double *t, *y, *yprime, *delta, *cj, *h, *wt;
+  int *ipar;
+  double *matrixA;              /* dense matrix or NULL */
+  double *Ax;                   /* values of the CSC matrix, used if matrixA is NULL */
+  unsigned int *map;            /* position of the elements of the sparse pattern in Ax */
+} DASSL_JAC_JOB;
+
+static void allocateJacThreads(DATA* data, threadData_t *threadData, DASSL_DATA *dasslData, int nThreads);
+static void freeJacThreads(DASSL_DATA *dasslData);
+static void jacA_coloredParallel(DASSL_JAC_JOB *job, threadData_t *threadData);
+
 static int continue_DASSL(int* idid, double* tolarence);
 
 /* function for calculating state values on residual form */
@@ -143,8 +220,50 @@ int dassl_initial(DATA* data, threadData_t *threadData, SOLVER_INFO* solverInfo,
 
   RHSFinalFlag = 0;
 
+  /* if FLAG_DASSL_LINEAR_SOLVER is set, choose the linear solver of the newton iteration */
+  dasslData->dasslLinearSolver = DASSL_LS_DENSE;
+  if (omc_flag[FLAG_DASSL_LINEAR_SOLVER])
+  {
+    dasslData->dasslLinearSolver = DASSL_LS_UNKNOWN;
+    for(i=1; i< DASSL_LS_MAX;i++)
+    {
+      if(!strcmp((const char*)omc_flagValue[FLAG_DASSL_LINEAR_SOLVER], dasslLinearSolverStr[i])){
+        dasslData->dasslLinearSolver = (int)i;
+        break;
+      }
+    }
+    if(dasslData->dasslLinearSolver == DASSL_LS_UNKNOWN)
+    {
+      if (ACTIVE_WARNING_STREAM(LOG_SOLVER))
+      {
+        warningStreamPrint(LOG_SOLVER, 1, "unrecognized linear solver %s, current options are:", (const char*)omc_flagValue[FLAG_DASSL_LINEAR_SOLVER]);
+        for(i=1; i < DASSL_LS_MAX; ++i)
+        {
+          warningStreamPrint(LOG_SOLVER, 0, "%-15s [%s]", dasslLinearSolverStr[i], dasslLinearSolverDescStr[i]);
+        }
+        messageClose(LOG_SOLVER);
+      }
+      throwStreamPrint(threadData,"unrecognized linear solver %s", (const char*)omc_flagValue[FLAG_DASSL_LINEAR_SOLVER]);
+    }
+#ifndef WITH_UMFPACK
+    if(dasslData->dasslLinearSolver == DASSL_LS_KLU)
+    {
+      throwStreamPrint(threadData, "dasslLinearSolver=klu is not available, the runtime is compiled without suitesparse.");
+    }
+#endif
+  }
+
   dasslData->liw = 40 + data->modelData->nStates;
-  dasslData->lrw = 60 + ((maxOrder + 4) * data->modelData->nStates) + (data->modelData->nStates * data->modelData->nStates)  + (3*data->modelData->nZeroCrossings);
+  if (dasslData->dasslLinearSolver == DASSL_LS_KLU)
+  {
+    /* krylov method with the default parameters and one element of WP and IWP; no dense matrix */
+    dasslData->liw += 1;
+    dasslData->lrw = 101 + 18*data->modelData->nStates + (3*data->modelData->nZeroCrossings) + 1;
+  }
+  else
+  {
+    dasslData->lrw = 60 + ((maxOrder + 4) * data->modelData->nStates) + (data->modelData->nStates * data->modelData->nStates)  + (3*data->modelData->nZeroCrossings);
+  }
   dasslData->rwork = (double*) calloc(dasslData->lrw, sizeof(double));
   assertStreamPrint(threadData, 0 != dasslData->rwork,"out of memory");
   dasslData->iwork = (int*)  calloc(dasslData->liw, sizeof(int));
@@ -171,6 +290,7 @@ int dassl_initial(DATA* data, threadData_t *threadData, SOLVER_INFO* solverInfo,
   dasslData->delta_hh = (double*) malloc(data->modelData->nStates*sizeof(double));
   dasslData->newdelta = (double*) malloc(data->modelData->nStates*sizeof(double));
   dasslData->stateDer = (double*) malloc(data->modelData->nStates*sizeof(double));
+  dasslData->sparseData = NULL;
 
   data->simulationInfo->currentContext = CONTEXT_ALGEBRAIC;
 
@@ -351,6 +471,57 @@ int dassl_initial(DATA* data, threadData_t *threadData, SOLVER_INFO* solverInfo,
       break;
   }
   infoStreamPrint(LOG_SOLVER, 0, "jacobian is calculated by %s", dasslJacobianMethodDescStr[dasslData->dasslJacobian]);
+  dasslData->preconditionFunction = dummy_precondition;
+
+  /* if FLAG_JACOBIAN_THREADS is set, the color groups of the jacobian are evaluated in parallel */
+  dasslData->threadPool = NULL;
+  dasslData->jacThreadData = NULL;
+  if (omc_flag[FLAG_JACOBIAN_THREADS])
+  {
+    int nThreads = atoi(omc_flagValue[FLAG_JACOBIAN_THREADS]);
+
+    assertStreamPrint(threadData, nThreads >= 1, "Selected number of jacobian threads %d is out of range (>= 1).", nThreads);
+
+    if (nThreads > 1)
+    {
+      if (dasslData->dasslJacobian != DASSL_COLOREDNUMJAC && dasslData->dasslJacobian != DASSL_COLOREDSYMJAC)
+      {
+        warningStreamPrint(LOG_STDOUT, 0, "The flag \"jacobianThreads\" is only used by the colored jacobians of dassl.");
+      }
+      else if (data->modelData->nExtObjs > 0)
+      {
+        /* the external objects are shared by all copies of the model data and may keep state */
+        warningStreamPrint(LOG_STDOUT, 0, "The model has external objects, the jacobian is evaluated sequentially.");
+      }
+      else
+      {
+        allocateJacThreads(data, threadData, dasslData, nThreads);
+      }
+    }
+  }
+  infoStreamPrint(LOG_SOLVER, 0, "jacobian is evaluated by %d thread(s)", omc_thread_pool_size(dasslData->threadPool));
+
+#ifdef WITH_UMFPACK
+  /* the iteration matrix is assembled from the colored jacobian in CSC
+   * format and factorized by klu; dassl uses it as preconditioner of its
+   * krylov method, which then converges in one or two iterations */
+  if (dasslData->dasslLinearSolver == DASSL_LS_KLU)
+  {
+    if (dasslData->dasslJacobian != DASSL_COLOREDNUMJAC && dasslData->dasslJacobian != DASSL_COLOREDSYMJAC)
+    {
+      throwStreamPrint(threadData, "dasslLinearSolver=klu needs the sparsity pattern of the jacobian (dasslJacobian=coloredNumerical or coloredSymbolical).");
+    }
+    dasslData->sparseData = allocateSparseData(data, threadData);
+    dasslData->jacobianFunction = JacobianSparse;
+    dasslData->preconditionFunction = PreconditionSparse;
+    dasslData->info[4] = 0;
+    dasslData->info[11] = 1;
+    dasslData->info[14] = 1;
+    dasslData->iwork[26] = 1;
+    dasslData->iwork[27] = 1;
+  }
+#endif
+  infoStreamPrint(LOG_SOLVER, 0, "linear solver is %s", dasslLinearSolverDescStr[dasslData->dasslLinearSolver]);
 
 
   /* if FLAG_DASSL_NO_ROOTFINDING is set, choose dassl with out internal root finding */
@@ -408,6 +579,16 @@ int dassl_deinitial(DASSL_DATA *dasslData)
   free(dasslData->newdelta);
   free(dasslData->stateDer);
   free(dasslData->dasslStatistics);
+#ifdef WITH_UMFPACK
+  if (dasslData->sparseData)
+  {
+    freeSparseData((DASSL_SPARSE_DATA*) dasslData->sparseData);
+  }
+#endif
+  if (dasslData->threadPool)
+  {
+    freeJacThreads(dasslData);
+  }
   free(dasslData->dasslStatisticsTmp);
 
   free(dasslData);
@@ -544,7 +725,7 @@ int dassl_step(DATA* data, threadData_t *threadData, SOLVER_INFO* solverInfo)
             &solverInfo->currentTime, sData->realVars, stateDer, &tout,
             dasslData->info, dasslData->rtol, dasslData->atol, &dasslData->idid,
             dasslData->rwork, &dasslData->lrw, dasslData->iwork, &dasslData->liw,
-            (double*) (void*) dasslData->rpar, dasslData->ipar, dasslData->jacobianFunction, dummy_precondition,
+            (double*) (void*) dasslData->rpar, dasslData->ipar, dasslData->jacobianFunction, dasslData->preconditionFunction,
             dasslData->zeroCrossingFunction, (int*) &dasslData->ng, dasslData->jroot);
 
     /* closing new step message */
@@ -911,7 +1092,15 @@ static int JacobianSymbolicColored(double *t, double *y, double *yprime, double
   data->callback->input_function(data, threadData);
   /* eval ode*/
   data->callback->functionODE(data, threadData);
-  functionJacAColored(data, threadData, pd);
+  if (dasslData->threadPool)
+  {
+    DASSL_JAC_JOB job = {data, dasslData, t, y, yprime, deltaD, cj, h, wt, ipar, pd, NULL, NULL};
+    jacA_coloredParallel(&job, threadData);
+  }
+  else
+  {
+    functionJacAColored(data, threadData, pd);
+  }
 
   /* add cj to the diagonal elements of the matrix */
   j = 0;
@@ -1130,7 +1319,12 @@ static int JacobianOwnNumColored(double *t, double *y, double *yprime, double *d
 
   setContext(data, t, CONTEXT_JACOBIAN);
 
-  if(jacA_numColored(data, t, y, yprime, deltaD, pd, cj, h, wt, rpar, ipar))
+  if (dasslData->threadPool)
+  {
+    DASSL_JAC_JOB job = {data, dasslData, t, y, yprime, deltaD, cj, h, wt, ipar, pd, NULL, NULL};
+    jacA_coloredParallel(&job, threadData);
+  }
+  else if(jacA_numColored(data, t, y, yprime, deltaD, pd, cj, h, wt, rpar, ipar))
   {
     throwStreamPrint(threadData, "Error, can not get Matrix A ");
     TRACE_POP
@@ -1150,6 +1344,582 @@ static int JacobianOwnNumColored(double *t, double *y, double *yprime, double *d
   return 0;
 }
 
+/*
+ * creates the thread pool of the parallel colored jacobian and a copy of
+ * the model data for every worker; worker 0 is the integrator thread itself.
+ * The copies share the variables, the old tables search without their
+ * cursors on the workers and models with external objects are not
+ * evaluated in parallel at all.
+ */
+static void allocateJacThreads(DATA* data, threadData_t *threadData, DASSL_DATA *dasslData, int nThreads)
+{
+  const int nStates = data->modelData->nStates;
+  DASSL_JAC_THREAD *jacThreads;
+  int i;
+
+  dasslData->threadPool = omc_thread_pool_create(nThreads);
+  assertStreamPrint(threadData, 0 != dasslData->threadPool, "could not create the threads of the jacobian");
+  nThreads = omc_thread_pool_size(dasslData->threadPool);
+  if (nThreads < 2)
+  {
+    warningStreamPrint(LOG_STDOUT, 0, "Could not start the threads of the jacobian, it is evaluated sequentially.");
+    omc_thread_pool_free(dasslData->threadPool);
+    dasslData->threadPool = NULL;
+    return;
+  }
+
+  jacThreads = (DASSL_JAC_THREAD*) calloc(nThreads, sizeof(DASSL_JAC_THREAD));
+  assertStreamPrint(threadData, 0 != jacThreads, "out of memory");
+  for(i = 0; i < nThreads; i++)
+  {
+    if (i == 0)
+    {
+      jacThreads[i].threadData = threadData;
+    }
+    else
+    {
+      /* zeroed and scanned by the garbage collector; localRoots may point to its objects */
+      jacThreads[i].threadData = (threadData_t*) omc_alloc_interface.malloc_uncollectable(sizeof(threadData_t));
+      assertStreamPrint(threadData, 0 != jacThreads[i].threadData, "out of memory");
+      jacThreads[i].threadData->parent = threadData;
+      pthread_mutex_init(&jacThreads[i].threadData->parentMutex, NULL);
+    }
+    jacThreads[i].data = initializeThreadDataStruc(data, threadData);
+    jacThreads[i].rpar[0] = (double*) (void*) jacThreads[i].data;
+    jacThreads[i].rpar[1] = (double*) (void*) dasslData;
+    jacThreads[i].rpar[2] = (double*) (void*) jacThreads[i].threadData;
+    jacThreads[i].delta_hh = (double*) malloc(nStates*sizeof(double));
+    jacThreads[i].newdelta = (double*) malloc(nStates*sizeof(double));
+    assertStreamPrint(threadData, jacThreads[i].delta_hh && jacThreads[i].newdelta, "out of memory");
+
+    if (dasslData->dasslJacobian == DASSL_COLOREDSYMJAC && data->callback->initialAnalyticJacobianA(jacThreads[i].data, threadData))
+    {
+      throwStreamPrint(threadData, "could not initialize the jacobian of thread %d", i);
+    }
+  }
+  dasslData->jacThreadData = jacThreads;
+}
+
+static void freeJacThreads(DASSL_DATA *dasslData)
+{
+  DASSL_JAC_THREAD *jacThreads = (DASSL_JAC_THREAD*) dasslData->jacThreadData;
+  int nThreads = omc_thread_pool_size(dasslData->threadPool);
+  int i;
+
+  omc_thread_pool_free(dasslData->threadPool);
+  for(i = 0; i < nThreads; i++)
+  {
+    deInitializeThreadDataStruc(jacThreads[i].data, jacThreads[0].threadData);
+    free(jacThreads[i].delta_hh);
+    free(jacThreads[i].newdelta);
+    if (i > 0)
+    {
+      pthread_mutex_destroy(&jacThreads[i].threadData->parentMutex);
+      omc_alloc_interface.free_uncollectable(jacThreads[i].threadData);
+    }
+  }
+  free(jacThreads);
+}
+
+/*
+ *  stores an element of column col of the jacobian; j is its position in
+ *  the sparse pattern
+ */
+static inline void jacA_storeElement(DASSL_JAC_JOB *job, unsigned int col, unsigned int j, unsigned int row, double value)
+{
+  if (job->matrixA)
+  {
+    job->matrixA[row + col*job->data->modelData->nStates] = value;
+  }
+  else
+  {
+    job->Ax[job->map[j]] = value;
+  }
+}
+
+/*
+ *  finite differences of one color group, evaluated on the copy of the
+ *  model data of the worker
+ */
+static void jacA_numColor(DASSL_JAC_JOB *job, DASSL_JAC_THREAD *jacThread, unsigned int color)
+{
+  DATA* data = jacThread->data;
+  const int index = data->callback->INDEX_JAC_A;
+  const SPARSE_PATTERN *pattern = &job->data->simulationInfo->analyticJacobians[index].sparsePattern;
+  double *y = data->localData[0]->realVars;
+  double *delta_hh = jacThread->delta_hh;
+  double delta_h = job->dasslData->sqrteps;
+  double delta_hhh;
+  int ires;
+  unsigned int ii, j;
+
+  for(ii = 0; ii < data->modelData->nStates; ii++)
+  {
+    if(pattern->colorCols[ii]-1 == color)
+    {
+      delta_hhh = *job->h * job->yprime[ii];
+      delta_hh[ii] = delta_h * fmax(fmax(fabs(job->y[ii]),fabs(delta_hhh)),fabs(1./job->wt[ii]));
+      delta_hh[ii] = (delta_hhh >= 0 ? delta_hh[ii] : -delta_hh[ii]);
+      delta_hh[ii] = job->y[ii] + delta_hh[ii] - job->y[ii];
+
+      y[ii] = job->y[ii] + delta_hh[ii];
+
+      delta_hh[ii] = 1. / delta_hh[ii];
+    }
+  }
+
+  functionODE_residual(job->t, y, job->yprime, job->cj, jacThread->newdelta, &ires, (double*) (void*) jacThread->rpar, job->ipar);
+
+  increaseJacContext(data);
+
+  for(ii = 0; ii < data->modelData->nStates; ii++)
+  {
+    if(pattern->colorCols[ii]-1 == color)
+    {
+      for(j = (ii == 0) ? 0 : pattern->leadindex[ii-1]; j < pattern->leadindex[ii]; j++)
+      {
+        jacA_storeElement(job, ii, j, pattern->index[j], (jacThread->newdelta[pattern->index[j]] - job->delta[pattern->index[j]]) * delta_hh[ii]);
+      }
+      y[ii] = job->y[ii];
+    }
+  }
+}
+
+/*
+ *  symbolic jacobian columns of one color group, evaluated on the copy of
+ *  the model data of the worker
+ */
+static void jacA_symColor(DASSL_JAC_JOB *job, DASSL_JAC_THREAD *jacThread, unsigned int color)
+{
+  DATA* data = jacThread->data;
+  ANALYTIC_JACOBIAN *jac = &data->simulationInfo->analyticJacobians[data->callback->INDEX_JAC_A];
+  unsigned int ii, j;
+
+  for(ii = 0; ii < jac->sizeCols; ii++)
+    if(jac->sparsePattern.colorCols[ii]-1 == color)
+      jac->seedVars[ii] = 1;
+
+  data->callback->functionJacA_column(data, jacThread->threadData);
+
+  for(ii = 0; ii < jac->sizeCols; ii++)
+  {
+    if(jac->sparsePattern.colorCols[ii]-1 == color)
+    {
+      for(j = (ii == 0) ? 0 : jac->sparsePattern.leadindex[ii-1]; j < jac->sparsePattern.leadindex[ii]; j++)
+      {
+        jacA_storeElement(job, ii, j, jac->sparsePattern.index[j], jac->resultVars[jac->sparsePattern.index[j]]);
+      }
+      jac->seedVars[ii] = 0;
+    }
+  }
+}
+
+/*
+ *  task of the thread pool, evaluates one color group; errors are caught
+ *  here and reported by jacA_coloredParallel on the integrator thread
+ */
+static void jacA_coloredTask(void *arg, int worker, int color)
+{
+  DASSL_JAC_JOB *job = (DASSL_JAC_JOB*) arg;
+  DASSL_JAC_THREAD *jacThread = ((DASSL_JAC_THREAD*) job->dasslData->jacThreadData) + worker;
+  threadData_t *threadData = jacThread->threadData;
+  int saveJumpState;
+  int success = 0;
+
+  if (!jacThread->initialized)
+  {
+    if (worker > 0)
+    {
+      pthread_setspecific(mmc_thread_data_key, threadData);
+      mmc_init_stackoverflow(threadData);
+    }
+    jacThread->initialized = 1;
+  }
+
+  saveJumpState = threadData->currentErrorStage;
+  threadData->currentErrorStage = ERROR_INTEGRATOR;
+
+  /* try */
+#if !defined(OMC_EMCC)
+  MMC_TRY_INTERNAL(simulationJumpBuffer)
+#endif
+
+  /* a worker has no outer handler; MMC_THROW and stack overflows end here */
+  if (worker > 0)
+  {
+    threadData->mmc_jumper = threadData->simulationJumpBuffer;
+    threadData->mmc_stack_overflow_jumper = threadData->simulationJumpBuffer;
+  }
+
+  if (job->dasslData->dasslJacobian == DASSL_COLOREDSYMJAC)
+  {
+    jacA_symColor(job, jacThread, (unsigned int) color);
+  }
+  else
+  {
+    jacA_numColor(job, jacThread, (unsigned int) color);
+  }
+  success = 1;
+
+#if !defined(OMC_EMCC)
+  MMC_CATCH_INTERNAL(simulationJumpBuffer)
+#endif
+
+  if (worker > 0)
+  {
+    threadData->mmc_jumper = NULL;
+    threadData->mmc_stack_overflow_jumper = NULL;
+  }
+  threadData->currentErrorStage = saveJumpState;
+  if (!success)
+  {
+    jacThread->failed = 1;
+  }
+}
+
+/*
+ *  function calculates the colored jacobian (numerical or symbolic) with
+ *  one task per color group on the thread pool. The columns of a color do
+ *  not share rows with each other, so the tasks write disjoint elements of
+ *  the matrix. For the symbolic jacobian functionODE has to be evaluated at
+ *  y before.
+ */
+static void jacA_coloredParallel(DASSL_JAC_JOB *job, threadData_t *threadData)
+{
+  DATA* data = job->data;
+  DASSL_JAC_THREAD *jacThreads = (DASSL_JAC_THREAD*) job->dasslData->jacThreadData;
+  int nThreads = omc_thread_pool_size(job->dasslData->threadPool);
+  double timeBackup;
+  int i, failed = 0;
+
+  /* the workers do not read the external inputs themselves */
+  timeBackup = data->localData[0]->timeValue;
+  data->localData[0]->timeValue = *job->t;
+  externalInputUpdate(data);
+
+  for(i = 0; i < nThreads; i++)
+  {
+    updateThreadDataStruc(jacThreads[i].data, data);
+    jacThreads[i].failed = 0;
+  }
+  data->localData[0]->timeValue = timeBackup;
+
+  omc_thread_pool_run(job->dasslData->threadPool, jacA_coloredTask, job,
+                      data->simulationInfo->analyticJacobians[data->callback->INDEX_JAC_A].sparsePattern.maxColors);
+
+  for(i = 0; i < nThreads; i++)
+  {
+    failed |= jacThreads[i].failed;
+  }
+  if (failed)
+  {
+    throwStreamPrint(threadData, "Error, can not get Matrix A ");
+  }
+}
+
+#ifdef WITH_UMFPACK
+/*
+ * assembles the pattern of J - cj*I in CSC format from the sparse pattern
+ * of the jacobian (plus the diagonal) and analyses it with klu
+ */
+static DASSL_SPARSE_DATA* allocateSparseData(DATA* data, threadData_t *threadData)
+{
+  const int index = data->callback->INDEX_JAC_A;
+  const SPARSE_PATTERN *pattern = &data->simulationInfo->analyticJacobians[index].sparsePattern;
+  const int n = data->modelData->nStates;
+  DASSL_SPARSE_DATA *sparseData = (DASSL_SPARSE_DATA*) calloc(1, sizeof(DASSL_SPARSE_DATA));
+  unsigned int *rows, *pos;
+  unsigned int i, j, k, l, m, start;
+  int hasDiag;
+
+  assertStreamPrint(threadData, 0 != sparseData, "out of memory");
+  sparseData->n = n;
+  sparseData->Ap = (int*) malloc((n+1)*sizeof(int));
+  sparseData->Ai = (int*) malloc((pattern->numberOfNoneZeros + n)*sizeof(int));
+  sparseData->map = (unsigned int*) malloc(modelica_integer_max(1, pattern->numberOfNoneZeros)*sizeof(unsigned int));
+  sparseData->diag = (int*) malloc(n*sizeof(int));
+  /* rows and pattern positions of one column, sorted by row */
+  rows = (unsigned int*) malloc((n+1)*sizeof(unsigned int));
+  pos = (unsigned int*) malloc((n+1)*sizeof(unsigned int));
+  assertStreamPrint(threadData, sparseData->Ap && sparseData->Ai && sparseData->map && sparseData->diag && rows && pos, "out of memory");
+
+  k = 0;
+  for(i = 0; i < n; i++)
+  {
+    start = (i == 0) ? 0 : pattern->leadindex[i-1];
+    m = 0;
+    hasDiag = 0;
+    for(j = start; j < pattern->leadindex[i]; j++)
+    {
+      for(l = m; l > 0 && rows[l-1] > pattern->index[j]; l--)
+      {
+        rows[l] = rows[l-1];
+        pos[l] = pos[l-1];
+      }
+      rows[l] = pattern->index[j];
+      pos[l] = j;
+      hasDiag |= (pattern->index[j] == i);
+      m++;
+    }
+    if(!hasDiag)
+    {
+      for(l = m; l > 0 && rows[l-1] > i; l--)
+      {
+        rows[l] = rows[l-1];
+        pos[l] = pos[l-1];
+      }
+      rows[l] = i;
+      pos[l] = (unsigned int) -1;
+      m++;
+    }
+
+    sparseData->Ap[i] = k;
+    for(l = 0; l < m; l++, k++)
+    {
+      sparseData->Ai[k] = rows[l];
+      if(rows[l] == i)
+        sparseData->diag[i] = k;
+      if(pos[l] != (unsigned int) -1)
+        sparseData->map[pos[l]] = k;
+    }
+  }
+  sparseData->Ap[n] = k;
+  sparseData->nnz = k;
+  sparseData->Ax = (double*) calloc(modelica_integer_max(1, k), sizeof(double));
+  assertStreamPrint(threadData, 0 != sparseData->Ax, "out of memory");
+  free(rows);
+  free(pos);
+
+  klu_defaults(&sparseData->common);
+  sparseData->symbolic = klu_analyze(n, sparseData->Ap, sparseData->Ai, &sparseData->common);
+  if (NULL == sparseData->symbolic)
+  {
+    throwStreamPrint(threadData, "klu could not analyse the iteration matrix of dassl (status %d).", sparseData->common.status);
+  }
+  infoStreamPrint(LOG_SOLVER, 0, "iteration matrix for klu: %d states, %d nonzero elements", n, sparseData->nnz);
+
+  return sparseData;
+}
+
+static void freeSparseData(DASSL_SPARSE_DATA *sparseData)
+{
+  infoStreamPrint(LOG_SOLVER, 0, "klu factorizations of the iteration matrix: %lu, refactorizations: %lu", sparseData->nFactor, sparseData->nRefactor);
+  if(sparseData->numeric)
+    klu_free_numeric(&sparseData->numeric, &sparseData->common);
+  if(sparseData->symbolic)
+    klu_free_symbolic(&sparseData->symbolic, &sparseData->common);
+  free(sparseData->Ap);
+  free(sparseData->Ai);
+  free(sparseData->Ax);
+  free(sparseData->map);
+  free(sparseData->diag);
+  free(sparseData);
+}
+
+/*
+ *  function calculates the jacobian by colored finite differences and
+ *  stores it in Ax of the sparse data
+ */
+static void jacA_numColoredSparse(DATA* data, double *t, double *y, double *yprime, double *delta, DASSL_SPARSE_DATA *sparseData,
+    double *cj, double *h, double *rewt, double *rpar, int *ipar)
+{
+  const int index = data->callback->INDEX_JAC_A;
+  const SPARSE_PATTERN *pattern = &data->simulationInfo->analyticJacobians[index].sparsePattern;
+  DASSL_DATA* dasslData = (DASSL_DATA*)(void*)((double**)rpar)[1];
+  double delta_h = dasslData->sqrteps;
+  double delta_hhh;
+  int ires;
+  double* delta_hh = dasslData->delta_hh;
+  double* ysave = dasslData->ysave;
+
+  unsigned int i,j,l,ii;
+
+  for(i = 0; i < pattern->maxColors; i++)
+  {
+    for(ii=0; ii < data->simulationInfo->analyticJacobians[index].sizeCols; ii++)
+    {
+      if(pattern->colorCols[ii]-1 == i)
+      {
+        delta_hhh = *h * yprime[ii];
+        delta_hh[ii] = delta_h * fmax(fmax(fabs(y[ii]),fabs(delta_hhh)),fabs(1./rewt[ii]));
+        delta_hh[ii] = (delta_hhh >= 0 ? delta_hh[ii] : -delta_hh[ii]);
+        delta_hh[ii] = y[ii] + delta_hh[ii] - y[ii];
+
+        ysave[ii] = y[ii];
+        y[ii] += delta_hh[ii];
+
+        delta_hh[ii] = 1. / delta_hh[ii];
+      }
+    }
+
+    functionODE_residual(t, y, yprime, cj, dasslData->newdelta, &ires, rpar, ipar);
+
+    increaseJacContext(data);
+
+    for(ii = 0; ii < data->simulationInfo->analyticJacobians[index].sizeCols; ii++)
+    {
+      if(pattern->colorCols[ii]-1 == i)
+      {
+        for(j = (ii == 0) ? 0 : pattern->leadindex[ii-1]; j < pattern->leadindex[ii]; j++)
+        {
+          l = pattern->index[j];
+          sparseData->Ax[sparseData->map[j]] = (dasslData->newdelta[l] - delta[l]) * delta_hh[ii];
+        }
+        y[ii] = ysave[ii];
+      }
+    }
+  }
+}
+
+/*
+ *  function calculates the symbolic colored jacobian and stores it in Ax
+ *  of the sparse data
+ */
+static void functionJacAColoredSparse(DATA* data, threadData_t *threadData, DASSL_SPARSE_DATA *sparseData)
+{
+  const int index = data->callback->INDEX_JAC_A;
+  ANALYTIC_JACOBIAN *jac = &data->simulationInfo->analyticJacobians[index];
+  unsigned int i,j,ii;
+
+  for(i=0; i < jac->sparsePattern.maxColors; i++)
+  {
+    for(ii=0; ii < jac->sizeCols; ii++)
+      if(jac->sparsePattern.colorCols[ii]-1 == i)
+        jac->seedVars[ii] = 1;
+
+    data->callback->functionJacA_column(data, threadData);
+
+    for(ii = 0; ii < jac->sizeCols; ii++)
+    {
+      if(jac->seedVars[ii] == 1)
+      {
+        for(j = (ii == 0) ? 0 : jac->sparsePattern.leadindex[ii-1]; j < jac->sparsePattern.leadindex[ii]; j++)
+        {
+          sparseData->Ax[sparseData->map[j]] = jac->resultVars[jac->sparsePattern.index[j]];
+        }
+        jac->seedVars[ii] = 0;
+      }
+    }
+  }
+}
+
+/*
+ * factorizes the iteration matrix; the numeric factorization is reused
+ * by klu_refactor as long as its pivots are acceptable
+ */
+static int factorSparse(DASSL_SPARSE_DATA *sparseData)
+{
+  if (sparseData->numeric)
+  {
+    if (klu_refactor(sparseData->Ap, sparseData->Ai, sparseData->Ax, sparseData->symbolic, sparseData->numeric, &sparseData->common) &&
+        klu_rcond(sparseData->symbolic, sparseData->numeric, &sparseData->common) &&
+        sparseData->common.rcond > DASSL_KLU_MIN_RCOND)
+    {
+      sparseData->nRefactor++;
+      return 0;
+    }
+    klu_free_numeric(&sparseData->numeric, &sparseData->common);
+  }
+
+  sparseData->numeric = klu_factor(sparseData->Ap, sparseData->Ai, sparseData->Ax, sparseData->symbolic, &sparseData->common);
+  sparseData->nFactor++;
+  if (NULL == sparseData->numeric || KLU_OK != sparseData->common.status)
+  {
+    infoStreamPrint(LOG_DASSL, 0, "klu failed to factorize the iteration matrix (status %d)", sparseData->common.status);
+    if (sparseData->numeric)
+      klu_free_numeric(&sparseData->numeric, &sparseData->common);
+    return 1;
+  }
+  return 0;
+}
+
+/*
+ * evaluates and factorizes the preconditioner J - cj*I of the krylov
+ * method of dassl; a nonzero ier lets dassl retry with a smaller step
+ */
+static int JacobianSparse(void *res, int *ires, int *neq, double *t, double *y, double *yprime, double *rewt, double *savr, double *wk,
+    double *h, double *cj, double *wp, int *iwp, int *ier, double *rpar, int* ipar)
+{
+  TRACE_PUSH
+  DATA* data = (DATA*)(void*)((double**)rpar)[0];
+  DASSL_DATA* dasslData = (DASSL_DATA*)(void*)((double**)rpar)[1];
+  threadData_t *threadData = (threadData_t*)(void*)((double**)rpar)[2];
+  DASSL_SPARSE_DATA* sparseData = (DASSL_SPARSE_DATA*) dasslData->sparseData;
+  DASSL_JAC_JOB job = {data, dasslData, t, y, yprime, savr, cj, h, rewt, ipar, NULL, sparseData->Ax, sparseData->map};
+  double* backupStates;
+  double timeBackup;
+  int i;
+
+  /* the diagonal elements which are not part of the pattern stay zero */
+  memset(sparseData->Ax, 0, sparseData->nnz*sizeof(double));
+
+  setContext(data, t, CONTEXT_JACOBIAN);
+  if (dasslData->dasslJacobian == DASSL_COLOREDSYMJAC)
+  {
+    backupStates = data->localData[0]->realVars;
+    timeBackup = data->localData[0]->timeValue;
+
+    data->localData[0]->timeValue = *t;
+    data->localData[0]->realVars = y;
+    /* read input vars */
+    externalInputUpdate(data);
+    data->callback->input_function(data, threadData);
+    /* eval ode*/
+    data->callback->functionODE(data, threadData);
+    if (dasslData->threadPool)
+    {
+      jacA_coloredParallel(&job, threadData);
+    }
+    else
+    {
+      functionJacAColoredSparse(data, threadData, sparseData);
+    }
+
+    data->localData[0]->realVars = backupStates;
+    data->localData[0]->timeValue = timeBackup;
+  }
+  else if (dasslData->threadPool)
+  {
+    jacA_coloredParallel(&job, threadData);
+  }
+  else
+  {
+    jacA_numColoredSparse(data, t, y, yprime, savr, sparseData, cj, h, rewt, rpar, ipar);
+  }
+  unsetContext(data);
+
+  /* add cj to the diagonal elements of the matrix */
+  for(i = 0; i < sparseData->n; i++)
+  {
+    sparseData->Ax[sparseData->diag[i]] -= *cj;
+  }
+
+  *ier = factorSparse(sparseData);
+
+  TRACE_POP
+  return 0;
+}
+
+/*
+ * solves P*x = b with the factorization of the preconditioner, b is
+ * overwritten by x
+ */
+static int PreconditionSparse(int *neq, double *t, double *y, double *yprime, double *savr, double *pwk, double *cj, double *wt,
+    double *wp, int *iwp, double *b, double *eplin, int* ier, double *rpar, int* ipar)
+{
+  DASSL_DATA* dasslData = (DASSL_DATA*)(void*)((double**)rpar)[1];
+  DASSL_SPARSE_DATA* sparseData = (DASSL_SPARSE_DATA*) dasslData->sparseData;
+
+  if (NULL == sparseData->numeric || !klu_solve(sparseData->symbolic, sparseData->numeric, sparseData->n, 1, b, &sparseData->common))
+  {
+    *ier = 1;
+    return 0;
+  }
+  *ier = 0;
+  return 0;
+}
+#endif
+
 #ifdef __cplusplus
 }
 #endif
@@ -32,6 +32,7 @@
 #define DASSL_H
 
 #include "simulation/solver/solver_main.h"
+#include "util/omc_thread_pool.h"
 
 #define DDASKR _daskr_ddaskr_
 
@@ -50,6 +51,14 @@ enum DASSL_JACOBIAN
   DASSL_JAC_MAX
 };
 
+enum DASSL_LINEAR_SOLVER
+{
+  DASSL_LS_UNKNOWN = 0,
+  DASSL_LS_DENSE,
+  DASSL_LS_KLU,
+  DASSL_LS_MAX
+};
+
 typedef struct DASSL_DATA{
 
   int dasslSteps;               /* if TRUE then dassl internal steps are used to store results */
@@ -57,6 +66,7 @@ typedef struct DASSL_DATA{
   double dasslStepsTime;        /* value specifies the time increment when output happens. Used in dasslSteps mode. */
   int dasslRootFinding;         /* if TRUE then the internal root finding is used */
   int dasslJacobian;            /* specifices the method to calculate the jacobian matrix */
+  int dasslLinearSolver;        /* specifices the linear solver of the newton iteration */
   int dasslAvoidEventRestart;   /* if TRUE then no restart after an event is performed */
 
   unsigned int* dasslStatistics;
@@ -85,10 +95,14 @@ typedef struct DASSL_DATA{
   double *delta_hh;
   double *newdelta;
   double *stateDer;
+  void *sparseData;             /* DASSL_SPARSE_DATA of the klu linear solver */
+  OMC_THREAD_POOL *threadPool;  /* evaluates the color groups of the jacobian in parallel; NULL if not used */
+  void *jacThreadData;          /* DASSL_JAC_THREAD of every worker of threadPool */
 
   /* function pointer of provied functions */
   void* jacobianFunction;
   void* zeroCrossingFunction;
+  void* preconditionFunction;
 } DASSL_DATA;
 
 /* main dassl function to make a step */
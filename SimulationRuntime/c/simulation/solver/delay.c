@@ -36,51 +36,113 @@
 #include "simulation_data.h"
 #include "util/ringbuffer.h"
 #include "openmodelica.h"
+#include "simulation/options.h"
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 
 /* the delayStructure looks like a matrix (rows = expressionNumber+currentColumnIndex, columns={time, value}) */
 
+#define DELAY_ROW(delayStruct, i) ((TIME_AND_VALUE*)getPow2RingData(delayStruct, i))
 
 void initDelay(DATA* data, double startTime)
 {
   /* get the start time of the simulation: time.start. */
   data->simulationInfo->tStart = startTime;
+
+  data->simulationInfo->delayHermite = 0;
+  if(omc_flag[FLAG_DELAY_INTERPOLATION])
+  {
+    if(0 == strcmp(omc_flagValue[FLAG_DELAY_INTERPOLATION], "hermite"))
+      data->simulationInfo->delayHermite = 1;
+    else if(0 != strcmp(omc_flagValue[FLAG_DELAY_INTERPOLATION], "linear"))
+      throwStreamPrint(NULL, "-delayInterpolation=%s is unknown, use linear or hermite", omc_flagValue[FLAG_DELAY_INTERPOLATION]);
+  }
 }
 
 /*
- * Find row with greatest time that is smaller than or equal to 'time'
+ * Find row with greatest time that is smaller than or equal to 'time', or 0
+ * if there is none.
+ * The search starts at row 'hint' (the result of the previous search) and
+ * gallops away from it, so that the usual case of slowly advancing times
+ * only needs a few comparisons.
  * Conditions:
  *  the buffer in 'delayStruct' is not empty
- *  'time' is smaller than the last entry in 'delayStruct'
  */
-static int findTime(double time, RINGBUFFER *delayStruct)
+static int findTime(double time, POW2_RINGBUFFER *delayStruct, int hint)
 {
-  int start = 0;
-  int end = ringBufferLength(delayStruct);
-  double t;
+  int length = pow2RingBufferLength(delayStruct);
+  int lo, hi, step = 1;
 
+  if(hint < 0 || hint >= length)
+    hint = 0;
+
+  /* find lo < hi with t[lo] <= time < t[hi]; t[-1] = -inf and t[length] = inf */
+  if(DELAY_ROW(delayStruct, hint)->t <= time)
+  {
+    lo = hint;
+    hi = hint + 1;
+    while(hi < length && DELAY_ROW(delayStruct, hi)->t <= time)
+    {
+      lo = hi;
+      hi = (length - lo > step) ? lo + step : length;
+      step *= 2;
+    }
+  }
+  else
+  {
+    hi = hint;
+    lo = hint - 1;
+    while(lo >= 0 && DELAY_ROW(delayStruct, lo)->t > time)
+    {
+      hi = lo;
+      lo = (hi > step) ? hi - step : -1;
+      step *= 2;
+    }
+  }
 
-  infoStreamPrint(LOG_EVENTS, 0, "findTime %e", time);
-  do
+  while(hi - lo > 1)
   {
-    int i = (start + end) / 2;
-    t = ((TIME_AND_VALUE*)getRingData(delayStruct, i))->t;
-    infoStreamPrint(LOG_EVENTS, 0, "time(%d, %d)[%d] = %e", start, end, i, t);
-    if(t > time)
-      end = i;
+    int i = lo + (hi - lo) / 2;
+    if(DELAY_ROW(delayStruct, i)->t > time)
+      hi = i;
     else
-      start = i;
-  }while(t != time && end > start + 1);
-  infoStreamPrint(LOG_EVENTS, 0, "return time[%d, %d] = %e", start, end, t);
-  return (start);
+      lo = i;
+  }
+  return lo < 0 ? 0 : lo;
+}
+
+/*
+ * Slope of the row i of 'delayStruct' for the Hermite interpolation, from the
+ * rows next to it. Rows at the same time (events) separate the pieces.
+ */
+static double delaySlope(POW2_RINGBUFFER *delayStruct, int i)
+{
+  int length = pow2RingBufferLength(delayStruct);
+  TIME_AND_VALUE *row = DELAY_ROW(delayStruct, i);
+  TIME_AND_VALUE *prev = i > 0 ? DELAY_ROW(delayStruct, i-1) : NULL;
+  TIME_AND_VALUE *next = i+1 < length ? DELAY_ROW(delayStruct, i+1) : NULL;
+  double h0 = prev ? row->t - prev->t : 0.0;
+  double h1 = next ? next->t - row->t : 0.0;
+
+  if(h0 > 0.0 && h1 > 0.0)
+  {
+    /* three-point formula for non-uniform steps */
+    return (h1 * (row->value - prev->value) / h0 + h0 * (next->value - row->value) / h1) / (h0 + h1);
+  }
+  if(h0 > 0.0)
+    return (row->value - prev->value) / h0;
+  if(h1 > 0.0)
+    return (next->value - row->value) / h1;
+  return 0.0;
 }
 
 void storeDelayedExpression(DATA* data, threadData_t *threadData, int exprNumber, double exprValue, double time, double delayTime, double delayMax)
 {
-  int i;
+  POW2_RINGBUFFER *delayStruct;
+  int i, length;
   TIME_AND_VALUE tpl;
 
   /* Allocate more space for expressions */
@@ -88,26 +150,35 @@ void storeDelayedExpression(DATA* data, threadData_t *threadData, int exprNumber
   assertStreamPrint(threadData, 0 <= exprNumber, "storeDelayedExpression: invalid expression number %d", exprNumber);
   assertStreamPrint(threadData, data->simulationInfo->tStart <= time, "storeDelayedExpression: time is smaller than starting time. Value ignored");
 
+  delayStruct = data->simulationInfo->delayStructure[exprNumber];
   tpl.t = time;
   tpl.value = exprValue;
-  appendRingData(data->simulationInfo->delayStructure[exprNumber], &tpl);
-  infoStreamPrint(LOG_EVENTS, 0, "storeDelayed[%d] %g:%g position=%d", exprNumber, time, exprValue,ringBufferLength(data->simulationInfo->delayStructure[exprNumber]));
+  tpl.slope = 0.0;
+  appendPow2RingData(delayStruct, &tpl);
+  length = pow2RingBufferLength(delayStruct);
+
+  if(data->simulationInfo->delayHermite)
+  {
+    /* the new row changes the slope of the previous one */
+    if(length > 1)
+      DELAY_ROW(delayStruct, length-2)->slope = delaySlope(delayStruct, length-2);
+    DELAY_ROW(delayStruct, length-1)->slope = delaySlope(delayStruct, length-1);
+  }
 
   /* dequeue not longer needed values */
-  i = findTime(time-delayMax+DBL_EPSILON,data->simulationInfo->delayStructure[exprNumber]);
-  if(i > 0){
-    dequeueNFirstRingDatas(data->simulationInfo->delayStructure[exprNumber], i-1);
-    infoStreamPrint(LOG_EVENTS, 0, "delayImpl: dequeueNFirstRingDatas[%d] %g = %g", i, time-delayMax+DBL_EPSILON, delayTime);
+  i = findTime(time-delayMax+DBL_EPSILON, delayStruct, 0);
+  if(i > 1)
+  {
+    dequeueNFirstPow2RingDatas(delayStruct, i-1, NULL);
+    data->simulationInfo->delayCursor[exprNumber] -= i-1;
   }
 }
 
 
 double delayImpl(DATA* data, threadData_t *threadData, int exprNumber, double exprValue, double time, double delayTime, double delayMax)
 {
-  RINGBUFFER* delayStruct = data->simulationInfo->delayStructure[exprNumber];
-  int length = ringBufferLength(delayStruct);
-
-  infoStreamPrint(LOG_EVENTS, 0, "delayImpl: exprNumber = %d, exprValue = %g, time = %g, delayTime = %g", exprNumber, exprValue, time, delayTime);
+  POW2_RINGBUFFER* delayStruct = data->simulationInfo->delayStructure[exprNumber];
+  int length = pow2RingBufferLength(delayStruct);
 
   /* Check for errors */
 
@@ -116,7 +187,6 @@ double delayImpl(DATA* data, threadData_t *threadData, int exprNumber, double ex
 
   if(time <= data->simulationInfo->tStart)
   {
-    infoStreamPrint(LOG_EVENTS, 0, "delayImpl: Entered at time < starting time: %g.", exprValue);
     return (exprValue);
   }
 
@@ -144,66 +214,57 @@ double delayImpl(DATA* data, threadData_t *threadData, int exprNumber, double ex
    */
   if(time <= data->simulationInfo->tStart + delayTime)
   {
-    double res = ((TIME_AND_VALUE*)getRingData(delayStruct, 0))->value;
-    infoStreamPrint(LOG_EVENTS, 0, "findTime: time <= tStart + delayTime: [%d] = %g",exprNumber, res);
-    return res;
+    return DELAY_ROW(delayStruct, 0)->value;
   }
   else
   {
     /* return expr(time-delayTime) */
     double timeStamp = time - delayTime;
-    double time0, time1, value0, value1;
+    TIME_AND_VALUE *row0, *row1;
     int i;
 
-    assertStreamPrint(threadData, 0.0 <= delayTime, "Negative delay requested: delayTime = %g", delayTime);
-
+    row0 = DELAY_ROW(delayStruct, length - 1);
     /* find the row for the lower limit */
-    if(timeStamp > ((TIME_AND_VALUE*)getRingData(delayStruct, length - 1))->t)
+    if(timeStamp > row0->t)
     {
-      infoStreamPrint(LOG_EVENTS, 0, "delayImpl: find the row  %g = %g", timeStamp, ((TIME_AND_VALUE*)getRingData(delayStruct, length - 1))->t);
       /* delay between the last accepted time step and the current time */
-      time0 = ((TIME_AND_VALUE*)getRingData(delayStruct, length - 1))->t;
-      value0 = ((TIME_AND_VALUE*)getRingData(delayStruct, length - 1))->value;
-      time1 = time;
-      value1 = exprValue;
-      infoStreamPrint(LOG_EVENTS, 0, "delayImpl: times %g and %g", time0, time1);
-      infoStreamPrint(LOG_EVENTS, 0, "delayImpl: values %g and  %g", value0, value1);
+      double timedif = time - row0->t;
+      return (row0->value * (time - timeStamp) + exprValue * (timeStamp - row0->t)) / timedif;
     }
-    else
+
+    i = findTime(timeStamp, delayStruct, data->simulationInfo->delayCursor[exprNumber]);
+    data->simulationInfo->delayCursor[exprNumber] = i;
+    row0 = DELAY_ROW(delayStruct, i);
+
+    /* was it an exact match or the last value? */
+    if(row0->t == timeStamp || i+1 == length)
     {
-      i = findTime(timeStamp, delayStruct);
-      assertStreamPrint(threadData, i < length, "%d = i < length = %d", i, length);
-      time0 = ((TIME_AND_VALUE*)getRingData(delayStruct, i))->t;
-      value0 = ((TIME_AND_VALUE*)getRingData(delayStruct, i))->value;
-
-      /* was it the last value? */
-      if(i+1 == length)
-      {
-        return value0;
-      }
-      time1 = ((TIME_AND_VALUE*)getRingData(delayStruct, i+1))->t;
-      value1 = ((TIME_AND_VALUE*)getRingData(delayStruct, i+1))->value;
+      return row0->value;
+    }
+    row1 = DELAY_ROW(delayStruct, i+1);
+    if(row1->t == timeStamp)
+    {
+      return row1->value;
     }
-    /* was it an exact match?*/
-    if(time0 == timeStamp){
-      infoStreamPrint(LOG_EVENTS, 0, "delayImpl: Exact match at %g = %g", timeStamp, value0);
-
-      return value0;
-    } else if(time1 == timeStamp) {
-      infoStreamPrint(LOG_EVENTS, 0, "delayImpl: Exact match at %g = %g", timeStamp, value1);
 
-      return value1;
-    } else {
+    if(data->simulationInfo->delayHermite)
+    {
+      /* cubic Hermite interpolation */
+      double h = row1->t - row0->t;
+      double s = (timeStamp - row0->t) / h;
+      double h00 = (1 + 2*s) * (1 - s) * (1 - s);
+      double h10 = s * (1 - s) * (1 - s);
+      double h01 = s * s * (3 - 2*s);
+      double h11 = s * s * (s - 1);
+      return h00*row0->value + h10*h*row0->slope + h01*row1->value + h11*h*row1->slope;
+    }
+    else
+    {
       /* linear interpolation */
-      double timedif = time1 - time0;
-      double dt0 = time1 - timeStamp;
-      double dt1 = timeStamp - time0;
-      double retVal = (value0 * dt0 + value1 * dt1) / timedif;
-      infoStreamPrint(LOG_EVENTS, 0, "delayImpl: Linear interpolation of %g between %g and %g", timeStamp, time0, time1);
-      infoStreamPrint(LOG_EVENTS, 0, "delayImpl: Linear interpolation of %g value: %g and %g = %g", timeStamp, value0, value1, retVal);
-      return retVal;
+      double timedif = row1->t - row0->t;
+      double dt0 = row1->t - timeStamp;
+      double dt1 = timeStamp - row0->t;
+      return (row0->value * dt0 + row1->value * dt1) / timedif;
     }
   }
-
 }
-
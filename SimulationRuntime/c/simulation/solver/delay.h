@@ -40,6 +40,7 @@ typedef struct TIME_AND_VALUE
 {
   double t; /* time; not named that due to macros */
   double value;
+  double slope; /* estimated derivative, only used with -delayInterpolation=hermite */
 } TIME_AND_VALUE;
 
 typedef struct EXPRESSION_DELAY_BUFFER
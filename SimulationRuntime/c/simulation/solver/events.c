@@ -50,8 +50,8 @@
 extern "C" {
 #endif
 
-double bisection(DATA* data, threadData_t *threadData, double*, double*, double*, double*, LIST*, LIST*);
-int checkZeroCrossings(DATA *data, LIST *list, LIST*);
+static double locateRoot(DATA* data, threadData_t *threadData, double*, double*, double*, double*, LIST*);
+void checkZeroCrossings(DATA *data, LIST *eventList, long *events, long *nEvents);
 void saveZeroCrossingsAfterEvent(DATA *data, threadData_t *threadData);
 
 int checkForStateEvent(DATA* data, LIST *eventList);
@@ -293,40 +293,42 @@ void findRoot(DATA* data, threadData_t *threadData, LIST *eventList, double *eve
 {
   TRACE_PUSH
 
-  long event_id;
+  SIMULATION_INFO *simInfo = data->simulationInfo;
+  long nStates = data->modelData->nStates;
+  long *events = simInfo->rootFindingEvents;
+  long nEvents = 0;
   LIST_NODE* it;
-  fortran_integer i=0;
-  static LIST *tmpEventList = NULL;
+  long i=0;
 
-  double *states_right = (double*) malloc(data->modelData->nStates * sizeof(double));
-  double *states_left = (double*) malloc(data->modelData->nStates * sizeof(double));
+  /* the states and derivatives of the step are stored in front of the states at the ends of the interval */
+  double *step = simInfo->rootFindingWork;
+  double *states_left = step + 4*nStates;
+  double *states_right = states_left + nStates;
 
-  double time_left = data->simulationInfo->timeValueOld;
+  double time_left = simInfo->timeValueOld;
   double time_right = data->localData[0]->timeValue;
 
-  tmpEventList = allocList(sizeof(long));
-
-  assert(states_right);
-  assert(states_left);
-
   for(it=listFirstNode(eventList); it; it=listNextNode(it))
   {
     infoStreamPrint(LOG_ZEROCROSSINGS, 0, "search for current event. Events in list: %ld", *((long*)listNodeData(it)));
   }
 
-  /* write states to work arrays */
-  memcpy(states_left,  data->simulationInfo->realVarsOld, data->modelData->nStates * sizeof(double));
-  memcpy(states_right, data->localData[0]->realVars    , data->modelData->nStates * sizeof(double));
+  /* write states and their derivatives to work arrays */
+  memcpy(step, simInfo->realVarsOld, 2*nStates * sizeof(double));
+  memcpy(step + 2*nStates, data->localData[0]->realVars, 2*nStates * sizeof(double));
+  memcpy(states_left, step, nStates * sizeof(double));
+  memcpy(states_right, step + 2*nStates, nStates * sizeof(double));
 
-  /* Search for event time and event_id with bisection method */
-  *eventTime = bisection(data, threadData, &time_left, &time_right, states_left, states_right, tmpEventList, eventList);
+  /* Search for event time and event_id */
+  *eventTime = locateRoot(data, threadData, &time_left, &time_right, states_left, states_right, eventList);
+  checkZeroCrossings(data, eventList, events, &nEvents);
 
-  if(listLen(tmpEventList) == 0)
+  if(nEvents == 0)
   {
-    double value = fabs(data->simulationInfo->zeroCrossings[*((long*) listFirstData(eventList))]);
+    double value = fabs(simInfo->zeroCrossings[*((long*) listFirstData(eventList))]);
     for(it = listFirstNode(eventList); it; it = listNextNode(it))
     {
-      double fvalue = fabs(data->simulationInfo->zeroCrossings[*((long*) listNodeData(it))]);
+      double fvalue = fabs(simInfo->zeroCrossings[*((long*) listNodeData(it))]);
       if(value > fvalue)
       {
         value = fvalue;
@@ -335,9 +337,9 @@ void findRoot(DATA* data, threadData_t *threadData, LIST *eventList, double *eve
     infoStreamPrint(LOG_ZEROCROSSINGS, 0, "Minimum value: %e", value);
     for(it = listFirstNode(eventList); it; it = listNextNode(it))
     {
-      if(value == fabs(data->simulationInfo->zeroCrossings[*((long*) listNodeData(it))]))
+      if(value == fabs(simInfo->zeroCrossings[*((long*) listNodeData(it))]))
       {
-        listPushBack(tmpEventList, listNodeData(it));
+        events[nEvents++] = *((long*) listNodeData(it));
         infoStreamPrint(LOG_ZEROCROSSINGS, 0, "added tmp event : %ld", *((long*) listNodeData(it)));
       }
     }
@@ -347,7 +349,7 @@ void findRoot(DATA* data, threadData_t *threadData, LIST *eventList, double *eve
 
   if(ACTIVE_STREAM(LOG_EVENTS))
   {
-    if(listLen(tmpEventList) > 0)
+    if(nEvents > 1)
     {
       debugStreamPrint(LOG_EVENTS, 0, "found events: ");
     }
@@ -356,23 +358,17 @@ void findRoot(DATA* data, threadData_t *threadData, LIST *eventList, double *eve
       debugStreamPrint(LOG_EVENTS, 0, "found event: ");
     }
   }
-  while(listLen(tmpEventList) > 0)
+  for(i=0; i<nEvents; i++)
   {
-    event_id = *((long*)listFirstData(tmpEventList));
-    listPopFront(tmpEventList);
-
-    infoStreamPrint(LOG_ZEROCROSSINGS, 0, "Event id: %ld ", event_id);
-
-    listPushFront(eventList, &event_id);
+    infoStreamPrint(LOG_ZEROCROSSINGS, 0, "Event id: %ld ", events[i]);
+    listPushBack(eventList, &events[i]);
   }
 
   *eventTime = time_right;
   debugStreamPrint(LOG_EVENTS, 0, "time: %.10e", *eventTime);
 
   data->localData[0]->timeValue = time_left;
-  for(i=0; i < data->modelData->nStates; i++) {
-    data->localData[0]->realVars[i] = states_left[i];
-  }
+  memcpy(data->localData[0]->realVars, states_left, nStates * sizeof(double));
 
   /* determined continuous system */
   data->callback->updateContinuousSystem(data, threadData);
@@ -380,56 +376,138 @@ void findRoot(DATA* data, threadData_t *threadData, LIST *eventList, double *eve
   /*sim_result_emit(data);*/
 
   data->localData[0]->timeValue = *eventTime;
-  for(i=0; i < data->modelData->nStates; i++)
-  {
-    data->localData[0]->realVars[i] = states_right[i];
-  }
-
-  free(states_left);
-  free(states_right);
+  memcpy(data->localData[0]->realVars, states_right, nStates * sizeof(double));
 
   TRACE_POP
 }
 
-/*! \fn bisection
+/*! \fn interpolateStates
+ *
+ *  \param [ref] [data]
+ *  \param [in]  [t0]
+ *  \param [in]  [t1]
+ *  \param [in]  [t]
+ *
+ *  Sets the states to their value at time t in [t0, t1] using the cubic
+ *  Hermite interpolation of the step, that matches the states and their
+ *  derivatives at both ends.
+ */
+static void interpolateStates(DATA* data, double t0, double t1, double t)
+{
+  long nStates = data->modelData->nStates, i;
+  const double *x0 = data->simulationInfo->rootFindingWork;
+  const double *dx0 = x0 + nStates;
+  const double *x1 = x0 + 2*nStates;
+  const double *dx1 = x0 + 3*nStates;
+  double h = t1 - t0;
+  double s = h > 0 ? (t - t0) / h : 1.0;
+  double h00 = (1 + 2*s) * (1 - s) * (1 - s);
+  double h10 = s * (1 - s) * (1 - s) * h;
+  double h01 = s * s * (3 - 2*s);
+  double h11 = s * s * (s - 1) * h;
+
+  for(i=0; i < nStates; i++)
+  {
+    data->localData[0]->realVars[i] = h00*x0[i] + h10*dx0[i] + h01*x1[i] + h11*dx1[i];
+  }
+}
+
+/*! \fn locateRoot
  *
  *  \param [ref] [data]
  *  \param [ref] [a]
  *  \param [ref] [b]
  *  \param [ref] [states_a]
  *  \param [ref] [states_b]
- *  \param [ref] [eventListTmp]
  *  \param [in]  [eventList]
  *  \return Founded event time
  *
- *  Method to find root in Intervall [oldTime, timeValue]
+ *  Method to find root in Intervall [oldTime, timeValue]. The next trial
+ *  point is the earliest regula falsi estimate of the zero crossings that
+ *  change sign in [a, b]. If the same end of the interval is kept twice in
+ *  a row, the zero-crossing values at that end are scaled down
+ *  (Anderson-Bjoerck variant of the Illinois method), and if the interval
+ *  did not shrink to half its size within two steps a bisection step is
+ *  done. Zero crossings that only have the values -1 and 1 are not scaled,
+ *  so for them this is the bisection method.
+ *
+ *  Only the zero crossings of eventList are evaluated at the trial points.
+ *  On return zeroCrossingsPre contains their values at a and zeroCrossings
+ *  the ones at b; the other zero crossings keep the values of the whole step,
+ *  they have no sign change in it.
  */
-double bisection(DATA* data, threadData_t *threadData, double* a, double* b, double* states_a, double* states_b, LIST *tmpEventList, LIST *eventList)
+static double locateRoot(DATA* data, threadData_t *threadData, double* a, double* b, double* states_a, double* states_b, LIST *eventList)
 {
   TRACE_PUSH
 
+  SIMULATION_INFO *simInfo = data->simulationInfo;
+  long nStates = data->modelData->nStates;
+  long nZeroCrossings = data->modelData->nZeroCrossings;
+  double *g_a = simInfo->rootFindingWork + 6*nStates;
+  double *g_b = g_a + nZeroCrossings;
+  double t0 = *a, t1 = *b;
   double TTOL = MINIMAL_STEP_SIZE + MINIMAL_STEP_SIZE*fabs(*b-*a); /* absTol + relTol*abs(b-a) */
-  double c;
-  long i=0;
-  /* n >= log(2)/log(2) + log(|b-a|/TOL)/log(2)*/
-  unsigned int n = 1 + ceil(log(fabs(*b - *a)/TTOL)/log(2));
+  double c, width = fabs(*b - *a);
+  long *events = simInfo->rootFindingEvents;
+  long *active = events + nZeroCrossings; /* the zero crossings of eventList */
+  long nEvents, nActive = 0, i;
+  int kept = 0, steps = 0; /* end of the interval kept by the last step: -1 left, 1 right */
+  LIST_NODE* it;
+  /* bisection needs n >= log(2)/log(2) + log(|b-a|/TOL)/log(2) steps, allow twice as many */
+  unsigned int n = 2 * (1 + ceil(log(fabs(*b - *a)/TTOL)/log(2)));
 
-  memcpy(data->simulationInfo->zeroCrossingsBackup, data->simulationInfo->zeroCrossings, data->modelData->nZeroCrossings * sizeof(modelica_real));
+  for(it=listFirstNode(eventList); it; it=listNextNode(it))
+  {
+    long ix = *((long*) listNodeData(it));
+    active[nActive++] = ix;
+    simInfo->zeroCrossingsBackup[ix] = simInfo->zeroCrossings[ix];
+    g_a[ix] = simInfo->zeroCrossingsPre[ix];
+    g_b[ix] = simInfo->zeroCrossings[ix];
+  }
 
-  infoStreamPrint(LOG_ZEROCROSSINGS, 0, "bisection method starts in interval [%e, %e]", *a, *b);
+  infoStreamPrint(LOG_ZEROCROSSINGS, 0, "root finding starts in interval [%e, %e]", *a, *b);
   infoStreamPrint(LOG_ZEROCROSSINGS, 0, "TTOL is set to %e and maximum number of intersections %d.", TTOL, n);
 
   while(fabs(*b - *a) > MINIMAL_STEP_SIZE && n-- > 0)
   {
-    c = 0.5 * (*a + *b);
-    data->localData[0]->timeValue = c;
+    double h = *b - *a, margin = 0.25 * MINIMAL_STEP_SIZE;
 
-    /*calculates states at time c */
-    for(i=0; i < data->modelData->nStates; i++)
+    if(h <= 0.5 * width)
+    {
+      width = h;
+      steps = 0;
+    }
+    if(++steps > 2)
+    {
+      /* regula falsi did not halve the interval in two steps */
+      c = 0.5 * (*a + *b);
+    }
+    else
     {
-      data->localData[0]->realVars[i] = 0.5*(states_a[i] + states_b[i]);
+      /* the earliest estimate of the crossings changing sign in [a, b] */
+      c = *b;
+      for(it=listFirstNode(eventList); it; it=listNextNode(it))
+      {
+        long ix = *((long*) listNodeData(it));
+        if((g_a[ix] < 0) != (g_b[ix] < 0))
+        {
+          double ci = *a - g_a[ix] * h / (g_b[ix] - g_a[ix]);
+          if(ci < c)
+          {
+            c = ci;
+          }
+        }
+      }
+      /* stay inside the interval */
+      if(c > *b - margin) c = *b - margin;
+      if(c < *a + margin) c = *a + margin;
     }
 
+    data->localData[0]->timeValue = c;
+
+    /*calculates states at time c */
+    interpolateStates(data, t0, t1, c);
+
     /*calculates Values dependents on new states*/
     /* read input vars */
     externalInputUpdate(data);
@@ -437,20 +515,51 @@ double bisection(DATA* data, threadData_t *threadData, double* a, double* b, dou
     /* eval needed equations*/
     data->callback->function_ZeroCrossingsEquations(data, threadData);
 
-    data->callback->function_ZeroCrossings(data, threadData, data->simulationInfo->zeroCrossings);
+    data->callback->function_ZeroCrossingsSubset(data, threadData, simInfo->zeroCrossings, active, nActive);
 
-    if(checkZeroCrossings(data, tmpEventList, eventList))  /* If Zerocrossing in left Section */
+    checkZeroCrossings(data, eventList, events, &nEvents);
+    if(nEvents > 0)  /* If Zerocrossing in left Section */
     {
-      memcpy(states_b, data->localData[0]->realVars, data->modelData->nStates * sizeof(modelica_real));
+      for(it=listFirstNode(eventList); it; it=listNextNode(it))
+      {
+        long ix = *((long*) listNodeData(it));
+        double g_c = simInfo->zeroCrossings[ix];
+        if(kept == -1 && fabs(g_a[ix]) != 1.0)
+        {
+          double m = (g_b[ix] < 0) == (g_c < 0) ? 1 - g_c / g_b[ix] : 0.5;
+          g_a[ix] *= m > 0 ? m : 0.5;
+        }
+        g_b[ix] = g_c;
+      }
+      kept = -1;
+      memcpy(states_b, data->localData[0]->realVars, nStates * sizeof(modelica_real));
       *b = c;
-      memcpy(data->simulationInfo->zeroCrossingsBackup, data->simulationInfo->zeroCrossings, data->modelData->nZeroCrossings * sizeof(modelica_real));
+      for(i=0; i<nActive; i++)
+      {
+        simInfo->zeroCrossingsBackup[active[i]] = simInfo->zeroCrossings[active[i]];
+      }
     }
     else  /*else Zerocrossing in right Section */
     {
-      memcpy(states_a, data->localData[0]->realVars, data->modelData->nStates * sizeof(modelica_real));
+      for(it=listFirstNode(eventList); it; it=listNextNode(it))
+      {
+        long ix = *((long*) listNodeData(it));
+        double g_c = simInfo->zeroCrossings[ix];
+        if(kept == 1 && fabs(g_b[ix]) != 1.0)
+        {
+          double m = (g_a[ix] < 0) == (g_c < 0) ? 1 - g_c / g_a[ix] : 0.5;
+          g_b[ix] *= m > 0 ? m : 0.5;
+        }
+        g_a[ix] = g_c;
+      }
+      kept = 1;
+      memcpy(states_a, data->localData[0]->realVars, nStates * sizeof(modelica_real));
       *a = c;
-      memcpy(data->simulationInfo->zeroCrossingsPre, data->simulationInfo->zeroCrossings, data->modelData->nZeroCrossings * sizeof(modelica_real));
-      memcpy(data->simulationInfo->zeroCrossings, data->simulationInfo->zeroCrossingsBackup, data->modelData->nZeroCrossings * sizeof(modelica_real));
+      for(i=0; i<nActive; i++)
+      {
+        simInfo->zeroCrossingsPre[active[i]] = simInfo->zeroCrossings[active[i]];
+        simInfo->zeroCrossings[active[i]] = simInfo->zeroCrossingsBackup[active[i]];
+      }
     }
   }
   c = 0.5*(*a + *b);
@@ -464,42 +573,33 @@ double bisection(DATA* data, threadData_t *threadData, double* a, double* b, dou
  *  Function checks for an event list on events
  *
  *  \param [ref] [data]
- *  \param [ref] [eventListTmp]
  *  \param [in]  [eventList]
- *  \return boolean value
+ *  \param [out] [events]  zero crossings of eventList that changed
+ *  \param [out] [nEvents] number of events
  */
-int checkZeroCrossings(DATA *data, LIST *tmpEventList, LIST *eventList)
+void checkZeroCrossings(DATA *data, LIST *eventList, long *events, long *nEvents)
 {
   TRACE_PUSH
   LIST_NODE *it;
 
-  listClear(tmpEventList);
-  infoStreamPrint(LOG_ZEROCROSSINGS, 0, "bisection checks for condition changes");
+  *nEvents = 0;
+  infoStreamPrint(LOG_ZEROCROSSINGS, 0, "root finding checks for condition changes");
 
   for(it=listFirstNode(eventList); it; it=listNextNode(it))
   {
+    long ix = *((long*) listNodeData(it));
     /* found event in left section */
-    if((data->simulationInfo->zeroCrossings[*((long*) listNodeData(it))] == -1 &&
-        data->simulationInfo->zeroCrossingsPre[*((long*) listNodeData(it))] == 1) ||
-       (data->simulationInfo->zeroCrossings[*((long*) listNodeData(it))] == 1 &&
-        data->simulationInfo->zeroCrossingsPre[*((long*) listNodeData(it))] == -1))
+    if(data->simulationInfo->zeroCrossings[ix] * data->simulationInfo->zeroCrossingsPre[ix] < 0)
     {
       infoStreamPrint(LOG_ZEROCROSSINGS, 0, "%ld changed from %s to current %s",
-            *((long*) listNodeData(it)),
-            (data->simulationInfo->zeroCrossingsPre[*((long*) listNodeData(it))] > 0) ? "TRUE" : "FALSE",
-            (data->simulationInfo->zeroCrossings[*((long*) listNodeData(it))] > 0) ? "TRUE" : "FALSE");
-      listPushFront(tmpEventList, listNodeData(it));
+            ix,
+            (data->simulationInfo->zeroCrossingsPre[ix] > 0) ? "TRUE" : "FALSE",
+            (data->simulationInfo->zeroCrossings[ix] > 0) ? "TRUE" : "FALSE");
+      events[(*nEvents)++] = ix;
     }
   }
 
-  if(listLen(tmpEventList) > 0)
-  {
-    TRACE_POP
-    return 1;   /* event in left section */
-  }
-
   TRACE_POP
-  return 0;     /* event in right section */
 }
 
 /*! \fn saveZeroCrossingsAfterEvent
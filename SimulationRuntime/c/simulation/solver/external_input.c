@@ -28,8 +28,10 @@
  *
  */
 
+#include <assert.h>
 #include <string.h>
 #include <setjmp.h>
+#include <stdint.h>
 
 #include "openmodelica.h"
 #include "openmodelica_func.h"
@@ -40,14 +42,65 @@
 #include "util/read_csv.h"
 #include "util/libcsv.h"
 #include "util/read_matlab4.h"
+#include "util/omc_mmap.h"
 
 #include "simulation/simulation_runtime.h"
 #include "simulation/solver/solver_main.h"
 #include "simulation/solver/model_help.h"
+#include "simulation/solver/external_input.h"
 #include "simulation/options.h"
 
+#if defined(_MSC_VER) || defined(__MINGW32__)
+#define input_fseek _fseeki64
+#else
+#define input_fseek fseeko
+#endif
+
+typedef struct {
+  char magic[8];
+  uint32_t byteOrder;
+  uint32_t ncols;
+  uint64_t nrows;
+  uint64_t dataOffset;
+} EXTERNAL_INPUT_BINARY_HEADER;
+
+typedef struct EXTERNAL_INPUT_STREAM
+{
+  int ncols;                  /* the time and the columns of the inputs */
+  int *column;                /* column of every input variable or -1 */
+  const modelica_real *rows;  /* the window: count rows starting with row first */
+  long first;
+  long count;
+
+  /* binary input */
+  omc_mmap_read map;
+
+  /* text input */
+  FILE *file;
+  modelica_real *buffer;      /* storage of the window */
+  int64_t *chunkOffset;       /* file offset of the first row of every chunk */
+  long nChunks;
+  long fileChunk;             /* chunk the file is positioned at or -1 */
+} EXTERNAL_INPUT_STREAM;
+
 static inline void externalInputallocate1(DATA* data, FILE * pFile);
 static inline void externalInputallocate2(DATA* data, char *filename);
+static void externalInputallocateBinary(DATA* data, const char *filename);
+static inline modelica_real externalInputTime(EXTERNAL_INPUT *in, long r);
+static inline modelica_real externalInputValue(EXTERNAL_INPUT *in, long r, int j);
+
+static int externalInputIsBinary(const char *filename)
+{
+  char magic[8];
+  FILE *file = fopen(filename, "rb");
+  int res;
+
+  if(file == NULL)
+    return 0;
+  res = fread(magic, 1, sizeof(magic), file) == sizeof(magic) && 0 == memcmp(magic, EXTERNAL_INPUT_BINARY_MAGIC, sizeof(magic));
+  fclose(file);
+  return res;
+}
 
 int externalInputallocate(DATA* data)
 {
@@ -62,35 +115,40 @@ int externalInputallocate(DATA* data)
     cflags = (char*)omc_flagValue[FLAG_INPUT_FILE];
     useLibCsvH = 0;
     if(cflags){
-      pFile = fopen(cflags,"r");
+      pFile = fopen(cflags,"rb");
       if(pFile == NULL)
         warningStreamPrint(LOG_STDOUT, 0, "OMC can't find the file %s.",cflags);
     }else{
-      pFile = fopen("externalInput.csv","r");
+      pFile = fopen("externalInput.csv","rb");
     }
   }
 
   data->simulationInfo->external_input.active = (modelica_boolean) (pFile != NULL);
+  data->simulationInfo->external_input.stream = NULL;
   if(data->simulationInfo->external_input.active || useLibCsvH){
-    if(useLibCsvH){
+    if(externalInputIsBinary(cflags ? cflags : "externalInput.csv")){
+      if(pFile)
+        fclose(pFile);
+      externalInputallocateBinary(data, cflags ? cflags : "externalInput.csv");
+    }else if(useLibCsvH){
       externalInputallocate2(data, cflags);
     }else
       externalInputallocate1(data, pFile);
 
+    data->simulationInfo->external_input.i = 0;
+
     if(ACTIVE_STREAM(LOG_SIMULATION))
     {
       printf("\nExternal Input");
       printf("\n========================================================");
       for(i = 0; i < data->simulationInfo->external_input.n; ++i){
-        printf("\nInput: t=%f   \t", data->simulationInfo->external_input.t[i]);
+        printf("\nInput: t=%f   \t", externalInputTime(&data->simulationInfo->external_input, i));
         for(j = 0; j < data->modelData->nInputVars; ++j){
-          printf("u%d(t)= %f \t",j+1,data->simulationInfo->external_input.u[i][j]);
+          printf("u%d(t)= %f \t",j+1,externalInputValue(&data->simulationInfo->external_input, i, j));
         }
       }
       printf("\n========================================================\n");
     }
-
-    data->simulationInfo->external_input.i = 0;
   }
 
   return 0;
@@ -156,16 +214,124 @@ void externalInputallocate2(DATA* data, char *filename){
   data->simulationInfo->external_input.active = data->simulationInfo->external_input.n > 0;
 }
 
+/* Reads chunk c of a text input file to dest; the file is only positioned
+ * if it is not already at the start of the chunk.
+ */
+static long externalInputReadChunk(EXTERNAL_INPUT *in, long c, modelica_real *dest)
+{
+  EXTERNAL_INPUT_STREAM *s = in->stream;
+  const long rows = modelica_integer_min(EXTERNAL_INPUT_CHUNK_ROWS, in->n - c*EXTERNAL_INPUT_CHUNK_ROWS);
+  long k;
+
+  if(s->fileChunk != c && input_fseek(s->file, s->chunkOffset[c], SEEK_SET)){
+    throwStreamPrint(NULL, "External input file: could not seek to row %ld.", c*EXTERNAL_INPUT_CHUNK_ROWS);
+  }
+  for(k = 0; k < rows*s->ncols; ++k){
+    if(fscanf(s->file, "%lf", dest + k) != 1){
+      s->fileChunk = -1;
+      throwStreamPrint(NULL, "External input file: could not read row %ld.", c*EXTERNAL_INPUT_CHUNK_ROWS + k/s->ncols);
+    }
+  }
+  s->fileChunk = c+1;
+  return rows;
+}
+
+/* Moves the window of a text input file so that it contains row r. Going
+ * forward by one chunk drops the oldest chunk of a full window; every other
+ * move reads the chunk of r and the one before it.
+ */
+static void externalInputMoveWindow(EXTERNAL_INPUT *in, long r)
+{
+  EXTERNAL_INPUT_STREAM *s = in->stream;
+  const long c = r / EXTERNAL_INPUT_CHUNK_ROWS;
+  const long rowSize = s->ncols;
+  long c0;
+
+  assert(s->file != NULL && r >= 0 && r < in->n);
+
+  if(s->count > 0 && c*EXTERNAL_INPUT_CHUNK_ROWS == s->first + s->count){
+    if(s->count == EXTERNAL_INPUT_WINDOW_CHUNKS*EXTERNAL_INPUT_CHUNK_ROWS){
+      memmove(s->buffer, s->buffer + EXTERNAL_INPUT_CHUNK_ROWS*rowSize, (s->count - EXTERNAL_INPUT_CHUNK_ROWS)*rowSize*sizeof(modelica_real));
+      s->first += EXTERNAL_INPUT_CHUNK_ROWS;
+      s->count -= EXTERNAL_INPUT_CHUNK_ROWS;
+    }
+    s->count += externalInputReadChunk(in, c, s->buffer + s->count*rowSize);
+    return;
+  }
+
+  c0 = c > 0 ? c-1 : 0;
+  s->first = c0*EXTERNAL_INPUT_CHUNK_ROWS;
+  s->count = 0;
+  for(; c0 <= c; ++c0){
+    s->count += externalInputReadChunk(in, c0, s->buffer + s->count*rowSize);
+  }
+}
+
+/* Returns row r of a streamed input: the time followed by the columns */
+static inline const modelica_real* externalInputRow(EXTERNAL_INPUT *in, long r)
+{
+  EXTERNAL_INPUT_STREAM *s = in->stream;
+
+  if(r < s->first || r >= s->first + s->count)
+    externalInputMoveWindow(in, r);
+  return s->rows + (r - s->first)*s->ncols;
+}
+
+static inline modelica_real externalInputTime(EXTERNAL_INPUT *in, long r)
+{
+  return in->stream ? externalInputRow(in, r)[0] : in->t[r];
+}
+
+static inline modelica_real externalInputValue(EXTERNAL_INPUT *in, long r, int j)
+{
+  if(in->stream){
+    const int col = in->stream->column[j];
+    return col < 0 ? 0.0 : externalInputRow(in, r)[col];
+  }
+  return in->u[r][j];
+}
+
+/* Counts the non-empty lines of a text input file and records the offset
+ * of the first row of every chunk; the first line is the header.
+ */
+static long externalInputIndexRows(FILE *pFile, int64_t **chunkOffset)
+{
+  char buf[65536];
+  size_t len, k;
+  int64_t pos = 0;
+  long lines = 0, capacity = 16;
+  int lineHasData = 0;
+
+  *chunkOffset = (int64_t*) malloc(capacity*sizeof(int64_t));
+  while((len = fread(buf, 1, sizeof(buf), pFile)) > 0){
+    for(k = 0; k < len; ++k, ++pos){
+      if(buf[k] == '\n'){
+        lines += lineHasData;
+        lineHasData = 0;
+      }else if(!lineHasData && buf[k] != ' ' && buf[k] != '\t' && buf[k] != '\r'){
+        lineHasData = 1;
+        if(lines > 0 && (lines-1) % EXTERNAL_INPUT_CHUNK_ROWS == 0){
+          const long c = (lines-1) / EXTERNAL_INPUT_CHUNK_ROWS;
+          if(c == capacity){
+            capacity *= 2;
+            *chunkOffset = (int64_t*) realloc(*chunkOffset, capacity*sizeof(int64_t));
+          }
+          (*chunkOffset)[c] = pos;
+        }
+      }
+    }
+  }
+  return lines + lineHasData;
+}
+
 static inline void externalInputallocate1(DATA* data, FILE * pFile){
+  EXTERNAL_INPUT *in = &data->simulationInfo->external_input;
+  EXTERNAL_INPUT_STREAM *s;
+  int64_t *chunkOffset;
   int n,m,c;
   int i,j;
-  n = 0;
 
-  while(1) {
-    c = fgetc(pFile);
-    if (c==EOF) break;
-    if (c=='\n') ++n;
-  }
+  n = externalInputIndexRows(pFile, &chunkOffset);
   // check if csv file is empty!
   if (n == 0)
   {
@@ -176,14 +342,29 @@ static inline void externalInputallocate1(DATA* data, FILE * pFile){
   --n;
   data->simulationInfo->external_input.n = n;
   data->simulationInfo->external_input.N = data->simulationInfo->external_input.n;
-  rewind(pFile);
+  m = data->modelData->nInputVars;
 
-  do{
-    c = fgetc(pFile);
-    if (c==EOF) break;
-  }while(c!='\n');
+  if(n > EXTERNAL_INPUT_STREAM_ROWS){
+    s = (EXTERNAL_INPUT_STREAM*) calloc(1, sizeof(EXTERNAL_INPUT_STREAM));
+    s->ncols = m+1;
+    s->column = (int*) malloc(modelica_integer_max(1,m)*sizeof(int));
+    for(j = 0; j < m; ++j)
+      s->column[j] = j+1;
+    s->file = pFile;
+    s->buffer = (modelica_real*) malloc(EXTERNAL_INPUT_WINDOW_CHUNKS*EXTERNAL_INPUT_CHUNK_ROWS*s->ncols*sizeof(modelica_real));
+    s->rows = s->buffer;
+    s->chunkOffset = chunkOffset;
+    s->nChunks = (n + EXTERNAL_INPUT_CHUNK_ROWS - 1) / EXTERNAL_INPUT_CHUNK_ROWS;
+    s->fileChunk = -1;
+    in->stream = s;
+    infoStreamPrint(LOG_SIMULATION, 0, "External input: reading %d rows in chunks of %d rows", n, EXTERNAL_INPUT_CHUNK_ROWS);
+    return;
+  }
+
+  if(n > 0)
+    input_fseek(pFile, chunkOffset[0], SEEK_SET);
+  free(chunkOffset);
 
-  m = data->modelData->nInputVars;
   data->simulationInfo->external_input.u = (modelica_real**)calloc(modelica_integer_max(1,n),sizeof(modelica_real*));
   for(i = 0; i<data->simulationInfo->external_input.n; ++i)
     data->simulationInfo->external_input.u[i] = (modelica_real*)calloc(modelica_integer_max(1,m),sizeof(modelica_real));
@@ -200,15 +381,89 @@ static inline void externalInputallocate1(DATA* data, FILE * pFile){
   fclose(pFile);
 }
 
+/* Maps a binary input file; see external_input.h for the format */
+static void externalInputallocateBinary(DATA* data, const char *filename)
+{
+  EXTERNAL_INPUT *in = &data->simulationInfo->external_input;
+  EXTERNAL_INPUT_STREAM *s = (EXTERNAL_INPUT_STREAM*) calloc(1, sizeof(EXTERNAL_INPUT_STREAM));
+  EXTERNAL_INPUT_BINARY_HEADER header;
+  const int nu = data->modelData->nInputVars;
+  const char **fileNames;
+  char **names;
+  const char *name, *end;
+  int i, j;
+
+  s->map = omc_mmap_open_read(filename);
+  memcpy(&header, s->map.data, modelica_integer_min(sizeof(header), s->map.size));
+  if(s->map.size < sizeof(header) || header.ncols < 1 || header.dataOffset < sizeof(header) || header.dataOffset % sizeof(modelica_real)
+     || header.dataOffset > s->map.size || (s->map.size - header.dataOffset) / (header.ncols*sizeof(modelica_real)) < header.nrows){
+    throwStreamPrint(NULL, "External input file %s is not a valid binary input file.", filename);
+  }
+  if(header.byteOrder != EXTERNAL_INPUT_BYTE_ORDER){
+    throwStreamPrint(NULL, "External input file %s was written on a machine with a different byte order.", filename);
+  }
+
+  fileNames = (const char**) malloc(header.ncols*sizeof(char*));
+  name = s->map.data + sizeof(header);
+  end = s->map.data + header.dataOffset;
+  for(i = 1; i < header.ncols; ++i){
+    const char *next = (const char*) memchr(name, '\0', end - name);
+    if(next == NULL){
+      throwStreamPrint(NULL, "External input file %s is not a valid binary input file.", filename);
+    }
+    fileNames[i] = name;
+    name = next + 1;
+  }
+
+  names = (char**) malloc(modelica_integer_max(1,nu)*sizeof(char*));
+  data->callback->inputNames(data, names);
+  s->column = (int*) malloc(modelica_integer_max(1,nu)*sizeof(int));
+  for(j = 0; j < nu; ++j){
+    s->column[j] = -1;
+    for(i = 1; i < header.ncols; ++i){
+      if(strcmp(names[j], fileNames[i]) == 0){
+        s->column[j] = i;
+        break;
+      }
+    }
+  }
+  free(names);
+  free(fileNames);
+
+  s->ncols = header.ncols;
+  s->rows = (const modelica_real*) (s->map.data + header.dataOffset);
+  s->first = 0;
+  s->count = header.nrows;
+  in->stream = s;
+  in->n = in->N = header.nrows;
+  in->t = NULL;
+  in->u = NULL;
+  in->active = in->n > 0;
+}
+
 int externalInputFree(DATA* data)
 {
   if(data->simulationInfo->external_input.active){
     int j;
-
-    free(data->simulationInfo->external_input.t);
-    for(j = 0; j < data->simulationInfo->external_input.N; ++j)
-      free(data->simulationInfo->external_input.u[j]);
-    free(data->simulationInfo->external_input.u);
+    EXTERNAL_INPUT_STREAM *s = data->simulationInfo->external_input.stream;
+
+    if(s){
+      if(s->file){
+        fclose(s->file);
+        free(s->buffer);
+        free(s->chunkOffset);
+      }else{
+        omc_mmap_close_read(s->map);
+      }
+      free(s->column);
+      free(s);
+      data->simulationInfo->external_input.stream = NULL;
+    }else{
+      free(data->simulationInfo->external_input.t);
+      for(j = 0; j < data->simulationInfo->external_input.N; ++j)
+        free(data->simulationInfo->external_input.u[j]);
+      free(data->simulationInfo->external_input.u);
+    }
     data->simulationInfo->external_input.active = 0;
   }
   return 0;
@@ -217,48 +472,56 @@ int externalInputFree(DATA* data)
 
 int externalInputUpdate(DATA* data)
 {
+  EXTERNAL_INPUT *in = &data->simulationInfo->external_input;
   double u1, u2;
   double t, t1, t2;
   long double dt;
   int i;
 
-  if(!data->simulationInfo->external_input.active){
+  if(!in->active){
     return -1;
   }
 
+  if(in->n == 1){
+    for(i = 0; i < data->modelData->nInputVars; ++i){
+      data->simulationInfo->inputVars[i] = externalInputValue(in, 0, i);
+    }
+    return 1;
+  }
+
   t = data->localData[0]->timeValue;
-  t1 = data->simulationInfo->external_input.t[data->simulationInfo->external_input.i];
-  t2 = data->simulationInfo->external_input.t[data->simulationInfo->external_input.i+1];
+  t1 = externalInputTime(in, in->i);
+  t2 = externalInputTime(in, in->i+1);
 
-  while(data->simulationInfo->external_input.i > 0 && t < t1){
-    --data->simulationInfo->external_input.i;
-    t1 = data->simulationInfo->external_input.t[data->simulationInfo->external_input.i];
-    t2 = data->simulationInfo->external_input.t[data->simulationInfo->external_input.i+1];
+  while(in->i > 0 && t < t1){
+    --in->i;
+    t1 = externalInputTime(in, in->i);
+    t2 = externalInputTime(in, in->i+1);
   }
 
   while(t > t2
-        && data->simulationInfo->external_input.i+1 < (data->simulationInfo->external_input.n-1)){
-    ++data->simulationInfo->external_input.i;
-    t1 = data->simulationInfo->external_input.t[data->simulationInfo->external_input.i];
-    t2 = data->simulationInfo->external_input.t[data->simulationInfo->external_input.i+1];
+        && in->i+1 < (in->n-1)){
+    ++in->i;
+    t1 = externalInputTime(in, in->i);
+    t2 = externalInputTime(in, in->i+1);
   }
 
   if(t == t1){
     for(i = 0; i < data->modelData->nInputVars; ++i){
-      data->simulationInfo->inputVars[i] = data->simulationInfo->external_input.u[data->simulationInfo->external_input.i][i];
+      data->simulationInfo->inputVars[i] = externalInputValue(in, in->i, i);
     }
     return 1;
   }else if(t == t2){
     for(i = 0; i < data->modelData->nInputVars; ++i){
-      data->simulationInfo->inputVars[i] = data->simulationInfo->external_input.u[data->simulationInfo->external_input.i+1][i];
+      data->simulationInfo->inputVars[i] = externalInputValue(in, in->i+1, i);
     }
     return 1;
   }
 
-  dt = (data->simulationInfo->external_input.t[data->simulationInfo->external_input.i+1] - data->simulationInfo->external_input.t[data->simulationInfo->external_input.i]);
+  dt = (t2 - t1);
   for(i = 0; i < data->modelData->nInputVars; ++i){
-    u1 = data->simulationInfo->external_input.u[data->simulationInfo->external_input.i][i];
-    u2 = data->simulationInfo->external_input.u[data->simulationInfo->external_input.i+1][i];
+    u1 = externalInputValue(in, in->i, i);
+    u2 = externalInputValue(in, in->i+1, i);
 
     if(u1 != u2){
       data->simulationInfo->inputVars[i] =  (u1*(dt+t1-t)+(t-t1)*u2)/dt;
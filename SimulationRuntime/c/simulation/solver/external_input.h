@@ -29,9 +29,36 @@
  */
 
 
+/*
+ * External inputs are read from -csvInput, -exInputFile or externalInput.csv.
+ *
+ * Text files with more than EXTERNAL_INPUT_STREAM_ROWS rows are not loaded
+ * completely; only a window of EXTERNAL_INPUT_WINDOW_CHUNKS chunks of
+ * EXTERNAL_INPUT_CHUNK_ROWS rows around the current time is kept in memory.
+ * The window keeps the chunk before the current one, so going back after a
+ * rejected step does not re-read the file.
+ *
+ * A file starting with EXTERNAL_INPUT_BINARY_MAGIC is read as binary input
+ * and memory-mapped; it is stored in the byte order of the writing machine:
+ *
+ *   header:  "OMINPUT1", u32 byteOrder (EXTERNAL_INPUT_BYTE_ORDER),
+ *            u32 ncols, u64 nrows, u64 dataOffset
+ *   names:   ncols-1 NUL-terminated names of the input variables
+ *   data:    at dataOffset (a multiple of 8): nrows rows of ncols doubles,
+ *            the time followed by the inputs in the order of the names
+ *
+ * Inputs of the model are matched by name; inputs missing in the file are 0.
+ */
+
 #ifndef _EXTERNAL_INPUT_H_
 #define _EXTERNAL_INPUT_H_
 
+#define EXTERNAL_INPUT_BINARY_MAGIC "OMINPUT1"
+#define EXTERNAL_INPUT_BYTE_ORDER 0x01020304
+#define EXTERNAL_INPUT_STREAM_ROWS 65536
+#define EXTERNAL_INPUT_CHUNK_ROWS 4096
+#define EXTERNAL_INPUT_WINDOW_CHUNKS 3
+
 #if defined(__cplusplus)
 extern "C" {
 #endif
@@ -48,6 +48,10 @@
 #include "linearSolverKlu.h"
 
 
+/* smallest reciprocal condition number for which a numeric refactorization
+ * with the pivoting of the last factorization is accepted */
+#define LS_KLU_MIN_RCOND 1e-12
+
 static void printMatrixCSC(int* Ap, int* Ai, double* Ax, int n);
 static void printMatrixCSR(int* Ap, int* Ai, double* Ax, int n);
 
@@ -71,6 +75,7 @@ allocateKluData(int n_row, int n_col, int nz, void** voiddata)
 
   data->Ai = (int*) calloc(nz,sizeof(int));
   data->Ax = (double*) calloc(nz,sizeof(double));
+  data->AxOld = (double*) calloc(nz,sizeof(double));
   data->work = (double*) calloc(n_col,sizeof(double));
 
   data->numberSolving = 0;
@@ -95,6 +100,7 @@ freeKluData(void **voiddata)
   free(data->Ap);
   free(data->Ai);
   free(data->Ax);
+  free(data->AxOld);
   free(data->work);
 
   if(data->symbolic)
@@ -256,9 +262,26 @@ solveKlu(DATA *data, threadData_t *threadData, int sysNumber)
     solverData->symbolic = klu_analyze(solverData->n_col, solverData->Ap, solverData->Ai, &solverData->common);
   }
 
-  /* compute the LU factorization of A */
+  /* compute the LU factorization of A; it is reused if A did not change and
+   * only numerically refactorized if the values changed */
   if (0 == solverData->common.status){
-    solverData->numeric = klu_factor(solverData->Ap, solverData->Ai, solverData->Ax, solverData->symbolic, &solverData->common);
+    if (solverData->numeric && 0 == memcmp(solverData->Ax, solverData->AxOld, sizeof(double)*solverData->nnz))
+    {
+      infoStreamPrint(LOG_LS, 0, "Reuse LU factorization of matrix A.");
+    }
+    else
+    {
+      memcpy(solverData->AxOld, solverData->Ax, sizeof(double)*solverData->nnz);
+      if (!solverData->numeric ||
+          !klu_refactor(solverData->Ap, solverData->Ai, solverData->Ax, solverData->symbolic, solverData->numeric, &solverData->common) ||
+          !klu_rcond(solverData->symbolic, solverData->numeric, &solverData->common) ||
+          solverData->common.rcond < LS_KLU_MIN_RCOND)
+      {
+        if (solverData->numeric)
+          klu_free_numeric(&solverData->numeric, &solverData->common);
+        solverData->numeric = klu_factor(solverData->Ap, solverData->Ai, solverData->Ax, solverData->symbolic, &solverData->common);
+      }
+    }
   }
 
   if (0 == solverData->common.status){
@@ -46,6 +46,7 @@ typedef struct DATA_KLU
   int *Ap;
   int *Ai;
   double *Ax;
+  double *AxOld;                   /* values of A of the last factorization */
   int n_col;
   int n_row;
   int nnz;
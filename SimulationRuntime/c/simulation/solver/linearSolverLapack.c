@@ -46,8 +46,9 @@
 #include "linearSolverLapack.h"
 
 
-extern int dgesv_(int *n, int *nrhs, double *a, int *lda,
-                  int *ipiv, double *b, int *ldb, int *info);
+extern int dgetrf_(int *m, int *n, double *a, int *lda, int *ipiv, int *info);
+extern int dgetrs_(char *trans, int *n, int *nrhs, double *a, int *lda,
+                   int *ipiv, double *b, int *ldb, int *info);
 
 /*! \fn allocate memory for linear system solver lapack
  *
@@ -66,6 +67,11 @@ int allocateLapackData(int size, void** voiddata)
   data->b = _omc_createVector(size, NULL);
   data->A = _omc_createMatrix(size, size, NULL);
 
+  data->Aold = (double*) malloc(size*size*sizeof(double));
+  data->LU = (double*) malloc(size*size*sizeof(double));
+  assertStreamPrint(NULL, 0 != data->Aold && 0 != data->LU, "Could not allocate data for linear solver lapack.");
+  data->factorized = 0;
+
   *voiddata = (void*)data;
   return 0;
 }
@@ -84,6 +90,9 @@ int freeLapackData(void **voiddata)
   _omc_destroyVector(data->b);
   _omc_destroyMatrix(data->A);
 
+  free(data->Aold);
+  free(data->LU);
+
   return 0;
 }
 
@@ -162,6 +171,7 @@ int solveLapack(DATA *data, threadData_t *threadData, int sysNumber)
 {
   void *dataAndThreadData[2] = {data, threadData};
   int i, j, iflag = 1;
+  char trans = 'N';
   LINEAR_SYSTEM_DATA* systemData = &(data->simulationInfo->linearSystemData[sysNumber]);
   DATA_LAPACK* solverData = (DATA_LAPACK*)systemData->solverData;
 
@@ -219,15 +229,40 @@ int solveLapack(DATA *data, threadData_t *threadData, int sysNumber)
 
   rt_ext_tp_tick(&(solverData->timeClock));
 
-  /* Solve system */
-  dgesv_((int*) &systemData->size,
-         (int*) &solverData->nrhs,
-         solverData->A->data,
-         (int*) &systemData->size,
-         solverData->ipiv,
-         solverData->b->data,
-         (int*) &systemData->size,
-         &solverData->info);
+  /* Solve system; the LU factorization is reused as long as A does not change,
+   * e.g. for constant coefficients */
+  if (solverData->factorized && 0 == memcmp(solverData->A->data, solverData->Aold, (systemData->size)*(systemData->size)*sizeof(double)))
+  {
+    infoStreamPrint(LOG_LS, 0, "Reuse LU factorization of matrix A.");
+  }
+  else
+  {
+    memcpy(solverData->Aold, solverData->A->data, (systemData->size)*(systemData->size)*sizeof(double));
+    dgetrf_((int*) &systemData->size,
+            (int*) &systemData->size,
+            solverData->A->data,
+            (int*) &systemData->size,
+            solverData->ipiv,
+            &solverData->info);
+    solverData->factorized = (0 == solverData->info);
+    if (solverData->factorized)
+    {
+      memcpy(solverData->LU, solverData->A->data, (systemData->size)*(systemData->size)*sizeof(double));
+    }
+  }
+
+  if (solverData->factorized)
+  {
+    dgetrs_(&trans,
+            (int*) &systemData->size,
+            (int*) &solverData->nrhs,
+            solverData->LU,
+            (int*) &systemData->size,
+            solverData->ipiv,
+            solverData->b->data,
+            (int*) &systemData->size,
+            &solverData->info);
+  }
 
   infoStreamPrint(LOG_LS, 0, "Solve System: %f", rt_ext_tp_tock(&(solverData->timeClock)));
 
@@ -48,6 +48,10 @@ typedef struct DATA_LAPACK
   _omc_vector* b;
   _omc_matrix* A;
 
+  double *Aold;       /* matrix A of the last factorization */
+  double *LU;         /* LU factorization of Aold */
+  int factorized;     /* LU and ipiv are valid */
+
   rtclock_t timeClock;             /* time clock */
 
 } DATA_LAPACK;
@@ -73,9 +73,11 @@ allocateUmfPackData(int n_row, int n_col, int nz, void** voiddata)
 
   data->Ai = (int*) calloc(nz,sizeof(int));
   data->Ax = (double*) calloc(nz,sizeof(double));
+  data->AxOld = (double*) calloc(nz,sizeof(double));
   data->work = (double*) calloc(n_col,sizeof(double));
 
   data->numberSolving=0;
+  data->numericValid=0;
   umfpack_di_defaults(data->control);
 
   data->control[UMFPACK_PIVOT_TOLERANCE] = 0.1;
@@ -104,6 +106,7 @@ freeUmfPackData(void **voiddata)
   free(data->Ap);
   free(data->Ai);
   free(data->Ax);
+  free(data->AxOld);
   free(data->work);
 
   if(data->symbolic)
@@ -265,9 +268,20 @@ solveUmfPack(DATA *data, threadData_t *threadData, int sysNumber)
     status = umfpack_di_symbolic(solverData->n_col, solverData->n_row, solverData->Ap, solverData->Ai, solverData->Ax, &(solverData->symbolic), solverData->control, solverData->info);
   }
 
-  /* compute the LU factorization of A */
+  /* compute the LU factorization of A; it is reused if A did not change */
   if (0 == status){
-    status = umfpack_di_numeric(solverData->Ap, solverData->Ai, solverData->Ax, solverData->symbolic, &(solverData->numeric), solverData->control, solverData->info);
+    if (solverData->numericValid && 0 == memcmp(solverData->Ax, solverData->AxOld, sizeof(double)*solverData->nnz))
+    {
+      infoStreamPrint(LOG_LS, 0, "Reuse LU factorization of matrix A.");
+    }
+    else
+    {
+      memcpy(solverData->AxOld, solverData->Ax, sizeof(double)*solverData->nnz);
+      if (solverData->numeric)
+        umfpack_di_free_numeric(&solverData->numeric);
+      status = umfpack_di_numeric(solverData->Ap, solverData->Ai, solverData->Ax, solverData->symbolic, &(solverData->numeric), solverData->control, solverData->info);
+      solverData->numericValid = (UMFPACK_OK == status);
+    }
   }
 
   if (0 == status){
@@ -47,10 +47,12 @@ typedef struct DATA_UMFPACK
   int *Ap;
   int *Ai;
   double *Ax;
+  double *AxOld;                   /* values of A of the last factorization */
   int n_col;
   int n_row;
   int nnz;
   void *symbolic, *numeric;
+  int numericValid;                /* numeric is a regular factorization of AxOld */
   double control[UMFPACK_CONTROL], info[UMFPACK_INFO];
 
   int col_akt;
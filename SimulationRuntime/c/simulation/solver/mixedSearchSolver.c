@@ -34,6 +34,7 @@
 #include <math.h>
 #include <stdlib.h>
 #include <string.h> /* memcpy */
+#include <stdint.h>
 
 #include "simulation/simulation_info_json.h"
 #include "util/omc_error.h"
@@ -43,16 +44,33 @@
 #include "nonlinearSystem.h"
 #include "nonlinearSolverHybrd.h"
 
+/* number of combinations one call of solveMixedSearch remembers; after that
+ * it only enumerates the remaining combinations in the order of nextVar */
+#define MIXED_SEARCH_MAX_STEPS 4096
+
 typedef struct DATA_SEARCHMIXED_SOLVER
 {
   modelica_boolean* iterationVars;
   modelica_boolean* iterationVars2;
   modelica_boolean* iterationVarsPre;
+  modelica_boolean* candidate;         /* next combination to try */
+  modelica_boolean* lastSolution;      /* last consistent combination, kept between the calls */
+  int hasLastSolution;
 
   long* iterationVarsIndex;
 
   modelica_boolean* stateofSearch;
 
+  /* combinations already tried in the current call: open addressing hash
+   * table of the packed combinations, an entry belongs to the current call
+   * if its stamp matches */
+  unsigned int nWords;
+  unsigned int tableSize;
+  uint64_t* tableKeys;
+  unsigned int* tableStamps;
+  unsigned int stamp;
+  uint64_t* key;
+
 }DATA_SEARCHMIXED_SOLVER;
 
 
@@ -62,15 +80,26 @@ typedef struct DATA_SEARCHMIXED_SOLVER
 int allocateMixedSearchData(int size, void** voiddata)
 {
   DATA_SEARCHMIXED_SOLVER* data = (DATA_SEARCHMIXED_SOLVER*) malloc(sizeof(DATA_SEARCHMIXED_SOLVER));
+  unsigned int maxEntries = (size < 12) ? (1u << size) : MIXED_SEARCH_MAX_STEPS;
   *voiddata = (void*)data;
   assertStreamPrint(NULL, 0 != data, "allocationHybrdData() failed!");
 
   data->iterationVars = (modelica_boolean*) malloc(size*sizeof(modelica_boolean));
   data->iterationVars2 = (modelica_boolean*) malloc(size*sizeof(modelica_boolean));
   data->iterationVarsPre = (modelica_boolean*) malloc(size*sizeof(modelica_boolean));
+  data->candidate = (modelica_boolean*) malloc(size*sizeof(modelica_boolean));
+  data->lastSolution = (modelica_boolean*) malloc(size*sizeof(modelica_boolean));
+  data->hasLastSolution = 0;
 
   data->stateofSearch = (modelica_boolean*) malloc(size*sizeof(modelica_boolean));
 
+  data->nWords = (size + 63) / 64;
+  for(data->tableSize = 4; data->tableSize < 2*maxEntries; data->tableSize *= 2);
+  data->tableKeys = (uint64_t*) malloc(data->tableSize*data->nWords*sizeof(uint64_t));
+  data->tableStamps = (unsigned int*) calloc(data->tableSize, sizeof(unsigned int));
+  data->stamp = 0;
+  data->key = (uint64_t*) malloc(data->nWords*sizeof(uint64_t));
+
   assertStreamPrint(NULL, 0 != *voiddata, "allocateMixedSearchData() voiddata failed!");
   return 0;
 }
@@ -85,12 +114,66 @@ int freeMixedSearchData(void **voiddata)
   free(data->iterationVars);
   free(data->iterationVars2);
   free(data->iterationVarsPre);
+  free(data->candidate);
+  free(data->lastSolution);
 
   free(data->stateofSearch);
 
+  free(data->tableKeys);
+  free(data->tableStamps);
+  free(data->key);
+
   return 0;
 }
 
+/*! \fn visitCombination
+ *
+ *  looks up a combination in the combinations tried in the current call.
+ *
+ *  \param [ref] [solverData]
+ *  \param [in]  [b] combination
+ *  \param [in]  [n] size of the combination
+ *  \param [in]  [insert] add the combination if it is not found
+ *  \return 1 if the combination was already tried, else 0
+ */
+static int visitCombination(DATA_SEARCHMIXED_SOLVER* solverData, const modelica_boolean *b, int n, int insert)
+{
+  const unsigned int nWords = solverData->nWords;
+  uint64_t hash = 0x9e3779b97f4a7c15ULL;
+  unsigned int i, j;
+
+  memset(solverData->key, 0, nWords*sizeof(uint64_t));
+  for(i = 0; i < (unsigned int) n; i++)
+  {
+    if (b[i])
+    {
+      solverData->key[i/64] |= ((uint64_t) 1) << (i%64);
+    }
+  }
+  for(j = 0; j < nWords; j++)
+  {
+    hash = (hash ^ solverData->key[j]) * 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+  }
+
+  for(i = (unsigned int) hash & (solverData->tableSize-1); ; i = (i+1) & (solverData->tableSize-1))
+  {
+    if (solverData->tableStamps[i] != solverData->stamp)
+    {
+      if (insert)
+      {
+        solverData->tableStamps[i] = solverData->stamp;
+        memcpy(solverData->tableKeys + i*nWords, solverData->key, nWords*sizeof(uint64_t));
+      }
+      return 0;
+    }
+    if (!memcmp(solverData->tableKeys + i*nWords, solverData->key, nWords*sizeof(uint64_t)))
+    {
+      return 1;
+    }
+  }
+}
+
 /*! \fn nextVar
  *
  *  function is used in generated code for mixed equation systems
@@ -159,7 +242,77 @@ modelica_boolean nextVar(modelica_boolean *b, int n) {
   }
 }
 
+/*! \fn nextCombination
+ *
+ *  chooses the next combination of the boolean variables after the current
+ *  one (iterationVars) led to the different values iterationVars2. The
+ *  combinations that were already tried are skipped. In this order:
+ *   1. the last consistent combination of a former call
+ *   2. the values computed from the current combination (fixed point step)
+ *   3. the current combination with one of the conflicting variables flipped
+ *   4. the remaining combinations in the order of nextVar
+ *  Without guided only 4. is used; it ends after at most all combinations
+ *  even if the tried ones are not remembered any more.
+ *
+ *  \param [in]  [guided] use the steps 1. to 3.
+ *  \return 1 if solverData->candidate holds a new combination, 0 if all
+ *          combinations were tried
+ */
+static int nextCombination(MIXED_SYSTEM_DATA* systemData, DATA_SEARCHMIXED_SOLVER* solverData, int guided)
+{
+  const int n = systemData->size;
+  int i;
+
+  if (guided)
+  {
+    if (solverData->hasLastSolution && !visitCombination(solverData, solverData->lastSolution, n, 0))
+    {
+      memcpy(solverData->candidate, solverData->lastSolution, n*sizeof(modelica_boolean));
+      return 1;
+    }
+
+    if (!visitCombination(solverData, solverData->iterationVars2, n, 0))
+    {
+      memcpy(solverData->candidate, solverData->iterationVars2, n*sizeof(modelica_boolean));
+      return 1;
+    }
+
+    memcpy(solverData->candidate, solverData->iterationVars, n*sizeof(modelica_boolean));
+    for(i = 0; i < n; i++)
+    {
+      if (solverData->iterationVars[i] != solverData->iterationVars2[i])
+      {
+        solverData->candidate[i] = !solverData->candidate[i];
+        if (!visitCombination(solverData, solverData->candidate, n, 0))
+        {
+          return 1;
+        }
+        solverData->candidate[i] = !solverData->candidate[i];
+      }
+    }
+  }
+
+  while(nextVar(solverData->stateofSearch, n))
+  {
+    for(i = 0; i < n; i++)
+      solverData->candidate[i] = *(systemData->iterationPreVarsPtr[i]) != solverData->stateofSearch[i];
+    if (!visitCombination(solverData, solverData->candidate, n, 0))
+    {
+      return 1;
+    }
+  }
+  return 0;
+}
+
 /*! \fn solve mixed system with extended search
+ *
+ *  Searches a combination of the boolean variables that is reproduced by
+ *  the discrete equations after solving the continuous part. Every tried
+ *  combination is remembered, so the search never evaluates a combination
+ *  twice, and it is guided by the variables in conflict before it falls
+ *  back to enumerating the combinations. After MIXED_SEARCH_MAX_STEPS
+ *  combinations the search only enumerates the combinations not yet
+ *  reached by nextVar, so it still ends with a solution if there is one.
  *
  *  \param [in]  [data]
  *                [sysNumber] index of the corresponing mixed system
@@ -188,6 +341,13 @@ int solveMixedSearch(DATA *data, int sysNumber)
 
   memset(solverData->stateofSearch, 0, systemData->size);
 
+  /* forget the combinations of the former call */
+  if (++solverData->stamp == 0)
+  {
+    memset(solverData->tableStamps, 0, solverData->tableSize*sizeof(unsigned int));
+    solverData->stamp = 1;
+  }
+
   /* update pre iteration vars */
   /* update iteration vars */
   for(i=0;i<systemData->size;++i)
@@ -198,6 +358,8 @@ int solveMixedSearch(DATA *data, int sysNumber)
     /* update pre iteration vars */
     for(i=0;i<systemData->size;++i)
       solverData->iterationVars[i] = *(systemData->iterationVarsPtr[i]);
+    if (stepCount < MIXED_SEARCH_MAX_STEPS)
+      visitCombination(solverData, solverData->iterationVars, systemData->size, 1);
 
     /* solve continuous equation part
      * and update iteration variables in model
@@ -247,11 +409,13 @@ int solveMixedSearch(DATA *data, int sysNumber)
     if(!found_solution )
     {
       /* try next set of values*/
-      if(nextVar(solverData->stateofSearch, systemData->size))
+      if(stepCount + 1 == MIXED_SEARCH_MAX_STEPS)
+        debugStreamPrint(LOG_NLS, 0, "#### continue with the enumeration of the combinations");
+      if(nextCombination(systemData, solverData, stepCount + 1 < MIXED_SEARCH_MAX_STEPS))
       {
         debugStreamPrint(LOG_NLS, 0, "#### set next STATE ");
         for(i = 0; i < systemData->size; i++)
-          *(systemData->iterationVarsPtr[i]) = *(systemData->iterationPreVarsPtr[i]) != solverData->stateofSearch[i];
+          *(systemData->iterationVarsPtr[i]) = solverData->candidate[i];
 
         /* debug output */
         if(ACTIVE_STREAM(LOG_NLS))
@@ -283,6 +447,8 @@ int solveMixedSearch(DATA *data, int sysNumber)
     if(found_solution  == 1)
     {
       success = 1;
+      memcpy(solverData->lastSolution, solverData->iterationVars, systemData->size*sizeof(modelica_boolean));
+      solverData->hasLastSolution = 1;
       if(ACTIVE_STREAM(LOG_NLS))
       {
         const char * __name;
@@ -911,6 +911,7 @@ void initializeDataStruc(DATA *data, threadData_t *threadData)
   data->simulationInfo->lsMethod = LS_LAPACK;
   data->simulationInfo->mixedMethod = MIXED_SEARCH;
   data->simulationInfo->newtonStrategy = NEWTON_PURE;
+  data->simulationInfo->nlsLinearSolver = NLS_LS_DENSE;
   data->simulationInfo->nlsCsvInfomation = 0;
   data->simulationInfo->currentContext = CONTEXT_ALGEBRAIC;
   data->simulationInfo->jacobianEvals = data->modelData->nStates;
@@ -918,6 +919,8 @@ void initializeDataStruc(DATA *data, threadData_t *threadData)
   data->simulationInfo->zeroCrossings = (modelica_real*) calloc(data->modelData->nZeroCrossings, sizeof(modelica_real));
   data->simulationInfo->zeroCrossingsPre = (modelica_real*) calloc(data->modelData->nZeroCrossings, sizeof(modelica_real));
   data->simulationInfo->zeroCrossingsBackup = (modelica_real*) calloc(data->modelData->nZeroCrossings, sizeof(modelica_real));
+  data->simulationInfo->rootFindingWork = (modelica_real*) calloc(6*data->modelData->nStates + 2*data->modelData->nZeroCrossings, sizeof(modelica_real));
+  data->simulationInfo->rootFindingEvents = (long*) calloc(2*data->modelData->nZeroCrossings, sizeof(long));
   data->simulationInfo->relations = (modelica_boolean*) calloc(data->modelData->nRelations, sizeof(modelica_boolean));
   data->simulationInfo->relationsPre = (modelica_boolean*) calloc(data->modelData->nRelations, sizeof(modelica_boolean));
   data->simulationInfo->storedRelations = (modelica_boolean*) calloc(data->modelData->nRelations, sizeof(modelica_boolean));
@@ -964,6 +967,9 @@ void initializeDataStruc(DATA *data, threadData_t *threadData)
   data->simulationInfo->stateSetData = (STATE_SET_DATA*) omc_alloc_interface.malloc_uncollectable(data->modelData->nStateSets*sizeof(STATE_SET_DATA));
   data->callback->initializeStateSets(data->modelData->nStateSets, data->simulationInfo->stateSetData, data);
 
+  /* threads for the independent systems, see initializeParallelSystems */
+  data->simulationInfo->parallelSystems = NULL;
+
   /* buffer for analytical jacobians */
   data->simulationInfo->analyticJacobians = (ANALYTIC_JACOBIAN*) omc_alloc_interface.malloc_uncollectable(data->modelData->nJacobians*sizeof(ANALYTIC_JACOBIAN));
 
@@ -1006,11 +1012,12 @@ void initializeDataStruc(DATA *data, threadData_t *threadData)
   data->simulationInfo->simulationSuccess = 0;
 
   /* initial delay */
-  data->simulationInfo->delayStructure = (RINGBUFFER**)malloc(data->modelData->nDelayExpressions * sizeof(RINGBUFFER*));
+  data->simulationInfo->delayStructure = (POW2_RINGBUFFER**)malloc(data->modelData->nDelayExpressions * sizeof(POW2_RINGBUFFER*));
   assertStreamPrint(threadData, 0 != data->simulationInfo->delayStructure, "out of memory");
 
   for(i=0; i<data->modelData->nDelayExpressions; i++)
-    data->simulationInfo->delayStructure[i] = allocRingBuffer(1024, sizeof(TIME_AND_VALUE));
+    data->simulationInfo->delayStructure[i] = allocPow2RingBuffer(1024, sizeof(TIME_AND_VALUE));
+  data->simulationInfo->delayCursor = (int*) calloc(data->modelData->nDelayExpressions, sizeof(int));
 
   TRACE_POP
 }
@@ -1073,6 +1080,8 @@ void deInitializeDataStruc(DATA *data)
   free(data->simulationInfo->zeroCrossings);
   free(data->simulationInfo->zeroCrossingsPre);
   free(data->simulationInfo->zeroCrossingsBackup);
+  free(data->simulationInfo->rootFindingWork);
+  free(data->simulationInfo->rootFindingEvents);
   free(data->simulationInfo->relations);
   free(data->simulationInfo->relationsPre);
   free(data->simulationInfo->storedRelations);
@@ -1124,9 +1133,169 @@ void deInitializeDataStruc(DATA *data)
 
   /* free delay structure */
   for(i=0; i<data->modelData->nDelayExpressions; i++)
-    freeRingBuffer(data->simulationInfo->delayStructure[i]);
+    freePow2RingBuffer(data->simulationInfo->delayStructure[i]);
 
   free(data->simulationInfo->delayStructure);
+  free(data->simulationInfo->delayCursor);
+
+  TRACE_POP
+}
+
+/*! \fn initializeThreadDataStruc
+ *
+ *  function creates a copy of the DATA structure to evaluate the model on an
+ *  other thread. The static model data, the parameters, the pre values and
+ *  the older entries of the ring buffer are shared with data; the current
+ *  values, the relations, the inputs, the jacobians and the solvers of the
+ *  algebraic loops are private to the copy. External inputs are not read by
+ *  the copy; updateThreadDataStruc takes over the inputs of data. The copy
+ *  evaluates its independent systems sequentially.
+ *
+ *  \param [in]  [data]
+ *  \param [ref] [threadData] thread data of the thread which uses the copy
+ *  \return copy of data, free'd by deInitializeThreadDataStruc
+ */
+DATA* initializeThreadDataStruc(DATA *data, threadData_t *threadData)
+{
+  TRACE_PUSH
+  DATA *copy = (DATA*) malloc(sizeof(DATA));
+  SIMULATION_INFO *simulationInfo = (SIMULATION_INFO*) malloc(sizeof(SIMULATION_INFO));
+  SIMULATION_DATA *sData = (SIMULATION_DATA*) malloc(sizeof(SIMULATION_DATA));
+  size_t i = 0;
+
+  assertStreamPrint(threadData, copy && simulationInfo && sData, "out of memory");
+  *copy = *data;
+  *simulationInfo = *data->simulationInfo;
+  *sData = *data->localData[0];
+  copy->simulationInfo = simulationInfo;
+
+  /* current values; localData[1..] are shared */
+  copy->localData = (SIMULATION_DATA**) malloc(SIZERINGBUFFER * sizeof(SIMULATION_DATA*));
+  assertStreamPrint(threadData, 0 != copy->localData, "out of memory");
+  copy->localData[0] = sData;
+  for(i=1; i<SIZERINGBUFFER; i++)
+    copy->localData[i] = data->localData[i];
+  sData->realVars = (modelica_real*) malloc(data->modelData->nVariablesReal * sizeof(modelica_real));
+  sData->integerVars = (modelica_integer*) malloc(data->modelData->nVariablesInteger * sizeof(modelica_integer));
+  sData->booleanVars = (modelica_boolean*) malloc(data->modelData->nVariablesBoolean * sizeof(modelica_boolean));
+  assertStreamPrint(threadData, sData->realVars && sData->integerVars && sData->booleanVars, "out of memory");
+
+  simulationInfo->relations = (modelica_boolean*) malloc(data->modelData->nRelations * sizeof(modelica_boolean));
+  simulationInfo->storedRelations = (modelica_boolean*) malloc(data->modelData->nRelations * sizeof(modelica_boolean));
+  simulationInfo->inputVars = (modelica_real*) malloc(data->modelData->nInputVars * sizeof(modelica_real));
+  simulationInfo->delayCursor = (int*) calloc(data->modelData->nDelayExpressions, sizeof(int));
+  simulationInfo->external_input.active = 0;
+  simulationInfo->nlsCsvInfomation = 0;
+  updateThreadDataStruc(copy, data);
+
+  /* jacobians are initialized on demand by the solvers using them */
+  simulationInfo->analyticJacobians = (ANALYTIC_JACOBIAN*) calloc(data->modelData->nJacobians, sizeof(ANALYTIC_JACOBIAN));
+
+  /* algebraic loops */
+  simulationInfo->mixedSystemData = (MIXED_SYSTEM_DATA*) omc_alloc_interface.malloc_uncollectable(data->modelData->nMixedSystems*sizeof(MIXED_SYSTEM_DATA));
+  data->callback->initialMixedSystem(data->modelData->nMixedSystems, simulationInfo->mixedSystemData);
+  simulationInfo->linearSystemData = (LINEAR_SYSTEM_DATA*) omc_alloc_interface.malloc_uncollectable(data->modelData->nLinearSystems*sizeof(LINEAR_SYSTEM_DATA));
+  data->callback->initialLinearSystem(data->modelData->nLinearSystems, simulationInfo->linearSystemData);
+  simulationInfo->nonlinearSystemData = (NONLINEAR_SYSTEM_DATA*) omc_alloc_interface.malloc_uncollectable(data->modelData->nNonLinearSystems*sizeof(NONLINEAR_SYSTEM_DATA));
+  data->callback->initialNonLinearSystem(data->modelData->nNonLinearSystems, simulationInfo->nonlinearSystemData);
+  initializeMixedSystems(copy, threadData);
+  initializeLinearSystems(copy, threadData);
+  initializeNonlinearSystems(copy, threadData);
+
+  TRACE_POP
+  return copy;
+}
+
+/*! \fn updateThreadDataStruc
+ *
+ *  function copies the current values, the relations, the inputs and the
+ *  state of the simulation (time, context, ...) of data into a copy created
+ *  by initializeThreadDataStruc
+ *
+ *  \param [ref] [copy]
+ *  \param [in]  [data]
+ */
+void updateThreadDataStruc(DATA *copy, DATA *data)
+{
+  TRACE_PUSH
+  SIMULATION_INFO *simulationInfo = copy->simulationInfo;
+  SIMULATION_DATA *sData = copy->localData[0];
+  SIMULATION_INFO backup = *simulationInfo;
+  SIMULATION_DATA backupData = *sData;
+
+  *simulationInfo = *data->simulationInfo;
+  simulationInfo->relations = backup.relations;
+  simulationInfo->storedRelations = backup.storedRelations;
+  simulationInfo->inputVars = backup.inputVars;
+  simulationInfo->delayCursor = backup.delayCursor;
+  simulationInfo->external_input = backup.external_input;
+  simulationInfo->nlsCsvInfomation = backup.nlsCsvInfomation;
+  simulationInfo->analyticJacobians = backup.analyticJacobians;
+  simulationInfo->mixedSystemData = backup.mixedSystemData;
+  simulationInfo->linearSystemData = backup.linearSystemData;
+  simulationInfo->nonlinearSystemData = backup.nonlinearSystemData;
+  simulationInfo->parallelSystems = NULL;
+  memcpy(simulationInfo->relations, data->simulationInfo->relations, data->modelData->nRelations * sizeof(modelica_boolean));
+  memcpy(simulationInfo->storedRelations, data->simulationInfo->storedRelations, data->modelData->nRelations * sizeof(modelica_boolean));
+  memcpy(simulationInfo->inputVars, data->simulationInfo->inputVars, data->modelData->nInputVars * sizeof(modelica_real));
+  memcpy(simulationInfo->delayCursor, data->simulationInfo->delayCursor, data->modelData->nDelayExpressions * sizeof(int));
+
+  *sData = *data->localData[0];
+  sData->realVars = backupData.realVars;
+  sData->integerVars = backupData.integerVars;
+  sData->booleanVars = backupData.booleanVars;
+  memcpy(sData->realVars, data->localData[0]->realVars, data->modelData->nVariablesReal * sizeof(modelica_real));
+  memcpy(sData->integerVars, data->localData[0]->integerVars, data->modelData->nVariablesInteger * sizeof(modelica_integer));
+  memcpy(sData->booleanVars, data->localData[0]->booleanVars, data->modelData->nVariablesBoolean * sizeof(modelica_boolean));
+
+  TRACE_POP
+}
+
+/*! \fn deInitializeThreadDataStruc
+ *
+ *  function frees a copy created by initializeThreadDataStruc
+ *
+ *  \param [ref] [copy]
+ *  \param [ref] [threadData]
+ */
+void deInitializeThreadDataStruc(DATA *copy, threadData_t *threadData)
+{
+  TRACE_PUSH
+  SIMULATION_INFO *simulationInfo = copy->simulationInfo;
+  ANALYTIC_JACOBIAN *jac;
+  size_t i = 0;
+
+  freeMixedSystems(copy, threadData);
+  freeLinearSystems(copy, threadData);
+  freeNonlinearSystems(copy, threadData);
+  omc_alloc_interface.free_uncollectable(simulationInfo->mixedSystemData);
+  omc_alloc_interface.free_uncollectable(simulationInfo->linearSystemData);
+  omc_alloc_interface.free_uncollectable(simulationInfo->nonlinearSystemData);
+
+  for(i=0; i<copy->modelData->nJacobians; i++)
+  {
+    jac = &simulationInfo->analyticJacobians[i];
+    free(jac->seedVars);
+    free(jac->resultVars);
+    free(jac->tmpVars);
+    free(jac->sparsePattern.leadindex);
+    free(jac->sparsePattern.index);
+    free(jac->sparsePattern.colorCols);
+  }
+  free(simulationInfo->analyticJacobians);
+
+  free(simulationInfo->relations);
+  free(simulationInfo->storedRelations);
+  free(simulationInfo->inputVars);
+  free(simulationInfo->delayCursor);
+  free(simulationInfo);
+
+  free(copy->localData[0]->realVars);
+  free(copy->localData[0]->integerVars);
+  free(copy->localData[0]->booleanVars);
+  free(copy->localData[0]);
+  free(copy->localData);
+  free(copy);
 
   TRACE_POP
 }
@@ -35,6 +35,7 @@ extern "C" {
 #endif
 
 #include "simulation_data.h"
+#include <float.h>
 
 /* lochel: I guess this is used for discrete relations */
 #define RELATION(res,exp1,exp2,index,op_w) \
@@ -74,12 +75,23 @@ extern "C" {
   } \
 }
 
+/* Value of a zero crossing of a relation of reals: the sign tells whether
+ * the relation holds, the magnitude is the distance of the operands (but never
+ * zero) so that the root finding in events.c can interpolate. */
+#define ZEROCROSSING_VALUE(res,distance) ((res) ? fmax((distance),DBL_MIN) : fmin((distance),-DBL_MIN))
+
 extern const size_t SIZERINGBUFFER;
 
 void initializeDataStruc(DATA *data, threadData_t *threadData);
 
 void deInitializeDataStruc(DATA *data);
 
+DATA* initializeThreadDataStruc(DATA *data, threadData_t *threadData);
+
+void updateThreadDataStruc(DATA *copy, DATA *data);
+
+void deInitializeThreadDataStruc(DATA *copy, threadData_t *threadData);
+
 void updateDiscreteSystem(DATA *data, threadData_t *threadData);
 
 void saveZeroCrossings(DATA *data, threadData_t *threadData);
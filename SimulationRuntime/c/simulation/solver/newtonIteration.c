@@ -49,6 +49,8 @@ extern "C" {
 
 #include "external_input.h"
 
+/* a step with the factorization of the former call has to reduce the residual at least by this factor */
+#define NEWTON_REUSE_CONTRACTION 0.1
 
 extern double enorm_(int *n, double *x);
 int solveLinearSystem(int* n, int* iwork, double* fvec, double *fjac, DATA_NEWTON* solverData);
@@ -113,6 +115,7 @@ int allocateNewtonData(int size, void** voiddata)
   data->delta_x_vec = (double*) calloc(size,sizeof(double));
 
   data->factorization = 0;
+  data->factorizationValid = 0;
   data->calculate_jacobian = 1;
   data->numberOfIterations = 0;
   data->numberOfFunctionEvaluations = 0;
@@ -163,6 +166,10 @@ int freeNewtonData(void **voiddata)
  * 					(i)  every i steps (=1 means original newton method)
  * 					(-1) never, factorization has to be given in A
  *
+ *  If the jacobian is calculated only once (calculate_jacobian = 0), the
+ *  iteration starts with the factorization of the former call and takes
+ *  a new jacobian as soon as a step does not reduce the residual by
+ *  NEWTON_REUSE_CONTRACTION.
  */
 int _omc_newton(int(*f)(int*, double*, double*, void*, int), DATA_NEWTON* solverData, void* userdata)
 {
@@ -179,6 +186,7 @@ int _omc_newton(int(*f)(int*, double*, double*, void*, int), DATA_NEWTON* solver
   int *iwork = solverData->iwork;
   int *info = &(solverData->info);
   int calc_jac = 1;
+  int reuseFactorization = solverData->calculate_jacobian == 0 && solverData->factorizationValid;
 
   double error_f  = 1.0 + *eps, scaledError_f = 1.0 + *eps, delta_x = 1.0 + *eps, delta_f = 1.0 + *eps, delta_x_scaled = 1.0 + *eps, lambda = 1.0;
   double current_fvec_enorm, enorm_new;
@@ -224,7 +232,11 @@ int _omc_newton(int(*f)(int*, double*, double*, void*, int), DATA_NEWTON* solver
     }
 
     /* calculate jacobian if no matrix is given */
-    if (calc_jac == 1 && solverData->calculate_jacobian >= 0)
+    if (reuseFactorization)
+    {
+      solverData->factorization = 1;
+    }
+    else if (calc_jac == 1 && solverData->calculate_jacobian >= 0)
     {
       (*f)(n, x, fvec, userdata, 0);
       solverData->factorization = 0;
@@ -294,6 +306,18 @@ int _omc_newton(int(*f)(int*, double*, double*, void*, int), DATA_NEWTON* solver
 
       calculatingErrors(solverData, &delta_x, &delta_x_scaled, &delta_f, &error_f, &scaledError_f, n, x, fvec);
 
+      if (reuseFactorization)
+      {
+        /* the old factorization does not converge fast enough, continue with a new jacobian */
+        if (error_f > NEWTON_REUSE_CONTRACTION * current_fvec_enorm)
+        {
+          infoStreamPrint(LOG_NLS_V, 0, "factorization of the former call converges too slowly, calculate the jacobian");
+          reuseFactorization = 0;
+        }
+        /* small steps of an old factorization do not mean convergence, only the residual does */
+        delta_x = delta_x_scaled = delta_f = 1.0 + *eps;
+      }
+
       /* updating x */
       memcpy(x, solverData->x_new, *n*sizeof(double));
 
@@ -367,6 +391,7 @@ int solveLinearSystem(int* n, int* iwork, double* fvec, double *fjac, DATA_NEWTO
     /* solve J*(x_{n+1} - x_n)=f */
     dgetrf_(n, n, fjac, n, iwork, &lapackinfo);
     solverData->factorization = 1;
+    solverData->factorizationValid = (lapackinfo == 0);
     dgetrs_(&trans, n, &nrsh, fjac, n, iwork, fvec, n, &lapackinfo);
   }
   else
@@ -62,6 +62,7 @@ typedef struct DATA_NEWTON
   int* iwork;
   int calculate_jacobian;
   int factorization;
+  int factorizationValid; /* fjac and iwork hold the LU factorization of a former iteration */
   int numberOfIterations; /* over the whole simulation time */
   int numberOfFunctionEvaluations; /* over the whole simulation time */
 
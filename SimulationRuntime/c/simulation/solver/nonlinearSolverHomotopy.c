@@ -48,6 +48,7 @@
 #include "nonlinearSystem.h"
 #include "nonlinearSolverHomotopy.h"
 #include "nonlinearSolverHybrd.h"
+#include "nonlinearSparseJacobian.h"
 
 /*! \typedef DATA_HOMOTOPY
  * define memory structure for nonlinear system solver
@@ -134,6 +135,11 @@ typedef struct DATA_HOMOTOPY
 
   void* dataHybrid;
 
+  /* -nlsLS=klu: the jacobian is kept as NLS_SPARSE_JACOBIAN and the dense
+   * matrices fJac, fJacx0, hJac and debug_fJac are not allocated */
+  void* sparseJac;
+  double* sparseJacx0; /* values of the sparse jacobian at x0 */
+
 } DATA_HOMOTOPY;
 
 /*! \fn allocateHomotopyData
@@ -177,12 +183,13 @@ int allocateHomotopyData(int size, void** voiddata)
   data->x1 = (double*) calloc(size,sizeof(double));
   data->finit = (double*) calloc(size,sizeof(double));
   data->fx0 = (double*) calloc(size,sizeof(double));
-  data->fJac = (double*) calloc((size*(size+1)),sizeof(double));
-  data->fJacx0 = (double*) calloc((size*(size+1)),sizeof(double));
+  /* jacobians are allocated by initializeHomotopyJacobian */
+  data->fJac = NULL;
+  data->fJacx0 = NULL;
 
   /* debug arrays */
   data->debug_dx = (double*) calloc(size,sizeof(double));
-  data->debug_fJac = (double*) calloc((size*(size+1)),sizeof(double));
+  data->debug_fJac = NULL;
 
    /* homotopy */
   data->y0 = (double*) calloc((size+1),sizeof(double));
@@ -193,8 +200,8 @@ int allocateHomotopyData(int size, void** voiddata)
   data->dy1 = (double*) calloc((size+1),sizeof(double));
   data->dy2 = (double*) calloc((size+1),sizeof(double));
   data->hvec = (double*) calloc(size,sizeof(double));
-  data->hJac  = (double*) calloc(size*(size+1),sizeof(double));
-  data->hJacInit  = (double*) calloc(size*(size+1),sizeof(double));
+  data->hJac = NULL;
+  data->hJacInit = NULL;
   data->ones  = (double*) calloc(size+1,sizeof(double));
 
   /* linear system */
@@ -203,6 +210,9 @@ int allocateHomotopyData(int size, void** voiddata)
 
   allocateHybrdData(size, &data->dataHybrid);
 
+  data->sparseJac = NULL;
+  data->sparseJacx0 = NULL;
+
   assertStreamPrint(NULL, 0 != *voiddata, "allocationHomotopyData() voiddata failed!");
   return 0;
 }
@@ -256,9 +266,45 @@ int freeHomotopyData(void **voiddata)
 
   freeHybrdData(&data->dataHybrid);
 
+#ifdef WITH_UMFPACK
+  if(data->sparseJac)
+    freeSparseJacobian((NLS_SPARSE_JACOBIAN*) data->sparseJac);
+#endif
+  free(data->sparseJacx0);
+
   return 0;
 }
 
+/*! \fn initializeHomotopyJacobian
+ *
+ *  allocates the jacobians with the first call of the solver, when the
+ *  jacobian of the system is known: the sparse jacobian with -nlsLS=klu
+ *  if the system has an analytical jacobian, else the dense matrices
+ */
+static void initializeHomotopyJacobian(DATA_HOMOTOPY* solverData)
+{
+  int size = solverData->n;
+
+#ifdef WITH_UMFPACK
+  DATA *data = solverData->data;
+  NONLINEAR_SYSTEM_DATA* systemData = &(data->simulationInfo->nonlinearSystemData[solverData->sysNumber]);
+
+  if(data->simulationInfo->nlsLinearSolver == NLS_LS_KLU && systemData->jacobianIndex != -1)
+  {
+    solverData->sparseJac = allocateSparseJacobian(data, solverData->threadData, systemData);
+    solverData->sparseJacx0 = (double*) calloc(((NLS_SPARSE_JACOBIAN*) solverData->sparseJac)->nnz, sizeof(double));
+    solverData->initialized = 1;
+    return;
+  }
+#endif
+  solverData->fJac = (double*) calloc((size*(size+1)),sizeof(double));
+  solverData->fJacx0 = (double*) calloc((size*(size+1)),sizeof(double));
+  solverData->debug_fJac = (double*) calloc((size*(size+1)),sizeof(double));
+  solverData->hJac  = (double*) calloc(size*(size+1),sizeof(double));
+  solverData->hJacInit  = (double*) calloc(size*(size+1),sizeof(double));
+  solverData->initialized = 1;
+}
+
 /* Prototypes for debug functions
  *  \author bbachmann
  */
@@ -848,6 +894,16 @@ static int wrapper_fvec_der(DATA_HOMOTOPY* solverData, double* x, double* fJac)
   int i;
   int jacobianIndex = (&(solverData->data->simulationInfo->nonlinearSystemData[solverData->sysNumber]))->jacobianIndex;
 
+#ifdef WITH_UMFPACK
+  /* sparse jacobian, fJac is not used */
+  if(solverData->sparseJac)
+  {
+    evalSparseJacobian((NLS_SPARSE_JACOBIAN*) solverData->sparseJac, solverData->data, solverData->threadData,
+                       &(solverData->data->simulationInfo->nonlinearSystemData[solverData->sysNumber]), solverData->xScaling);
+    return 0;
+  }
+#endif
+
   /* calculate jacobian */
   if(jacobianIndex != -1)
   {
@@ -907,6 +963,14 @@ static int wrapper_fvec_homotopy_newton_der(DATA_HOMOTOPY* solverData, double* x
   /* Newton homotopy */
   wrapper_fvec_der(solverData, x, hJac);
 
+#ifdef WITH_UMFPACK
+  if(solverData->sparseJac)
+  {
+    vecCopy(n, solverData->fx0, ((NLS_SPARSE_JACOBIAN*) solverData->sparseJac)->column);
+    return 0;
+  }
+#endif
+
   /* add f(x0) as the last column of the Jacobian*/
   vecCopy(n, solverData->fx0, hJac + n*n);
 
@@ -944,6 +1008,19 @@ static int wrapper_fvec_homotopy_fixpoint_der(DATA_HOMOTOPY* solverData, double*
 
   /* Fixpoint homotopy */
   wrapper_fvec_der(solverData, x, hJac);
+#ifdef WITH_UMFPACK
+  if(solverData->sparseJac)
+  {
+    NLS_SPARSE_JACOBIAN* jac = (NLS_SPARSE_JACOBIAN*) solverData->sparseJac;
+    for (j=0; j<jac->nnz; j++)
+      jac->Ax[j] = x[n]*jac->Ax[j];
+    for (i=0; i<n; i++){
+      jac->Ax[jac->diag[i]] = jac->Ax[jac->diag[i]] + (1-x[n]);
+      jac->column[i] = solverData->f1[i]-(x[i] - solverData->x0[i]);
+    }
+    return 0;
+  }
+#endif
   for (i=0; i<n; i++){
     for (j=0; j<n; j++) {
       hJac[i+ j * n] = x[n]*hJac[i+ j * n];
@@ -1087,6 +1164,185 @@ int solveSystemWithTotalPivotSearch(int n, double* x, double* A, int* indRow, in
 
   return 0;
 }
+
+#ifdef WITH_UMFPACK
+/*! \fn solveSparseBordered
+ *
+ *  solves the bordered system [J column] * y = 0 of the sparse jacobian
+ *  with y[pos] = 1, i.e. B*z = -b where B is J with column pos replaced
+ *  by the additional column and b the column pos of [J column]
+ */
+static int solveSparseBordered(DATA_HOMOTOPY* solverData, double* y, double* b, int pos)
+{
+  NLS_SPARSE_JACOBIAN* jac = (NLS_SPARSE_JACOBIAN*) solverData->sparseJac;
+  int n = solverData->n;
+
+  vecScalarMult(n, b, -1.0, y);
+  if (solveSparseJacobian(jac, pos, y) != 0)
+    return -1;
+
+  /* the coefficient of the additional column is the lambda component */
+  y[n] = y[pos];
+  y[pos] = 1.0;
+
+  if(ACTIVE_STREAM(LOG_NLS_JAC))
+  {
+    debugVectorDouble(LOG_NLS_JAC,"solution:", y, n+1);
+    messageClose(LOG_NLS_JAC);
+  }
+  return 0;
+}
+#endif
+
+/*! \fn prepareNewtonSystem
+ *
+ *  stores the residual f1 as right hand side of the Newton system and
+ *  calculates the scaling factors of the residuals from the jacobian
+ */
+static void prepareNewtonSystem(DATA_HOMOTOPY* solverData)
+{
+#ifdef WITH_UMFPACK
+  if (solverData->sparseJac)
+  {
+    sparseJacobianRowSums((NLS_SPARSE_JACOBIAN*) solverData->sparseJac, 0, solverData->resScaling);
+    debugVectorDouble(LOG_NLS_JAC, "residuum scaling:", solverData->resScaling, solverData->n);
+    return;
+  }
+#endif
+  vecCopy(solverData->n, solverData->f1, solverData->fJac + solverData->n*solverData->n);
+  /* calculate scaling factor of residuals */
+  matVecMultAbsBB(solverData->n, solverData->fJac, solverData->ones, solverData->resScaling);
+  debugVectorDouble(LOG_NLS_JAC, "residuum scaling:", solverData->resScaling, solverData->n);
+  scaleMatrixRows(solverData->n, solverData->m, solverData->fJac);
+}
+
+/*! \fn storeJacobianX0
+ *
+ *  keeps the jacobian at x0 for a re-run of the solution process
+ */
+static void storeJacobianX0(DATA_HOMOTOPY* solverData, int restore)
+{
+#ifdef WITH_UMFPACK
+  if (solverData->sparseJac)
+  {
+    NLS_SPARSE_JACOBIAN* jac = (NLS_SPARSE_JACOBIAN*) solverData->sparseJac;
+    if (restore)
+      vecCopy(jac->nnz, solverData->sparseJacx0, jac->Ax);
+    else
+      vecCopy(jac->nnz, jac->Ax, solverData->sparseJacx0);
+    return;
+  }
+#endif
+  if (restore)
+    vecCopy(solverData->n*solverData->m, solverData->fJacx0, solverData->fJac);
+  else
+  {
+    vecCopy(solverData->n, solverData->f1, solverData->fJac + solverData->n*solverData->n);
+    vecCopy(solverData->n*solverData->m, solverData->fJac, solverData->fJacx0);
+  }
+}
+
+/*! \fn solveNewtonStep
+ *
+ *  calculates the (scaled) Newton step dy0 of the system prepared by
+ *  prepareNewtonSystem, dy0[n] = 1
+ */
+static int solveNewtonStep(DATA_HOMOTOPY* solverData)
+{
+  int pos = solverData->n, rank;
+
+#ifdef WITH_UMFPACK
+  if (solverData->sparseJac)
+  {
+    if (solveSparseBordered(solverData, solverData->dy0, solverData->f1, pos) != 0)
+    {
+      warningStreamPrint(LOG_NLS, 0, "Matrix singular!");
+      return -1;
+    }
+    return 0;
+  }
+#endif
+  return solveSystemWithTotalPivotSearch(solverData->n, solverData->dy0, solverData->fJac, solverData->indRow, solverData->indCol, &pos, &rank);
+}
+
+/*! \fn solveHomotopyTangent
+ *
+ *  calculates the tangent dy0 of the homotopy path from hJac. The dense
+ *  solver chooses the fixed component pos by total pivoting; the sparse
+ *  solver takes the largest (scaled) component of the last direction dy2,
+ *  which usually stays the same along the path, so the symbolic analysis
+ *  of the bordered matrix is reused.
+ */
+static int solveHomotopyTangent(DATA_HOMOTOPY* solverData, int *pos)
+{
+  int rank;
+
+#ifdef WITH_UMFPACK
+  if (solverData->sparseJac)
+  {
+    NLS_SPARSE_JACOBIAN* jac = (NLS_SPARSE_JACOBIAN*) solverData->sparseJac;
+    int i, k, n = solverData->n;
+
+    *pos = n;
+    for (i=0; i<n; i++)
+      if (fabs(solverData->dy2[i])/solverData->xScaling[i] > fabs(solverData->dy2[*pos])/solverData->xScaling[*pos])
+        *pos = i;
+
+    /* column pos of [J column] */
+    if (*pos < n)
+    {
+      vecConst(n, 0.0, solverData->f2);
+      for (k=jac->Ap[*pos]; k<jac->Ap[*pos+1]; k++)
+        solverData->f2[jac->Ai[k]] = jac->Ax[k];
+    }
+    else
+      vecCopy(n, jac->column, solverData->f2);
+
+    if (solveSparseBordered(solverData, solverData->dy0, solverData->f2, *pos) == 0)
+      return 0;
+    /* fixed lambda */
+    if (*pos < n)
+    {
+      debugInt(LOG_NLS_HOMOTOPY, "singular bordered matrix, position = ", *pos);
+      *pos = n;
+      if (solveSparseBordered(solverData, solverData->dy0, jac->column, *pos) == 0)
+        return 0;
+    }
+    warningStreamPrint(LOG_NLS, 0, "Matrix singular!");
+    return -1;
+  }
+#endif
+  scaleMatrixRows(solverData->n, solverData->m, solverData->hJac);
+  *pos = -1; /* stable solution algorithm for solving a generalized over-determined linear system */
+  return solveSystemWithTotalPivotSearch(solverData->n, solverData->dy0, solverData->hJac, solverData->indRow, solverData->indCol, pos, &rank);
+}
+
+/*! \fn solveHomotopyCorrector
+ *
+ *  calculates the (scaled) corrector step dy1 for h(y1) = hvec with the
+ *  component pos fixed
+ */
+static int solveHomotopyCorrector(DATA_HOMOTOPY* solverData, int pos)
+{
+  int rank;
+
+#ifdef WITH_UMFPACK
+  if (solverData->sparseJac)
+  {
+    sparseJacobianRowSums((NLS_SPARSE_JACOBIAN*) solverData->sparseJac, 1, solverData->resScaling);
+    debugVectorDouble(LOG_NLS_HOMOTOPY, "residuum scaling of function h:", solverData->resScaling, solverData->n);
+    return solveSparseBordered(solverData, solverData->dy1, solverData->hvec, pos);
+  }
+#endif
+  matVecMultAbs(solverData->n, solverData->m, solverData->hJac, solverData->ones, solverData->resScaling);
+  debugVectorDouble(LOG_NLS_HOMOTOPY, "residuum scaling of function h:", solverData->resScaling, solverData->n);
+
+  /* copy vector h to column "pos" of the jacobian */
+  vecCopy(solverData->n, solverData->hvec, solverData->hJac + pos*solverData->n);
+  scaleMatrixRows(solverData->n, solverData->m, solverData->hJac);
+  return solveSystemWithTotalPivotSearch(solverData->n, solverData->dy1, solverData->hJac, solverData->indRow, solverData->indCol, &pos, &rank);
+}
+
 /*! \fn solve system with damped Newton-Raphson
  *
  *  \author bbachmann
@@ -1095,7 +1351,6 @@ int solveSystemWithTotalPivotSearch(int n, double* x, double* A, int* indRow, in
 static int newtonAlgorithm(DATA_HOMOTOPY* solverData, double* x)
 {
   int numberOfIterations = 0 ,i, j, n=solverData->n, m=solverData->m;
-  int  pos = solverData->n, rank;
   double error_f, error_f1, error_f2,error_f_scaled, delta_x, delta_x_scaled, grad_f1, grad_f;
   int numberOfSmallSteps = 0;
   double error_f_old = 1e100;
@@ -1131,7 +1386,7 @@ static int newtonAlgorithm(DATA_HOMOTOPY* solverData, double* x)
     debugInt(LOG_NLS_V, "Iteration:", numberOfIterations);
 
     /* solve jacobian and function value (both stored in hJac, last column is fvec), side effects: jacobian matrix is changed */
-    if ((numberOfIterations>1) && (solveSystemWithTotalPivotSearch(solverData->n, solverData->dy0, solverData->fJac, solverData->indRow, solverData->indCol, &pos, &rank) != 0))
+    if ((numberOfIterations>1) && (solveNewtonStep(solverData) != 0))
     {
       /* report solver abortion */
       solverData->info=-1;
@@ -1383,11 +1638,7 @@ static int newtonAlgorithm(DATA_HOMOTOPY* solverData, double* x)
       debugString(LOG_NLS_V,"UPS! assert when calculating Jacobian!!!");
       break;
     }
-    vecCopy(n, solverData->f1, solverData->fJac + n*n);
-    /* calculate scaling factor of residuals */
-    matVecMultAbsBB(solverData->n, solverData->fJac, solverData->ones, solverData->resScaling);
-    debugVectorDouble(LOG_NLS_JAC, "residuum scaling:", solverData->resScaling, solverData->n);
-    scaleMatrixRows(solverData->n, solverData->m, solverData->fJac);
+    prepareNewtonSystem(solverData);
   }
   return 0;
 }
@@ -1411,7 +1662,7 @@ static int homotopyAlgorithm(DATA_HOMOTOPY* solverData, double *x)
   int retries = 0;
   int retries2 = 0;
   int iflag = 1;
-  int pos, rank;
+  int pos;
   int iter = 0;
   int maxiter = 20;
   int numSteps = 0;
@@ -1478,14 +1729,12 @@ static int homotopyAlgorithm(DATA_HOMOTOPY* solverData, double *x)
     MMC_TRY_INTERNAL(simulationJumpBuffer)
 #endif
       solverData->hJac_dh(solverData, solverData->y0, solverData->hJac);
-      scaleMatrixRows(solverData->n, solverData->m, solverData->hJac);
       assert = 0;
-      pos = -1; /* stable solution algorithm for solving a generalized over-determined linear system */
 #ifndef OMC_EMCC
     MMC_CATCH_INTERNAL(simulationJumpBuffer)
 #endif
 
-      if (assert || (solveSystemWithTotalPivotSearch(solverData->n, solverData->dy0, solverData->hJac, solverData->indRow, solverData->indCol, &pos, &rank) != 0))
+      if (assert || (solveHomotopyTangent(solverData, &pos) != 0))
       {
         /* report solver abortion */
         solverData->info=-1;
@@ -1577,13 +1826,7 @@ static int homotopyAlgorithm(DATA_HOMOTOPY* solverData, double *x)
           stepAccept = 0;
           break;
       }
-      matVecMultAbs(solverData->n, solverData->m, solverData->hJac, solverData->ones, solverData->resScaling);
-      debugVectorDouble(LOG_NLS_HOMOTOPY, "residuum scaling of function h:", solverData->resScaling, solverData->n);
-
-      /* copy vector h to column "pos" of the jacobian */
-      vecCopy(solverData->n, solverData->hvec, solverData->hJac + pos*solverData->n);
-      scaleMatrixRows(solverData->n, solverData->m, solverData->hJac);
-      if (solveSystemWithTotalPivotSearch(solverData->n, solverData->dy1, solverData->hJac, solverData->indRow, solverData->indCol, &pos, &rank) != 0)
+      if (solveHomotopyCorrector(solverData, pos) != 0)
       {
         stepAccept = 0;
         break;
@@ -1707,8 +1950,6 @@ int solveHomotopy(DATA *data, threadData_t *threadData, int sysNumber)
   int giveUp = 0;
   int alreadyTested = 0;
   int iflag = 1;
-  int pos;
-  int rank;
   int iter;
   int maxiter = 10;
   int tries = 0;
@@ -1732,6 +1973,9 @@ int solveHomotopy(DATA *data, threadData_t *threadData, int sysNumber)
   solverData->minValue = systemData->min;
   solverData->maxValue = systemData->max;
 
+  if (!solverData->initialized)
+    initializeHomotopyJacobian(solverData);
+
   vecConst(solverData->m,1.0,solverData->ones);
 
   debugString(LOG_NLS_V, "------------------------------------------------------");
@@ -1809,17 +2053,12 @@ int solveHomotopy(DATA *data, threadData_t *threadData, int sysNumber)
       }
     }
     solverData->fJac_f(solverData, solverData->x0, solverData->fJac);
-    vecCopy(solverData->n, solverData->f1, solverData->fJac + solverData->n*solverData->n);
-    vecCopy(solverData->n*solverData->m, solverData->fJac, solverData->fJacx0);
+    storeJacobianX0(solverData, 0);
     if (mixedSystem)
       memcpy(relationsPreBackup, data->simulationInfo->relations, sizeof(modelica_boolean)*data->modelData->nRelations);
-    /* calculate scaling factor of residuals */
-    matVecMultAbsBB(solverData->n, solverData->fJac, solverData->ones, solverData->resScaling);
-    debugVectorDouble(LOG_NLS_JAC, "residuum scaling:", solverData->resScaling, solverData->n);
-    scaleMatrixRows(solverData->n, solverData->m, solverData->fJac);
+    prepareNewtonSystem(solverData);
 
-    pos = solverData->n;
-    assert = (solveSystemWithTotalPivotSearch(solverData->n, solverData->dy0, solverData->fJac, solverData->indRow, solverData->indCol, &pos, &rank) != 0);
+    assert = (solveNewtonStep(solverData) != 0);
     if (!assert)
       debugString(LOG_NLS_V, "regular initial point!!!");
     giveUp = 0;
@@ -1898,14 +2137,9 @@ int solveHomotopy(DATA *data, threadData_t *threadData, int sysNumber)
           alreadyTested = 1;
           vecCopy(solverData->n, solverData->x0, solverData->x);
           vecCopy(solverData->n, solverData->fx0, solverData->f1);
-          vecCopy(solverData->n*solverData->m, solverData->fJacx0, solverData->fJac);
-
-          /* calculate scaling factor of residuals */
-          matVecMultAbsBB(solverData->n, solverData->fJac, solverData->ones, solverData->resScaling);
-          scaleMatrixRows(solverData->n, solverData->m, solverData->fJac);
-
-          pos = solverData->n;
-          solveSystemWithTotalPivotSearch(solverData->n, solverData->dy0, solverData->fJac,   solverData->indRow, solverData->indCol, &pos, &rank);
+          storeJacobianX0(solverData, 1);
+          prepareNewtonSystem(solverData);
+          solveNewtonStep(solverData);
           debugDouble(LOG_NLS,"solve mixed system at time : ", solverData->timeValue);
           continue;
         }
@@ -1971,14 +2205,9 @@ int solveHomotopy(DATA *data, threadData_t *threadData, int sysNumber)
  #endif
       solverData->f(solverData, solverData->x, solverData->f1);
       solverData->fJac_f(solverData, solverData->x, solverData->fJac);
-      vecCopy(solverData->n, solverData->f1, solverData->fJac + solverData->n*solverData->n);
-      /* calculate scaling factor of residuals */
-      matVecMultAbsBB(solverData->n, solverData->fJac, solverData->ones, solverData->resScaling);
-      debugVectorDouble(LOG_NLS_JAC, "residuum scaling:", solverData->resScaling, solverData->n);
-      scaleMatrixRows(solverData->n, solverData->m, solverData->fJac);
-
-      pos = solverData->n;
-      assert = (solveSystemWithTotalPivotSearch(solverData->n, solverData->dy0, solverData->fJac,   solverData->indRow, solverData->indCol, &pos, &rank) != 0);
+      prepareNewtonSystem(solverData);
+
+      assert = (solveNewtonStep(solverData) != 0);
       if (!assert)
         debugString(LOG_NLS_V, "regular initial point!!!");
 #ifndef OMC_EMCC
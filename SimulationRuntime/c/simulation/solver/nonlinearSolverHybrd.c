@@ -48,8 +48,14 @@ extern "C" {
 
 #include "nonlinearSystem.h"
 #include "nonlinearSolverHybrd.h"
+#include "nonlinearSparseJacobian.h"
 extern double enorm_(integer *n, double *x);
 
+/* maximal number of iterations and smallest damping factor of the sparse
+ * Newton method before hybrj */
+#define HYBRD_SPARSE_NEWTON_MAX_ITER 50
+#define HYBRD_SPARSE_NEWTON_MIN_DAMPING 1e-4
+
 struct dataAndSys {
   DATA* data;
   threadData_t *threadData;
@@ -93,10 +99,11 @@ int allocateHybrdData(int size, void** voiddata)
   data->info = 0;
   data->nfev = 0;
   data->njev = 0;
-  data->fjac = (double*) calloc((size*size), sizeof(double));
-  data->fjacobian = (double*) calloc((size*size), sizeof(double));
+  /* dense matrices of hybrj are allocated by allocateHybrdJacobian */
+  data->fjac = NULL;
+  data->fjacobian = NULL;
   data->ldfjac = size;
-  data->r__ = (double*) malloc(((size*(size+1))/2)*sizeof(double));
+  data->r__ = NULL;
   data->lr = (size*(size + 1)) / 2;
   data->qtf = (double*) malloc(size*sizeof(double));
   data->wa1 = (double*) malloc(size*sizeof(double));
@@ -107,6 +114,8 @@ int allocateHybrdData(int size, void** voiddata)
   data->numberOfIterations = 0;
   data->numberOfFunctionEvaluations = 0;
 
+  data->sparseJac = NULL;
+
   assertStreamPrint(NULL, 0 != *voiddata, "allocationHybrdData() voiddata failed!");
   return 0;
 }
@@ -137,9 +146,29 @@ int freeHybrdData(void **voiddata)
   free(data->wa3);
   free(data->wa4);
 
+#ifdef WITH_UMFPACK
+  if(data->sparseJac)
+    freeSparseJacobian((NLS_SPARSE_JACOBIAN*) data->sparseJac);
+#endif
+
   return 0;
 }
 
+/*! \fn allocate the dense matrices of hybrj
+ *
+ *  They are allocated with the first call of hybrj, so they are never
+ *  needed if the sparse Newton iteration converges for a large system.
+ */
+static void allocateHybrdJacobian(DATA_HYBRD* data)
+{
+  integer size = data->n;
+
+  data->fjac = (double*) calloc((size*size), sizeof(double));
+  data->fjacobian = (double*) calloc((size*size), sizeof(double));
+  data->r__ = (double*) malloc(((size*(size+1))/2)*sizeof(double));
+  assertStreamPrint(NULL, 0 != data->fjac && 0 != data->fjacobian && 0 != data->r__, "allocateHybrdJacobian() failed!");
+}
+
 /*! \fn printVector
  *
  *  \param [in]  [vector]
@@ -398,6 +427,82 @@ static int wrapper_fvec_hybrj(const integer* n, const double* x, double* f, doub
   return 0;
 }
 
+#ifdef WITH_UMFPACK
+/*! \fn solve non-linear system with a damped Newton method and the klu
+ *  factorization of the sparse analytical jacobian
+ *
+ *  Used with -nlsLS=klu before hybrj, which needs the dense jacobian. The
+ *  step is halved until the residual decreases; if that fails, x is reset
+ *  and hybrj solves the system.
+ *
+ *  \return 1 if the residual or the scaled residual is below tol
+ */
+static int solveSparseNewton(struct dataAndSys* dataSys, DATA_HYBRD* solverData, double tol)
+{
+  DATA *data = dataSys->data;
+  NONLINEAR_SYSTEM_DATA* systemData = &(data->simulationInfo->nonlinearSystemData[dataSys->sysNumber]);
+  NLS_SPARSE_JACOBIAN* jac = (NLS_SPARSE_JACOBIAN*) solverData->sparseJac;
+  integer iflag = 1;
+  double xerror, xerror_scaled, xerror_new, lambda;
+  int i, k;
+
+  memcpy(solverData->xSave, solverData->x, solverData->n*sizeof(double));
+  solverData->nfev = 0;
+  solverData->njev = 0;
+
+  wrapper_fvec_hybrj(&solverData->n, solverData->x, solverData->fvec, solverData->fjac, &solverData->ldfjac, &iflag, dataSys);
+  solverData->nfev++;
+  xerror = enorm_(&solverData->n, solverData->fvec);
+
+  for(k=0; k<HYBRD_SPARSE_NEWTON_MAX_ITER; k++)
+  {
+    /* jacobian with respect to the scaled x vector */
+    evalSparseJacobian(jac, data, dataSys->threadData, systemData, solverData->useXScaling ? solverData->xScalefactors : NULL);
+    solverData->njev++;
+
+    sparseJacobianRowMax(jac, solverData->resScaling);
+    for(i=0; i<solverData->n; i++)
+    {
+      solverData->resScaling[i] = fmax(solverData->resScaling[i], 1e-16);
+      solverData->fvecScaled[i] = solverData->fvec[i] * (1 / solverData->resScaling[i]);
+    }
+    xerror_scaled = enorm_(&solverData->n, solverData->fvecScaled);
+    infoStreamPrint(LOG_NLS_V, 0, "sparse newton iteration %d: error = %g, scaled error = %g", k, xerror, xerror_scaled);
+
+    if(xerror <= tol || xerror_scaled <= tol)
+    {
+      solverData->info = 1;
+      return 1;
+    }
+
+    for(i=0; i<solverData->n; i++)
+      solverData->wa1[i] = -solverData->fvec[i];
+    if(solveSparseJacobian(jac, solverData->n, solverData->wa1))
+      break;
+
+    /* halve the step until the residual decreases */
+    memcpy(solverData->wa2, solverData->x, solverData->n*sizeof(double));
+    for(lambda=1.0; lambda>=HYBRD_SPARSE_NEWTON_MIN_DAMPING; lambda*=0.5)
+    {
+      for(i=0; i<solverData->n; i++)
+        solverData->x[i] = solverData->wa2[i] + lambda*solverData->wa1[i];
+      wrapper_fvec_hybrj(&solverData->n, solverData->x, solverData->fvec, solverData->fjac, &solverData->ldfjac, &iflag, dataSys);
+      solverData->nfev++;
+      xerror_new = enorm_(&solverData->n, solverData->fvec);
+      if(xerror_new < xerror)
+        break;
+    }
+    if(xerror_new >= xerror)
+      break;
+    xerror = xerror_new;
+  }
+
+  infoStreamPrint(LOG_NLS_V, 0, "sparse newton iteration did not converge, continue with hybrj");
+  memcpy(solverData->x, solverData->xSave, solverData->n*sizeof(double));
+  return 0;
+}
+#endif
+
 /*! \fn solve non-linear system with hybrd method
  *
  *  \param [in]  [data]
@@ -432,6 +537,10 @@ int solveHybrd(DATA *data, threadData_t *threadData, int sysNumber)
   int assertCalled = 0;
   int assertRetries = 0;
   int assertMessage = 0;
+#ifdef WITH_UMFPACK
+  int sparseTried = 0;
+#endif
+  int sparseSolved = 0;
 
   modelica_boolean* relationsPreBackup;
 
@@ -465,6 +574,15 @@ int solveHybrd(DATA *data, threadData_t *threadData, int sysNumber)
     solverData->xScalefactors[i] = fmax(fabs(solverData->x[i]), systemData->nominal[i]);
   }
 
+  if(!solverData->initialized)
+  {
+#ifdef WITH_UMFPACK
+    if(data->simulationInfo->nlsLinearSolver == NLS_LS_KLU && systemData->jacobianIndex != -1)
+      solverData->sparseJac = allocateSparseJacobian(data, threadData, systemData);
+#endif
+    solverData->initialized = 1;
+  }
+
   /* start solving loop */
   while(!giveUp && !success)
   {
@@ -499,6 +617,7 @@ int solveHybrd(DATA *data, threadData_t *threadData, int sysNumber)
     }
 
     giveUp = 1;
+    sparseSolved = 0;
 
     /* try */
     {
@@ -506,12 +625,26 @@ int solveHybrd(DATA *data, threadData_t *threadData, int sysNumber)
 #ifndef OMC_EMCC
       MMC_TRY_INTERNAL(simulationJumpBuffer)
 #endif
-      hybrj_(wrapper_fvec_hybrj, &solverData->n, solverData->x,
-          solverData->fvec, solverData->fjac, &solverData->ldfjac, &solverData->xtol,
-          &solverData->maxfev, solverData->diag, &solverData->mode, &solverData->factor,
-          &solverData->nprint, &solverData->info, &solverData->nfev, &solverData->njev, solverData->r__,
-          &solverData->lr, solverData->qtf, solverData->wa1, solverData->wa2,
-          solverData->wa3, solverData->wa4, (void*) &dataAndSysNumber);
+#ifdef WITH_UMFPACK
+      /* first try Newton's method with the sparse jacobian */
+      if(solverData->sparseJac && !sparseTried)
+      {
+        sparseTried = 1;
+        sparseSolved = solveSparseNewton(&dataAndSysNumber, solverData, local_tol);
+      }
+#endif
+      if(!sparseSolved)
+      {
+        if(!solverData->fjac)
+          allocateHybrdJacobian(solverData);
+
+        hybrj_(wrapper_fvec_hybrj, &solverData->n, solverData->x,
+            solverData->fvec, solverData->fjac, &solverData->ldfjac, &solverData->xtol,
+            &solverData->maxfev, solverData->diag, &solverData->mode, &solverData->factor,
+            &solverData->nprint, &solverData->info, &solverData->nfev, &solverData->njev, solverData->r__,
+            &solverData->lr, solverData->qtf, solverData->wa1, solverData->wa2,
+            solverData->wa3, solverData->wa4, (void*) &dataAndSysNumber);
+      }
 
       success = 1;
       if(assertCalled)
@@ -623,11 +756,15 @@ int solveHybrd(DATA *data, threadData_t *threadData, int sysNumber)
       {
         int l=0;
         for(i=0; i<solverData->n; i++){
-          solverData->resScaling[i] = 1e-16;
-          for(j=0; j<solverData->n; j++){
-            solverData->resScaling[i] = (fabs(solverData->fjacobian[l]) > solverData->resScaling[i])
-                    ? fabs(solverData->fjacobian[l]) : solverData->resScaling[i];
-            l++;
+          /* the sparse Newton iteration computed resScaling already */
+          if(!sparseSolved)
+          {
+            solverData->resScaling[i] = 1e-16;
+            for(j=0; j<solverData->n; j++){
+              solverData->resScaling[i] = (fabs(solverData->fjacobian[l]) > solverData->resScaling[i])
+                      ? fabs(solverData->fjacobian[l]) : solverData->resScaling[i];
+              l++;
+            }
           }
           solverData->fvecScaled[i] = solverData->fvec[i] * (1 / solverData->resScaling[i]);
         }
@@ -645,7 +782,7 @@ int solveHybrd(DATA *data, threadData_t *threadData, int sysNumber)
         }
 
         /* debug output */
-        if(ACTIVE_STREAM(LOG_NLS_JAC))
+        if(ACTIVE_STREAM(LOG_NLS_JAC) && !sparseSolved)
         {
           char *buffer = (char*)malloc(sizeof(char)*solverData->n*15);
 
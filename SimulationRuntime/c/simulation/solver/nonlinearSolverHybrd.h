@@ -97,6 +97,8 @@ typedef struct DATA_HYBRD
   unsigned int numberOfIterations; /* over the whole simulation time */
   unsigned int numberOfFunctionEvaluations; /* over the whole simulation time */
 
+  void* sparseJac; /* NLS_SPARSE_JACOBIAN of the sparse Newton iteration with -nlsLS=klu */
+
 } DATA_HYBRD;
 
 #ifdef __cplusplus
@@ -0,0 +1,342 @@
+/*
+ * This file is part of OpenModelica.
+ *
+ * Copyright (c) 1998-CurrentYear, Open Source Modelica Consortium (OSMC),
+ * c/o Linköpings universitet, Department of Computer and Information Science,
+ * SE-58183 Linköping, Sweden.
+ *
+ * All rights reserved.
+ *
+ * THIS PROGRAM IS PROVIDED UNDER THE TERMS OF THE BSD NEW LICENSE OR THE
+ * GPL VERSION 3 LICENSE OR THE OSMC PUBLIC LICENSE (OSMC-PL) VERSION 1.2.
+ * ANY USE, REPRODUCTION OR DISTRIBUTION OF THIS PROGRAM CONSTITUTES
+ * RECIPIENT'S ACCEPTANCE OF THE OSMC PUBLIC LICENSE OR THE GPL VERSION 3,
+ * ACCORDING TO RECIPIENTS CHOICE.
+ *
+ * The OpenModelica software and the OSMC (Open Source Modelica Consortium)
+ * Public License (OSMC-PL) are obtained from OSMC, either from the above
+ * address, from the URLs: http://www.openmodelica.org or
+ * http://www.ida.liu.se/projects/OpenModelica, and in the OpenModelica
+ * distribution. GNU version 3 is obtained from:
+ * http://www.gnu.org/copyleft/gpl.html. The New BSD License is obtained from:
+ * http://www.opensource.org/licenses/BSD-3-Clause.
+ *
+ * This program is distributed WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, EXCEPT AS
+ * EXPRESSLY SET FORTH IN THE BY RECIPIENT SELECTED SUBSIDIARY LICENSE
+ * CONDITIONS OF OSMC-PL.
+ *
+ */
+
+/*! \file nonlinearSparseJacobian.c
+ */
+
+#include "omc_config.h"
+
+#ifdef WITH_UMFPACK
+#include <math.h>
+#include <float.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "simulation_data.h"
+#include "util/omc_error.h"
+#include "model_help.h"
+
+#include "nonlinearSparseJacobian.h"
+
+/* smallest reciprocal condition number for which a numeric refactorization
+ * with the pivoting of the last factorization is accepted */
+#define NLS_KLU_MIN_RCOND 1e-12
+
+/*! \fn allocateSparseJacobian
+ *
+ *  assembles the pattern of the jacobian (plus the diagonal) in CSC format
+ *  from the sparse pattern of the analytical jacobian and analyses it
+ *  with klu
+ */
+NLS_SPARSE_JACOBIAN* allocateSparseJacobian(DATA *data, threadData_t *threadData, NONLINEAR_SYSTEM_DATA *systemData)
+{
+  const SPARSE_PATTERN *pattern = &data->simulationInfo->analyticJacobians[systemData->jacobianIndex].sparsePattern;
+  const int n = systemData->size;
+  NLS_SPARSE_JACOBIAN *jac = (NLS_SPARSE_JACOBIAN*) calloc(1, sizeof(NLS_SPARSE_JACOBIAN));
+  unsigned int *rows, *pos;
+  unsigned int i, j, k, l, m, start;
+  int hasDiag;
+
+  assertStreamPrint(threadData, 0 != jac, "out of memory");
+  jac->n = n;
+  jac->Ap = (int*) malloc((n+1)*sizeof(int));
+  jac->Ai = (int*) malloc((pattern->numberOfNoneZeros + n)*sizeof(int));
+  jac->map = (unsigned int*) malloc(modelica_integer_max(1, pattern->numberOfNoneZeros)*sizeof(unsigned int));
+  jac->diag = (int*) malloc(n*sizeof(int));
+  jac->column = (double*) calloc(n, sizeof(double));
+  /* rows and pattern positions of one column, sorted by row */
+  rows = (unsigned int*) malloc((n+1)*sizeof(unsigned int));
+  pos = (unsigned int*) malloc((n+1)*sizeof(unsigned int));
+  assertStreamPrint(threadData, jac->Ap && jac->Ai && jac->map && jac->diag && jac->column && rows && pos, "out of memory");
+
+  k = 0;
+  for(i = 0; i < (unsigned int) n; i++)
+  {
+    start = (i == 0) ? 0 : pattern->leadindex[i-1];
+    m = 0;
+    hasDiag = 0;
+    for(j = start; j < pattern->leadindex[i]; j++)
+    {
+      for(l = m; l > 0 && rows[l-1] > pattern->index[j]; l--)
+      {
+        rows[l] = rows[l-1];
+        pos[l] = pos[l-1];
+      }
+      rows[l] = pattern->index[j];
+      pos[l] = j;
+      hasDiag |= (pattern->index[j] == i);
+      m++;
+    }
+    if(!hasDiag)
+    {
+      for(l = m; l > 0 && rows[l-1] > i; l--)
+      {
+        rows[l] = rows[l-1];
+        pos[l] = pos[l-1];
+      }
+      rows[l] = i;
+      pos[l] = (unsigned int) -1;
+      m++;
+    }
+
+    jac->Ap[i] = k;
+    for(l = 0; l < m; l++, k++)
+    {
+      jac->Ai[k] = rows[l];
+      if(rows[l] == i)
+        jac->diag[i] = k;
+      if(pos[l] != (unsigned int) -1)
+        jac->map[pos[l]] = k;
+    }
+  }
+  jac->Ap[n] = k;
+  jac->nnz = k;
+  jac->Ax = (double*) calloc(modelica_integer_max(1, k), sizeof(double));
+  /* a replaced column is dense */
+  jac->Bp = (int*) malloc((n+1)*sizeof(int));
+  jac->Bi = (int*) malloc((k + n)*sizeof(int));
+  jac->Bx = (double*) malloc((k + n)*sizeof(double));
+  assertStreamPrint(threadData, jac->Ax && jac->Bp && jac->Bi && jac->Bx, "out of memory");
+  free(rows);
+  free(pos);
+
+  klu_defaults(&jac->common);
+  jac->jac.pos = n;
+  jac->jac.symbolic = klu_analyze(n, jac->Ap, jac->Ai, &jac->common);
+  if (NULL == jac->jac.symbolic)
+  {
+    throwStreamPrint(threadData, "klu could not analyse the jacobian of nonlinear system %ld (status %d).", (long)systemData->equationIndex, jac->common.status);
+  }
+  jac->nAnalyze++;
+  jac->bordered.pos = -1;
+
+  infoStreamPrint(LOG_NLS, 0, "jacobian of nonlinear system %ld for klu: %d unknowns, %d nonzero elements", (long)systemData->equationIndex, n, jac->nnz);
+
+  return jac;
+}
+
+static void freeFactor(NLS_SPARSE_JACOBIAN *jac, NLS_KLU_FACTOR *factor)
+{
+  if(factor->numeric)
+    klu_free_numeric(&factor->numeric, &jac->common);
+  if(factor->symbolic)
+    klu_free_symbolic(&factor->symbolic, &jac->common);
+}
+
+/*! \fn freeSparseJacobian
+ */
+void freeSparseJacobian(NLS_SPARSE_JACOBIAN *jac)
+{
+  infoStreamPrint(LOG_NLS, 0, "klu analyses of the jacobian: %lu, factorizations: %lu, refactorizations: %lu", jac->nAnalyze, jac->nFactor, jac->nRefactor);
+  freeFactor(jac, &jac->jac);
+  freeFactor(jac, &jac->bordered);
+  free(jac->Ap);
+  free(jac->Ai);
+  free(jac->Ax);
+  free(jac->map);
+  free(jac->diag);
+  free(jac->column);
+  free(jac->Bp);
+  free(jac->Bi);
+  free(jac->Bx);
+  free(jac);
+}
+
+/*! \fn evalSparseJacobian
+ *
+ *  calculates the colored analytical jacobian at the current values of
+ *  the variables and stores it in Ax; column j is multiplied by
+ *  xScaling[j] if xScaling is given
+ */
+void evalSparseJacobian(NLS_SPARSE_JACOBIAN *jac, DATA *data, threadData_t *threadData, NONLINEAR_SYSTEM_DATA *systemData, const double *xScaling)
+{
+  ANALYTIC_JACOBIAN *analyticJacobian = &data->simulationInfo->analyticJacobians[systemData->jacobianIndex];
+  const SPARSE_PATTERN *pattern = &analyticJacobian->sparsePattern;
+  unsigned int i, j, ii;
+  double scale;
+
+  /* the diagonal elements which are not part of the pattern stay zero */
+  memset(jac->Ax, 0, jac->nnz*sizeof(double));
+
+  for(i = 0; i < pattern->maxColors; i++)
+  {
+    for(ii = 0; ii < analyticJacobian->sizeCols; ii++)
+      if(pattern->colorCols[ii]-1 == i)
+        analyticJacobian->seedVars[ii] = 1;
+
+    systemData->analyticalJacobianColumn(data, threadData);
+
+    for(ii = 0; ii < analyticJacobian->sizeCols; ii++)
+    {
+      if(analyticJacobian->seedVars[ii] == 1)
+      {
+        scale = xScaling ? xScaling[ii] : 1.0;
+        for(j = (ii == 0) ? 0 : pattern->leadindex[ii-1]; j < pattern->leadindex[ii]; j++)
+        {
+          jac->Ax[jac->map[j]] = analyticJacobian->resultVars[pattern->index[j]] * scale;
+        }
+        analyticJacobian->seedVars[ii] = 0;
+      }
+    }
+  }
+}
+
+/*! \fn sparseJacobianRowSums
+ *
+ *  sums of the absolute values of every row of the jacobian, including
+ *  the additional column if withColumn is set
+ */
+void sparseJacobianRowSums(NLS_SPARSE_JACOBIAN *jac, int withColumn, double *sums)
+{
+  int i, k;
+
+  for(i = 0; i < jac->n; i++)
+    sums[i] = withColumn ? fabs(jac->column[i]) : 0.0;
+  for(k = 0; k < jac->nnz; k++)
+    sums[jac->Ai[k]] += fabs(jac->Ax[k]);
+}
+
+/*! \fn sparseJacobianRowMax
+ *
+ *  largest absolute value of every row of the jacobian
+ */
+void sparseJacobianRowMax(NLS_SPARSE_JACOBIAN *jac, double *rowMax)
+{
+  int i, k;
+
+  for(i = 0; i < jac->n; i++)
+    rowMax[i] = 0.0;
+  for(k = 0; k < jac->nnz; k++)
+    rowMax[jac->Ai[k]] = fmax(rowMax[jac->Ai[k]], fabs(jac->Ax[k]));
+}
+
+/*
+ * factorizes the matrix; the numeric factorization is reused by
+ * klu_refactor as long as its pivots are acceptable
+ */
+static int factorSparse(NLS_SPARSE_JACOBIAN *jac, NLS_KLU_FACTOR *factor, int *Ap, int *Ai, double *Ax)
+{
+  if (factor->numeric)
+  {
+    if (klu_refactor(Ap, Ai, Ax, factor->symbolic, factor->numeric, &jac->common) &&
+        klu_rcond(factor->symbolic, factor->numeric, &jac->common) &&
+        jac->common.rcond > NLS_KLU_MIN_RCOND)
+    {
+      jac->nRefactor++;
+      return 0;
+    }
+    klu_free_numeric(&factor->numeric, &jac->common);
+  }
+
+  factor->numeric = klu_factor(Ap, Ai, Ax, factor->symbolic, &jac->common);
+  jac->nFactor++;
+  if (NULL == factor->numeric || KLU_OK != jac->common.status ||
+      !klu_rcond(factor->symbolic, factor->numeric, &jac->common) || jac->common.rcond < DBL_EPSILON)
+  {
+    infoStreamPrint(LOG_NLS_V, 0, "klu failed to factorize the jacobian (status %d)", jac->common.status);
+    if (factor->numeric)
+      klu_free_numeric(&factor->numeric, &jac->common);
+    return 1;
+  }
+  return 0;
+}
+
+/*! \fn solveSparseJacobian
+ *
+ *  solves B*z = b, b is overwritten by z. B is the jacobian with column
+ *  pos replaced by the additional column, or the jacobian itself if pos
+ *  equals n; so z[pos] is the coefficient of the additional column.
+ *
+ *  The pattern of B only changes with pos, hence the symbolic analysis
+ *  of the jacobian and of the last bordered matrix are reused.
+ *
+ *  \return 0 on success, 1 if the matrix is singular
+ */
+int solveSparseJacobian(NLS_SPARSE_JACOBIAN *jac, int pos, double *b)
+{
+  NLS_KLU_FACTOR *factor = &jac->jac;
+  int *Ap = jac->Ap, *Ai = jac->Ai;
+  double *Ax = jac->Ax;
+  int i, j, k, p;
+
+  if(pos < jac->n)
+  {
+    factor = &jac->bordered;
+    Ap = jac->Bp;
+    Ai = jac->Bi;
+    Ax = jac->Bx;
+
+    for(j = 0, k = 0; j < jac->n; j++)
+    {
+      Ap[j] = k;
+      if(j == pos)
+      {
+        for(i = 0; i < jac->n; i++, k++)
+        {
+          Ai[k] = i;
+          Ax[k] = jac->column[i];
+        }
+      }
+      else
+      {
+        for(p = jac->Ap[j]; p < jac->Ap[j+1]; p++, k++)
+        {
+          Ai[k] = jac->Ai[p];
+          Ax[k] = jac->Ax[p];
+        }
+      }
+    }
+    Ap[jac->n] = k;
+
+    if(factor->pos != pos)
+    {
+      freeFactor(jac, factor);
+      factor->pos = pos;
+      factor->symbolic = klu_analyze(jac->n, Ap, Ai, &jac->common);
+      jac->nAnalyze++;
+      if (NULL == factor->symbolic)
+      {
+        factor->pos = -1;
+        infoStreamPrint(LOG_NLS_V, 0, "klu could not analyse the bordered jacobian (status %d)", jac->common.status);
+        return 1;
+      }
+    }
+  }
+
+  if(factorSparse(jac, factor, Ap, Ai, Ax))
+    return 1;
+
+  if(!klu_solve(factor->symbolic, factor->numeric, jac->n, 1, b, &jac->common))
+    return 1;
+
+  return 0;
+}
+
+#endif
@@ -0,0 +1,99 @@
+/*
+ * This file is part of OpenModelica.
+ *
+ * Copyright (c) 1998-CurrentYear, Open Source Modelica Consortium (OSMC),
+ * c/o Linköpings universitet, Department of Computer and Information Science,
+ * SE-58183 Linköping, Sweden.
+ *
+ * All rights reserved.
+ *
+ * THIS PROGRAM IS PROVIDED UNDER THE TERMS OF THE BSD NEW LICENSE OR THE
+ * GPL VERSION 3 LICENSE OR THE OSMC PUBLIC LICENSE (OSMC-PL) VERSION 1.2.
+ * ANY USE, REPRODUCTION OR DISTRIBUTION OF THIS PROGRAM CONSTITUTES
+ * RECIPIENT'S ACCEPTANCE OF THE OSMC PUBLIC LICENSE OR THE GPL VERSION 3,
+ * ACCORDING TO RECIPIENTS CHOICE.
+ *
+ * The OpenModelica software and the OSMC (Open Source Modelica Consortium)
+ * Public License (OSMC-PL) are obtained from OSMC, either from the above
+ * address, from the URLs: http://www.openmodelica.org or
+ * http://www.ida.liu.se/projects/OpenModelica, and in the OpenModelica
+ * distribution. GNU version 3 is obtained from:
+ * http://www.gnu.org/copyleft/gpl.html. The New BSD License is obtained from:
+ * http://www.opensource.org/licenses/BSD-3-Clause.
+ *
+ * This program is distributed WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, EXCEPT AS
+ * EXPRESSLY SET FORTH IN THE BY RECIPIENT SELECTED SUBSIDIARY LICENSE
+ * CONDITIONS OF OSMC-PL.
+ *
+ */
+
+/*! \file nonlinearSparseJacobian.h
+ *
+ *  klu factorization of the colored analytical jacobian of a nonlinear
+ *  system, used by the homotopy and the hybrid solver with -nlsLS=klu.
+ */
+
+#include "omc_config.h"
+
+#ifdef WITH_UMFPACK
+#ifndef _NONLINEARSPARSEJACOBIAN_H_
+#define _NONLINEARSPARSEJACOBIAN_H_
+
+#include "simulation_data.h"
+#include "suitesparse/Include/klu.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* klu data of one bordered matrix, see solveSparseJacobian */
+typedef struct NLS_KLU_FACTOR
+{
+  int pos;                      /* replaced column, n if the matrix is the jacobian itself */
+  klu_symbolic *symbolic;       /* analysed once for every value of pos */
+  klu_numeric *numeric;
+} NLS_KLU_FACTOR;
+
+/* jacobian of a nonlinear system in CSC format */
+typedef struct NLS_SPARSE_JACOBIAN
+{
+  int n;
+  int nnz;
+  int *Ap;
+  int *Ai;
+  double *Ax;
+  unsigned int *map;            /* position in Ax of every element of the sparse pattern */
+  int *diag;                    /* position in Ax of the diagonal element of every column */
+  double *column;               /* additional column of the bordered system, e.g. dh/dlambda */
+
+  /* the matrix passed to klu if a column is replaced by column */
+  int *Bp;
+  int *Bi;
+  double *Bx;
+
+  klu_common common;
+  NLS_KLU_FACTOR jac;           /* factorization of the jacobian */
+  NLS_KLU_FACTOR bordered;      /* factorization of the last bordered matrix */
+
+  unsigned long nAnalyze;
+  unsigned long nFactor;
+  unsigned long nRefactor;
+} NLS_SPARSE_JACOBIAN;
+
+NLS_SPARSE_JACOBIAN* allocateSparseJacobian(DATA *data, threadData_t *threadData, NONLINEAR_SYSTEM_DATA *systemData);
+void freeSparseJacobian(NLS_SPARSE_JACOBIAN *jac);
+
+void evalSparseJacobian(NLS_SPARSE_JACOBIAN *jac, DATA *data, threadData_t *threadData, NONLINEAR_SYSTEM_DATA *systemData, const double *xScaling);
+
+void sparseJacobianRowSums(NLS_SPARSE_JACOBIAN *jac, int withColumn, double *sums);
+void sparseJacobianRowMax(NLS_SPARSE_JACOBIAN *jac, double *rowMax);
+
+int solveSparseJacobian(NLS_SPARSE_JACOBIAN *jac, int pos, double *b);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+#endif
@@ -161,8 +161,7 @@ int print_csvLineCallStats(OMC_WRITE_CSV* csvData, int num, double time,
   fputc(csvData->seperator,csvData->handle);
 
   /* simulation time */
-  sprintf(buffer, "%g", time);
-  omc_write_csv(csvData, buffer);
+  omc_write_csv_real(csvData, time);
   fputc(csvData->seperator,csvData->handle);
 
   /* solving iterations */
@@ -285,41 +284,34 @@ int print_csvLineIterStats(void* voidCsvData, int size, int num,
 
   /* x */
   for(j=0; j<size; ++j) {
-    sprintf(buffer, "%g", x[j]);
-    omc_write_csv(csvData, buffer);
+    omc_write_csv_real(csvData, x[j]);
     fputc(csvData->seperator,csvData->handle);
   }
 
   /* r */
   for(j=0; j<size; ++j) {
-    sprintf(buffer, "%g", f[j]);
-    omc_write_csv(csvData, buffer);
+    omc_write_csv_real(csvData, f[j]);
     fputc(csvData->seperator,csvData->handle);
   }
 
   /* error_f */
-  sprintf(buffer, "%g", error_f);
-  omc_write_csv(csvData, buffer);
+  omc_write_csv_real(csvData, error_f);
   fputc(csvData->seperator,csvData->handle);
 
   /* error_f */
-  sprintf(buffer, "%g", error_fs);
-  omc_write_csv(csvData, buffer);
+  omc_write_csv_real(csvData, error_fs);
   fputc(csvData->seperator,csvData->handle);
 
   /* delta_x */
-  sprintf(buffer, "%g", delta_x);
-  omc_write_csv(csvData, buffer);
+  omc_write_csv_real(csvData, delta_x);
   fputc(csvData->seperator,csvData->handle);
 
   /* delta_xs */
-  sprintf(buffer, "%g", delta_xs);
-  omc_write_csv(csvData, buffer);
+  omc_write_csv_real(csvData, delta_xs);
   fputc(csvData->seperator,csvData->handle);
 
   /* lambda */
-  sprintf(buffer, "%g", lambda);
-  omc_write_csv(csvData, buffer);
+  omc_write_csv_real(csvData, lambda);
 
   /* finish line */
   fputc('\n',csvData->handle);
@@ -369,7 +361,7 @@ int initializeNonlinearSystems(DATA *data, threadData_t *threadData)
     nonlinsys[i].nlsxOld = (double*) malloc(size*sizeof(double));
 
     /* allocate value list*/
-    nonlinsys[i].oldValueList = (void*) allocValueList(1);
+    nonlinsys[i].oldValueList = (void*) allocValueList(size);
 
     nonlinsys[i].nominal = (double*) malloc(size*sizeof(double));
     nonlinsys[i].min = (double*) malloc(size*sizeof(double));
@@ -481,7 +473,7 @@ int freeNonlinearSystems(DATA *data, threadData_t *threadData)
     free(nonlinsys[i].nominal);
     free(nonlinsys[i].min);
     free(nonlinsys[i].max);
-    freeValueList(nonlinsys[i].oldValueList, 1);
+    freeValueList(nonlinsys[i].oldValueList);
 
 #if !defined(OMC_MINIMAL_RUNTIME)
     if (data->simulationInfo->nlsCsvInfomation)
@@ -573,7 +565,7 @@ int solve_nonlinear_system(DATA *data, threadData_t *threadData, int sysNumber)
   infoStreamPrint(LOG_NLS_EXTRAPOLATE, 1, "############ Start new iteration for system %d at time at %g ############", sysNumber, data->localData[0]->timeValue);
   printValuesListTimes((VALUES_LIST*)nonlinsys->oldValueList);
   /* if list is empty use current start values */
-  if (listLen(((VALUES_LIST*)nonlinsys->oldValueList)->valueList)==0)
+  if (((VALUES_LIST*)nonlinsys->oldValueList)->length == 0)
   {
 	memcpy(nonlinsys->nlsxOld, nonlinsys->nlsx, nonlinsys->size*(sizeof(double)));
 	memcpy(nonlinsys->nlsxExtrapolation, nonlinsys->nlsx, nonlinsys->size*(sizeof(double)));
@@ -679,8 +671,7 @@ int solve_nonlinear_system(DATA *data, threadData_t *threadData, int sysNumber)
     /* do not use solution of jacobian for next extrapolation */
     if (data->simulationInfo->currentContext < 4)
     {
-      addListElement((VALUES_LIST*)nonlinsys->oldValueList,
-              createValueElement(nonlinsys->size, data->localData[0]->timeValue, nonlinsys->nlsx));
+      addListElement((VALUES_LIST*)nonlinsys->oldValueList, data->localData[0]->timeValue, nonlinsys->nlsx);
     }
   }
   messageClose(LOG_NLS_EXTRAPOLATE);
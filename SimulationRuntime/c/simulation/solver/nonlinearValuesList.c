@@ -29,309 +29,278 @@
 *
 */
 
-/*! \file nonlinearValuesList.h
+/*! \file nonlinearValuesList.c
  * Description: This is a C implementation of a value database
- *              based on a list. It's purpose is to be used by a
- *              a non-linear solver in OpenModelica in order to
- *              guess next value by extrapolation or interpolation.
+ *              based on a fixed-size history per system. It's purpose
+ *              is to be used by a non-linear solver in OpenModelica in
+ *              order to guess next value by polynomial extrapolation of
+ *              the last solutions.
  *              Assuming time passes forward.
  *
  */
 
 #include "nonlinearValuesList.h"
 
-#include "util/list.h"
 #include "util/omc_error.h"
 
+#include <float.h>
+#include <math.h>
 #include <stdlib.h>
 #include <string.h>
 
-/* Forward extrapolate function definition */
-double extrapolateValues(const double, const double, const double, const double, const double);
-
-VALUES_LIST* allocValueList(unsigned int numberOfList)
+VALUES_LIST* allocValueList(unsigned int size)
 {
-  unsigned int i = 0;
-  VALUES_LIST* valueList = (VALUES_LIST*) malloc(numberOfList*sizeof(VALUES_LIST));
+  VALUES_LIST* valueList = (VALUES_LIST*) malloc(sizeof(VALUES_LIST));
 
-  for(i=0; i<numberOfList; ++i){
-    (valueList+i)->valueList = allocList(sizeof(VALUE));
-  }
+  assertStreamPrint(NULL, NULL != valueList, "out of memory");
+  valueList->size = size;
+  valueList->length = 0;
+  valueList->order = 1;
+  valueList->time = (double*) malloc(VALUES_LIST_CAPACITY*sizeof(double));
+  valueList->values = (double*) malloc(VALUES_LIST_CAPACITY*size*sizeof(double));
+  assertStreamPrint(NULL, valueList->time && (valueList->values || !size), "out of memory");
 
   return valueList;
 }
 
-void freeValueList(VALUES_LIST *valueList, unsigned int numberOfList)
+void freeValueList(VALUES_LIST *valueList)
+{
+  free(valueList->time);
+  free(valueList->values);
+  free(valueList);
+}
+
+/* position of the newest element that is not later than time; length if there is none */
+static unsigned int findElement(VALUES_LIST *valueList, double time)
 {
-  VALUE* elem;
-  VALUES_LIST *tmpList;
+  unsigned int i;
 
-  int i,j;
-  for(j = 0; j < numberOfList; ++j)
+  for(i = 0; i < valueList->length; ++i)
   {
-    tmpList = valueList+j;
-    for(i = 0; i < listLen(tmpList->valueList); ++i)
+    if (valueList->time[i] <= time)
     {
-      elem = (VALUE*) listFirstData(tmpList->valueList);
-      listPopFront(tmpList->valueList);
+      break;
     }
-    freeList(tmpList->valueList);
   }
-  free(valueList);
+  return i;
 }
 
-void cleanValueList(VALUES_LIST *valueList, LIST_NODE *startNode)
+/*! \fn extrapolationWeights
+ *
+ *  computes the weights of the Lagrange polynomial through the elements
+ *  first..first+order at the given time. The order is reduced if two of
+ *  the elements are too close to each other.
+ *
+ *  \return order of the polynomial
+ */
+static unsigned int extrapolationWeights(VALUES_LIST *valueList, unsigned int first, unsigned int order, double time, double *weights)
 {
-  LIST_NODE *next, *node;
-  VALUE* elem;
+  const double *t = valueList->time + first;
+  const double minDistance = 100*DBL_EPSILON*fmax(1.0, fabs(time));
+  unsigned int k, m;
 
-  int i, j;
-  next = listNextNode(startNode);
-  /* clean list from next node */
-  infoStreamPrint(LOG_NLS_EXTRAPOLATE, 0, "cleanValueList length: %d", listLen(valueList->valueList));
-  updateNodeNext(valueList->valueList, startNode, NULL);
+  for(k = 0; k < order; ++k)
+  {
+    if (t[k] - t[k+1] <= minDistance)
+    {
+      order = k;
+      break;
+    }
+  }
 
-  removeNodes(valueList->valueList, next);
+  for(k = 0; k <= order; ++k)
+  {
+    weights[k] = 1.0;
+    for(m = 0; m <= order; ++m)
+    {
+      if (m != k)
+      {
+        weights[k] *= (time - t[m]) / (t[k] - t[m]);
+      }
+    }
+  }
+  return order;
 }
 
-void cleanValueListbyTime(VALUES_LIST *valueList, double time)
+/* evaluates the polynomial through the elements first..first+order at the given time */
+static void extrapolateValues(VALUES_LIST *valueList, unsigned int first, unsigned int order, double time, double *result)
 {
-  LIST_NODE *next, *node;
-  VALUE* elem;
+  double weights[VALUES_LIST_MAX_ORDER+1];
+  const double *values = valueList->values + first*valueList->size;
+  unsigned int i, k;
 
-  /*  if it's empty anyway */
-  if (listLen(valueList->valueList) == 0)
+  order = extrapolationWeights(valueList, first, order, time, weights);
+  for(i = 0; i < valueList->size; ++i)
   {
-    return;
+    result[i] = weights[0]*values[i];
+    for(k = 1; k <= order; ++k)
+    {
+      result[i] += weights[k]*values[k*valueList->size+i];
+    }
   }
-  printValuesListTimes(valueList);
-  node = listFirstNode(valueList->valueList);
-  do
+}
+
+/*! \fn selectOrder
+ *
+ *  predicts the new solution with every possible order from the stored
+ *  elements and keeps the order with the smallest relative error for the
+ *  next extrapolation. So a polynomial that overshoots (e.g. close to a
+ *  kink of the solution) falls back to a lower order and a smooth solution
+ *  gets the higher orders.
+ */
+static void selectOrder(VALUES_LIST *valueList, double time, const double *values)
+{
+  double weights[VALUES_LIST_MAX_ORDER+1];
+  double error, bestError = -1.0;
+  unsigned int maxOrder = valueList->length - 1, order, usedOrder, i, k;
+
+  if (maxOrder > VALUES_LIST_MAX_ORDER)
+  {
+    maxOrder = VALUES_LIST_MAX_ORDER;
+  }
+
+  for(order = 0; order <= maxOrder; ++order)
   {
-    elem = ((VALUE*)listNodeData(node));
-    next = listNextNode(node);
-    /*  if next node is empty */
-    if (!next)
+    usedOrder = extrapolationWeights(valueList, 0, order, time, weights);
+    if (usedOrder < order)
     {
-      return;
+      break;
     }
-    if (elem->time <= time)
+
+    error = 0.0;
+    for(i = 0; i < valueList->size; ++i)
     {
-      break;
+      double prediction = weights[0]*valueList->values[i];
+      double scale = fabs(values[i]) + fabs(valueList->values[i]);
+      for(k = 1; k <= order; ++k)
+      {
+        prediction += weights[k]*valueList->values[k*valueList->size+i];
+      }
+      if (scale > 0.0)
+      {
+        error = fmax(error, fabs(prediction - values[i]) / scale);
+      }
     }
-    /* debug output */
-    infoStreamPrint(LOG_NLS_EXTRAPOLATE, 0, "cleanValueListbyTime %g check element: ", time);
-    printValueElement(elem);
-
-    freeNode(node);
-    updatelistFirst(valueList->valueList, next);
-    updatelistLength(valueList->valueList, listLen(valueList->valueList)-1);
-    node = next;
-  }while(1);
-  cleanValueList(valueList, node);
-  infoStreamPrint(LOG_NLS_EXTRAPOLATE, 0, "New list length %d: ", listLen(valueList->valueList));
-  printValuesListTimes(valueList);
-  infoStreamPrint(LOG_NLS_EXTRAPOLATE, 0, "Done!");
+
+    if (bestError < 0.0 || error < bestError)
+    {
+      bestError = error;
+      valueList->order = order;
+    }
+  }
+  infoStreamPrint(LOG_NLS_EXTRAPOLATE, 0, "extrapolation order %u (relative error %g)", valueList->order, bestError);
 }
 
-VALUE* createValueElement(unsigned int size, double time, double* values)
+void cleanValueListbyTime(VALUES_LIST *valueList, double time)
 {
-  VALUE* elem = (VALUE*) malloc(sizeof(VALUE));
-  elem->values = (double*) malloc(size*sizeof(double));
-  elem->time = time;
-  elem->size = size;
-
-  memcpy(elem->values, values, size*sizeof(double));
+  unsigned int i;
 
-  /* debug output */
-  infoStreamPrint(LOG_NLS_EXTRAPOLATE, 1, "Create Element");
-  messageClose(LOG_NLS_EXTRAPOLATE);
+  /*  if it's empty anyway */
+  if (valueList->length == 0)
+  {
+    return;
+  }
+  printValuesListTimes(valueList);
 
-  return elem;
-}
+  /* keep only the newest element that is not later than time, the
+   * elements before an event are not used to extrapolate after it */
+  i = findElement(valueList, time);
+  if (i == valueList->length)
+  {
+    i = valueList->length - 1;
+  }
+  if (i > 0)
+  {
+    valueList->time[0] = valueList->time[i];
+    memcpy(valueList->values, valueList->values + i*valueList->size, valueList->size*sizeof(double));
+  }
+  valueList->length = 1;
 
-void freeValue(VALUE* elem)
-{
-  free(elem->values);
-  free(elem);
+  infoStreamPrint(LOG_NLS_EXTRAPOLATE, 0, "cleanValueListbyTime %g: kept element at time %g", time, valueList->time[0]);
 }
 
-void addListElement(VALUES_LIST* valuesList, VALUE* newElem)
+void addListElement(VALUES_LIST* valueList, double time, const double* values)
 {
-  LIST_NODE *node, *next;
-  VALUE* elem;
-  int replace = 0, i = 0;
+  const unsigned int size = valueList->size;
+  unsigned int i, n;
 
   /* debug output */
-  infoStreamPrint(LOG_NLS_EXTRAPOLATE, 1, "Adding element in a list of size %d", listLen(valuesList->valueList));
-  printValueElement(newElem);
+  infoStreamPrint(LOG_NLS_EXTRAPOLATE, 1, "Adding element at time %g in a list of size %u", time, valueList->length);
 
-  /*  if it's empty, just push in  */
-  if (listLen(valuesList->valueList) == 0)
+  i = findElement(valueList, time);
+  if (i < valueList->length && valueList->time[i] == time)
   {
-    infoStreamPrint(LOG_NLS_EXTRAPOLATE, 0, "List is empty add just.");
-    listPushFront(valuesList->valueList, (void*) newElem);
-
+    infoStreamPrint(LOG_NLS_EXTRAPOLATE, 0, "replace element.");
+    memcpy(valueList->values + i*size, values, size*sizeof(double));
     messageClose(LOG_NLS_EXTRAPOLATE);
     return;
   }
 
-  /*  if the element at begin is earlier than current
-   *  push the element just in front and if the end element
-   *  is later than current push it just back.*/
-  node = listFirstNode(valuesList->valueList);
-  if (((VALUE*)listNodeData(node))->time < newElem->time)
+  if (i == 0 && valueList->length > 1)
   {
-    infoStreamPrint(LOG_NLS_EXTRAPOLATE, 0, "First Value list element is:");
-    printValueElement(((VALUE*)listNodeData(node)));
-    infoStreamPrint(LOG_NLS_EXTRAPOLATE, 0, "so new element is added before.");
-    listPushFront(valuesList->valueList, (void*) newElem);
-
+    /* a step forward in time, check how well the history predicted it */
+    selectOrder(valueList, time, values);
+  }
+  else if (i == VALUES_LIST_CAPACITY)
+  {
+    infoStreamPrint(LOG_NLS_EXTRAPOLATE, 0, "element is older than the whole history, skip it.");
     messageClose(LOG_NLS_EXTRAPOLATE);
     return;
   }
 
-  infoStreamPrint(LOG_NLS_EXTRAPOLATE, 0, "Search position of new element");
-  /* search correct position */
-  next = node;
-  do
-  {
-    /*  if next node is empty */
-    if (!next)
-    {
-      infoStreamPrint(LOG_NLS_EXTRAPOLATE, 0, "Search finished last element reached");
-      break;
-    }
-
-    elem = ((VALUE*)listNodeData(next));
-
-    /* debug output */
-    infoStreamPrint(LOG_NLS_EXTRAPOLATE, 0, "Next node of list is element:");
-    printValueElement(elem);
-
-    if (elem->time < newElem->time)
-    {
-      break;
-    }
-    else if (elem->time == newElem->time)
-    {
-      replace = 1;
-      break;
-    }
-    node = next;
-    next = listNextNode(node);
-    i++; /* count insert or replace place */
-  }while(1);
-
-  /* add element before currect node */
-  if (!replace){
-    infoStreamPrint(LOG_NLS_EXTRAPOLATE, 0, "Insert element before last output element.");
-    listInsert(valuesList->valueList, node, (void*) newElem);
-  }
-  else
-  {
-    infoStreamPrint(LOG_NLS_EXTRAPOLATE, 0, "replace element.");
-    updateNodeData(valuesList->valueList, next, (void*) newElem);
-  }
-  /*  clean list if too full */
-  if (i < 3 && listLen(valuesList->valueList)>10)
+  /* move the older elements back, the oldest one drops out if the list is full */
+  n = valueList->length < VALUES_LIST_CAPACITY ? valueList->length : VALUES_LIST_CAPACITY - 1;
+  if (n > i)
   {
-    while(i < 4)
-    {
-      next = listNextNode(next);
-      i++;
-    }
-    cleanValueList(valuesList, next);
+    memmove(valueList->time + i + 1, valueList->time + i, (n-i)*sizeof(double));
+    memmove(valueList->values + (i+1)*size, valueList->values + i*size, (n-i)*size*sizeof(double));
   }
+  valueList->time[i] = time;
+  memcpy(valueList->values + i*size, values, size*sizeof(double));
+  valueList->length = n + 1;
 
   messageClose(LOG_NLS_EXTRAPOLATE);
-  return;
 }
 
-void getValues(VALUES_LIST* valuesList, double time, double* extrapolatedValues, double* oldOutput)
+void getValues(VALUES_LIST* valueList, double time, double* extrapolatedValues, double* oldOutput)
 {
-  LIST_NODE *begin, *next, *old, *old2;
-  VALUE *oldValues, *old2Values, *elem;
-
-  infoStreamPrint(LOG_NLS_EXTRAPOLATE, 1, "Get values for time %g in a list of size %d", time, listLen(valuesList->valueList));
-  begin = listFirstNode(valuesList->valueList);
-
-  assertStreamPrint(NULL, NULL != begin, "getValues failed, no elements");
+  unsigned int i, order;
 
-  /* find corresponding values */
-  do{
-    elem = (VALUE*)listNodeData(begin);
-    infoStreamPrint(LOG_NLS_EXTRAPOLATE, 0, "Searching current element:");
-    printValueElement(elem);
-
-    if (elem->time == time)
-    {
-      old = begin;
-      old2 = NULL;
-      infoStreamPrint(LOG_NLS_EXTRAPOLATE, 0, "take element with the same time.");
-      break;
-    }
-    else if (elem->time < time)
-    {
-      old = begin;
-      old2 = listNextNode(old);
-      infoStreamPrint(LOG_NLS_EXTRAPOLATE, 0, "found element to use for extrapolation.");
-      break;
-    }
-   else
-    {
-      next = listNextNode(begin);
-      if (!next){
-        old = begin;
-        old2 = next;
-        infoStreamPrint(LOG_NLS_EXTRAPOLATE, 0, "reached end of list.");
-        break;
-      }
-      else
-      {
-        begin = next;
-      }
-    }
-  }while(1);
+  infoStreamPrint(LOG_NLS_EXTRAPOLATE, 1, "Get values for time %g in a list of size %u", time, valueList->length);
+  assertStreamPrint(NULL, 0 < valueList->length, "getValues failed, no elements");
 
-  /*  get next values */
-  if (old2 == NULL)
+  i = findElement(valueList, time);
+  if (i == valueList->length)
   {
-    oldValues = (VALUE*) listNodeData(old);
-    memcpy(extrapolatedValues, oldValues->values, oldValues->size*sizeof(double));
-    memcpy(oldOutput, oldValues->values, oldValues->size*sizeof(double));
-    infoStreamPrint(LOG_NLS_EXTRAPOLATE, 0, "take just old values.");
+    /* all elements are later, take the oldest one */
+    i = valueList->length - 1;
+    order = 0;
+  }
+  else if (valueList->time[i] == time)
+  {
+    order = 0;
   }
   else
   {
-    int i;
-    oldValues = (VALUE*) listNodeData(old);
-    old2Values = (VALUE*) listNodeData(old2);
-    infoStreamPrint(LOG_NLS_EXTRAPOLATE, 0, "Use following elements for calculation:");
-    printValueElement(oldValues);
-    printValueElement(old2Values);
-    for(i = 0; i < oldValues->size; ++i)
+    order = valueList->length - 1 - i;
+    if (order > valueList->order)
     {
-      extrapolatedValues[i] = extrapolateValues(time, oldValues->values[i], oldValues->time, old2Values->values[i], old2Values->time);
+      order = valueList->order;
     }
-    memcpy(oldOutput, oldValues->values, oldValues->size*sizeof(double));
   }
-  messageClose(LOG_NLS_EXTRAPOLATE);
-  return;
-}
 
-void printValueElement(VALUE* elem)
-{
-  /* debug output */
-  if(ACTIVE_STREAM(LOG_NLS_EXTRAPOLATE))
+  memcpy(oldOutput, valueList->values + i*valueList->size, valueList->size*sizeof(double));
+  if (order == 0)
   {
-    int i;
-    infoStreamPrint(LOG_NLS_EXTRAPOLATE, 1, "Element(size %d) at time %g ", elem->size, elem->time);
-    for(i = 0; i < elem->size; i++) {
-      infoStreamPrint(LOG_NLS_EXTRAPOLATE, 0, " oldValues[%d] = %g",i, elem->values[i]);
-    }
-    messageClose(LOG_NLS_EXTRAPOLATE);
+    memcpy(extrapolatedValues, oldOutput, valueList->size*sizeof(double));
+    infoStreamPrint(LOG_NLS_EXTRAPOLATE, 0, "take just old values of time %g.", valueList->time[i]);
+  }
+  else
+  {
+    extrapolateValues(valueList, i, order, time, extrapolatedValues);
+    infoStreamPrint(LOG_NLS_EXTRAPOLATE, 0, "extrapolate with order %u from time %g.", order, valueList->time[i]);
   }
+  messageClose(LOG_NLS_EXTRAPOLATE);
 }
 
 void printValuesListTimes(VALUES_LIST* list)
@@ -339,42 +308,18 @@ void printValuesListTimes(VALUES_LIST* list)
   /* debug output */
   if(ACTIVE_STREAM(LOG_NLS_EXTRAPOLATE))
   {
-    int i;
-    LIST_NODE *next;
-    VALUE *elem;
+    unsigned int i;
 
     infoStreamPrint(LOG_NLS_EXTRAPOLATE, 1, "Print all elements");
-    if (listLen(list->valueList) == 0){
+    if (list->length == 0){
       infoStreamPrint(LOG_NLS_EXTRAPOLATE, 0, "List is empty!");
       messageClose(LOG_NLS_EXTRAPOLATE);
       return;
     }
-    next = listFirstNode(list->valueList);
-
-    assertStreamPrint(NULL, NULL != next, "printValuesListTimes failed, no elements");
 
-    /* go though the list */
-    for(i = 0; i < listLen(list->valueList); i++) {
-      elem = (VALUE*)listNodeData(next);
-      infoStreamPrint(LOG_NLS_EXTRAPOLATE, 0, "Element %d at time %g", i, elem->time);
-      next = listNextNode(next);
+    for(i = 0; i < list->length; i++) {
+      infoStreamPrint(LOG_NLS_EXTRAPOLATE, 0, "Element %u at time %g", i, list->time[i]);
     }
     messageClose(LOG_NLS_EXTRAPOLATE);
   }
 }
-
-double extrapolateValues(const double time, const double old1, const double time1, const double old2, const double time2)
-{
-  double retValue;
-
-  if (time1 == time2 || old1 == old2)
-  {
-    retValue = old1;
-  }
-  else
-  {
-    retValue = old2 + ((time - time2)/(time1 - time2)) * (old1-old2);
-  }
-
-  return retValue;
-}
@@ -37,38 +37,31 @@
 #ifndef _OMC_VALUE_LIST_H
 #define _OMC_VALUE_LIST_H
 
-#include "util/list.h"
+/* number of old solutions kept per system */
+#define VALUES_LIST_CAPACITY 8
+/* highest order of the extrapolation polynomial */
+#define VALUES_LIST_MAX_ORDER 3
 
 typedef struct VALUES_LIST
 {
-  LIST* valueList;
+  unsigned int size;          /* number of values of an element */
+  unsigned int length;        /* number of stored elements */
+  double *time;               /* times of the elements, the newest first */
+  double *values;             /* values of the elements, element i starts at values[i*size] */
+  unsigned int order;         /* order of the next extrapolation, chosen by addListElement */
 } VALUES_LIST;
 
-typedef struct VALUE
-{
-  double time;
-  unsigned int size;
-  double *values;
-} VALUE;
-
 
-VALUES_LIST *allocValueList(const unsigned int numberOfLists);
-void freeValueList(VALUES_LIST *valueList, unsigned int numberOfLists);
+VALUES_LIST *allocValueList(unsigned int size);
+void freeValueList(VALUES_LIST *valueList);
 
-VALUE* createValueElement(unsigned int size, double time, double* values);
-void freeValue(VALUE* elem);
-void cleanValueList(VALUES_LIST *valueListm, LIST_NODE* next);
 void cleanValueListbyTime(VALUES_LIST *valueList, double time);
-void removeNodes(LIST* list, LIST_NODE *node);
 
-void addListElement(VALUES_LIST* valueList, VALUE* elem);
+void addListElement(VALUES_LIST* valueList, double time, const double* values);
 void getValues(VALUES_LIST* valueList, double time, double* values, double* oldOutput);
 
-void printValueElement(VALUE* elem);
 void printValuesListTimes(VALUES_LIST* list);
 
 
 
 #endif
-
-
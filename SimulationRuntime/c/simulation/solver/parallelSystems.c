@@ -0,0 +1,248 @@
+/*
+ * This file is part of OpenModelica.
+ *
+ * Copyright (c) 1998-CurrentYear, Linköping University,
+ * Department of Computer and Information Science,
+ * SE-58183 Linköping, Sweden.
+ *
+ * All rights reserved.
+ *
+ * THIS PROGRAM IS PROVIDED UNDER THE TERMS OF THIS OSMC PUBLIC
+ * LICENSE (OSMC-PL). ANY USE, REPRODUCTION OR DISTRIBUTION OF
+ * THIS PROGRAM CONSTITUTES RECIPIENT'S ACCEPTANCE OF THE OSMC
+ * PUBLIC LICENSE.
+ *
+ * The OpenModelica software and the Open Source Modelica
+ * Consortium (OSMC) Public License (OSMC-PL) are obtained
+ * from Linköping University, either from the above address,
+ * from the URL: http://www.ida.liu.se/projects/OpenModelica
+ * and in the OpenModelica distribution.
+ *
+ * This program is distributed  WITHOUT ANY WARRANTY; without
+ * even the implied warranty of  MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE, EXCEPT AS EXPRESSLY SET FORTH
+ * IN THE BY RECIPIENT SELECTED SUBSIDIARY LICENSE CONDITIONS
+ * OF OSMC-PL.
+ *
+ * See the full OSMC Public License conditions for more details.
+ *
+ */
+
+/*! \file parallelSystems.c
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <setjmp.h>
+
+#include "simulation_data.h"
+#include "util/omc_error.h"
+#include "util/memory_pool.h"
+#include "util/omc_thread_pool.h"
+#include "simulation/options.h"
+#include "simulation/solver/parallelSystems.h"
+#include "meta/meta_modelica.h"
+
+typedef struct PARALLEL_SYSTEMS_THREAD
+{
+  threadData_t *threadData;
+  DATA data;                       /* shallow copy of the caller's DATA ... */
+  SIMULATION_INFO simulationInfo;  /* ... with a private SIMULATION_INFO */
+  int initialized;
+  int failed;
+} PARALLEL_SYSTEMS_THREAD;
+
+typedef struct PARALLEL_SYSTEMS
+{
+  OMC_THREAD_POOL *pool;
+  PARALLEL_SYSTEMS_THREAD *threads;
+  PARALLEL_SYSTEM_FUNC *systems;   /* systems of the current job */
+} PARALLEL_SYSTEMS;
+
+/*! \fn initializeParallelSystems
+ *
+ *  starts the threads selected with -parallelSystems; without the flag, or
+ *  if the model has external objects, the systems are evaluated sequentially.
+ *
+ *  \param [ref] [data]
+ */
+void initializeParallelSystems(DATA *data, threadData_t *threadData)
+{
+  PARALLEL_SYSTEMS *parallelSystems;
+  int nThreads = 1, i;
+
+  data->simulationInfo->parallelSystems = NULL;
+  if (omc_flag[FLAG_PARALLEL_SYSTEMS])
+  {
+    nThreads = atoi(omc_flagValue[FLAG_PARALLEL_SYSTEMS]);
+    assertStreamPrint(threadData, nThreads >= 1, "Selected number of threads %d for the independent systems is out of range (>= 1).", nThreads);
+  }
+  if (nThreads < 2)
+  {
+    return;
+  }
+  if (data->modelData->nExtObjs > 0)
+  {
+    /* the external objects are shared by all threads and may keep state */
+    warningStreamPrint(LOG_STDOUT, 0, "The model has external objects, the independent systems are evaluated sequentially.");
+    return;
+  }
+
+  parallelSystems = (PARALLEL_SYSTEMS*) calloc(1, sizeof(PARALLEL_SYSTEMS));
+  assertStreamPrint(threadData, 0 != parallelSystems, "out of memory");
+  parallelSystems->pool = omc_thread_pool_create(nThreads);
+  nThreads = omc_thread_pool_size(parallelSystems->pool);
+  if (nThreads < 2)
+  {
+    warningStreamPrint(LOG_STDOUT, 0, "Could not start the threads of the independent systems, they are evaluated sequentially.");
+    omc_thread_pool_free(parallelSystems->pool);
+    free(parallelSystems);
+    return;
+  }
+
+  parallelSystems->threads = (PARALLEL_SYSTEMS_THREAD*) calloc(nThreads, sizeof(PARALLEL_SYSTEMS_THREAD));
+  assertStreamPrint(threadData, 0 != parallelSystems->threads, "out of memory");
+  for(i = 1; i < nThreads; i++)
+  {
+    /* zeroed and scanned by the garbage collector; localRoots may point to its objects */
+    parallelSystems->threads[i].threadData = (threadData_t*) omc_alloc_interface.malloc_uncollectable(sizeof(threadData_t));
+    assertStreamPrint(threadData, 0 != parallelSystems->threads[i].threadData, "out of memory");
+    parallelSystems->threads[i].threadData->parent = threadData;
+    pthread_mutex_init(&parallelSystems->threads[i].threadData->parentMutex, NULL);
+  }
+
+  infoStreamPrint(LOG_SOLVER, 0, "evaluating independent systems on %d threads", nThreads);
+  data->simulationInfo->parallelSystems = parallelSystems;
+}
+
+/*! \fn freeParallelSystems
+ *
+ *  \param [ref] [data]
+ */
+void freeParallelSystems(DATA *data)
+{
+  PARALLEL_SYSTEMS *parallelSystems = (PARALLEL_SYSTEMS*) data->simulationInfo->parallelSystems;
+  int nThreads, i;
+
+  if (!parallelSystems)
+  {
+    return;
+  }
+
+  nThreads = omc_thread_pool_size(parallelSystems->pool);
+  omc_thread_pool_free(parallelSystems->pool);
+  for(i = 1; i < nThreads; i++)
+  {
+    pthread_mutex_destroy(&parallelSystems->threads[i].threadData->parentMutex);
+    omc_alloc_interface.free_uncollectable(parallelSystems->threads[i].threadData);
+  }
+  free(parallelSystems->threads);
+  free(parallelSystems);
+  data->simulationInfo->parallelSystems = NULL;
+}
+
+static void evaluateSystemTask(void *arg, int worker, int system)
+{
+  PARALLEL_SYSTEMS *parallelSystems = (PARALLEL_SYSTEMS*) arg;
+  PARALLEL_SYSTEMS_THREAD *thread = parallelSystems->threads + worker;
+  threadData_t *threadData = thread->threadData;
+  int saveJumpState;
+  int success = 0;
+
+  if (!thread->initialized)
+  {
+    if (worker > 0)
+    {
+      pthread_setspecific(mmc_thread_data_key, threadData);
+      mmc_init_stackoverflow(threadData);
+    }
+    thread->initialized = 1;
+  }
+
+  saveJumpState = threadData->currentErrorStage;
+  threadData->currentErrorStage = ERROR_SIMULATION;
+
+  /* try */
+#if !defined(OMC_EMCC)
+  MMC_TRY_INTERNAL(simulationJumpBuffer)
+#endif
+
+  /* a worker has no outer handler; MMC_THROW and stack overflows end here */
+  if (worker > 0)
+  {
+    threadData->mmc_jumper = threadData->simulationJumpBuffer;
+    threadData->mmc_stack_overflow_jumper = threadData->simulationJumpBuffer;
+  }
+
+  parallelSystems->systems[system](&thread->data, threadData);
+  success = 1;
+
+#if !defined(OMC_EMCC)
+  MMC_CATCH_INTERNAL(simulationJumpBuffer)
+#endif
+
+  if (worker > 0)
+  {
+    threadData->mmc_jumper = NULL;
+    threadData->mmc_stack_overflow_jumper = NULL;
+  }
+  threadData->currentErrorStage = saveJumpState;
+  if (!success)
+  {
+    thread->failed = 1;
+  }
+}
+
+/*! \fn evaluateParallelSystems
+ *
+ *  calls the independent systems; concurrently if initializeParallelSystems
+ *  has started threads, otherwise one after the other. An error in any of
+ *  the systems is thrown again after all of them are done.
+ *
+ *  \param [ref] [data]
+ *  \param [in]  [nSystems] number of systems
+ *  \param [in]  [systems] functions of the systems
+ */
+void evaluateParallelSystems(DATA *data, threadData_t *threadData, int nSystems, PARALLEL_SYSTEM_FUNC *systems)
+{
+  PARALLEL_SYSTEMS *parallelSystems = (PARALLEL_SYSTEMS*) data->simulationInfo->parallelSystems;
+  int nThreads, i, failed = 0;
+
+  if (!parallelSystems || nSystems < 2)
+  {
+    for(i = 0; i < nSystems; i++)
+    {
+      systems[i](data, threadData);
+    }
+    return;
+  }
+
+  nThreads = omc_thread_pool_size(parallelSystems->pool);
+  parallelSystems->threads[0].threadData = threadData;
+  for(i = 0; i < nThreads; i++)
+  {
+    PARALLEL_SYSTEMS_THREAD *thread = parallelSystems->threads + i;
+    thread->simulationInfo = *data->simulationInfo;
+    thread->simulationInfo.parallelSystems = NULL;
+    thread->data = *data;
+    thread->data.simulationInfo = &thread->simulationInfo;
+    thread->failed = 0;
+  }
+
+  parallelSystems->systems = systems;
+  omc_thread_pool_run(parallelSystems->pool, evaluateSystemTask, parallelSystems, nSystems);
+
+  for(i = 0; i < nThreads; i++)
+  {
+    if (parallelSystems->threads[i].simulationInfo.needToIterate)
+    {
+      data->simulationInfo->needToIterate = 1;
+    }
+    failed |= parallelSystems->threads[i].failed;
+  }
+
+  if (failed)
+  {
+    throwStreamPrint(threadData, "evaluation of the independent systems failed");
+  }
+}
@@ -0,0 +1,63 @@
+/*
+ * This file is part of OpenModelica.
+ *
+ * Copyright (c) 1998-CurrentYear, Linköping University,
+ * Department of Computer and Information Science,
+ * SE-58183 Linköping, Sweden.
+ *
+ * All rights reserved.
+ *
+ * THIS PROGRAM IS PROVIDED UNDER THE TERMS OF THIS OSMC PUBLIC
+ * LICENSE (OSMC-PL). ANY USE, REPRODUCTION OR DISTRIBUTION OF
+ * THIS PROGRAM CONSTITUTES RECIPIENT'S ACCEPTANCE OF THE OSMC
+ * PUBLIC LICENSE.
+ *
+ * The OpenModelica software and the Open Source Modelica
+ * Consortium (OSMC) Public License (OSMC-PL) are obtained
+ * from Linköping University, either from the above address,
+ * from the URL: http://www.ida.liu.se/projects/OpenModelica
+ * and in the OpenModelica distribution.
+ *
+ * This program is distributed  WITHOUT ANY WARRANTY; without
+ * even the implied warranty of  MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE, EXCEPT AS EXPRESSLY SET FORTH
+ * IN THE BY RECIPIENT SELECTED SUBSIDIARY LICENSE CONDITIONS
+ * OF OSMC-PL.
+ *
+ * See the full OSMC Public License conditions for more details.
+ *
+ */
+
+/*! \file parallelSystems.h
+ *
+ * Evaluates the independent partitions of the ODE and algebraic equations
+ * (generated with -d=pthreads) concurrently on the threads selected with
+ * -parallelSystems. Every thread works on its own shallow copy of DATA and
+ * SIMULATION_INFO: the flags the solvers toggle (solveContinuous,
+ * noThrowDivZero, ...) are private, everything else is shared. The
+ * partitions write disjoint variables and algebraic loops, but they may
+ * read the same ones and use the same global state: the old tables are
+ * searched without their lookup cursors on the worker threads, and models
+ * with external objects are evaluated sequentially.
+ */
+
+#ifndef _PARALLELSYSTEMS_H_
+#define _PARALLELSYSTEMS_H_
+
+#include "simulation_data.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef void (*PARALLEL_SYSTEM_FUNC)(DATA *data, threadData_t *threadData);
+
+void initializeParallelSystems(DATA *data, threadData_t *threadData);
+void freeParallelSystems(DATA *data);
+void evaluateParallelSystems(DATA *data, threadData_t *threadData, int nSystems, PARALLEL_SYSTEM_FUNC *systems);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
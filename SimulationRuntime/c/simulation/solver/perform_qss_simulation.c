@@ -29,6 +29,8 @@
  */
 
 #include <stdio.h>
+#include <math.h>
+#include <float.h>
 #include "solver_main.h"
 
 #include "simulation/simulation_runtime.h"
@@ -50,16 +52,54 @@ enum error_msg
   OK = 0L           /*!< Everything is fine. */
 };
 
-const modelica_real EPS = 1e-15;
-
-/* Needed if we want to write all the variables into a file*/
-/* #define D */
-
-static modelica_integer deltaQ( DATA* data,const modelica_real dQ, const modelica_integer index, modelica_real* dTnextQ, modelica_real* nextQ, modelica_real* diffQ);
-static modelica_integer getDerWithStateK(const unsigned int *index, const unsigned int* leadindex, modelica_integer* der, uinteger* numDer, const uinteger k);
-static modelica_integer getStatesInDer(const unsigned int* index, const unsigned int* leadindex, const uinteger ROWS, const uinteger STATES, uinteger** StatesInDer);
-static modelica_integer qss_step(DATA* data, SOLVER_INFO* solverInfo);
-static uinteger minStep( const modelica_real* tqp, const uinteger size );
+/*! struct QSS_DATA
+ * \brief  State of the QSS integration.
+ *
+ * Every state has its own time base:
+ *   x_i(t) = x[i] + dx[i]*(t-tx[i]) + ddx[i]/2*(t-tx[i])^2
+ *   q_i(t) = q[i] + mq[i]*(t-tq[i])
+ * ddx and mq stay zero for QSS1. tNext[i] is the time when x_i drifts dQ[i]
+ * away from q_i; the states are kept in a binary heap ordered by tNext.
+ */
+typedef struct QSS_DATA
+{
+  uinteger order;
+  uinteger nStates;
+
+  modelica_real* x;
+  modelica_real* dx;
+  modelica_real* ddx;
+  modelica_real* tx;
+  modelica_real* q;
+  modelica_real* mq;
+  modelica_real* tq;
+  modelica_real* dQ;            /* quantum of every state, default = nominal*10^-4 */
+  modelica_real* tNext;
+
+  uinteger* heap;               /* heap[0] is the state that changes next */
+  uinteger* heapPos;            /* position of every state in heap */
+
+  const unsigned int* derLead;  /* sparsity pattern of A by column: derivatives depending on state k */
+  const unsigned int* derIndex;
+  unsigned int* stateLead;      /* transposed pattern: states the derivative j depends on */
+  unsigned int* stateIndex;
+
+  uinteger* affected;           /* derivatives that are re-evaluated in the current step */
+  uinteger nAffected;
+  modelica_boolean* isAffected;
+
+  unsigned long nSteps;
+  unsigned long nEvaluations;
+} QSS_DATA;
+
+static modelica_integer allocQSSData(QSS_DATA* qss, DATA* data, const SPARSE_PATTERN* pattern, uinteger order);
+static void freeQSSData(QSS_DATA* qss);
+static modelica_integer initializeQSS(QSS_DATA* qss, DATA* data, threadData_t *threadData, modelica_real time);
+static modelica_integer qss_step(QSS_DATA* qss, DATA* data, threadData_t *threadData, uinteger ind);
+static void emitQSS(QSS_DATA* qss, DATA* data, threadData_t *threadData, modelica_real time);
+static modelica_real nextChange(const modelica_real a, const modelica_real b, const modelica_real c, const modelica_real dQ);
+static void heapSiftDown(QSS_DATA* qss, uinteger pos);
+static void heapUpdate(QSS_DATA* qss, uinteger i);
 
 /*! performQSSSimulation(DATA* data, SOLVER_INFO* solverInfo)
  *
@@ -73,15 +113,31 @@ modelica_integer prefixedName_performQSSSimulation(DATA* data, threadData_t *thr
   TRACE_PUSH
 
   SIMULATION_INFO *simInfo = data->simulationInfo;
-  MODEL_DATA *mData = data->modelData;
   uinteger currStepNo = 0;
   modelica_integer retValIntegrator = 0;
   modelica_integer retValue = 0;
   uinteger ind = 0;
+  modelica_real tChange = 0.0;
+  uinteger order = 1;
+  QSS_DATA qss;
+
+  /* output points, every step is emitted with -noEquidistantTimeGrid */
+  const modelica_boolean emitSteps = omc_flag[FLAG_NOEQUIDISTANT_GRID];
+  modelica_integer outputStep = 1;
+  modelica_real nextOutput;
+  modelica_real lastEmit = simInfo->startTime;
 
   solverInfo->currentTime = simInfo->startTime;
 
-  warningStreamPrint(LOG_STDOUT, 0, "This QSS method is under development and should not be used yet.");
+  if (omc_flag[FLAG_QSS_ORDER])
+  {
+    order = atoi(omc_flagValue[FLAG_QSS_ORDER]);
+    if (order < 1 || order > 2)
+    {
+      warningStreamPrint(LOG_STDOUT, 0, "QSS order %s is not supported, use 1 or 2. Using order 1.", omc_flagValue[FLAG_QSS_ORDER]);
+      order = 1;
+    }
+  }
 
   if (data->callback->initialAnalyticJacobianA(data, threadData))
   {
@@ -90,113 +146,16 @@ modelica_integer prefixedName_performQSSSimulation(DATA* data, threadData_t *thr
   }
   printSparseStructure(data, LOG_SOLVER);
 
-/* *********************************************************************************** */
-  /* Initialization */
-  uinteger i = 0; /* loop var */
-  SIMULATION_DATA *sData = (SIMULATION_DATA*)data->localData[0];
-  modelica_real* state = sData->realVars;
-  modelica_real* stateDer = sData->realVars + data->modelData->nStates;
-  const SPARSE_PATTERN* pattern = &(data->simulationInfo->analyticJacobians[data->callback->INDEX_JAC_A].sparsePattern);
-  const uinteger ROWS = data->simulationInfo->analyticJacobians[data->callback->INDEX_JAC_A].sizeRows;
-  const uinteger STATES = data->modelData->nStates;
-  uinteger numDer = 0;  /* number of derivatives influenced by state k */
-
-  modelica_boolean fail = 0;
-  modelica_real* qik = NULL;  /* Approximation of states */
-  modelica_real* xik = NULL;  /* states */
-  modelica_real* derXik = NULL;  /* Derivative of states */
-  modelica_real* tq = NULL;    /* Time of approximation, because not all approximations are calculated at a specific time, each approx. has its own timestamp */
-  modelica_real* tx = NULL;    /* Time of the states, because not all states are calculated at a specific time, each state has its own timestamp */
-  modelica_real* tqp = NULL;    /* Time of the next change in state */
-  modelica_real* nQh = NULL;    /* next value of the state */
-  modelica_real* dQ = NULL;    /* change in quantity of every state, default = nominal*10^-4 */
-
-  /* allocate memory*/
-  qik = (modelica_real*)calloc(STATES, sizeof(modelica_real));
-  fail = (qik == NULL) ? 1 : ( 0 | fail);
-  xik = (modelica_real*)calloc(STATES, sizeof(modelica_real));
-  fail = (xik == NULL) ? 1 : ( 0 | fail);
-  derXik = (modelica_real*)calloc(STATES, sizeof(modelica_real));
-  fail = (derXik == NULL) ? 1 : ( 0 | fail);
-  tq = (modelica_real*)calloc(STATES, sizeof(modelica_real));
-  fail = (tq == NULL) ? 1 : ( 0 | fail);
-  tx = (modelica_real*)calloc(STATES, sizeof(modelica_real));
-  fail = (tx == NULL) ? 1 : ( 0 | fail);
-  tqp = (modelica_real*)calloc(STATES, sizeof(modelica_real));
-  fail = (tqp == NULL) ? 1 : ( 0 | fail);
-  nQh = (modelica_real*)calloc(STATES, sizeof(modelica_real));
-  fail = (nQh == NULL) ? 1 : ( 0 | fail);
-  dQ = (modelica_real*)calloc(STATES, sizeof(modelica_real));
-  fail = (dQ == NULL) ? 1 : ( 0 | fail);
-
-
-  if (fail)
-    return OO_MEMORY;
-  /* end - allocate memory */
-
-  /* further initialization of local variables */
-
-  modelica_real diffQ = 0.0, dTnextQ = 0.0, nextQ = 0.0;
-  for (i = 0; i < STATES; i++)
-  {
-    dQ[i] = 0.0001 * data->modelData->realVarsData[i].attribute.nominal;
-    tx[i] = tq[i] = simInfo->startTime;
-    qik[i] = state[i];
-    xik[i] = state[i];
-    derXik[i] = stateDer[i];
-    retValue = deltaQ(data, dQ[i], i, &dTnextQ, &nextQ, &diffQ);
-    if (OK != retValue)
-      return retValue;
-    tqp[i] = tq[i] + dTnextQ;
-    nQh[i] = nextQ;
-  }
-
-/* Transform the sparsity pattern into a data structure for an index based access. */
-  modelica_integer* der = (modelica_integer*)calloc(ROWS, sizeof(modelica_integer));
-  if (NULL==der)
-    return OO_MEMORY;
-  for (i = 0; i < ROWS; i++)
-    der[i] = -1;
-
-  /* how many states are involved in each derivative */
-  /* **** This is needed if we have QSS2 or higher **** */
- /* uinteger* numStatesInDer = calloc(ROWS,sizeof(uinteger));
-  if (NULL==numStatesInDer) return OO_MEMORY; */
-  /*
-   *   dx1/dt = x2
-   *   dx2/dt = x1 + x2
-   *   lead to
-   *  StatesInDer[0]-{ 2 }
-   *  StatesInDer[1]-{ 1, 2 }
-  */
-/*  uinteger** StatesInDer = calloc(ROWS,sizeof(uinteger*));
-  if (NULL==StatesInDer) return OO_MEMORY; */
-
-  /* count number of states in each derivative*/
-/*  for (i = 0; i < pattern->leadindex[ROWS-1]; i++) numStatesInDer[ pattern->index[i] ]++; */
-  /* collect memory for all stateindices */
-/*  for (i = 0; i < ROWS; i++)
-  {
-    *(StatesInDer + i) = calloc(numStatesInDer[i], sizeof(uinteger));
-    if (NULL==*(StatesInDer + i)) return OO_MEMORY;
-  }
+  retValue = allocQSSData(&qss, data, &(data->simulationInfo->analyticJacobians[data->callback->INDEX_JAC_A].sparsePattern), order);
+  if (OK != retValue)
+    return retValue;
 
-  retValue = getStatesInDer(pattern->index, pattern->leadindex, ROWS, STATES, StatesInDer);
-  if (OK != retValue) return retValue; */
+  nextOutput = (outputStep < simInfo->numSteps) ? simInfo->startTime + outputStep*simInfo->stepSize : simInfo->stopTime;
 
-/*  retValue = getDerWithStateK(pattern->index, pattern->leadindex, der, &numDer, 0);
-  if (OK != retValue) return retValue; */
-/* End of transformation */
-
-#ifdef D
-  FILE* fid=NULL;
-  fid = fopen("log_qss.txt","w");
-#endif
-
-/* *********************************************************************************** */
+  retValue = initializeQSS(&qss, data, threadData, simInfo->startTime);
 
 /***** Start main simulation loop *****/
-  while(solverInfo->currentTime < simInfo->stopTime)
+  while(OK == retValue && solverInfo->currentTime < simInfo->stopTime)
   {
     modelica_integer success = 0;
     threadData->currentErrorStage = ERROR_SIMULATION;
@@ -213,141 +172,40 @@ modelica_integer prefixedName_performQSSSimulation(DATA* data, threadData_t *thr
       printf("TRACE: push loop step=%u, time=%.12g\n", currStepNo, solverInfo->currentTime);
 #endif
 
-#ifdef D
-    fprintf(fid,"t = %.8f\n",solverInfo->currentTime);
-    fprintf(fid,"%16s\t%16s\t%16s\t%16s\t%16s\t%16s\n","tx","x","dx","tq","q","tqp");
-    for (i = 0; i < STATES; i++)
-    {
-      fprintf(fid,"%16.8f\t%16.8f\t%16.8f\t%16.8f\t%16.8f\t%16.8f\n",tx[i],xik[i],derXik[i],tq[i],qik[i],tqp[i]);
-    }
-#endif
-
     currStepNo++;
 
-    ind = minStep(tqp, STATES);
+    /* the state that changes next */
+    ind = (qss.nStates > 0) ? qss.heap[0] : 0;
+    tChange = (qss.nStates > 0) ? qss.tNext[ind] : DBL_MAX;
 
-    if (isnan(tqp[ind]))
+    /* emit the output points reached before the next change */
+    while (!emitSteps && outputStep <= simInfo->numSteps && nextOutput <= fmin(tChange, simInfo->stopTime))
     {
-#ifdef D
-      fprintf(fid,"Exit caused by #QNAN!\tind=%d",ind);
-#endif
-      return ISNAN;
+      emitQSS(&qss, data, threadData, nextOutput);
+      lastEmit = nextOutput;
+      outputStep++;
+      nextOutput = (outputStep < simInfo->numSteps) ? simInfo->startTime + outputStep*simInfo->stepSize : simInfo->stopTime;
     }
-    if (isinf(tqp[ind]))
+
+    if (tChange > simInfo->stopTime)
     {
-      /* If all derivatives are zero, the states stay constant and only the
-       * time propagates till stop->time.
+      /* no state changes any more until stop->time, including the case that
+       * all derivatives are zero
        */
-      warningStreamPrint(LOG_STDOUT, 0, "All derivatives are zero at time %f!.\n", sData->timeValue);
       solverInfo->currentTime = simInfo->stopTime;
-      sData->timeValue = solverInfo->currentTime;
-
-      continue;
-    }
-
-    qik[ind] = nQh[ind];
-
-    xik[ind] = qik[ind];
-    state[ind] = qik[ind];
-
-    tx[ind] = tqp[ind];
-    tq[ind] = tqp[ind];
-
-    solverInfo->currentTime = tqp[ind];
-
-#ifdef D
-    fprintf(fid,"Index: %d\n\n",ind);
-#endif
-
-    /* the state[ind] will change again in dTnextQ*/
-    retValue = deltaQ(data, dQ[ind], ind, &dTnextQ, &nextQ, &diffQ);
-    if (OK != retValue)
-      return retValue;
-    tqp[ind] = tq[ind] + dTnextQ;
-    nQh[ind] = nextQ;
-
-    if (0 != strcmp("ia", data->simulationInfo->outputFormat))
-    {
-      communicateStatus("Running", (solverInfo->currentTime-simInfo->startTime)/(simInfo->stopTime-simInfo->startTime));
     }
-
-    /* get the derivatives depending on state[ind] */
-    for (i = 0; i < ROWS; i++)
-      der[i] = -1;
-    retValue = getDerWithStateK(pattern->index, pattern->leadindex, der, &numDer, ind);
-
-    uinteger k = 0, j = 0;
-    for (k = 0; k < numDer; k++)
+    else
     {
-      j = der[k];
-      if (j != ind)
+      solverInfo->currentTime = tChange;
+      retValue = qss_step(&qss, data, threadData, ind);
+      if (emitSteps)
       {
-        xik[j] = xik[j] + derXik[j] * (solverInfo->currentTime - tx[j]);
-        state[j] = xik[j];
-        tx[j] = solverInfo->currentTime;
+        emitQSS(&qss, data, threadData, solverInfo->currentTime);
+        lastEmit = solverInfo->currentTime;
       }
     }
-
-    /*
-     * Recalculate all equations which are affected by state[ind].
-     * Unfortunately all equations will be calculated up to now. And we need to evaluate
-     * the equations as f(t,q) and not f(t,x). So all states were saved onto a local stack
-     * and overwritten by q. After evaluating the equations the states are written back.
-     */
-    for (i = 0; i < STATES; i++)
-    {
-      xik[i] = state[i];   /* save current state */
-      state[i] = qik[i];  /* overwrite current state for dx/dt = f(t,q) */
-    }
-
-    /* update continous system */
-    sData->timeValue = solverInfo->currentTime;
-    externalInputUpdate(data);
-    data->callback->input_function(data, threadData);
-    data->callback->functionODE(data, threadData);
-    data->callback->functionAlgebraics(data, threadData);
-    data->callback->output_function(data, threadData);
-    data->callback->function_storeDelayed(data, threadData);
-
-    for (i = 0; i < STATES; i++)
-    {
-      state[i] = xik[i];  /* restore current state */
-    }
-
-
-    /*
-     * Get derivatives affected by state[ind] and write back ALL derivatives. After that we have
-     * states and derivatives for different times tx.
-    */
-
-    for (k = 0; k < numDer; k++)
-    {
-      j = der[k];
-      derXik[j] = stateDer[j];
-    }
-    derXik[ind] = stateDer[ind];  /* not in every case part of the above derivatives */
-
-    for (i = 0; i < STATES; i++)
-    {
-      stateDer[i] = derXik[i];  /* write back all derivatives */
-    }
-
-    /* recalculate the time of next change only for the affected states */
-    for (k = 0; k < numDer; k++)
-    {
-       j = der[k];
-      retValue = deltaQ(data, dQ[j], j, &dTnextQ, &nextQ, &diffQ);
-      if (OK != retValue)
-        return retValue;
-      tqp[j] = solverInfo->currentTime + dTnextQ;
-      nQh[j] = nextQ;
-    }
-
-    /*sData->timeValue = solverInfo->currentTime;*/
     solverInfo->laststep = solverInfo->currentTime;
 
-    sim_result.emit(&sim_result, data, threadData);
-
     /* check if terminate()=true */
     if (terminationTerminate)
     {
@@ -357,12 +215,24 @@ modelica_integer prefixedName_performQSSSimulation(DATA* data, threadData_t *thr
       simInfo->stopTime = solverInfo->currentTime;
     }
 
+    /* the states of the last output are the values at the end of the simulation */
+    if (OK == retValue && solverInfo->currentTime >= simInfo->stopTime && lastEmit < solverInfo->currentTime)
+    {
+      emitQSS(&qss, data, threadData, solverInfo->currentTime);
+      lastEmit = solverInfo->currentTime;
+    }
+
     /* terminate for some cases:
      * - integrator fails
      * - non-linear system failed to solve
      * - assert was called
      */
-    if (retValIntegrator)
+    if (ISNAN == retValue)
+    {
+      infoStreamPrint(LOG_STDOUT, 0, "model terminate | Time of next change is NaN. | Simulation terminated at time %g", solverInfo->currentTime);
+      break;
+    }
+    else if (retValIntegrator)
     {
       retValue = -1 + retValIntegrator;
       infoStreamPrint(LOG_STDOUT, 0, "model terminate | Integrator failed. | Simulation terminated at time %g", solverInfo->currentTime);
@@ -403,167 +273,407 @@ modelica_integer prefixedName_performQSSSimulation(DATA* data, threadData_t *thr
   }
   /* End of main loop */
 
-#ifdef D
-  fprintf(fid,"t = %.8f\n",solverInfo->currentTime);
-  fprintf(fid,"%16s\t%16s\t%16s\t%16s\t%16s\t%16s\n","tx","x","dx","tq","q","tqp");
-  for (i = 0; i < STATES; i++)
-  {
-    fprintf(fid,"%16.8f\t%16.8f\t%16.8f\t%16.8f\t%16.8f\t%16.8f\n",tx[i],xik[i],derXik[i],tq[i],qik[i],tqp[i]);
-  }
-  fclose(fid);
-#endif
+  infoStreamPrint(LOG_STATS, 0, "QSS%d: %lu state changes, %lu evaluations of the derivatives", (int) qss.order, qss.nSteps, qss.nEvaluations);
 
-  /* free memory*/
-   free(der);
- /*  for (i = 0; i < ROWS; i++) free(*(StatesInDer + i));
-   free(StatesInDer);
-   free(numStatesInDer); */
-   free(qik);
-   free(xik);
-   free(derXik);
-   free(tq);
-   free(tx);
-   free(tqp);
-   free(nQh);
-   free(dQ);
-   /* end - free memory */
+  freeQSSData(&qss);
 
   TRACE_POP
   return retValue;
 }
 
 
-/*! static int deltaQ( DATA* data, const modelica_integer index, modelica_real* dTnextQ, modelica_real* nextQ, modelica_real* diffQ)
- *  \brief  Computes the next step in time and quantity for state[index].
+/*! static modelica_integer allocQSSData(QSS_DATA* qss, DATA* data, const SPARSE_PATTERN* pattern, uinteger order)
+ *  \brief  Allocates the QSS data and transposes the sparsity pattern of A.
+ *  \param [out] [qss]
  *  \param [ref] [data]  Global data object.
- *  \param [in]  [dQ] Change of quantity for state[index], (nominal value) * 10^-4.
- *  \param [in] [index]  A new step will be computed for state[index].
- *  \param [out] [dTnextQ]  The state will change after dTnextQ second.
- *  \param [out] [nextQ]  Next quantity reached by the state.
- *  \param [out] [diffQ]  Difference between the states current and future value.
+ *  \param [in]  [pattern]  Sparsity pattern of the jacobian A (column k holds the derivatives depending on state k).
+ *  \param [in]  [order]  1 for QSS1, 2 for QSS2.
  *  \return  [0]  Everything is fine.
  */
-static modelica_integer deltaQ( DATA* data, const modelica_real dQ, const modelica_integer index, modelica_real* dTnextQ, modelica_real* nextQ, modelica_real* diffQ)
+static modelica_integer allocQSSData(QSS_DATA* qss, DATA* data, const SPARSE_PATTERN* pattern, uinteger order)
 {
+  const uinteger STATES = data->modelData->nStates;
+  const unsigned int nnz = (STATES > 0) ? pattern->leadindex[STATES-1] : 0;
+  unsigned int* count;
+  uinteger i = 0, k = 0;
+  unsigned int j = 0;
+  modelica_boolean fail = 0;
 
-  /* localData[0] because old values in the ringbuffer are not stored in QSS1 and so the ringbuffer will not be rotated. */
-  SIMULATION_DATA *sDataOld = (SIMULATION_DATA*)data->localData[0];
-  modelica_real* stateDer = sDataOld->realVars + data->modelData->nStates;
+  memset(qss, 0, sizeof(QSS_DATA));
+  qss->order = order;
+  qss->nStates = STATES;
+
+  qss->x = (modelica_real*)calloc(STATES, sizeof(modelica_real));
+  qss->dx = (modelica_real*)calloc(STATES, sizeof(modelica_real));
+  qss->ddx = (modelica_real*)calloc(STATES, sizeof(modelica_real));
+  qss->tx = (modelica_real*)calloc(STATES, sizeof(modelica_real));
+  qss->q = (modelica_real*)calloc(STATES, sizeof(modelica_real));
+  qss->mq = (modelica_real*)calloc(STATES, sizeof(modelica_real));
+  qss->tq = (modelica_real*)calloc(STATES, sizeof(modelica_real));
+  qss->dQ = (modelica_real*)calloc(STATES, sizeof(modelica_real));
+  qss->tNext = (modelica_real*)calloc(STATES, sizeof(modelica_real));
+  qss->heap = (uinteger*)calloc(STATES, sizeof(uinteger));
+  qss->heapPos = (uinteger*)calloc(STATES, sizeof(uinteger));
+  qss->stateLead = (unsigned int*)calloc(STATES+1, sizeof(unsigned int));
+  qss->stateIndex = (unsigned int*)calloc(nnz+1, sizeof(unsigned int));
+  qss->affected = (uinteger*)calloc(STATES+1, sizeof(uinteger));
+  qss->isAffected = (modelica_boolean*)calloc(STATES, sizeof(modelica_boolean));
+  count = (unsigned int*)calloc(STATES+1, sizeof(unsigned int));
+
+  fail = !qss->x || !qss->dx || !qss->ddx || !qss->tx || !qss->q || !qss->mq || !qss->tq || !qss->dQ ||
+         !qss->tNext || !qss->heap || !qss->heapPos || !qss->stateLead || !qss->stateIndex ||
+         !qss->affected || !qss->isAffected || !count;
+  if (fail)
+  {
+    free(count);
+    freeQSSData(qss);
+    return OO_MEMORY;
+  }
 
+  qss->derLead = pattern->leadindex;
+  qss->derIndex = pattern->index;
 
-  if (stateDer[index] >= 0 )    /* quantity of the state will increase */
+  /* transpose the pattern, stateLead[j]..stateLead[j+1] are the states in derivative j */
+  for (i = 0; i < nnz; i++)
+    count[pattern->index[i]+1]++;
+  for (i = 0; i < STATES; i++)
+    qss->stateLead[i+1] = qss->stateLead[i] + count[i+1];
+  memcpy(count, qss->stateLead, STATES*sizeof(unsigned int));
+  for (k = 0; k < STATES; k++)
   {
-    *nextQ = (floor( sDataOld->realVars[index] / dQ ) + 1 ) * dQ;
-    if (*nextQ <= (sDataOld->realVars[index] + EPS))
-      *nextQ = *nextQ + dQ;
+    for (j = (k == 0) ? 0 : pattern->leadindex[k-1]; j < pattern->leadindex[k]; j++)
+      qss->stateIndex[count[pattern->index[j]]++] = k;
+  }
+  free(count);
+
+  for (i = 0; i < STATES; i++)
+    qss->dQ[i] = 0.0001 * data->modelData->realVarsData[i].attribute.nominal;
+
+  return OK;
+}
+
+/*! static void freeQSSData(QSS_DATA* qss)
+ *  \brief  Frees the memory allocated by allocQSSData.
+ */
+static void freeQSSData(QSS_DATA* qss)
+{
+  free(qss->x);
+  free(qss->dx);
+  free(qss->ddx);
+  free(qss->tx);
+  free(qss->q);
+  free(qss->mq);
+  free(qss->tq);
+  free(qss->dQ);
+  free(qss->tNext);
+  free(qss->heap);
+  free(qss->heapPos);
+  free(qss->stateLead);
+  free(qss->stateIndex);
+  free(qss->affected);
+  free(qss->isAffected);
+}
+
+/*! static void evaluateDerivatives(QSS_DATA* qss, DATA* data, threadData_t *threadData, modelica_real time, modelica_boolean all)
+ *  \brief  Evaluates the derivatives with the quantized states at time.
+ *
+ *  Only the states needed by the affected derivatives are set to q(time),
+ *  unless all is set. The generated code evaluates the whole ODE, so the
+ *  other derivatives are not valid afterwards.
+ */
+static void evaluateDerivatives(QSS_DATA* qss, DATA* data, threadData_t *threadData, modelica_real time, modelica_boolean all)
+{
+  SIMULATION_DATA *sData = (SIMULATION_DATA*)data->localData[0];
+  modelica_real* state = sData->realVars;
+  uinteger i = 0, k = 0;
+  unsigned int j = 0;
+
+  if (all)
+  {
+    for (k = 0; k < qss->nStates; k++)
+      state[k] = qss->q[k] + qss->mq[k] * (time - qss->tq[k]);
   }
   else
   {
-    *nextQ = floor( sDataOld->realVars[index] / dQ ) * dQ;
-    if (*nextQ >= (sDataOld->realVars[index] - EPS ))
-      *nextQ = *nextQ - dQ;
+    for (i = 0; i < qss->nAffected; i++)
+    {
+      for (j = qss->stateLead[qss->affected[i]]; j < qss->stateLead[qss->affected[i]+1]; j++)
+      {
+        k = qss->stateIndex[j];
+        state[k] = qss->q[k] + qss->mq[k] * (time - qss->tq[k]);
+      }
+    }
   }
 
-  *diffQ = fabs(*nextQ - sDataOld->realVars[index]);
-  *dTnextQ = fabs(*diffQ / stateDer[index]);
-
-  return OK;
+  sData->timeValue = time;
+  externalInputUpdate(data);
+  data->callback->input_function(data, threadData);
+  data->callback->functionODE(data, threadData);
+  qss->nEvaluations++;
 }
 
-/*! static int getDerWithStateK(const unsigned int *index, const unsigned int* leadindex, int* der, unsigned int* numDer, const unsigned int k)
- *  \brief  Returns the indices of all derivatives with state k inside.
- *  \param [ref] [index]
- *  \param [ref] [leadindex]
- *  \param [out] [der]  Derivatives which are influenced by state k.
- *  \param [out] [numDer] Number of influenced derivatives.
- *  \param [in] [k]  State to look for.
- *  \return [0]  Everything is fine.
+/*! static modelica_integer updateAffected(QSS_DATA* qss, DATA* data, threadData_t *threadData, modelica_real time, modelica_boolean all)
+ *  \brief  Re-evaluates the derivatives in qss->affected and schedules their next change.
+ *
+ *  The states in qss->affected have to be advanced to time. For QSS2 the
+ *  second derivative is approximated by a difference quotient of the
+ *  derivatives along the quantized trajectories.
+ *
+ *  \return  [0]  Everything is fine.
  */
-static modelica_integer getDerWithStateK(const unsigned int *index, const unsigned int* leadindex, modelica_integer* der, uinteger* numDer, const uinteger k)
+static modelica_integer updateAffected(QSS_DATA* qss, DATA* data, threadData_t *threadData, modelica_real time, modelica_boolean all)
 {
-  uinteger start = 0;
-  if (0 < k)
-    start = leadindex[k - 1];
-  uinteger j = 0;
-  uinteger i = 0;
-  for (i = start; i < leadindex[k]; i++)
+  modelica_real* stateDer = data->localData[0]->realVars + qss->nStates;
+  const modelica_real delta = sqrt(DBL_EPSILON) * fmax(fabs(time), 1.0);
+  uinteger i = 0, j = 0;
+
+  evaluateDerivatives(qss, data, threadData, time, all);
+  for (i = 0; i < qss->nAffected; i++)
+  {
+    j = qss->affected[i];
+    qss->dx[j] = stateDer[j];
+  }
+
+  if (qss->order > 1)
+  {
+    evaluateDerivatives(qss, data, threadData, time + delta, all);
+    for (i = 0; i < qss->nAffected; i++)
+    {
+      j = qss->affected[i];
+      qss->ddx[j] = (stateDer[j] - qss->dx[j]) / delta;
+    }
+  }
+
+  for (i = 0; i < qss->nAffected; i++)
   {
-    der[j] = index[i];
-    j++;
+    j = qss->affected[i];
+    qss->tNext[j] = time + nextChange(qss->x[j] - (qss->q[j] + qss->mq[j] * (time - qss->tq[j])),
+                                      qss->dx[j] - qss->mq[j], 0.5 * qss->ddx[j], qss->dQ[j]);
+    if (isnan(qss->tNext[j]))
+      return ISNAN;
   }
-  *numDer = j;
+
   return OK;
 }
-/*! static int getStatesInDer(const unsigned int* index, const unsigned int* leadindex, const unsigned int ROWS, const unsigned int STATES, unsigned int** StatesInDer)
- *  \brief  Return the indices of all states in each derivative for an indexed access.
- *  \param [ref] [index]
- *  \param [ref] [leadindex]
- *  \param [in]  [ROWS] number of derivatives
- *  \param [in]  [STATES] number of states
- *  \param [out] [StatesInDer]  index of states in each derivative
- *
+
+/*! static modelica_integer initializeQSS(QSS_DATA* qss, DATA* data, threadData_t *threadData, modelica_real time)
+ *  \brief  Starts all states with q = x and builds the heap.
+ *  \return  [0]  Everything is fine.
  */
-static modelica_integer getStatesInDer(const unsigned int* index, const unsigned int* leadindex, const uinteger ROWS, const uinteger STATES, uinteger** StatesInDer)
+static modelica_integer initializeQSS(QSS_DATA* qss, DATA* data, threadData_t *threadData, modelica_real time)
 {
-  uinteger i = 0, k = 0; /* loop var */
-  uinteger numDer = 0;
-  modelica_integer* der = (modelica_integer*)calloc(ROWS, sizeof(modelica_integer));
-  uinteger* stackPointer = (uinteger*)calloc(ROWS, sizeof(uinteger));
+  modelica_real* state = data->localData[0]->realVars;
+  modelica_real* stateDer = data->localData[0]->realVars + qss->nStates;
+  modelica_integer retValue = OK;
+  uinteger i = 0;
 
-  if (NULL == der)
-    return OO_MEMORY;
+  for (i = 0; i < qss->nStates; i++)
+  {
+    qss->x[i] = qss->q[i] = state[i];
+    qss->tx[i] = qss->tq[i] = time;
+    qss->affected[i] = i;
+    qss->heap[i] = i;
+    qss->heapPos[i] = i;
+  }
+  qss->nAffected = qss->nStates;
 
-  for (i = 0; i < ROWS; i++)
-    der[i] = -1;
+  /* the slopes of the quantized states are the derivatives at the start */
+  if (qss->order > 1)
+  {
+    evaluateDerivatives(qss, data, threadData, time, 1);
+    for (i = 0; i < qss->nStates; i++)
+      qss->mq[i] = stateDer[i];
+  }
 
-  for (i = 0; i < ROWS; i++)
-    stackPointer[i] = 0;
+  retValue = updateAffected(qss, data, threadData, time, 1);
 
-  /*    Ask for all states in which derivative they occur. */
-  for (k = 0; k < STATES; k++)
+  for (i = qss->nStates/2; i > 0; i--)
+    heapSiftDown(qss, i-1);
+
+  return retValue;
+}
+
+/*! static modelica_integer qss_step(QSS_DATA* qss, DATA* data, threadData_t *threadData, uinteger ind)
+ *  \brief  Changes the quantized state ind at its time of next change.
+ *
+ *  Only the derivatives depending on state ind are updated and only
+ *  their states are re-scheduled in the heap.
+ *
+ *  \return  [0]  Everything is fine.
+ */
+static modelica_integer qss_step(QSS_DATA* qss, DATA* data, threadData_t *threadData, uinteger ind)
+{
+  const modelica_real time = qss->tNext[ind];
+  modelica_real dt = 0.0;
+  modelica_integer retValue = OK;
+  uinteger i = 0, j = 0;
+  unsigned int k = 0;
+
+  /* the derivatives depending on state[ind] and der(state[ind]) itself */
+  qss->nAffected = 0;
+  for (k = (ind == 0) ? 0 : qss->derLead[ind-1]; k < qss->derLead[ind]; k++)
   {
-    getDerWithStateK(index, leadindex, der, &numDer, k);
-    for (i = 0; i < ROWS; i++)
+    j = qss->derIndex[k];
+    if (!qss->isAffected[j])
     {
-      if (der[i] < 0)
-        continue;
-      /* stackPointer refers to the next free position for der[i] in StatesInDer */
-      StatesInDer[ der[i] ][ stackPointer[ der[i] ] ] = k;
-      stackPointer[ der[i] ]++;
-      der[i] = -1;  // clear all
+      qss->isAffected[j] = 1;
+      qss->affected[qss->nAffected++] = j;
     }
   }
+  if (!qss->isAffected[ind])
+    qss->affected[qss->nAffected++] = ind;
+  for (i = 0; i < qss->nAffected; i++)
+    qss->isAffected[qss->affected[i]] = 0;
 
-  free(der);
-  free(stackPointer);
-  return OK;
-}
+  /* advance the affected states to time */
+  for (i = 0; i < qss->nAffected; i++)
+  {
+    j = qss->affected[i];
+    dt = time - qss->tx[j];
+    qss->x[j] += (qss->dx[j] + 0.5 * qss->ddx[j] * dt) * dt;
+    qss->dx[j] += qss->ddx[j] * dt;
+    qss->tx[j] = time;
+  }
+
+  /* new quantized state */
+  qss->q[ind] = qss->x[ind];
+  qss->mq[ind] = (qss->order > 1) ? qss->dx[ind] : 0.0;
+  qss->tq[ind] = time;
 
+  retValue = updateAffected(qss, data, threadData, time, 0);
 
-/*! static unsigned int minStep(const modelica_real* tqp, const unsigned int size )
- *  \brief  Finds the index of the state which will change first.
- *  \param [in] [tqp]  State[i] will change in time tqp[i].
- *  \param [in] [size]  Number of states.
- *  \return  Index of the state which will change first.
+  for (i = 0; i < qss->nAffected; i++)
+    heapUpdate(qss, qss->affected[i]);
+
+  data->callback->function_storeDelayed(data, threadData);
+  qss->nSteps++;
+
+  return retValue;
+}
+
+/*! static void emitQSS(QSS_DATA* qss, DATA* data, threadData_t *threadData, modelica_real time)
+ *  \brief  Evaluates the model with all states at x(time) and emits the result.
  */
-static uinteger minStep(const modelica_real* tqp, const uinteger size )
+static void emitQSS(QSS_DATA* qss, DATA* data, threadData_t *threadData, modelica_real time)
 {
+  SIMULATION_DATA *sData = (SIMULATION_DATA*)data->localData[0];
+  modelica_real* state = sData->realVars;
+  modelica_real dt = 0.0;
   uinteger i = 0;
-  uinteger ind = i;
-  modelica_real tmin =
-#if defined(_MSC_VER)
-      NAN;
-#else
-      1.0/0.0; /* We can have a QNAN at any index and tqp[i] < QNAN will fail in every case. */
-#endif
 
-  for (i = 0; i < size; i++)
+  for (i = 0; i < qss->nStates; i++)
+  {
+    dt = time - qss->tx[i];
+    state[i] = qss->x[i] + (qss->dx[i] + 0.5 * qss->ddx[i] * dt) * dt;
+  }
+
+  sData->timeValue = time;
+  externalInputUpdate(data);
+  data->callback->input_function(data, threadData);
+  data->callback->functionODE(data, threadData);
+  data->callback->functionAlgebraics(data, threadData);
+  data->callback->output_function(data, threadData);
+
+  if (0 != strcmp("ia", data->simulationInfo->outputFormat))
+  {
+    communicateStatus("Running", (time-data->simulationInfo->startTime)/(data->simulationInfo->stopTime-data->simulationInfo->startTime));
+  }
+
+  sim_result.emit(&sim_result, data, threadData);
+}
+
+/*! static modelica_real nextChange(const modelica_real a, const modelica_real b, const modelica_real c, const modelica_real dQ)
+ *  \brief  Returns the first tau > 0 with |a + b*tau + c*tau^2| = dQ.
+ *  \param [in] [a]  Current difference x - q.
+ *  \param [in] [b]  Difference of the slopes.
+ *  \param [in] [c]  Half of the second derivative of x.
+ *  \param [in] [dQ]  Quantum of the state.
+ *  \return  tau, or DBL_MAX if the difference never reaches dQ.
+ */
+static modelica_real nextChange(const modelica_real a, const modelica_real b, const modelica_real c, const modelica_real dQ)
+{
+  modelica_real tau = DBL_MAX, r = 0.0, disc = 0.0, s = 0.0;
+  int sign = 0;
+
+  if (isnan(a) || isnan(b) || isnan(c))
+    return a + b + c;
+  if (fabs(a) >= dQ)
+    return 0.0;
+
+  for (sign = -1; sign <= 1; sign += 2)
   {
-    if (tqp[i] < tmin && !isnan(tqp[i]))
+    /* c*tau^2 + b*tau + (a - sign*dQ) = 0 */
+    const modelica_real a0 = a - sign*dQ;
+    if (0.0 == c)
     {
-      ind = i;
-      tmin = tqp[i];
+      if (0.0 != b)
+      {
+        r = -a0 / b;
+        if (r > 0.0 && r < tau)
+          tau = r;
+      }
+      continue;
+    }
+    disc = b*b - 4.0*c*a0;
+    if (disc < 0.0)
+      continue;
+    s = -0.5 * (b + ((b >= 0.0) ? sqrt(disc) : -sqrt(disc)));
+    if (0.0 != s)
+    {
+      r = s / c;
+      if (r > 0.0 && r < tau)
+        tau = r;
+      r = a0 / s;
+      if (r > 0.0 && r < tau)
+        tau = r;
     }
   }
-  return ind;
+  return tau;
+}
+
+/*! static void heapSiftDown(QSS_DATA* qss, uinteger pos)
+ *  \brief  Moves heap[pos] down until its children change later.
+ */
+static void heapSiftDown(QSS_DATA* qss, uinteger pos)
+{
+  const uinteger i = qss->heap[pos];
+  const modelica_real t = qss->tNext[i];
+  uinteger child = 0;
+
+  while ((child = 2*pos + 1) < qss->nStates)
+  {
+    if (child + 1 < qss->nStates && qss->tNext[qss->heap[child+1]] < qss->tNext[qss->heap[child]])
+      child++;
+    if (!(qss->tNext[qss->heap[child]] < t))
+      break;
+    qss->heap[pos] = qss->heap[child];
+    qss->heapPos[qss->heap[pos]] = pos;
+    pos = child;
+  }
+
+  qss->heap[pos] = i;
+  qss->heapPos[i] = pos;
+}
+
+/*! static void heapUpdate(QSS_DATA* qss, uinteger i)
+ *  \brief  Restores the heap order after tNext[i] changed.
+ */
+static void heapUpdate(QSS_DATA* qss, uinteger i)
+{
+  uinteger pos = qss->heapPos[i], parent = 0;
+  const modelica_real t = qss->tNext[i];
+
+  while (pos > 0)
+  {
+    parent = (pos - 1) / 2;
+    if (!(t < qss->tNext[qss->heap[parent]]))
+      break;
+    qss->heap[pos] = qss->heap[parent];
+    qss->heapPos[qss->heap[pos]] = pos;
+    pos = parent;
+  }
+
+  qss->heap[pos] = i;
+  qss->heapPos[i] = pos;
+  heapSiftDown(qss, pos);
 }
@@ -167,6 +167,7 @@ typedef struct EXTERNAL_INPUT
   modelica_integer N;
   modelica_integer n;
   modelica_integer i;
+  struct EXTERNAL_INPUT_STREAM *stream; /* rows of a long or binary input file read on demand; NULL if t and u hold all rows */
 }EXTERNAL_INPUT;
 
 /* Alias data with various types*/
@@ -301,7 +302,7 @@ typedef struct NONLINEAR_SYSTEM_DATA
   modelica_real *nlsxOld;              /* previous x */
   modelica_real *nlsxExtrapolation;    /* extrapolated values for x from old and old2 - used as initial guess */
 
-  void *oldValueList;                  /* old values organized in a sorted list for extrapolation and interpolate, respectively */
+  void *oldValueList;                  /* VALUES_LIST: history of the last solutions for the extrapolation of the start values */
 
   modelica_integer method;             /* used for linear tearing system if 1: Newton step is done otherwise 0 */
   modelica_real residualError;         /* not used */
@@ -528,6 +529,7 @@ typedef struct SIMULATION_INFO
   int mixedMethod;                     /* mixed solver */
   int nlsMethod;                       /* nonlinear solver */
   int newtonStrategy;                  /* newton damping strategy solver */
+  int nlsLinearSolver;                 /* linear solver of the homotopy and hybrid nonlinear solvers */
   int nlsCsvInfomation;                /* = 1 csv files with detailed nonlinear solver process are generated */
 
   /* current context evaluation, set by dassl and used for extrapolation
@@ -560,7 +562,9 @@ typedef struct SIMULATION_INFO
 
   modelica_real* zeroCrossings;
   modelica_real* zeroCrossingsPre;
-  modelica_real* zeroCrossingsBackup;  /* used by bisection in event.c */
+  modelica_real* zeroCrossingsBackup;  /* used by the root finding in event.c */
+  modelica_real* rootFindingWork;      /* used by the root finding in event.c: 6*nStates + 2*nZeroCrossings */
+  long* rootFindingEvents;             /* used by the root finding in event.c: 2*nZeroCrossings */
   modelica_boolean* relations;
   modelica_boolean* relationsPre;
   modelica_boolean* storedRelations;   /* this array contains a copy of relations each time the event iteration starts */
@@ -600,9 +604,13 @@ typedef struct SIMULATION_INFO
 
   STATE_SET_DATA* stateSetData;
 
+  void *parallelSystems;               /* threads of evaluateParallelSystems; NULL if the independent systems are evaluated sequentially */
+
   /* delay vars */
   double tStart;
-  RINGBUFFER **delayStructure;
+  POW2_RINGBUFFER **delayStructure;
+  int *delayCursor;                    /* per delay expression: row found by the last lookup in delayStructure */
+  modelica_boolean delayHermite;       /* interpolate delay() with cubic Hermite polynomials */
   const char *OPENMODELICAHOME;
 
   CHATTERING_INFO chatteringInfo;
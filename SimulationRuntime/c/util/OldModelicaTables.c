@@ -34,7 +34,18 @@
 #include <math.h>
 #include <ctype.h>
 
+#include <stdint.h>
+#include <sys/stat.h>
+#if defined(_WIN32)
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
 #include "omc_inline.h"
+#include "omc_mmap.h"
+#include "omc_init.h"
 #include "ModelicaUtilities.h"
 #ifdef _MSC_VER
 #include "omc_msvc.h"
@@ -46,6 +57,49 @@
 /* Definition to make a copy of the arrays */
 #define COPY_ARRAYS
 
+/* Tables read from files are shared by all table objects of the process
+ * that refer to the same file (path, modification time and size) and table
+ * name. The parsed table is also stored in a binary sidecar file next to the
+ * original one, <file>.<table>.omtab, which is memory-mapped by later
+ * loads, also by other processes:
+ *   header: "OMTAB01" + '\0', u32 byteOrder, u32 0, i64 mtime and i64 size
+ *           of the original file, u64 rows, u64 cols
+ *   data:   rows*cols doubles, row-wise
+ * The sidecar is written to a temporary file and renamed, so concurrent
+ * simulations never see a partial one. If it cannot be written (e.g. a
+ * read-only directory) the table is only shared within the process.
+ */
+#define OMTAB_MAGIC "OMTAB01"
+#define OMTAB_BYTE_ORDER 0x01020304
+
+typedef struct OMTAB_HEADER
+{
+  char magic[8];
+  uint32_t byteOrder;
+  uint32_t reserved;
+  int64_t mtime;
+  int64_t fileSize;
+  uint64_t rows;
+  uint64_t cols;
+} OMTAB_HEADER;
+
+typedef struct TableFileCache
+{
+  char *filename;
+  char *tablename;
+  int64_t mtime;
+  int64_t fileSize;
+  size_t rows;
+  size_t cols;
+  const double *data;
+  char mapped;          /* data is in map, otherwise it is malloc'ed */
+  omc_mmap_read map;
+  int refCount;
+  struct TableFileCache *next;
+} TableFileCache;
+
+static TableFileCache *tableFileCache = NULL;
+
 typedef struct InterpolationTable
 {
   char *filename;
@@ -58,6 +112,8 @@ typedef struct InterpolationTable
   int ipoType;
   int expoType;
   double startTime;
+  size_t lastIdx; /* interval found by the last lookup */
+  TableFileCache *cache; /* shared data of a table read from a file */
 } InterpolationTable;
 
 typedef struct InterpolationTable2D
@@ -72,6 +128,9 @@ typedef struct InterpolationTable2D
   char colWise;
   int ipoType;
   int expoType;
+  size_t lastRow; /* row and column found by the last lookup */
+  size_t lastCol;
+  TableFileCache *cache; /* shared data of a table read from a file */
 } InterpolationTable2D;
 
 static InterpolationTable** interpolationTables=NULL;
@@ -79,6 +138,16 @@ static int ninterpolationTables=0;
 static InterpolationTable2D** interpolationTables2D=NULL;
 static int ninterpolationTables2D=0;
 
+/* The tables are shared by all threads, but the threads evaluating parts of
+ * the model concurrently (their threadData has a parent) would race on the
+ * cursors of the last lookup; they search without them.
+ */
+static inline int useTableCursors(void)
+{
+  threadData_t *threadData = (threadData_t*) pthread_getspecific(mmc_thread_data_key);
+  return !threadData || !threadData->parent;
+}
+
 static InterpolationTable *InterpolationTable_init(double time,double startTime, int ipoType, int expoType,
          const char* tableName, const char* fileName,
          const double *table,
@@ -86,12 +155,14 @@ static InterpolationTable *InterpolationTable_init(double time,double startTime,
 /* InterpolationTable *InterpolationTable_Copy(InterpolationTable *orig); */
 static void InterpolationTable_deinit(InterpolationTable *tpl);
 static double InterpolationTable_interpolate(InterpolationTable *tpl, double time, size_t col);
+static void InterpolationTable_interpolateColumns(InterpolationTable *tpl, double time, const int *cols, size_t ncols, double *res);
 static double InterpolationTable_maxTime(InterpolationTable *tpl);
 static double InterpolationTable_minTime(InterpolationTable *tpl);
 static char InterpolationTable_compare(InterpolationTable *tpl, const char* fname, const char* tname, const double* table);
 
 static double InterpolationTable_extrapolate(InterpolationTable *tpl, double time, size_t col, char beforeData);
 static inline double InterpolationTable_interpolateLin(InterpolationTable *tpl, double time, size_t i, size_t j);
+static size_t InterpolationTable_findInterval(InterpolationTable *tpl, double time, size_t lastIdx);
 static inline const double InterpolationTable_getElt(InterpolationTable *tpl, size_t row, size_t col);
 static void InterpolationTable_checkValidityOfData(InterpolationTable *tpl);
 
@@ -104,6 +175,7 @@ static double InterpolationTable2D_interpolate(InterpolationTable2D *tpl, double
 static char InterpolationTable2D_compare(InterpolationTable2D *tpl, const char* fname, const char* tname, const double* table);
 static double InterpolationTable2D_linInterpolate(double x, double x_1, double x_2, double f_1, double f_2);
 static const double InterpolationTable2D_getElt(InterpolationTable2D *tpl, size_t row, size_t col);
+static size_t InterpolationTable2D_find(InterpolationTable2D *tpl, char inRows, double x, size_t lo, size_t hi, size_t *cursor);
 static void InterpolationTable2D_checkValidityOfData(InterpolationTable2D *tpl);
 
 
@@ -200,6 +272,27 @@ double omcTableTimeIpo(int tableID, int icol, double timeIn)
 }
 
 
+/* Interpolates the columns icols[0..ncols-1] (1-based) at timeIn into res;
+ * the interval is only searched once for all columns.
+ */
+void omcTableTimeIpoColumns(int tableID, int ncols, const int *icols, double timeIn, double *res)
+{
+#ifdef INFOS
+  infoStreamPrint("Interpolate Table[%d] %d columns add Time %f",tableID,ncols,timeIn);
+#endif
+  if(tableID >= 0 && tableID < (int)ninterpolationTables)
+  {
+    InterpolationTable_interpolateColumns(interpolationTables[tableID],timeIn,icols,ncols,res);
+  }
+  else
+  {
+    int i;
+    for(i = 0; i < ncols; ++i)
+      res[i] = 0.0;
+  }
+}
+
+
 double omcTableTimeTmax(int tableID)
 {
 #ifdef INFOS
@@ -296,6 +389,8 @@ double omcTable2DIpo(int tableID,double u1_, double u2_)
 */
 
 static void openFile(const char *filename, const char* tableName, size_t *rows, size_t *cols, double **data);
+static TableFileCache *TableFileCache_get(const char *filename, const char *tableName);
+static void TableFileCache_release(TableFileCache *entry);
 
 
 /* \brief Read data from text file.
@@ -1022,6 +1117,181 @@ static char *copyTableNameFile(const char *name)
   return dst;
 }
 
+static char *TableFileCache_sidecarName(const char *filename, const char *tableName)
+{
+  size_t l = strlen(filename), i;
+  char *name = (char*)malloc(l + strlen(tableName) + 8);
+  if (!name) {
+    ModelicaFormatError("Not enough memory for Table: %s",tableName);
+  }
+  strcpy(name,filename);
+  name[l++] = '.';
+  for(i = 0; tableName[i]; ++i)
+    name[l++] = isalnum((unsigned char)tableName[i]) ? tableName[i] : '_';
+  strcpy(name+l,".omtab");
+  return name;
+}
+
+/* maps the sidecar if it belongs to the current version of the file */
+static char TableFileCache_mapSidecar(TableFileCache *entry, const char *sidecar)
+{
+  struct stat st;
+  const OMTAB_HEADER *hdr;
+  size_t n;
+
+  if(stat(sidecar,&st) != 0 || (size_t)st.st_size < sizeof(OMTAB_HEADER))
+    return 0;
+  /* a sidecar that cannot be mapped is ignored and the table is parsed */
+  entry->map = omc_mmap_try_open_read(sidecar);
+  if(!entry->map.data)
+    return 0;
+  if(entry->map.size < sizeof(OMTAB_HEADER))
+  {
+    omc_mmap_close_read(entry->map);
+    return 0;
+  }
+  hdr = (const OMTAB_HEADER*) entry->map.data;
+  /* number of doubles after the header; rows*cols must not overflow */
+  n = (entry->map.size - sizeof(OMTAB_HEADER)) / sizeof(double);
+  if(memcmp(hdr->magic,OMTAB_MAGIC,8) == 0 && hdr->byteOrder == OMTAB_BYTE_ORDER &&
+     hdr->mtime == entry->mtime && hdr->fileSize == entry->fileSize &&
+     entry->map.size == sizeof(OMTAB_HEADER) + n*sizeof(double) &&
+     (hdr->cols == 0 ? n == 0 : hdr->rows <= n / hdr->cols && hdr->rows*hdr->cols == n))
+  {
+    entry->rows = hdr->rows;
+    entry->cols = hdr->cols;
+    entry->data = (const double*)(entry->map.data + sizeof(OMTAB_HEADER));
+    entry->mapped = 1;
+    return 1;
+  }
+  omc_mmap_close_read(entry->map);
+  return 0;
+}
+
+static void TableFileCache_writeSidecar(TableFileCache *entry, const char *sidecar)
+{
+  OMTAB_HEADER hdr;
+  char *tmp = (char*)malloc(strlen(sidecar) + 32);
+  FILE *f;
+  size_t n = entry->rows*entry->cols;
+
+  if(!tmp)
+    return;
+  sprintf(tmp,"%s.%ld.tmp",sidecar,(long)getpid());
+  f = fopen(tmp,"wb");
+  if(!f)
+  {
+    free(tmp);
+    return;
+  }
+  memset(&hdr,0,sizeof(hdr));
+  memcpy(hdr.magic,OMTAB_MAGIC,8);
+  hdr.byteOrder = OMTAB_BYTE_ORDER;
+  hdr.mtime = entry->mtime;
+  hdr.fileSize = entry->fileSize;
+  hdr.rows = entry->rows;
+  hdr.cols = entry->cols;
+  if(fwrite(&hdr,sizeof(hdr),1,f) != 1 || (n && fwrite(entry->data,sizeof(double),n,f) != n))
+  {
+    fclose(f);
+    remove(tmp);
+  }
+  else if(fclose(f) != 0 || rename(tmp,sidecar) != 0)
+  {
+    /* e.g. it was created by another process in the meantime */
+    remove(tmp);
+  }
+  free(tmp);
+}
+
+/* Returns the shared data of a table in a file, reading it if necessary. */
+static TableFileCache *TableFileCache_get(const char *filename, const char *tableName)
+{
+  struct stat st;
+  TableFileCache *entry, table;
+  char *sidecar;
+  double *data = NULL;
+
+  if(stat(filename,&st) != 0) {
+    ModelicaFormatError("Not possible to open file `%s' for table `%s'.",filename,tableName);
+  }
+
+  for(entry = tableFileCache; entry; entry = entry->next)
+  {
+    if(entry->mtime == (int64_t)st.st_mtime && entry->fileSize == (int64_t)st.st_size &&
+       !strcmp(entry->filename,filename) && !strcmp(entry->tablename,tableName))
+    {
+      entry->refCount++;
+      return entry;
+    }
+  }
+
+  /* openFile leaves with ModelicaFormatError on errors, so nothing is
+   * allocated while it runs */
+  memset(&table,0,sizeof(TableFileCache));
+  table.mtime = st.st_mtime;
+  table.fileSize = st.st_size;
+  sidecar = TableFileCache_sidecarName(filename,tableName);
+  if(!TableFileCache_mapSidecar(&table,sidecar))
+  {
+    free(sidecar);
+    sidecar = NULL;
+    openFile(filename,tableName,&table.rows,&table.cols,&data);
+    table.data = data;
+  }
+
+  entry = (TableFileCache*)malloc(sizeof(TableFileCache));
+  if (!entry) {
+    if(table.mapped)
+      omc_mmap_close_read(table.map);
+    free(data);
+    free(sidecar);
+    ModelicaFormatError("Not enough memory for Table: %s",tableName);
+  }
+  *entry = table;
+  entry->filename = copyTableNameFile(filename);
+  entry->tablename = copyTableNameFile(tableName);
+  entry->refCount = 1;
+
+  if(!entry->mapped)
+  {
+    sidecar = TableFileCache_sidecarName(filename,tableName);
+    TableFileCache_writeSidecar(entry,sidecar);
+    /* use the shared pages from now on */
+    if(TableFileCache_mapSidecar(entry,sidecar))
+      free(data);
+  }
+  free(sidecar);
+
+  entry->next = tableFileCache;
+  tableFileCache = entry;
+  return entry;
+}
+
+static void TableFileCache_release(TableFileCache *entry)
+{
+  TableFileCache **it;
+
+  if(--entry->refCount > 0)
+    return;
+  for(it = &tableFileCache; *it; it = &(*it)->next)
+  {
+    if(*it == entry)
+    {
+      *it = entry->next;
+      break;
+    }
+  }
+  if(entry->mapped) {
+    omc_mmap_close_read(entry->map);
+  } else {
+    free((void*)entry->data);
+  }
+  free(entry->filename);
+  free(entry->tablename);
+  free(entry);
+}
+
 static InterpolationTable* InterpolationTable_init(double time, double startTime,
                int ipoType, int expoType,
                const char* tableName, const char* fileName,
@@ -1048,8 +1318,11 @@ static InterpolationTable* InterpolationTable_init(double time, double startTime
 
     if(fileName && strncmp("NoName",fileName,6) != 0)
     {
-      openFile(fileName,tableName,&(tpl->rows),&(tpl->cols),&(tpl->data));
-      tpl->own_data = 1;
+      tpl->cache = TableFileCache_get(fileName,tableName);
+      tpl->rows = tpl->cache->rows;
+      tpl->cols = tpl->cache->cols;
+      tpl->data = (double*) tpl->cache->data;
+      tpl->own_data = 0;
     } else
     {
 #ifndef COPY_ARRAYS
@@ -1084,6 +1357,8 @@ static void InterpolationTable_deinit(InterpolationTable *tpl)
   {
     if(tpl->own_data)
       free(tpl->data);
+    if(tpl->cache)
+      TableFileCache_release(tpl->cache);
     free(tpl);
   }
 }
@@ -1105,12 +1380,76 @@ static double InterpolationTable_interpolate(InterpolationTable *tpl, double tim
   if(time < InterpolationTable_minTime(tpl))
     return InterpolationTable_extrapolate(tpl,time,col,time <= InterpolationTable_minTime(tpl));
 
-  for(i = 0; i < lastIdx; ++i) {
-    if(InterpolationTable_getElt(tpl,i,0) > time) {
-      return InterpolationTable_interpolateLin(tpl,time, i-1,col);
+  i = InterpolationTable_findInterval(tpl,time,lastIdx);
+  if(i < lastIdx-1)
+    return InterpolationTable_interpolateLin(tpl,time,i,col);
+  return InterpolationTable_extrapolate(tpl,time,col,time <= InterpolationTable_minTime(tpl));
+}
+
+/* Interpolates several columns (1-based) at the same time. */
+static void InterpolationTable_interpolateColumns(InterpolationTable *tpl, double time, const int *cols, size_t ncols, double *res)
+{
+  size_t i, k;
+  size_t lastIdx = tpl->colWise ? tpl->cols : tpl->rows;
+
+  if(tpl->data && lastIdx > 1 && time >= InterpolationTable_minTime(tpl))
+  {
+    i = InterpolationTable_findInterval(tpl,time,lastIdx);
+    if(i < lastIdx-1)
+    {
+      double t_1 = InterpolationTable_getElt(tpl,i,0);
+      double t_2 = InterpolationTable_getElt(tpl,i+1,0);
+      double w = (time-t_1)/(t_2-t_1);
+      for(k = 0; k < ncols; ++k)
+      {
+        double y_1 = InterpolationTable_getElt(tpl,i,cols[k]-1);
+        double y_2 = InterpolationTable_getElt(tpl,i+1,cols[k]-1);
+        res[k] = y_1 + w * (y_2-y_1);
+      }
+      return;
     }
   }
-  return InterpolationTable_extrapolate(tpl,time,col,time <= InterpolationTable_minTime(tpl));
+
+  /* outside of the table or special cases */
+  for(k = 0; k < ncols; ++k)
+    res[k] = InterpolationTable_interpolate(tpl,time,cols[k]-1);
+}
+
+/* Returns the last row i with t[i] <= time, time >= t[0]. The interval of
+ * the last lookup is tried first, then the neighbouring one, and only then
+ * the table is searched with bisection.
+ */
+static size_t InterpolationTable_findInterval(InterpolationTable *tpl, double time, size_t lastIdx)
+{
+  size_t noCursor = lastIdx;
+  size_t *cursor = useTableCursors() ? &tpl->lastIdx : &noCursor;
+  size_t lo, hi, i = *cursor;
+
+  if(i < lastIdx && InterpolationTable_getElt(tpl,i,0) <= time)
+  {
+    if(i+1 == lastIdx || InterpolationTable_getElt(tpl,i+1,0) > time)
+      return i;
+    if(i+2 == lastIdx || InterpolationTable_getElt(tpl,i+2,0) > time)
+      return (*cursor = i+1);
+    lo = i+1;
+    hi = lastIdx;
+  }
+  else
+  {
+    lo = 0;
+    hi = i < lastIdx ? i : lastIdx;
+  }
+
+  /* t[lo] <= time and t[hi] > time (or hi == lastIdx) */
+  while(hi - lo > 1)
+  {
+    i = lo + (hi - lo) / 2;
+    if(InterpolationTable_getElt(tpl,i,0) > time)
+      hi = i;
+    else
+      lo = i;
+  }
+  return (*cursor = lo);
 }
 
 static double InterpolationTable_maxTime(InterpolationTable *tpl)
@@ -1133,7 +1472,7 @@ static char InterpolationTable_compare(InterpolationTable *tpl, const char* fnam
   else
   {
     /* table loaded from file */
-    return ((!strncmp(tpl->filename,fname,6)) && (!strncmp(tpl->tablename,tname,6)));
+    return ((!strcmp(tpl->filename,fname)) && (!strcmp(tpl->tablename,tname)));
   }
 }
 
@@ -1226,8 +1565,11 @@ static InterpolationTable2D* InterpolationTable2D_init(int ipoType, const char*
 
     if(fileName && strncmp("NoName",fileName,6) != 0)
     {
-      openFile(fileName,tableName,&(tpl->rows),&(tpl->cols),&(tpl->data));
-      tpl->own_data = 1;
+      tpl->cache = TableFileCache_get(fileName,tableName);
+      tpl->rows = tpl->cache->rows;
+      tpl->cols = tpl->cache->cols;
+      tpl->data = (double*) tpl->cache->data;
+      tpl->own_data = 0;
     } else {
 #ifndef COPY_ARRAYS
       if (!table) {
@@ -1260,6 +1602,8 @@ static void InterpolationTable2D_deinit(InterpolationTable2D *table)
   {
     if(table->own_data)
       free(table->data);
+    if(table->cache)
+      TableFileCache_release(table->cache);
     free(table);
   }
 }
@@ -1441,8 +1785,7 @@ static double InterpolationTable2D_interpolate(InterpolationTable2D *table, doub
       return InterpolationTable2D_getElt(table,1,1);
     }
     /* find interval corresponding x1 */
-    for(i = 2; i < table->rows; ++i)
-      if(InterpolationTable2D_getElt(table,i,0) >= x1) break;
+    i = InterpolationTable2D_find(table,1,x1,2,table->rows,&table->lastRow);
     if((table->ipoType == 2) && (table->rows > 3))
     {
       /* smooth interpolation with Akima Splines such that der(y) is continuous */
@@ -1466,8 +1809,7 @@ static double InterpolationTable2D_interpolate(InterpolationTable2D *table, doub
   if(table->rows == 2)
   {
     /* find interval corresponding x2 */
-    for(j = 2; j < table->cols; ++j)
-      if(InterpolationTable2D_getElt(table,0,j) >= x2) break;
+    j = InterpolationTable2D_find(table,0,x2,2,table->cols,&table->lastCol);
 
     if((table->ipoType == 2) && (table->cols > 3))
     {
@@ -1490,10 +1832,8 @@ static double InterpolationTable2D_interpolate(InterpolationTable2D *table, doub
   }
 
   /* find intervals corresponding x1 and x2 */
-  for(i = 2; i < table->rows-1; ++i)
-    if(InterpolationTable2D_getElt(table,i,0) >= x1) break;
-  for(j = 2; j < table->cols-1; ++j)
-    if(InterpolationTable2D_getElt(table,0,j) >= x2) break;
+  i = InterpolationTable2D_find(table,1,x1,2,table->rows-1,&table->lastRow);
+  j = InterpolationTable2D_find(table,0,x2,2,table->cols-1,&table->lastCol);
 
   if((table->ipoType == 2) && (table->rows != 3) && (table->cols != 3)  )
   {
@@ -1553,7 +1893,7 @@ static char InterpolationTable2D_compare(InterpolationTable2D *tpl, const char*
   else
   {
     /* table loaded from file */
-    return ((!strncmp(tpl->filename,fname,6)) && (!strncmp(tpl->tablename,tname,6)));
+    return ((!strcmp(tpl->filename,fname)) && (!strcmp(tpl->tablename,tname)));
   }
   return 0;
 }
@@ -1571,6 +1911,38 @@ static const double InterpolationTable2D_getElt(InterpolationTable2D *tpl, size_
   return tpl->data[row*tpl->cols+col];
 }
 
+/* Returns the first index k in [lo, hi) where the first column (inRows) or
+ * the first row has a value >= x, or hi if there is none. The result of the
+ * last search is tried first, then the table is searched with bisection.
+ */
+static size_t InterpolationTable2D_find(InterpolationTable2D *tpl, char inRows, double x, size_t lo, size_t hi, size_t *cursor)
+{
+  size_t noCursor = hi+1;
+  size_t k;
+
+  if(!useTableCursors())
+    cursor = &noCursor;
+  k = *cursor;
+
+  if(lo >= hi)
+    return hi;
+  if(lo <= k && k <= hi &&
+     (k == lo || (inRows ? InterpolationTable2D_getElt(tpl,k-1,0) : InterpolationTable2D_getElt(tpl,0,k-1)) < x) &&
+     (k == hi || (inRows ? InterpolationTable2D_getElt(tpl,k,0) : InterpolationTable2D_getElt(tpl,0,k)) >= x))
+    return k;
+
+  /* the values at [lo, hi) are strictly increasing */
+  while(lo < hi)
+  {
+    k = lo + (hi - lo) / 2;
+    if((inRows ? InterpolationTable2D_getElt(tpl,k,0) : InterpolationTable2D_getElt(tpl,0,k)) >= x)
+      hi = k;
+    else
+      lo = k + 1;
+  }
+  return (*cursor = lo);
+}
+
 static void InterpolationTable2D_checkValidityOfData(InterpolationTable2D *tpl)
 {
   size_t i = 0;
@@ -1680,6 +2052,18 @@ extern double ModelicaTables_CombiTimeTable_interpolate(int tableID, int icol, d
 
 
 
+extern void ModelicaTables_CombiTimeTable_interpolateColumns(int tableID, int ncol, const int *icol, double u, double *y);
+  /* Interpolate several columns of a table at once
+
+     -> tableID: Pointer to table defined with ModelicaTables_CombiTimeTable_init
+     -> ncol   : Number of columns to interpolate
+     -> icol   : Columns to interpolate
+     -> u      : Abscissa value (time)
+     <- y      : Ordinate values of the columns
+ */
+
+
+
 extern int ModelicaTables_CombiTable1D_init(
                   const  char*  tableName,
                   const  char*  fileName,
@@ -1716,6 +2100,18 @@ extern double ModelicaTables_CombiTable1D_interpolate(int tableID, int icol, dou
 
 
 
+extern void ModelicaTables_CombiTable1D_interpolateColumns(int tableID, int ncol, const int *icol, double u, double *y);
+  /* Interpolate several columns of a table at once
+
+     -> tableID: Pointer to table defined with ModelicaTables_CombiTable1D_init
+     -> ncol   : Number of columns to interpolate
+     -> icol   : Columns to interpolate
+     -> u      : Abscissa value
+     <- y      : Ordinate values of the columns
+ */
+
+
+
 extern int ModelicaTables_CombiTable2D_init(
                    const char*   tableName,
                    const char*   fileName,
@@ -1776,6 +2172,11 @@ double ModelicaTables_CombiTimeTable_interpolate(int tableID, int icol, double u
   return omcTableTimeIpo(tableID,icol,u);
 }
 
+void ModelicaTables_CombiTimeTable_interpolateColumns(int tableID, int ncol, const int *icol, double u, double *y)
+{
+  omcTableTimeIpoColumns(tableID,ncol,icol,u,y);
+}
+
 double ModelicaTables_CombiTimeTable_minimumTime(int tableID)
 {
   return omcTableTimeTmin(tableID);
@@ -1802,6 +2203,11 @@ double ModelicaTables_CombiTable1D_interpolate(int tableID, int icol, double u)
   return omcTableTimeIpo(tableID,icol,u);
 }
 
+void ModelicaTables_CombiTable1D_interpolateColumns(int tableID, int ncol, const int *icol, double u, double *y)
+{
+  omcTableTimeIpoColumns(tableID,ncol,icol,u,y);
+}
+
 int ModelicaTables_CombiTable2D_init(const char* tableName, const char* fileName,
                                        double const *table, int nRow, int nColumn,
                                        int smoothness)
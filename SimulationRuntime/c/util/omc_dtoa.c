@@ -0,0 +1,380 @@
+/*
+ * This file is part of OpenModelica.
+ *
+ * Copyright (c) 1998-CurrentYear, Open Source Modelica Consortium (OSMC),
+ * c/o Linköpings universitet, Department of Computer and Information Science,
+ * SE-58183 Linköping, Sweden.
+ *
+ * All rights reserved.
+ *
+ * THIS PROGRAM IS PROVIDED UNDER THE TERMS OF THE BSD NEW LICENSE OR THE
+ * GPL VERSION 3 LICENSE OR THE OSMC PUBLIC LICENSE (OSMC-PL) VERSION 1.2.
+ * ANY USE, REPRODUCTION OR DISTRIBUTION OF THIS PROGRAM CONSTITUTES
+ * RECIPIENT'S ACCEPTANCE OF THE OSMC PUBLIC LICENSE OR THE GPL VERSION 3,
+ * ACCORDING TO RECIPIENTS CHOICE.
+ *
+ * The OpenModelica software and the OSMC (Open Source Modelica Consortium)
+ * Public License (OSMC-PL) are obtained from OSMC, either from the above
+ * address, from the URLs: http://www.openmodelica.org or
+ * http://www.ida.liu.se/projects/OpenModelica, and in the OpenModelica
+ * distribution. GNU version 3 is obtained from:
+ * http://www.gnu.org/copyleft/gpl.html. The New BSD License is obtained from:
+ * http://www.opensource.org/licenses/BSD-3-Clause.
+ *
+ * This program is distributed WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, EXCEPT AS
+ * EXPRESSLY SET FORTH IN THE BY RECIPIENT SELECTED SUBSIDIARY LICENSE
+ * CONDITIONS OF OSMC-PL.
+ *
+ */
+
+/*
+ * Grisu2 with the boundaries of the double, following
+ *   Florian Loitsch, "Printing Floating-Point Numbers Quickly and Accurately
+ *   with Integers", PLDI 2010
+ * The digits are generated from a 64-bit approximation of value*10^-k that is
+ * scaled into [2^-60, 2^-32), so all arithmetic is done with integers.
+ */
+
+#include "omc_dtoa.h"
+#include "omc_msvc.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+typedef struct {
+  uint64_t f;
+  int e;
+} diy_fp;
+
+typedef struct {
+  uint64_t f;
+  int e;
+  int k;
+} cached_power;
+
+#define DTOA_ALPHA -60
+#define DTOA_GAMMA -32
+
+/* 10^k as normalized diy_fp for k = -300, -292, ..., 324 */
+#define DTOA_POWERS_MIN_DEC_EXP -300
+#define DTOA_POWERS_DEC_STEP 8
+static const cached_power dtoa_powers[] = {
+  { UINT64_C(0xAB70FE17C79AC6CA), -1060, -300 },
+  { UINT64_C(0xFF77B1FCBEBCDC4F), -1034, -292 },
+  { UINT64_C(0xBE5691EF416BD60C), -1007, -284 },
+  { UINT64_C(0x8DD01FAD907FFC3C),  -980, -276 },
+  { UINT64_C(0xD3515C2831559A83),  -954, -268 },
+  { UINT64_C(0x9D71AC8FADA6C9B5),  -927, -260 },
+  { UINT64_C(0xEA9C227723EE8BCB),  -901, -252 },
+  { UINT64_C(0xAECC49914078536D),  -874, -244 },
+  { UINT64_C(0x823C12795DB6CE57),  -847, -236 },
+  { UINT64_C(0xC21094364DFB5637),  -821, -228 },
+  { UINT64_C(0x9096EA6F3848984F),  -794, -220 },
+  { UINT64_C(0xD77485CB25823AC7),  -768, -212 },
+  { UINT64_C(0xA086CFCD97BF97F4),  -741, -204 },
+  { UINT64_C(0xEF340A98172AACE5),  -715, -196 },
+  { UINT64_C(0xB23867FB2A35B28E),  -688, -188 },
+  { UINT64_C(0x84C8D4DFD2C63F3B),  -661, -180 },
+  { UINT64_C(0xC5DD44271AD3CDBA),  -635, -172 },
+  { UINT64_C(0x936B9FCEBB25C996),  -608, -164 },
+  { UINT64_C(0xDBAC6C247D62A584),  -582, -156 },
+  { UINT64_C(0xA3AB66580D5FDAF6),  -555, -148 },
+  { UINT64_C(0xF3E2F893DEC3F126),  -529, -140 },
+  { UINT64_C(0xB5B5ADA8AAFF80B8),  -502, -132 },
+  { UINT64_C(0x87625F056C7C4A8B),  -475, -124 },
+  { UINT64_C(0xC9BCFF6034C13053),  -449, -116 },
+  { UINT64_C(0x964E858C91BA2655),  -422, -108 },
+  { UINT64_C(0xDFF9772470297EBD),  -396, -100 },
+  { UINT64_C(0xA6DFBD9FB8E5B88F),  -369,  -92 },
+  { UINT64_C(0xF8A95FCF88747D94),  -343,  -84 },
+  { UINT64_C(0xB94470938FA89BCF),  -316,  -76 },
+  { UINT64_C(0x8A08F0F8BF0F156B),  -289,  -68 },
+  { UINT64_C(0xCDB02555653131B6),  -263,  -60 },
+  { UINT64_C(0x993FE2C6D07B7FAC),  -236,  -52 },
+  { UINT64_C(0xE45C10C42A2B3B06),  -210,  -44 },
+  { UINT64_C(0xAA242499697392D3),  -183,  -36 },
+  { UINT64_C(0xFD87B5F28300CA0E),  -157,  -28 },
+  { UINT64_C(0xBCE5086492111AEB),  -130,  -20 },
+  { UINT64_C(0x8CBCCC096F5088CC),  -103,  -12 },
+  { UINT64_C(0xD1B71758E219652C),   -77,   -4 },
+  { UINT64_C(0x9C40000000000000),   -50,    4 },
+  { UINT64_C(0xE8D4A51000000000),   -24,   12 },
+  { UINT64_C(0xAD78EBC5AC620000),     3,   20 },
+  { UINT64_C(0x813F3978F8940984),    30,   28 },
+  { UINT64_C(0xC097CE7BC90715B3),    56,   36 },
+  { UINT64_C(0x8F7E32CE7BEA5C70),    83,   44 },
+  { UINT64_C(0xD5D238A4ABE98068),   109,   52 },
+  { UINT64_C(0x9F4F2726179A2245),   136,   60 },
+  { UINT64_C(0xED63A231D4C4FB27),   162,   68 },
+  { UINT64_C(0xB0DE65388CC8ADA8),   189,   76 },
+  { UINT64_C(0x83C7088E1AAB65DB),   216,   84 },
+  { UINT64_C(0xC45D1DF942711D9A),   242,   92 },
+  { UINT64_C(0x924D692CA61BE758),   269,  100 },
+  { UINT64_C(0xDA01EE641A708DEA),   295,  108 },
+  { UINT64_C(0xA26DA3999AEF774A),   322,  116 },
+  { UINT64_C(0xF209787BB47D6B85),   348,  124 },
+  { UINT64_C(0xB454E4A179DD1877),   375,  132 },
+  { UINT64_C(0x865B86925B9BC5C2),   402,  140 },
+  { UINT64_C(0xC83553C5C8965D3D),   428,  148 },
+  { UINT64_C(0x952AB45CFA97A0B3),   455,  156 },
+  { UINT64_C(0xDE469FBD99A05FE3),   481,  164 },
+  { UINT64_C(0xA59BC234DB398C25),   508,  172 },
+  { UINT64_C(0xF6C69A72A3989F5C),   534,  180 },
+  { UINT64_C(0xB7DCBF5354E9BECE),   561,  188 },
+  { UINT64_C(0x88FCF317F22241E2),   588,  196 },
+  { UINT64_C(0xCC20CE9BD35C78A5),   614,  204 },
+  { UINT64_C(0x98165AF37B2153DF),   641,  212 },
+  { UINT64_C(0xE2A0B5DC971F303A),   667,  220 },
+  { UINT64_C(0xA8D9D1535CE3B396),   694,  228 },
+  { UINT64_C(0xFB9B7CD9A4A7443C),   720,  236 },
+  { UINT64_C(0xBB764C4CA7A44410),   747,  244 },
+  { UINT64_C(0x8BAB8EEFB6409C1A),   774,  252 },
+  { UINT64_C(0xD01FEF10A657842C),   800,  260 },
+  { UINT64_C(0x9B10A4E5E9913129),   827,  268 },
+  { UINT64_C(0xE7109BFBA19C0C9D),   853,  276 },
+  { UINT64_C(0xAC2820D9623BF429),   880,  284 },
+  { UINT64_C(0x80444B5E7AA7CF85),   907,  292 },
+  { UINT64_C(0xBF21E44003ACDD2D),   933,  300 },
+  { UINT64_C(0x8E679C2F5E44FF8F),   960,  308 },
+  { UINT64_C(0xD433179D9C8CB841),   986,  316 },
+  { UINT64_C(0x9E19DB92B4E31BA9),  1013,  324 },};
+
+static diy_fp diy_fp_sub(diy_fp x, diy_fp y)
+{
+  diy_fp r;
+  r.f = x.f - y.f;
+  r.e = x.e;
+  return r;
+}
+
+/* the upper 64 bits of x.f*y.f, rounded */
+static diy_fp diy_fp_mul(diy_fp x, diy_fp y)
+{
+  const uint64_t u_lo = x.f & 0xFFFFFFFFu, u_hi = x.f >> 32;
+  const uint64_t v_lo = y.f & 0xFFFFFFFFu, v_hi = y.f >> 32;
+  const uint64_t p0 = u_lo * v_lo, p1 = u_lo * v_hi, p2 = u_hi * v_lo, p3 = u_hi * v_hi;
+  uint64_t q = (p0 >> 32) + (p1 & 0xFFFFFFFFu) + (p2 & 0xFFFFFFFFu);
+  diy_fp r;
+  q += UINT64_C(1) << 31;
+  r.f = p3 + (p2 >> 32) + (p1 >> 32) + (q >> 32);
+  r.e = x.e + y.e + 64;
+  return r;
+}
+
+static diy_fp diy_fp_normalize(diy_fp x)
+{
+  while((x.f >> 63) == 0) {
+    x.f <<= 1;
+    x.e--;
+  }
+  return x;
+}
+
+static diy_fp diy_fp_normalize_to(diy_fp x, int e)
+{
+  x.f <<= x.e - e;
+  x.e = e;
+  return x;
+}
+
+/* value = w and the neighbouring boundaries m_minus < w < m_plus, all with the same exponent */
+static void dtoa_boundaries(double value, diy_fp *m_minus, diy_fp *w, diy_fp *m_plus)
+{
+  uint64_t bits, fraction;
+  int biasedExponent;
+  diy_fp v, plus, minus;
+
+  memcpy(&bits, &value, sizeof(double));
+  fraction = bits & ((UINT64_C(1) << 52) - 1);
+  biasedExponent = (int) (bits >> 52);
+
+  if(biasedExponent == 0) {
+    v.f = fraction;
+    v.e = 1 - 1075;
+  } else {
+    v.f = fraction | (UINT64_C(1) << 52);
+    v.e = biasedExponent - 1075;
+  }
+
+  plus.f = 2*v.f + 1;
+  plus.e = v.e - 1;
+  if(fraction == 0 && biasedExponent > 1) {
+    /* the lower boundary is closer (value is a power of 2) */
+    minus.f = 4*v.f - 1;
+    minus.e = v.e - 2;
+  } else {
+    minus.f = 2*v.f - 1;
+    minus.e = v.e - 1;
+  }
+
+  *m_plus = diy_fp_normalize(plus);
+  *m_minus = diy_fp_normalize_to(minus, m_plus->e);
+  *w = diy_fp_normalize(v);
+}
+
+static cached_power dtoa_cached_power(int e)
+{
+  /* k = ceil((alpha - e - 1) * log10(2)) */
+  const int f = DTOA_ALPHA - e - 1;
+  const int k = (f * 78913) / (1 << 18) + (f > 0);
+  const int index = (-DTOA_POWERS_MIN_DEC_EXP + k + (DTOA_POWERS_DEC_STEP - 1)) / DTOA_POWERS_DEC_STEP;
+  return dtoa_powers[index];
+}
+
+/* number of digits of n; pow10 is the largest power of 10 <= n */
+static int dtoa_largest_pow10(uint32_t n, uint32_t *pow10)
+{
+  static const uint32_t p[] = {1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000};
+  int k = 9;
+  while(k > 0 && n < p[k])
+    k--;
+  *pow10 = p[k];
+  return k + 1;
+}
+
+/* moves the last digit towards w as long as the number stays within the boundaries */
+static void dtoa_round(char *buffer, int length, uint64_t dist, uint64_t delta, uint64_t rest, uint64_t ten_k)
+{
+  while(rest < dist && delta - rest >= ten_k && (rest + ten_k < dist || dist - rest > rest + ten_k - dist)) {
+    buffer[length-1]--;
+    rest += ten_k;
+  }
+}
+
+static int dtoa_digits(char *buffer, int *decimalExponent, diy_fp M_minus, diy_fp w, diy_fp M_plus)
+{
+  uint64_t delta = diy_fp_sub(M_plus, M_minus).f;
+  uint64_t dist = diy_fp_sub(M_plus, w).f;
+  const int shift = -M_plus.e;
+  const uint64_t one = UINT64_C(1) << shift;
+  uint32_t p1 = (uint32_t) (M_plus.f >> shift); /* integral part */
+  uint64_t p2 = M_plus.f & (one - 1);           /* fractional part */
+  uint32_t pow10;
+  int length = 0, n, m;
+
+  n = dtoa_largest_pow10(p1, &pow10);
+  while(n > 0) {
+    uint64_t rest;
+    buffer[length++] = (char) ('0' + p1 / pow10);
+    p1 %= pow10;
+    n--;
+    rest = ((uint64_t) p1 << shift) + p2;
+    if(rest <= delta) {
+      *decimalExponent += n;
+      dtoa_round(buffer, length, dist, delta, rest, (uint64_t) pow10 << shift);
+      return length;
+    }
+    pow10 /= 10;
+  }
+
+  for(m = 0; ; ) {
+    p2 *= 10;
+    buffer[length++] = (char) ('0' + (p2 >> shift));
+    p2 &= one - 1;
+    m++;
+    delta *= 10;
+    dist *= 10;
+    if(p2 <= delta)
+      break;
+  }
+  *decimalExponent -= m;
+  dtoa_round(buffer, length, dist, delta, p2, one);
+  return length;
+}
+
+static int dtoa_exponent(char *buffer, int e)
+{
+  int n = 0;
+  buffer[n++] = 'e';
+  if(e < 0) {
+    buffer[n++] = '-';
+    e = -e;
+  } else {
+    buffer[n++] = '+';
+  }
+  if(e >= 100) {
+    buffer[n++] = (char) ('0' + e / 100);
+    e %= 100;
+  }
+  buffer[n++] = (char) ('0' + e / 10);
+  buffer[n++] = (char) ('0' + e % 10);
+  return n;
+}
+
+int omc_dtoa_shortest(double value, char *buffer)
+{
+  char digits[20];
+  diy_fp m_minus, w, m_plus, c, M_minus, M_plus;
+  cached_power cached;
+  int n = 0, length, decimalExponent, x, i;
+  uint64_t bits;
+
+  memcpy(&bits, &value, sizeof(double));
+  if(bits >> 63) {
+    buffer[n++] = '-';
+    value = -value;
+  }
+  if(isnan(value)) {
+    strcpy(buffer + n, "nan");
+    return n + 3;
+  }
+  if(isinf(value)) {
+    strcpy(buffer + n, "inf");
+    return n + 3;
+  }
+  if(value == 0) {
+    buffer[n++] = '0';
+    buffer[n] = '\0';
+    return n;
+  }
+
+  dtoa_boundaries(value, &m_minus, &w, &m_plus);
+  cached = dtoa_cached_power(m_plus.e);
+  c.f = cached.f;
+  c.e = cached.e;
+  w = diy_fp_mul(w, c);
+  M_minus = diy_fp_mul(m_minus, c);
+  M_plus = diy_fp_mul(m_plus, c);
+  /* stay strictly inside the boundaries, the products are only approximations */
+  M_minus.f++;
+  M_plus.f--;
+  decimalExponent = -cached.k;
+  length = dtoa_digits(digits, &decimalExponent, M_minus, w, M_plus);
+
+  /* value = digits * 10^decimalExponent = d.ddd * 10^x */
+  x = length + decimalExponent - 1;
+  if(x < -4 || x > 16) {
+    buffer[n++] = digits[0];
+    if(length > 1) {
+      buffer[n++] = '.';
+      memcpy(buffer + n, digits + 1, length - 1);
+      n += length - 1;
+    }
+    n += dtoa_exponent(buffer + n, x);
+  } else if(decimalExponent >= 0) {
+    /* integral: 1234500 */
+    memcpy(buffer + n, digits, length);
+    n += length;
+    for(i = 0; i < decimalExponent; i++)
+      buffer[n++] = '0';
+  } else if(x >= 0) {
+    /* 123.45 */
+    memcpy(buffer + n, digits, x + 1);
+    n += x + 1;
+    buffer[n++] = '.';
+    memcpy(buffer + n, digits + x + 1, length - x - 1);
+    n += length - x - 1;
+  } else {
+    /* 0.0012345 */
+    buffer[n++] = '0';
+    buffer[n++] = '.';
+    for(i = -1; i > x; i--)
+      buffer[n++] = '0';
+    memcpy(buffer + n, digits, length);
+    n += length;
+  }
+  buffer[n] = '\0';
+  return n;
+}
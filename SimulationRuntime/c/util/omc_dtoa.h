@@ -0,0 +1,64 @@
+/*
+ * This file is part of OpenModelica.
+ *
+ * Copyright (c) 1998-CurrentYear, Open Source Modelica Consortium (OSMC),
+ * c/o Linköpings universitet, Department of Computer and Information Science,
+ * SE-58183 Linköping, Sweden.
+ *
+ * All rights reserved.
+ *
+ * THIS PROGRAM IS PROVIDED UNDER THE TERMS OF THE BSD NEW LICENSE OR THE
+ * GPL VERSION 3 LICENSE OR THE OSMC PUBLIC LICENSE (OSMC-PL) VERSION 1.2.
+ * ANY USE, REPRODUCTION OR DISTRIBUTION OF THIS PROGRAM CONSTITUTES
+ * RECIPIENT'S ACCEPTANCE OF THE OSMC PUBLIC LICENSE OR THE GPL VERSION 3,
+ * ACCORDING TO RECIPIENTS CHOICE.
+ *
+ * The OpenModelica software and the OSMC (Open Source Modelica Consortium)
+ * Public License (OSMC-PL) are obtained from OSMC, either from the above
+ * address, from the URLs: http://www.openmodelica.org or
+ * http://www.ida.liu.se/projects/OpenModelica, and in the OpenModelica
+ * distribution. GNU version 3 is obtained from:
+ * http://www.gnu.org/copyleft/gpl.html. The New BSD License is obtained from:
+ * http://www.opensource.org/licenses/BSD-3-Clause.
+ *
+ * This program is distributed WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, EXCEPT AS
+ * EXPRESSLY SET FORTH IN THE BY RECIPIENT SELECTED SUBSIDIARY LICENSE
+ * CONDITIONS OF OSMC-PL.
+ *
+ */
+
+/*
+ * Conversion of doubles to the shortest decimal string that reads back to
+ * the same double. This is a lot faster than printf("%.17g") and used by the
+ * text result formats.
+ */
+
+#ifndef OMC_DTOA_H
+#define OMC_DTOA_H
+
+/* Enough for the longest result ("-2.2250738585072014e-308") and the 0 */
+#define OMC_DTOA_BUFFER_SIZE 32
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Writes the shortest representation of value that round-trips, using the
+ * Grisu2 algorithm (Florian Loitsch, "Printing Floating-Point Numbers Quickly
+ * and Accurately with Integers", PLDI 2010). The result always reads back to
+ * value; in rare cases it has one digit more than necessary.
+ *
+ * Like %g, fixed notation is used for decimal exponents from -4 to 16 and
+ * scientific notation (1e+20) otherwise; nan and inf are written as by printf.
+ *
+ * buffer needs OMC_DTOA_BUFFER_SIZE bytes. Returns the length of the
+ * (null-terminated) string.
+ */
+int omc_dtoa_shortest(double value, char *buffer);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif
@@ -60,6 +60,29 @@ omc_mmap_read_unix omc_mmap_open_read_unix(const char *fileName)
   return res;
 }
 
+omc_mmap_read_unix omc_mmap_try_open_read_unix(const char *fileName)
+{
+  struct stat s;
+  omc_mmap_read_unix res = {0};
+  const char *data;
+  int fd = open(fileName, O_RDONLY);
+  if (fd < 0) {
+    return res;
+  }
+  if (fstat(fd, &s) < 0 || s.st_size == 0) {
+    close(fd);
+    return res;
+  }
+  data = (const char*) mmap(0, s.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    return res;
+  }
+  res.size = s.st_size;
+  res.data = data;
+  return res;
+}
+
 omc_mmap_write_unix omc_mmap_open_write_unix(const char *fileName, size_t size)
 {
   omc_mmap_write_unix res = {0};
@@ -130,6 +153,32 @@ omc_mmap_read_inmemory omc_mmap_open_read_inmemory(const char *fileName)
   return res;
 }
 
+omc_mmap_read_inmemory omc_mmap_try_open_read_inmemory(const char *fileName)
+{
+  omc_mmap_read_inmemory res = {0};
+  FILE *file = fopen(fileName, "rb");
+  long fileSize;
+  char *data;
+  if (!file) {
+    return res;
+  }
+  if (fseek(file, 0, SEEK_END) || (fileSize = ftell(file)) <= 0) {
+    fclose(file);
+    return res;
+  }
+  rewind(file);
+  data = (char*) malloc(fileSize);
+  if (!data || 1 != fread(data, fileSize, 1, file)) {
+    free(data);
+    fclose(file);
+    return res;
+  }
+  fclose(file);
+  res.size = fileSize;
+  res.data = data;
+  return res;
+}
+
 omc_mmap_write_inmemory omc_mmap_open_write_inmemory(const char *fileName, size_t size)
 {
   omc_mmap_write_inmemory res = {0};
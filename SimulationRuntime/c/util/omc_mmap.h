@@ -78,6 +78,9 @@ typedef struct {
 } omc_mmap_write_inmemory;
 
 omc_mmap_read_inmemory omc_mmap_open_read_inmemory(const char *filename);
+/* Like omc_mmap_open_read_inmemory, but returns an empty map (data==NULL)
+ * instead of throwing if the file cannot be read */
+omc_mmap_read_inmemory omc_mmap_try_open_read_inmemory(const char *filename);
 omc_mmap_write_inmemory omc_mmap_open_write_inmemory(const char *filename, size_t size);
 void omc_mmap_close_read_inmemory(omc_mmap_read_inmemory map);
 void omc_mmap_close_write_inmemory(omc_mmap_write_inmemory map);
@@ -85,6 +88,9 @@ void omc_mmap_close_write_inmemory(omc_mmap_write_inmemory map);
 #if HAVE_MMAP
 
 omc_mmap_read_unix omc_mmap_open_read_unix(const char *filename);
+/* Like omc_mmap_open_read_unix, but returns an empty map (data==NULL)
+ * instead of throwing if the file cannot be mapped */
+omc_mmap_read_unix omc_mmap_try_open_read_unix(const char *filename);
 omc_mmap_write_unix omc_mmap_open_write_unix(const char *filename, size_t size);
 void omc_mmap_close_read_unix(omc_mmap_read_unix map);
 void omc_mmap_close_write_unix(omc_mmap_write_unix map);
@@ -92,6 +98,7 @@ void omc_mmap_close_write_unix(omc_mmap_write_unix map);
 typedef omc_mmap_read_unix omc_mmap_read;
 typedef omc_mmap_write_unix omc_mmap_write;
 #define omc_mmap_open_read(X) omc_mmap_open_read_unix(X);
+#define omc_mmap_try_open_read(X) omc_mmap_try_open_read_unix(X)
 #define omc_mmap_open_write(X,Y) omc_mmap_open_write_unix(X,Y);
 #define omc_mmap_close_read(X) omc_mmap_close_read_unix(X);
 #define omc_mmap_close_write(X) omc_mmap_close_write_unix(X);
@@ -101,6 +108,7 @@ typedef omc_mmap_write_unix omc_mmap_write;
 typedef omc_mmap_read_inmemory omc_mmap_read;
 typedef omc_mmap_write_inmemory omc_mmap_write;
 #define omc_mmap_open_read(X) omc_mmap_open_read_inmemory(X);
+#define omc_mmap_try_open_read(X) omc_mmap_try_open_read_inmemory(X)
 #define omc_mmap_open_write(X,Y) omc_mmap_open_write_inmemory(X,Y);
 #define omc_mmap_close_read(X) omc_mmap_close_read_inmemory(X);
 #define omc_mmap_close_write(X) omc_mmap_close_write_inmemory(X);
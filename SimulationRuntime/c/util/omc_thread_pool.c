@@ -0,0 +1,195 @@
+/*
+ * This file is part of OpenModelica.
+ *
+ * Copyright (c) 1998-CurrentYear, Open Source Modelica Consortium (OSMC),
+ * c/o Linköpings universitet, Department of Computer and Information Science,
+ * SE-58183 Linköping, Sweden.
+ *
+ * All rights reserved.
+ *
+ * THIS PROGRAM IS PROVIDED UNDER THE TERMS OF THE BSD NEW LICENSE OR THE
+ * GPL VERSION 3 LICENSE OR THE OSMC PUBLIC LICENSE (OSMC-PL) VERSION 1.2.
+ * ANY USE, REPRODUCTION OR DISTRIBUTION OF THIS PROGRAM CONSTITUTES
+ * RECIPIENT'S ACCEPTANCE OF THE OSMC PUBLIC LICENSE OR THE GPL VERSION 3,
+ * ACCORDING TO RECIPIENTS CHOICE.
+ *
+ * The OpenModelica software and the OSMC (Open Source Modelica Consortium)
+ * Public License (OSMC-PL) are obtained from OSMC, either from the above
+ * address, from the URLs: http://www.openmodelica.org or
+ * http://www.ida.liu.se/projects/OpenModelica, and in the OpenModelica
+ * distribution. GNU version 3 is obtained from:
+ * http://www.gnu.org/copyleft/gpl.html. The New BSD License is obtained from:
+ * http://www.opensource.org/licenses/BSD-3-Clause.
+ *
+ * This program is distributed WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, EXCEPT AS
+ * EXPRESSLY SET FORTH IN THE BY RECIPIENT SELECTED SUBSIDIARY LICENSE
+ * CONDITIONS OF OSMC-PL.
+ *
+ */
+
+#include <stdlib.h>
+#include <pthread.h>
+
+#include "omc_thread_pool.h"
+
+/* the workers evaluate model code which allocates from the garbage
+ * collector, so it has to know about the threads to scan their stacks */
+#if !defined(OMC_MINIMAL_RUNTIME)
+#include "meta/gc/mmc_gc.h"
+#define omc_thread_pool_pthread_create GC_pthread_create
+#define omc_thread_pool_pthread_join GC_pthread_join
+#else
+#define omc_thread_pool_pthread_create pthread_create
+#define omc_thread_pool_pthread_join pthread_join
+#endif
+
+typedef struct {
+  OMC_THREAD_POOL *pool;
+  int index;
+} OMC_THREAD_POOL_WORKER;
+
+struct OMC_THREAD_POOL {
+  int nThreads;
+  pthread_t *threads;
+  OMC_THREAD_POOL_WORKER *workers;
+  pthread_mutex_t mutex;
+  pthread_cond_t start;         /* signaled when a new job is available */
+  pthread_cond_t done;          /* signaled when the last worker finished the job */
+  unsigned long generation;     /* number of the current job */
+  int running;                  /* threads which did not finish the current job */
+  int shutdown;
+
+  omc_thread_pool_task task;
+  void *arg;
+  int nTasks;
+  int nextTask;
+};
+
+/* works on the current job until no task is left; called and returns with the mutex locked */
+static void omc_thread_pool_work(OMC_THREAD_POOL *pool, int worker)
+{
+  int task;
+
+  while (pool->nextTask < pool->nTasks) {
+    task = pool->nextTask++;
+    pthread_mutex_unlock(&pool->mutex);
+    pool->task(pool->arg, worker, task);
+    pthread_mutex_lock(&pool->mutex);
+  }
+}
+
+static void* omc_thread_pool_thread(void *arg)
+{
+  OMC_THREAD_POOL_WORKER *worker = (OMC_THREAD_POOL_WORKER*) arg;
+  OMC_THREAD_POOL *pool = worker->pool;
+  unsigned long generation = 0;
+
+  pthread_mutex_lock(&pool->mutex);
+  for (;;) {
+    while (!pool->shutdown && pool->generation == generation) {
+      pthread_cond_wait(&pool->start, &pool->mutex);
+    }
+    if (pool->shutdown) {
+      break;
+    }
+    generation = pool->generation;
+    omc_thread_pool_work(pool, worker->index);
+    if (0 == --pool->running) {
+      pthread_cond_signal(&pool->done);
+    }
+  }
+  pthread_mutex_unlock(&pool->mutex);
+  return NULL;
+}
+
+OMC_THREAD_POOL* omc_thread_pool_create(int nThreads)
+{
+  OMC_THREAD_POOL *pool;
+  int i;
+
+  if (nThreads < 1) {
+    return NULL;
+  }
+  pool = (OMC_THREAD_POOL*) calloc(1, sizeof(OMC_THREAD_POOL));
+  if (!pool) {
+    return NULL;
+  }
+  pool->threads = (pthread_t*) malloc(nThreads*sizeof(pthread_t));
+  pool->workers = (OMC_THREAD_POOL_WORKER*) malloc(nThreads*sizeof(OMC_THREAD_POOL_WORKER));
+  if (!pool->threads || !pool->workers) {
+    free(pool->threads);
+    free(pool->workers);
+    free(pool);
+    return NULL;
+  }
+  pthread_mutex_init(&pool->mutex, NULL);
+  pthread_cond_init(&pool->start, NULL);
+  pthread_cond_init(&pool->done, NULL);
+
+  /* worker 0 is the thread calling omc_thread_pool_run */
+  pool->nThreads = 1;
+  for (i = 1; i < nThreads; i++) {
+    pool->workers[i].pool = pool;
+    pool->workers[i].index = i;
+    if (omc_thread_pool_pthread_create(&pool->threads[i], NULL, omc_thread_pool_thread, &pool->workers[i])) {
+      break;
+    }
+    pool->nThreads++;
+  }
+  return pool;
+}
+
+void omc_thread_pool_free(OMC_THREAD_POOL *pool)
+{
+  int i;
+
+  if (!pool) {
+    return;
+  }
+  pthread_mutex_lock(&pool->mutex);
+  pool->shutdown = 1;
+  pthread_cond_broadcast(&pool->start);
+  pthread_mutex_unlock(&pool->mutex);
+  for (i = 1; i < pool->nThreads; i++) {
+    omc_thread_pool_pthread_join(pool->threads[i], NULL);
+  }
+  pthread_cond_destroy(&pool->done);
+  pthread_cond_destroy(&pool->start);
+  pthread_mutex_destroy(&pool->mutex);
+  free(pool->threads);
+  free(pool->workers);
+  free(pool);
+}
+
+int omc_thread_pool_size(OMC_THREAD_POOL *pool)
+{
+  return pool ? pool->nThreads : 1;
+}
+
+void omc_thread_pool_run(OMC_THREAD_POOL *pool, omc_thread_pool_task task, void *arg, int nTasks)
+{
+  int i;
+
+  if (!pool || pool->nThreads == 1 || nTasks < 2) {
+    for (i = 0; i < nTasks; i++) {
+      task(arg, 0, i);
+    }
+    return;
+  }
+
+  pthread_mutex_lock(&pool->mutex);
+  pool->task = task;
+  pool->arg = arg;
+  pool->nTasks = nTasks;
+  pool->nextTask = 0;
+  pool->running = pool->nThreads - 1;
+  pool->generation++;
+  pthread_cond_broadcast(&pool->start);
+
+  omc_thread_pool_work(pool, 0);
+  while (pool->running > 0) {
+    pthread_cond_wait(&pool->done, &pool->mutex);
+  }
+  pthread_mutex_unlock(&pool->mutex);
+}
@@ -0,0 +1,66 @@
+/*
+ * This file is part of OpenModelica.
+ *
+ * Copyright (c) 1998-CurrentYear, Open Source Modelica Consortium (OSMC),
+ * c/o Linköpings universitet, Department of Computer and Information Science,
+ * SE-58183 Linköping, Sweden.
+ *
+ * All rights reserved.
+ *
+ * THIS PROGRAM IS PROVIDED UNDER THE TERMS OF THE BSD NEW LICENSE OR THE
+ * GPL VERSION 3 LICENSE OR THE OSMC PUBLIC LICENSE (OSMC-PL) VERSION 1.2.
+ * ANY USE, REPRODUCTION OR DISTRIBUTION OF THIS PROGRAM CONSTITUTES
+ * RECIPIENT'S ACCEPTANCE OF THE OSMC PUBLIC LICENSE OR THE GPL VERSION 3,
+ * ACCORDING TO RECIPIENTS CHOICE.
+ *
+ * The OpenModelica software and the OSMC (Open Source Modelica Consortium)
+ * Public License (OSMC-PL) are obtained from OSMC, either from the above
+ * address, from the URLs: http://www.openmodelica.org or
+ * http://www.ida.liu.se/projects/OpenModelica, and in the OpenModelica
+ * distribution. GNU version 3 is obtained from:
+ * http://www.gnu.org/copyleft/gpl.html. The New BSD License is obtained from:
+ * http://www.opensource.org/licenses/BSD-3-Clause.
+ *
+ * This program is distributed WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, EXCEPT AS
+ * EXPRESSLY SET FORTH IN THE BY RECIPIENT SELECTED SUBSIDIARY LICENSE
+ * CONDITIONS OF OSMC-PL.
+ *
+ */
+
+/*
+ * A small persistent pool of worker threads. omc_thread_pool_run hands out
+ * the tasks 0..nTasks-1 of one job to the workers and returns when all of
+ * them are done; the calling thread works on the job as worker 0, so a pool
+ * of size 1 does not create any thread at all.
+ *
+ * The worker index passed to the task is fixed for a thread as long as the
+ * pool exists, so it can select per-thread data.
+ */
+
+#ifndef OMC_THREAD_POOL_H_
+#define OMC_THREAD_POOL_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct OMC_THREAD_POOL OMC_THREAD_POOL;
+
+typedef void (*omc_thread_pool_task)(void *arg, int worker, int task);
+
+/* creates a pool of nThreads workers (including the caller); returns NULL on failure */
+OMC_THREAD_POOL* omc_thread_pool_create(int nThreads);
+
+void omc_thread_pool_free(OMC_THREAD_POOL *pool);
+
+int omc_thread_pool_size(OMC_THREAD_POOL *pool);
+
+/* calls task(arg, worker, i) for i = 0..nTasks-1 and waits for all of them */
+void omc_thread_pool_run(OMC_THREAD_POOL *pool, omc_thread_pool_task task, void *arg, int nTasks);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
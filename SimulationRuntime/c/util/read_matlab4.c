@@ -54,6 +54,9 @@ typedef struct {
 static const char *binTrans_char = "binTrans";
 static const char *binNormal_char = "binNormal";
 
+/* Number of bytes of data_2 that are gathered at once; should fit into the cache */
+#define MAT4_GATHER_BYTES (256*1024)
+
 /* strcmp ignore whitespace */
 static OMC_INLINE int strcmp_iws(const char *a, const char *b)
 {
@@ -108,6 +111,11 @@ int mat_element_length(int type)
 void omc_free_matlab4_reader(ModelicaMatReader *reader)
 {
   unsigned int i;
+  if (reader->map.data) {
+    omc_mmap_close_read(reader->map);
+    reader->map.data = NULL;
+    reader->map.size = 0;
+  }
   if (reader->file) {
     fclose(reader->file);
     reader->file = 0;
@@ -167,6 +175,7 @@ const char* omc_new_matlab4_reader(const char *filename, ModelicaMatReader *read
   if(!reader->file) return strerror(errno);
   reader->fileName = strdup(filename);
   reader->readAll = 0;
+  reader->binTrans = 1;
   for(i=0; i<nMatrix;i++) {
     MHeader_t hdr;
     int nr = fread(&hdr,sizeof(MHeader_t),1,reader->file);
@@ -407,49 +416,13 @@ const char* omc_new_matlab4_reader(const char *filename, ModelicaMatReader *read
         if(-1==fseek(reader->file,matrix_length,SEEK_CUR)) return "Corrupt header: data_2 matrix";
       }
       if(binTrans==0) {
-        unsigned int k,j;
+        /* The variables are stored contiguously; they are read on demand */
         reader->nrows = hdr.mrows;
         /* Allow empty matrix; it's not a complete file, but ok... */
         /* if(reader->nrows < 2) return "Too few rows in data_2 matrix"; */
         reader->nvar = hdr.ncols;
         reader->var_offset = ftell(reader->file);
         reader->vars = (double**) calloc(reader->nvar*2,sizeof(double*));
-        if(reader->doublePrecision==1)
-        {
-          double *tmp=NULL;
-          tmp = (double*) malloc(hdr.mrows*hdr.ncols*sizeof(double));
-          if(1 != fread(tmp,matrix_length,1,reader->file)) return "Corrupt header: data_2 matrix";
-          for(k=0; k<hdr.ncols; k++) {
-            reader->vars[k] = (double*) malloc(hdr.mrows*sizeof(double));
-            for(j=0; j<hdr.mrows; j++) {
-              reader->vars[k][j] = tmp[j+k*hdr.mrows];
-            }
-          }
-          for(k=reader->nvar; k<reader->nvar*2; k++) {
-            reader->vars[k] = (double*) malloc(hdr.mrows*sizeof(double));
-            for(j=0; j<hdr.mrows; j++) {
-              reader->vars[k][j] = -reader->vars[k-reader->nvar][j];
-            }
-          }
-          free(tmp);
-        } else {
-          float *tmp=NULL;
-          tmp = (float*) malloc(hdr.mrows*hdr.ncols*sizeof(float));
-          if(1 != fread(tmp,matrix_length,1,reader->file)) return "Corrupt header: data_2 matrix";
-          for(k=0; k<hdr.ncols; k++) {
-            reader->vars[k] = (double*) malloc(hdr.mrows*sizeof(double));
-            for(j=0; j<hdr.mrows; j++) {
-              reader->vars[k][j] = tmp[j+k*hdr.mrows];
-            }
-          }
-          for(k=reader->nvar; k<reader->nvar*2; k++) {
-            reader->vars[k] = (double*) malloc(hdr.mrows*sizeof(double));
-            for(j=0; j<hdr.mrows; j++) {
-              reader->vars[k][j] = -reader->vars[k-reader->nvar][j];
-            }
-          }
-          free(tmp);
-        }
         if(-1==fseek(reader->file,matrix_length,SEEK_CUR)) return "Corrupt header: data_2 matrix";
       }
       break;
@@ -458,6 +431,20 @@ const char* omc_new_matlab4_reader(const char *filename, ModelicaMatReader *read
       return "Implementation error: Unknown case";
     }
   };
+  reader->binTrans = binTrans;
+#if HAVE_MMAP
+  /* Map the file so that data_2 can be read without seeking; only on 64-bit
+   * platforms since result files easily exceed the 32-bit address space */
+  if (sizeof(void*) >= 8 && reader->nvar*reader->nrows > 0) {
+    size_t element_length = reader->doublePrecision==1 ? sizeof(double) : sizeof(float);
+    reader->map = omc_mmap_try_open_read(filename);
+    if (reader->map.data && reader->map.size < reader->var_offset + element_length*reader->nvar*reader->nrows) {
+      omc_mmap_close_read(reader->map);
+      reader->map.data = NULL;
+      reader->map.size = 0;
+    }
+  }
+#endif
   return 0;
 }
 
@@ -540,60 +527,194 @@ ModelicaMatVariable_t *omc_matlab4_find_var(ModelicaMatReader *reader, const cha
   return res;
 }
 
-/* Writes the number of values in the returned array if nvals is non-NULL */
-double* omc_matlab4_read_vals(ModelicaMatReader *reader, int varIndex)
+/* A new simulation may have overwritten the file; touching pages that were
+ * truncated away would crash us, so stop using the mapping in that case.
+ * Called once at the start of every reading operation. */
+static void omc_matlab4_check_mapping(ModelicaMatReader *reader)
 {
-  size_t absVarIndex = abs(varIndex);
-  size_t ix = (varIndex < 0 ? absVarIndex + reader->nvar : absVarIndex) -1;
-  assert(absVarIndex > 0 && absVarIndex <= reader->nvar);
-  if(!reader->vars[ix]) {
-    unsigned int i;
-    double *tmp = (double*) malloc(reader->nrows*sizeof(double));
-    if(reader->doublePrecision==1)
-    {
-      for(i=0; i<reader->nrows; i++) {
-        fseek(reader->file,reader->var_offset + sizeof(double)*(i*reader->nvar + absVarIndex-1), SEEK_SET);
-        if(1 != fread(&tmp[i], sizeof(double), 1, reader->file)) {
-          /* fprintf(stderr, "Corrupt file at %d of %d? nvar %d\n", i, reader->nrows, reader->nvar); */
-          free(tmp);
-          tmp=NULL;
-          return NULL;
+#if HAVE_MMAP
+  struct stat s;
+  if (reader->map.data && (fstat(fileno(reader->file), &s) < 0 || (size_t) s.st_size != reader->map.size)) {
+    omc_mmap_close_read(reader->map);
+    reader->map.data = NULL;
+    reader->map.size = 0;
+  }
+#endif
+}
+
+/* Returns data_2 of the memory-mapped file or NULL if the file is not mapped */
+static OMC_INLINE const char* omc_matlab4_mapped_data(ModelicaMatReader *reader)
+{
+  return reader->map.data ? reader->map.data + reader->var_offset : NULL;
+}
+
+/* data_2 is not necessarily aligned in the file */
+static OMC_INLINE double omc_matlab4_element(const char *data, size_t pos, char doublePrecision)
+{
+  if (doublePrecision==1) {
+    double d;
+    memcpy(&d, data + pos*sizeof(double), sizeof(double));
+    return d;
+  } else {
+    float f;
+    memcpy(&f, data + pos*sizeof(float), sizeof(float));
+    return f;
+  }
+}
+
+/* Reads the variables cols[0..n-1] (absolute indexes) of a binTrans file
+ * into out[0..n-1]. The time points are gathered block by block, so that
+ * a block of rows stays in the cache while all requested columns are
+ * copied out of it. Without a mapped file the block is read with a single
+ * fread, unless the rows are so long that seeking to the few requested
+ * values reads less data. */
+static int omc_matlab4_gather_binTrans(ModelicaMatReader *reader, size_t n, const size_t *cols, double **out)
+{
+  size_t element_length = reader->doublePrecision==1 ? sizeof(double) : sizeof(float);
+  size_t row_length = element_length*reader->nvar;
+  size_t blockRows = MAT4_GATHER_BYTES / row_length;
+  const char *data = omc_matlab4_mapped_data(reader);
+  char *buffer = NULL;
+  size_t t0,t,k;
+
+  if (!data && row_length > n*BUFSIZ) {
+    for (k=0; k<n; k++) {
+      for (t=0; t<reader->nrows; t++) {
+        char tmp[sizeof(double)];
+        fseek(reader->file,reader->var_offset + row_length*t + element_length*cols[k], SEEK_SET);
+        if (1 != fread(tmp, element_length, 1, reader->file)) {
+          return 1;
         }
-        if(varIndex < 0) tmp[i] = -tmp[i];
-        /* fprintf(stderr, "tmp[%d]=%g\n", i, tmp[i]); */
+        out[k][t] = omc_matlab4_element(tmp, 0, reader->doublePrecision);
       }
     }
-    else
-    {
-      float *buffer = (float*) malloc(reader->nrows*sizeof(float));
-      for(i=0; i<reader->nrows; i++) {
-        fseek(reader->file,reader->var_offset + sizeof(float)*(i*reader->nvar + absVarIndex-1), SEEK_SET);
-        if(1 != fread(&buffer[i], sizeof(float), 1, reader->file)) {
-          /* fprintf(stderr, "Corrupt file at %d of %d? nvar %d\n", i, reader->nrows, reader->nvar); */
-          free(buffer);
-          free(tmp);
-          tmp=NULL;
-          return NULL;
+    return 0;
+  }
+
+  if (blockRows == 0) {
+    blockRows = 1;
+  }
+  if (!data) {
+    buffer = (char*) malloc(blockRows*row_length);
+    if (!buffer) {
+      return 1;
+    }
+    fseek(reader->file, reader->var_offset, SEEK_SET);
+  }
+  for (t0=0; t0<reader->nrows; t0+=blockRows) {
+    size_t nt = t0+blockRows > reader->nrows ? reader->nrows-t0 : blockRows;
+    const char *rows;
+    if (data) {
+      rows = data + t0*row_length;
+    } else {
+      if (nt != fread(buffer, row_length, nt, reader->file)) {
+        free(buffer);
+        return 1;
+      }
+      rows = buffer;
+    }
+    for (k=0; k<n; k++) {
+      double *dest = out[k] + t0;
+      for (t=0; t<nt; t++) {
+        dest[t] = omc_matlab4_element(rows, t*reader->nvar + cols[k], reader->doublePrecision);
+      }
+    }
+  }
+  free(buffer);
+  return 0;
+}
+
+/* Reads the variables cols[0..n-1] (absolute indexes) of a binNormal file
+ * into out[0..n-1]; every variable is a contiguous block */
+static int omc_matlab4_gather_binNormal(ModelicaMatReader *reader, size_t n, const size_t *cols, double **out)
+{
+  size_t element_length = reader->doublePrecision==1 ? sizeof(double) : sizeof(float);
+  const char *data = omc_matlab4_mapped_data(reader);
+  size_t t,k;
+
+  for (k=0; k<n; k++) {
+    if (data) {
+      const char *col = data + element_length*reader->nrows*cols[k];
+      if (reader->doublePrecision==1) {
+        memcpy(out[k], col, reader->nrows*sizeof(double));
+      } else {
+        for (t=0; t<reader->nrows; t++) {
+          out[k][t] = omc_matlab4_element(col, t, reader->doublePrecision);
         }
       }
-      if(varIndex < 0)
-      {
-        for(i=0; i<reader->nrows; i++) {
-          tmp[i] = -buffer[i];
+    } else {
+      fseek(reader->file,reader->var_offset + element_length*reader->nrows*cols[k], SEEK_SET);
+      if (reader->nrows != fread(out[k], element_length, reader->nrows, reader->file)) {
+        return 1;
+      }
+      if (reader->doublePrecision != 1) {
+        for (t=reader->nrows; t>0; t--) {
+          out[k][t-1] = ((float*)out[k])[t-1];
         }
       }
-      else
-      {
-          for(i=0; i<reader->nrows; i++) {
-            tmp[i] = buffer[i];
-          }
+    }
+  }
+  return 0;
+}
+
+int omc_matlab4_read_vals_multi(ModelicaMatReader *reader, int nvars, const int *varIndexes, double **vals)
+{
+  size_t *cols = (size_t*) malloc(nvars*sizeof(size_t));
+  size_t *ixs = (size_t*) malloc(nvars*sizeof(size_t));
+  double **out = (double**) malloc(nvars*sizeof(double*));
+  size_t n = 0, i, t;
+  int err = 0;
+
+  /* Collect the variables that were not read before */
+  for (i=0; i<nvars; i++) {
+    size_t absVarIndex = abs(varIndexes[i]);
+    size_t ix = (varIndexes[i] < 0 ? absVarIndex + reader->nvar : absVarIndex) -1;
+    assert(absVarIndex > 0 && absVarIndex <= reader->nvar);
+    if (!reader->vars[ix]) {
+      reader->vars[ix] = (double*) malloc(reader->nrows*sizeof(double));
+      cols[n] = absVarIndex-1;
+      ixs[n] = ix;
+      out[n] = reader->vars[ix];
+      n++;
+    }
+  }
+
+  if (n > 0) {
+    omc_matlab4_check_mapping(reader);
+    err = reader->binTrans ? omc_matlab4_gather_binTrans(reader, n, cols, out) : omc_matlab4_gather_binNormal(reader, n, cols, out);
+  }
+  for (i=0; i<n; i++) {
+    if (err) {
+      free(reader->vars[ixs[i]]);
+      reader->vars[ixs[i]] = NULL;
+    } else if (ixs[i] >= reader->nvar) {
+      /* Negated alias */
+      for (t=0; t<reader->nrows; t++) {
+        out[i][t] = -out[i][t];
       }
-      free(buffer);
-      /* fprintf(stderr, "tmp[%d]=%g\n", i, tmp[i]); */
     }
-    reader->vars[ix] = tmp;
   }
-  return reader->vars[ix];
+  if (vals && !err) {
+    for (i=0; i<nvars; i++) {
+      size_t absVarIndex = abs(varIndexes[i]);
+      vals[i] = reader->vars[(varIndexes[i] < 0 ? absVarIndex + reader->nvar : absVarIndex) -1];
+    }
+  }
+
+  free(cols);
+  free(ixs);
+  free(out);
+  return err;
+}
+
+/* Writes the number of values in the returned array if nvals is non-NULL */
+double* omc_matlab4_read_vals(ModelicaMatReader *reader, int varIndex)
+{
+  double *vals;
+  if (omc_matlab4_read_vals_multi(reader, 1, &varIndex, &vals)) {
+    return NULL;
+  }
+  return vals;
 }
 
 void matrix_transpose(double *m, int w, int h)
@@ -670,7 +791,9 @@ int omc_matlab4_read_all_vals(ModelicaMatReader *reader)
       tmp[i] = ((float*)tmp)[i];
     }
   }
-  matrix_transpose(tmp,nvar,nrows);
+  if (reader->binTrans) {
+    matrix_transpose(tmp,nvar,nrows);
+  }
   /* Negative aliases */
   for (i=0; i<nrows*nvar; i++) {
     tmp[nrows*nvar + i] = -tmp[i];
@@ -687,24 +810,29 @@ int omc_matlab4_read_all_vals(ModelicaMatReader *reader)
   return 0;
 }
 
-double omc_matlab4_read_single_val(double *res, ModelicaMatReader *reader, int varIndex, int timeIndex)
+/* omc_matlab4_read_single_val without checking the mapping first */
+static double omc_matlab4_read_single_val_unchecked(double *res, ModelicaMatReader *reader, int varIndex, int timeIndex)
 {
   size_t absVarIndex = abs(varIndex);
   size_t ix = (varIndex < 0 ? absVarIndex + reader->nvar : absVarIndex) -1;
+  size_t pos = reader->binTrans ? timeIndex*reader->nvar + absVarIndex-1 : (absVarIndex-1)*reader->nrows + timeIndex;
+  const char *data;
   assert(absVarIndex > 0 && absVarIndex <= reader->nvar);
   if(reader->vars[ix]) {
     *res = reader->vars[ix][timeIndex];
     return 0;
   }
-  if(reader->doublePrecision==1) {
-    fseek(reader->file,reader->var_offset + sizeof(double)*(timeIndex*reader->nvar + absVarIndex-1), SEEK_SET);
+  if((data = omc_matlab4_mapped_data(reader))) {
+    *res = omc_matlab4_element(data, pos, reader->doublePrecision);
+  } else if(reader->doublePrecision==1) {
+    fseek(reader->file,reader->var_offset + sizeof(double)*pos, SEEK_SET);
     if(1 != fread(res, sizeof(double), 1, reader->file)) {
       *res = 0;
       return 1;
     }
   } else {
     float tmpres;
-    fseek(reader->file,reader->var_offset + sizeof(float)*(timeIndex*reader->nvar + absVarIndex-1), SEEK_SET);
+    fseek(reader->file,reader->var_offset + sizeof(float)*pos, SEEK_SET);
     if(1 != fread(&tmpres, sizeof(float), 1, reader->file)) {
       *res = 0;
       return 1;
@@ -717,6 +845,12 @@ double omc_matlab4_read_single_val(double *res, ModelicaMatReader *reader, int v
   return 0;
 }
 
+double omc_matlab4_read_single_val(double *res, ModelicaMatReader *reader, int varIndex, int timeIndex)
+{
+  omc_matlab4_check_mapping(reader);
+  return omc_matlab4_read_single_val_unchecked(res, reader, varIndex, timeIndex);
+}
+
 void find_closest_points(double key, double *vec, int nelem, int *index1, double *weight1, int *index2, double *weight2)
 {
   int min = 0;
@@ -738,6 +872,15 @@ void find_closest_points(double key, double *vec, int nelem, int *index1, double
       max = mid - 1;
     }
   } while(max > min);
+  if(max == min && key == vec[max]) {
+    /* The loop may end on the matching point without looking at it */
+    while(max < nelem-1 && vec[max] == vec[max+1]) max++;
+    *index1 = max;
+    *weight1 = 1.0;
+    *index2 = -1;
+    *weight2 = 0.0;
+    return;
+  }
   if(max == min) {
     if(key > vec[max])
       max++;
@@ -776,13 +919,14 @@ int omc_matlab4_val(double *res, ModelicaMatReader *reader, ModelicaMatVariable_
     if(time < omc_matlab4_startTime(reader)) return 1;
     if(!omc_matlab4_read_vals(reader,1)) return 1;
     find_closest_points(time, reader->vars[0], reader->nrows, &i1, &w1, &i2, &w2);
+    omc_matlab4_check_mapping(reader);
     if(i2 == -1) {
-      return (int)omc_matlab4_read_single_val(res,reader,var->index,i1);
+      return (int)omc_matlab4_read_single_val_unchecked(res,reader,var->index,i1);
     } else if(i1 == -1) {
-      return (int)omc_matlab4_read_single_val(res,reader,var->index,i2);
+      return (int)omc_matlab4_read_single_val_unchecked(res,reader,var->index,i2);
     } else {
-      if(omc_matlab4_read_single_val(&y1,reader,var->index,i1)) return 1;
-      if(omc_matlab4_read_single_val(&y2,reader,var->index,i2)) return 1;
+      if(omc_matlab4_read_single_val_unchecked(&y1,reader,var->index,i1)) return 1;
+      if(omc_matlab4_read_single_val_unchecked(&y2,reader,var->index,i2)) return 1;
       *res = w1*y1 + w2*y2;
       return 0;
     }
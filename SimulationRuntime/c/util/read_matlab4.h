@@ -34,6 +34,7 @@
 #include <stdio.h>
 #include <stdint.h>
 #include "omc_msvc.h"
+#include "omc_mmap.h"
 
 typedef struct {
   char *name,*descr;
@@ -54,6 +55,8 @@ typedef struct {
   int readAll; /* Read all variables already */
   double **vars;
   char doublePrecision; /* data_1 and data_2 in double ore single precision */
+  char binTrans; /* data_2 is stored time point by time point (binTrans) or variable by variable (binNormal) */
+  omc_mmap_read map; /* The whole file if it could be memory-mapped; map.data is NULL otherwise */
 } ModelicaMatReader;
 
 /* Returns 0 on success; the error message on error.
@@ -77,12 +80,25 @@ ModelicaMatVariable_t *omc_matlab4_find_var(ModelicaMatReader *reader, const cha
  */
 double* omc_matlab4_read_vals(ModelicaMatReader *reader, int varIndex);
 
+/* Reads the values of nvars variables in a single pass over the data.
+ * The indexes are the ones of omc_matlab4_read_vals and the same restrictions apply.
+ * If vals is non-NULL, it is filled with the nvars value arrays.
+ * Returns 0 on success.
+ */
+int omc_matlab4_read_vals_multi(ModelicaMatReader *reader, int nvars, const int *varIndexes, double **vals);
+
 /* Returns 0 on success */
 int omc_matlab4_val(double *res, ModelicaMatReader *reader, ModelicaMatVariable_t *var, double time);
 
 /* For debugging */
 void omc_matlab4_print_all_vars(FILE *stream, ModelicaMatReader *reader);
 
+/* Compares the names of two variables, ignoring whitespace (for qsort/bsearch) */
+int omc_matlab4_comp_var(const void *a, const void *b);
+
+/* Finds the two points of the sorted vec to interpolate key from; index2 is -1 if key is one of the points */
+void find_closest_points(double key, double *vec, int nelem, int *index1, double *weight1, int *index2, double *weight2);
+
 double omc_matlab4_startTime(ModelicaMatReader *reader);
 
 double omc_matlab4_stopTime(ModelicaMatReader *reader);
@@ -0,0 +1,490 @@
+/*
+ * This file is part of OpenModelica.
+ *
+ * Copyright (c) 1998-CurrentYear, Open Source Modelica Consortium (OSMC),
+ * c/o Linköpings universitet, Department of Computer and Information Science,
+ * SE-58183 Linköping, Sweden.
+ *
+ * All rights reserved.
+ *
+ * THIS PROGRAM IS PROVIDED UNDER THE TERMS OF THE BSD NEW LICENSE OR THE
+ * GPL VERSION 3 LICENSE OR THE OSMC PUBLIC LICENSE (OSMC-PL) VERSION 1.2.
+ * ANY USE, REPRODUCTION OR DISTRIBUTION OF THIS PROGRAM CONSTITUTES
+ * RECIPIENT'S ACCEPTANCE OF THE OSMC PUBLIC LICENSE OR THE GPL VERSION 3,
+ * ACCORDING TO RECIPIENTS CHOICE.
+ *
+ * The OpenModelica software and the OSMC (Open Source Modelica Consortium)
+ * Public License (OSMC-PL) are obtained from OSMC, either from the above
+ * address, from the URLs: http://www.openmodelica.org or
+ * http://www.ida.liu.se/projects/OpenModelica, and in the OpenModelica
+ * distribution. GNU version 3 is obtained from:
+ * http://www.gnu.org/copyleft/gpl.html. The New BSD License is obtained from:
+ * http://www.opensource.org/licenses/BSD-3-Clause.
+ *
+ * This program is distributed WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, EXCEPT AS
+ * EXPRESSLY SET FORTH IN THE BY RECIPIENT SELECTED SUBSIDIARY LICENSE
+ * CONDITIONS OF OSMC-PL.
+ *
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <errno.h>
+#include <string.h>
+#include <math.h>
+#include "read_omz.h"
+
+/* Make Visual Studio not complain about deprecated items */
+#ifdef _MSC_VER
+#define strdup _strdup
+#endif
+
+#if defined(_MSC_VER) || defined(__MINGW32__)
+#define omz_fseek _fseeki64
+#define omz_ftell _ftelli64
+#else
+#define omz_fseek fseeko
+#define omz_ftell ftello
+#endif
+
+static int omz_read(OMZReader *reader, void *dest, size_t size)
+{
+  return size != fread(dest, 1, size, reader->file);
+}
+
+static int omz_read_uint32(OMZReader *reader, uint32_t *value)
+{
+  return omz_read(reader, value, sizeof(uint32_t));
+}
+
+static char* omz_read_str(OMZReader *reader)
+{
+  uint32_t len;
+  char *str;
+  if (omz_read_uint32(reader, &len) || len > (1u<<24)) {
+    return NULL;
+  }
+  str = (char*) malloc(len+1);
+  if (str == NULL || omz_read(reader, str, len)) {
+    free(str);
+    return NULL;
+  }
+  str[len] = '\0';
+  return str;
+}
+
+static unsigned char* omz_buffer(OMZReader *reader, size_t size)
+{
+  if (size > reader->bufferSize) {
+    unsigned char *buffer = (unsigned char*) realloc(reader->buffer, size);
+    if (buffer == NULL) {
+      return NULL;
+    }
+    reader->buffer = buffer;
+    reader->bufferSize = size;
+  }
+  return reader->buffer;
+}
+
+/* Reads the chunk index written at the end of the file; returns 0 on success */
+static int omz_read_index(OMZReader *reader, uint64_t fileSize, uint64_t *paramOffset)
+{
+  char magic[8];
+  uint64_t indexOffset;
+  uint32_t size, i;
+  unsigned char tag;
+
+  if (fileSize < 16 || omz_fseek(reader->file, fileSize-16, SEEK_SET) ||
+      omz_read(reader, &indexOffset, sizeof(uint64_t)) || omz_read(reader, magic, 8) ||
+      memcmp(magic, OMZ_TRAILER_MAGIC, 8) || indexOffset >= fileSize ||
+      omz_fseek(reader->file, indexOffset, SEEK_SET) ||
+      omz_read(reader, &tag, 1) || tag != OMZ_RECORD_INDEX ||
+      omz_read_uint32(reader, &size) || omz_read_uint32(reader, &reader->nchunks) ||
+      size != sizeof(uint32_t) + reader->nchunks*(sizeof(uint64_t)+sizeof(uint32_t)+2*sizeof(double)) + sizeof(uint64_t)) {
+    reader->nchunks = 0;
+    return 1;
+  }
+  reader->chunks = (OMZChunk*) calloc(reader->nchunks+1, sizeof(OMZChunk));
+  if (!reader->chunks) {
+    reader->nchunks = 0;
+    return 1;
+  }
+  for (i=0; i<reader->nchunks; i++) {
+    OMZChunk *chunk = &reader->chunks[i];
+    if (omz_read(reader, &chunk->offset, sizeof(uint64_t)) || omz_read_uint32(reader, &chunk->nrows) ||
+        omz_read(reader, &chunk->firstTime, sizeof(double)) || omz_read(reader, &chunk->lastTime, sizeof(double))) {
+      free(reader->chunks);
+      reader->chunks = NULL;
+      reader->nchunks = 0;
+      return 1;
+    }
+  }
+  return omz_read(reader, paramOffset, sizeof(uint64_t));
+}
+
+/* The simulation did not finish writing the file: collect the complete chunks */
+static void omz_scan_records(OMZReader *reader, uint64_t offset, uint64_t fileSize, uint64_t *paramOffset)
+{
+  uint32_t maxChunks = 0, size;
+  unsigned char tag;
+
+  while (offset + 5 <= fileSize && 0 == omz_fseek(reader->file, offset, SEEK_SET) &&
+         0 == omz_read(reader, &tag, 1) && 0 == omz_read_uint32(reader, &size) &&
+         offset + 5 + size <= fileSize) {
+    if (tag == OMZ_RECORD_PARAMETERS) {
+      *paramOffset = offset;
+    } else if (tag == OMZ_RECORD_CHUNK) {
+      OMZChunk *chunk;
+      if (reader->nchunks == maxChunks) {
+        uint32_t newMax = maxChunks ? 2*maxChunks : 64;
+        OMZChunk *chunks = (OMZChunk*) realloc(reader->chunks, (newMax+1)*sizeof(OMZChunk));
+        if (!chunks) {
+          /* keep the chunks found so far */
+          break;
+        }
+        reader->chunks = chunks;
+        maxChunks = newMax;
+      }
+      chunk = &reader->chunks[reader->nchunks];
+      memset(chunk, 0, sizeof(OMZChunk));
+      chunk->offset = offset;
+      if (omz_read_uint32(reader, &chunk->nrows) || omz_read(reader, &chunk->firstTime, sizeof(double)) ||
+          omz_read(reader, &chunk->lastTime, sizeof(double))) {
+        break;
+      }
+      reader->nchunks++;
+    } else if (tag != OMZ_RECORD_INDEX) {
+      break;
+    }
+    offset += 5 + size;
+  }
+}
+
+const char* omc_new_omz_reader(const char *filename, OMZReader *reader)
+{
+  char magic[4];
+  uint32_t version, byteOrder, chunkRows, i;
+  uint64_t headerEnd, fileSize, paramOffset = 0;
+  unsigned char tag;
+
+  memset(reader, 0, sizeof(OMZReader));
+  reader->file = fopen(filename, "rb");
+  if (!reader->file) {
+    return strerror(errno);
+  }
+  reader->fileName = strdup(filename);
+
+  if (omz_read(reader, magic, 4) || memcmp(magic, OMZ_MAGIC, 4)) {
+    omc_free_omz_reader(reader);
+    return "Not a compressed result file (wrong magic number)";
+  }
+  if (omz_read_uint32(reader, &version) || version != OMZ_VERSION) {
+    omc_free_omz_reader(reader);
+    return "Unsupported version of the compressed result format";
+  }
+  if (omz_read_uint32(reader, &byteOrder) || byteOrder != OMZ_BYTE_ORDER) {
+    omc_free_omz_reader(reader);
+    return "The compressed result file was written on a machine with a different byte order";
+  }
+  if (omz_read_uint32(reader, &chunkRows) || omz_read_uint32(reader, &reader->nsignals) || reader->nsignals == 0) {
+    omc_free_omz_reader(reader);
+    return "Corrupt header";
+  }
+  reader->kinds = (unsigned char*) malloc(reader->nsignals);
+  if (omz_read(reader, reader->kinds, reader->nsignals) || omz_read_uint32(reader, &reader->nparam)) {
+    omc_free_omz_reader(reader);
+    return "Corrupt header";
+  }
+  reader->paramKinds = (unsigned char*) malloc(reader->nparam+1);
+  reader->params = (double*) calloc(reader->nparam+1, sizeof(double));
+  if (omz_read(reader, reader->paramKinds, reader->nparam) || omz_read_uint32(reader, &reader->nall)) {
+    omc_free_omz_reader(reader);
+    return "Corrupt header";
+  }
+  reader->allInfo = (ModelicaMatVariable_t*) calloc(reader->nall+1, sizeof(ModelicaMatVariable_t));
+  for (i=0; i<reader->nall; i++) {
+    ModelicaMatVariable_t *var = &reader->allInfo[i];
+    unsigned char isParam;
+    int32_t index;
+    var->name = omz_read_str(reader);
+    var->descr = omz_read_str(reader);
+    if (!var->name || !var->descr || omz_read(reader, &isParam, 1) || omz_read(reader, &index, sizeof(int32_t)) ||
+        index == 0 || (uint32_t) abs(index) > (isParam ? reader->nparam : reader->nsignals)) {
+      reader->nall = i+1;
+      omc_free_omz_reader(reader);
+      return "Corrupt variable information";
+    }
+    var->isParam = isParam;
+    var->index = index;
+  }
+  qsort(reader->allInfo, reader->nall, sizeof(ModelicaMatVariable_t), omc_matlab4_comp_var);
+
+  /* the chunk index */
+  headerEnd = omz_ftell(reader->file);
+  omz_fseek(reader->file, 0, SEEK_END);
+  fileSize = omz_ftell(reader->file);
+  if (omz_read_index(reader, fileSize, &paramOffset)) {
+    omz_scan_records(reader, headerEnd, fileSize, &paramOffset);
+  }
+  for (i=0; i<reader->nchunks; i++) {
+    reader->chunks[i].firstRow = reader->nrows;
+    reader->chunks[i].columns = NULL;
+    reader->nrows += reader->chunks[i].nrows;
+  }
+
+  /* the parameters */
+  if (paramOffset == 0 || omz_fseek(reader->file, paramOffset, SEEK_SET) || omz_read(reader, &tag, 1) ||
+      tag != OMZ_RECORD_PARAMETERS || omz_read_uint32(reader, &version) || version != reader->nparam*sizeof(double) ||
+      omz_read(reader, reader->params, reader->nparam*sizeof(double))) {
+    omc_free_omz_reader(reader);
+    return "Could not read the parameters";
+  }
+  reader->vars = (double**) calloc(2*reader->nsignals, sizeof(double*));
+  return 0;
+}
+
+void omc_free_omz_reader(OMZReader *reader)
+{
+  uint32_t i;
+  if (reader->file) {
+    fclose(reader->file);
+  }
+  free(reader->fileName);
+  for (i=0; i<reader->nall && reader->allInfo; i++) {
+    free(reader->allInfo[i].name);
+    free(reader->allInfo[i].descr);
+  }
+  free(reader->allInfo);
+  free(reader->params);
+  free(reader->paramKinds);
+  free(reader->kinds);
+  for (i=0; i<reader->nchunks; i++) {
+    free(reader->chunks[i].columns);
+  }
+  free(reader->chunks);
+  for (i=0; i<2*reader->nsignals && reader->vars; i++) {
+    free(reader->vars[i]);
+  }
+  free(reader->vars);
+  free(reader->buffer);
+  memset(reader, 0, sizeof(OMZReader));
+}
+
+ModelicaMatVariable_t *omc_omz_find_var(OMZReader *reader, const char *varName)
+{
+  ModelicaMatVariable_t key;
+  ModelicaMatVariable_t *res;
+  char *omcName;
+
+  key.name = (char*) varName;
+  res = (ModelicaMatVariable_t*)bsearch(&key,reader->allInfo,reader->nall,sizeof(ModelicaMatVariable_t),omc_matlab4_comp_var);
+  if (res == NULL && 0==strcmp(varName, "Time")) {
+    key.name = "time";
+    res = (ModelicaMatVariable_t*)bsearch(&key,reader->allInfo,reader->nall,sizeof(ModelicaMatVariable_t),omc_matlab4_comp_var);
+  } else if (res == NULL && NULL != (omcName = openmodelicaStyleVariableName(varName))) {
+    key.name = omcName;
+    res = (ModelicaMatVariable_t*)bsearch(&key,reader->allInfo,reader->nall,sizeof(ModelicaMatVariable_t),omc_matlab4_comp_var);
+    free(omcName);
+  }
+  return res;
+}
+
+static int omz_decode_real(const unsigned char *bytes, size_t size, double *vals, uint32_t nrows)
+{
+  const unsigned char *end = bytes + size;
+  uint64_t prev = 0, x;
+  uint32_t row = 0;
+  int lead, n, i;
+
+  while (bytes < end) {
+    unsigned char c = *bytes++;
+    if (c & 0x80) {
+      n = (c & 0x7F) + 1;
+      if (row + n > nrows) {
+        return 1;
+      }
+      for (i=0; i<n; i++) {
+        memcpy(&vals[row++], &prev, sizeof(double));
+      }
+      continue;
+    }
+    lead = c >> 4;
+    n = c & 0x0F;
+    if (n == 0 || lead + n > 8 || bytes + n > end || row == nrows) {
+      return 1;
+    }
+    x = 0;
+    for (i=n-1; i>=0; i--) {
+      x = (x << 8) | bytes[i];
+    }
+    bytes += n;
+    prev ^= x << (8*(8-lead-n));
+    memcpy(&vals[row++], &prev, sizeof(double));
+  }
+  return row != nrows;
+}
+
+static int omz_decode_integer(const unsigned char *bytes, size_t size, double *vals, uint32_t nrows)
+{
+  const unsigned char *end = bytes + size;
+  uint64_t count, zigzag;
+  uint32_t row = 0;
+  double value;
+  int shift;
+
+  while (bytes < end) {
+    for (count = 0, shift = 0; bytes < end && shift < 64; shift += 7) {
+      count |= (uint64_t)(*bytes & 0x7F) << shift;
+      if (!(*bytes++ & 0x80)) break;
+    }
+    for (zigzag = 0, shift = 0; bytes < end && shift < 64; shift += 7) {
+      zigzag |= (uint64_t)(*bytes & 0x7F) << shift;
+      if (!(*bytes++ & 0x80)) break;
+    }
+    if (count > nrows - row) {
+      return 1;
+    }
+    value = (zigzag & 1) ? (double) (int64_t) ~(zigzag >> 1) : (double) (int64_t) (zigzag >> 1);
+    while (count--) {
+      vals[row++] = value;
+    }
+  }
+  return row != nrows;
+}
+
+/* Decodes signal ix (0-based) of the given chunk into vals; returns 0 on success */
+static int omz_read_chunk_signal(OMZReader *reader, OMZChunk *chunk, uint32_t ix, double *vals)
+{
+  unsigned char *bytes;
+  size_t size;
+
+  if (chunk->columns == NULL) {
+    /* the column sizes are read once per chunk */
+    uint32_t i, *sizes = (uint32_t*) omz_buffer(reader, reader->nsignals*sizeof(uint32_t));
+    uint64_t offset = chunk->offset + 1 + 2*sizeof(uint32_t) + 2*sizeof(double);
+    if (sizes == NULL || omz_fseek(reader->file, offset, SEEK_SET) || omz_read(reader, sizes, reader->nsignals*sizeof(uint32_t))) {
+      return 1;
+    }
+    chunk->columns = (uint64_t*) malloc((reader->nsignals+1)*sizeof(uint64_t));
+    if (chunk->columns == NULL) {
+      return 1;
+    }
+    offset += reader->nsignals*sizeof(uint32_t);
+    for (i=0; i<reader->nsignals; i++) {
+      chunk->columns[i] = offset;
+      offset += sizes[i];
+    }
+    chunk->columns[reader->nsignals] = offset;
+  }
+  size = chunk->columns[ix+1] - chunk->columns[ix];
+  bytes = omz_buffer(reader, size);
+  if ((size && bytes == NULL) || omz_fseek(reader->file, chunk->columns[ix], SEEK_SET) || omz_read(reader, bytes, size)) {
+    return 1;
+  }
+  if (reader->kinds[ix] == OMZ_KIND_REAL) {
+    return omz_decode_real(bytes, size, vals, chunk->nrows);
+  }
+  return omz_decode_integer(bytes, size, vals, chunk->nrows);
+}
+
+static double omz_negate(unsigned char kind, double value)
+{
+  return kind == OMZ_KIND_BOOLEAN ? (value == 0.0 ? 1.0 : 0.0) : -value;
+}
+
+double* omc_omz_read_vals(OMZReader *reader, int varIndex)
+{
+  uint32_t absVarIndex = abs(varIndex), i;
+  uint32_t ix = (varIndex < 0 ? absVarIndex + reader->nsignals : absVarIndex) - 1;
+  double *vals;
+
+  if (absVarIndex == 0 || absVarIndex > reader->nsignals) {
+    return NULL;
+  }
+  if (reader->vars[ix]) {
+    return reader->vars[ix];
+  }
+  vals = (double*) malloc((reader->nrows+1)*sizeof(double));
+  if (varIndex < 0) {
+    double *posVals = omc_omz_read_vals(reader, absVarIndex);
+    if (posVals == NULL) {
+      free(vals);
+      return NULL;
+    }
+    for (i=0; i<reader->nrows; i++) {
+      vals[i] = omz_negate(reader->kinds[absVarIndex-1], posVals[i]);
+    }
+  } else {
+    for (i=0; i<reader->nchunks; i++) {
+      if (omz_read_chunk_signal(reader, &reader->chunks[i], ix, vals + reader->chunks[i].firstRow)) {
+        free(vals);
+        return NULL;
+      }
+    }
+  }
+  reader->vars[ix] = vals;
+  return vals;
+}
+
+double omc_omz_startTime(OMZReader *reader)
+{
+  return reader->nchunks ? reader->chunks[0].firstTime : 0.0;
+}
+
+double omc_omz_stopTime(OMZReader *reader)
+{
+  return reader->nchunks ? reader->chunks[reader->nchunks-1].lastTime : 0.0;
+}
+
+int omc_omz_val(double *res, OMZReader *reader, ModelicaMatVariable_t *var, double time)
+{
+  uint32_t absVarIndex = abs(var->index), lo, hi, c, n;
+  double *times, *vals, w1, w2;
+  int i1, i2, fail = 0;
+
+  if (var->isParam) {
+    *res = var->index < 0 ? omz_negate(reader->paramKinds[absVarIndex-1], reader->params[absVarIndex-1]) : reader->params[absVarIndex-1];
+    return 0;
+  }
+  if (reader->nchunks == 0 || time > omc_omz_stopTime(reader) || time < omc_omz_startTime(reader)) {
+    return 1;
+  }
+  /* the last chunk starting at or before time; at events this gives the right limit */
+  lo = 0;
+  hi = reader->nchunks - 1;
+  while (lo < hi) {
+    uint32_t mid = lo + (hi-lo+1)/2;
+    if (reader->chunks[mid].firstTime <= time) {
+      lo = mid;
+    } else {
+      hi = mid - 1;
+    }
+  }
+  c = lo;
+  /* time may lie between the last point of this chunk and the first of the next one */
+  n = reader->chunks[c].nrows + ((time > reader->chunks[c].lastTime && c+1 < reader->nchunks) ? reader->chunks[c+1].nrows : 0);
+  times = (double*) malloc(2*n*sizeof(double));
+  vals = times + n;
+  fail = omz_read_chunk_signal(reader, &reader->chunks[c], 0, times) ||
+         omz_read_chunk_signal(reader, &reader->chunks[c], absVarIndex-1, vals);
+  if (!fail && n > reader->chunks[c].nrows) {
+    fail = omz_read_chunk_signal(reader, &reader->chunks[c+1], 0, times + reader->chunks[c].nrows) ||
+           omz_read_chunk_signal(reader, &reader->chunks[c+1], absVarIndex-1, vals + reader->chunks[c].nrows);
+  }
+  if (!fail) {
+    find_closest_points(time, times, n, &i1, &w1, &i2, &w2);
+    if (i2 == -1) {
+      *res = vals[i1];
+    } else if (i1 == -1) {
+      *res = vals[i2];
+    } else {
+      *res = w1*vals[i1] + w2*vals[i2];
+    }
+    if (var->index < 0) {
+      *res = omz_negate(reader->kinds[absVarIndex-1], *res);
+    }
+  }
+  free(times);
+  return fail;
+}
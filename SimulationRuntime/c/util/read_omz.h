@@ -0,0 +1,144 @@
+/*
+ * This file is part of OpenModelica.
+ *
+ * Copyright (c) 1998-CurrentYear, Open Source Modelica Consortium (OSMC),
+ * c/o Linköpings universitet, Department of Computer and Information Science,
+ * SE-58183 Linköping, Sweden.
+ *
+ * All rights reserved.
+ *
+ * THIS PROGRAM IS PROVIDED UNDER THE TERMS OF THE BSD NEW LICENSE OR THE
+ * GPL VERSION 3 LICENSE OR THE OSMC PUBLIC LICENSE (OSMC-PL) VERSION 1.2.
+ * ANY USE, REPRODUCTION OR DISTRIBUTION OF THIS PROGRAM CONSTITUTES
+ * RECIPIENT'S ACCEPTANCE OF THE OSMC PUBLIC LICENSE OR THE GPL VERSION 3,
+ * ACCORDING TO RECIPIENTS CHOICE.
+ *
+ * The OpenModelica software and the OSMC (Open Source Modelica Consortium)
+ * Public License (OSMC-PL) are obtained from OSMC, either from the above
+ * address, from the URLs: http://www.openmodelica.org or
+ * http://www.ida.liu.se/projects/OpenModelica, and in the OpenModelica
+ * distribution. GNU version 3 is obtained from:
+ * http://www.gnu.org/copyleft/gpl.html. The New BSD License is obtained from:
+ * http://www.opensource.org/licenses/BSD-3-Clause.
+ *
+ * This program is distributed WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, EXCEPT AS
+ * EXPRESSLY SET FORTH IN THE BY RECIPIENT SELECTED SUBSIDIARY LICENSE
+ * CONDITIONS OF OSMC-PL.
+ *
+ */
+
+/*
+ * Reader for the compressed result format (.omz) written by
+ * simulation/results/simulation_result_omz.cpp.
+ *
+ * All numbers are stored in the byte order of the writing machine; the
+ * header contains OMZ_BYTE_ORDER so a reader can detect a mismatch.
+ *
+ *   header:   "OMZ1" u32 version, u32 byteOrder, u32 chunkRows,
+ *             u32 nsignals, u8 kind[nsignals], u32 nparam, u8 kind[nparam],
+ *             u32 nall, nall * (u32 len, name, u32 len, descr, u8 isParam, i32 index)
+ *   records:  u8 tag, u32 size, size bytes of payload
+ *     'P'     nparam doubles; the last parameter record is the valid one
+ *     'C'     u32 nrows, f64 firstTime, f64 lastTime, u32 columnSize[nsignals],
+ *             followed by the encoded column of each signal
+ *     'I'     the chunk index: u32 nchunks, nchunks * (u64 offset, u32 nrows,
+ *             f64 firstTime, f64 lastTime), u64 offset of the parameter record
+ *   trailer:  u64 offset of the 'I' record, "OMZ1END"
+ *
+ * Signal 1 is the time; variables refer to signals and parameters with a
+ * 1-based index that is negative for negated aliases (like dataInfo of the
+ * MATLAB v4 files). Negating a boolean means the logical not.
+ *
+ * Every column of a chunk is encoded on its own, so a variable can be read
+ * without decoding the other ones:
+ *  - reals: each value is XOR'ed with the previous one (0 at the start of the
+ *    chunk). A byte 0x80|(n-1) stands for n (1..128) unchanged values; any
+ *    other byte is (leadingZeroBytes<<4)|nbytes and is followed by the nbytes
+ *    significant bytes of the XOR, least significant first.
+ *  - integers and booleans: runs of (varint count, zigzag varint value).
+ *
+ * The chunk index and the trailer are written when the simulation finishes;
+ * if they are missing, the reader recovers all complete chunks by scanning
+ * the records.
+ */
+
+#ifndef OMC_READ_OMZ_H
+#define OMC_READ_OMZ_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include "read_matlab4.h"
+
+#define OMZ_MAGIC "OMZ1"
+#define OMZ_TRAILER_MAGIC "OMZ1END"
+#define OMZ_VERSION 1
+#define OMZ_BYTE_ORDER 0x01020304
+
+#define OMZ_RECORD_PARAMETERS 'P'
+#define OMZ_RECORD_CHUNK 'C'
+#define OMZ_RECORD_INDEX 'I'
+
+#define OMZ_KIND_REAL 0
+#define OMZ_KIND_INTEGER 1
+#define OMZ_KIND_BOOLEAN 2
+
+typedef struct {
+  uint64_t offset; /* file offset of the 'C' record */
+  uint32_t nrows;
+  uint32_t firstRow; /* index of the first time point in the whole result */
+  double firstTime, lastTime;
+  uint64_t *columns; /* file offsets of the columns and the end of the chunk; NULL until needed */
+} OMZChunk;
+
+typedef struct {
+  FILE *file;
+  char *fileName;
+  uint32_t nall;
+  ModelicaMatVariable_t *allInfo; /* Sorted array of variables and their associated information */
+  uint32_t nparam;
+  double *params;
+  unsigned char *paramKinds;
+  uint32_t nsignals;
+  unsigned char *kinds;
+  uint32_t nrows;
+  uint32_t nchunks;
+  OMZChunk *chunks;
+  double **vars; /* decoded signals, NULL until read */
+  unsigned char *buffer; /* scratch space for an encoded column */
+  size_t bufferSize;
+} OMZReader;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Returns 0 on success; the error message on error.
+ * The internal data is free'd by omc_free_omz_reader.
+ */
+const char* omc_new_omz_reader(const char *filename, OMZReader *reader);
+
+void omc_free_omz_reader(OMZReader *reader);
+
+/* Returns a variable or NULL */
+ModelicaMatVariable_t *omc_omz_find_var(OMZReader *reader, const char *varName);
+
+/* Returns all values of the variable with the given index (see omc_matlab4_read_vals).
+ * The returned data persists until the reader is closed; NULL on failure.
+ */
+double* omc_omz_read_vals(OMZReader *reader, int varIndex);
+
+/* Interpolates the variable at the given time, only decoding the chunks
+ * containing that time. Returns 0 on success.
+ */
+int omc_omz_val(double *res, OMZReader *reader, ModelicaMatVariable_t *var, double time);
+
+double omc_omz_startTime(OMZReader *reader);
+
+double omc_omz_stopTime(OMZReader *reader);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif
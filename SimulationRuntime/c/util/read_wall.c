@@ -0,0 +1,914 @@
+/*
+ * This file is part of OpenModelica.
+ *
+ * Copyright (c) 1998-CurrentYear, Open Source Modelica Consortium (OSMC),
+ * c/o Linköpings universitet, Department of Computer and Information Science,
+ * SE-58183 Linköping, Sweden.
+ *
+ * All rights reserved.
+ *
+ * THIS PROGRAM IS PROVIDED UNDER THE TERMS OF THE BSD NEW LICENSE OR THE
+ * GPL VERSION 3 LICENSE OR THE OSMC PUBLIC LICENSE (OSMC-PL) VERSION 1.2.
+ * ANY USE, REPRODUCTION OR DISTRIBUTION OF THIS PROGRAM CONSTITUTES
+ * RECIPIENT'S ACCEPTANCE OF THE OSMC PUBLIC LICENSE OR THE GPL VERSION 3,
+ * ACCORDING TO RECIPIENTS CHOICE.
+ *
+ * The OpenModelica software and the OSMC (Open Source Modelica Consortium)
+ * Public License (OSMC-PL) are obtained from OSMC, either from the above
+ * address, from the URLs: http://www.openmodelica.org or
+ * http://www.ida.liu.se/projects/OpenModelica, and in the OpenModelica
+ * distribution. GNU version 3 is obtained from:
+ * http://www.gnu.org/copyleft/gpl.html. The New BSD License is obtained from:
+ * http://www.opensource.org/licenses/BSD-3-Clause.
+ *
+ * This program is distributed WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, EXCEPT AS
+ * EXPRESSLY SET FORTH IN THE BY RECIPIENT SELECTED SUBSIDIARY LICENSE
+ * CONDITIONS OF OSMC-PL.
+ *
+ */
+
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <errno.h>
+#include <string.h>
+#include <math.h>
+#include "read_wall.h"
+
+/* Make Visual Studio not complain about deprecated items */
+#ifdef _MSC_VER
+#define strdup _strdup
+#endif
+
+#if defined(_MSC_VER) || defined(__MINGW32__)
+#define wall_fseek _fseeki64
+#define wall_ftell _ftelli64
+#else
+#define wall_fseek fseeko
+#define wall_ftell ftello
+#endif
+
+/* rows larger than this are read one value at a time instead of reading the
+ * whole chunk */
+#define WALL_SEEK_ROW_SIZE 4096
+
+/* A position in a msgpack buffer */
+typedef struct {
+  const unsigned char *p, *end;
+} wall_cursor;
+
+static int wall_read(WallReader *reader, void *dest, size_t size)
+{
+  return size != fread(dest, 1, size, reader->file);
+}
+
+static unsigned char* wall_buffer(WallReader *reader, size_t size)
+{
+  if (size > reader->bufferSize) {
+    unsigned char *buffer = (unsigned char*) realloc(reader->buffer, size);
+    if (buffer == NULL) {
+      return NULL;
+    }
+    reader->buffer = buffer;
+    reader->bufferSize = size;
+  }
+  return reader->buffer;
+}
+
+static uint32_t wall_be32(const unsigned char *p)
+{
+  return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static uint64_t wall_be64(const unsigned char *p)
+{
+  return ((uint64_t)wall_be32(p) << 32) | wall_be32(p+4);
+}
+
+static int wall_need(wall_cursor *c, size_t n)
+{
+  return (size_t) (c->end - c->p) < n;
+}
+
+/* Reads the length of a map (isArray=0) or an array (isArray=1); returns 0 on success */
+static int wall_container(wall_cursor *c, int isArray, uint32_t *n)
+{
+  unsigned char tag;
+  if (wall_need(c, 1)) return 1;
+  tag = *c->p++;
+  if (tag >> 4 == (isArray ? 0x9 : 0x8)) {
+    *n = tag & 0x0F;
+  } else if (tag == (isArray ? 0xDC : 0xDE) && !wall_need(c, 2)) {
+    *n = ((uint32_t)c->p[0] << 8) | c->p[1];
+    c->p += 2;
+  } else if (tag == (isArray ? 0xDD : 0xDF) && !wall_need(c, 4)) {
+    *n = wall_be32(c->p);
+    c->p += 4;
+  } else {
+    return 1;
+  }
+  return 0;
+}
+
+/* Reads a string (not NUL-terminated); returns 0 on success */
+static int wall_str(wall_cursor *c, const char **str, uint32_t *len)
+{
+  unsigned char tag;
+  if (wall_need(c, 1)) return 1;
+  tag = *c->p++;
+  if ((tag & 0xE0) == 0xA0) {
+    *len = tag & 0x1F;
+  } else if (tag == 0xD9 && !wall_need(c, 1)) {
+    *len = *c->p++;
+  } else if (tag == 0xDA && !wall_need(c, 2)) {
+    *len = ((uint32_t)c->p[0] << 8) | c->p[1];
+    c->p += 2;
+  } else if (tag == 0xDB && !wall_need(c, 4)) {
+    *len = wall_be32(c->p);
+    c->p += 4;
+  } else {
+    return 1;
+  }
+  if (wall_need(c, *len)) return 1;
+  *str = (const char*) c->p;
+  c->p += *len;
+  return 0;
+}
+
+static int wall_str_is(const char *str, uint32_t len, const char *expected)
+{
+  return len == strlen(expected) && 0 == memcmp(str, expected, len);
+}
+
+static char* wall_strdup(const char *str, uint32_t len)
+{
+  char *res = (char*) malloc(len+1);
+  memcpy(res, str, len);
+  res[len] = '\0';
+  return res;
+}
+
+/* Reads a number or boolean and its kind; returns 0 on success and 2 for a string */
+static int wall_number(wall_cursor *c, double *value, char *kind)
+{
+  unsigned char tag;
+  uint64_t bits;
+  if (wall_need(c, 1)) return 1;
+  tag = *c->p;
+  *kind = WALL_KIND_INTEGER;
+  if (tag <= 0x7F || tag >= 0xE0) {
+    *value = (double) (signed char) tag;
+    c->p++;
+    return 0;
+  }
+  if ((tag & 0xE0) == 0xA0 || (tag >= 0xD9 && tag <= 0xDB)) {
+    const char *str;
+    uint32_t len;
+    return wall_str(c, &str, &len) ? 1 : 2;
+  }
+  c->p++;
+  switch (tag) {
+  case 0xC2:
+  case 0xC3:
+    *kind = WALL_KIND_BOOLEAN;
+    *value = tag == 0xC3;
+    return 0;
+  case 0xCA:
+    if (wall_need(c, 4)) return 1;
+    {
+      uint32_t b32 = wall_be32(c->p);
+      float f;
+      memcpy(&f, &b32, sizeof(float));
+      *value = f;
+    }
+    *kind = WALL_KIND_REAL;
+    c->p += 4;
+    return 0;
+  case 0xCB:
+    if (wall_need(c, 8)) return 1;
+    bits = wall_be64(c->p);
+    memcpy(value, &bits, sizeof(double));
+    *kind = WALL_KIND_REAL;
+    c->p += 8;
+    return 0;
+  case 0xCC: if (wall_need(c, 1)) return 1; *value = c->p[0]; c->p += 1; return 0;
+  case 0xCD: if (wall_need(c, 2)) return 1; *value = (c->p[0] << 8) | c->p[1]; c->p += 2; return 0;
+  case 0xCE: if (wall_need(c, 4)) return 1; *value = wall_be32(c->p); c->p += 4; return 0;
+  case 0xCF: if (wall_need(c, 8)) return 1; *value = (double) wall_be64(c->p); c->p += 8; return 0;
+  case 0xD0: if (wall_need(c, 1)) return 1; *value = (int8_t) c->p[0]; c->p += 1; return 0;
+  case 0xD1: if (wall_need(c, 2)) return 1; *value = (int16_t) ((c->p[0] << 8) | c->p[1]); c->p += 2; return 0;
+  case 0xD2: if (wall_need(c, 4)) return 1; *value = (int32_t) wall_be32(c->p); c->p += 4; return 0;
+  case 0xD3: if (wall_need(c, 8)) return 1; *value = (double) (int64_t) wall_be64(c->p); c->p += 8; return 0;
+  default:
+    return 1;
+  }
+}
+
+/* Skips any msgpack object; returns 0 on success */
+static int wall_skip(wall_cursor *c, int depth)
+{
+  unsigned char tag;
+  uint32_t n, i;
+  double value;
+  char kind;
+  if (wall_need(c, 1) || depth > 64) return 1;
+  tag = *c->p;
+  if (tag == 0xC0) {
+    c->p++;
+    return 0;
+  }
+  if (tag >> 4 == 0x8 || tag == 0xDE || tag == 0xDF) {
+    if (wall_container(c, 0, &n)) return 1;
+    for (i=0; i<2*n; i++) {
+      if (wall_skip(c, depth+1)) return 1;
+    }
+    return 0;
+  }
+  if (tag >> 4 == 0x9 || tag == 0xDC || tag == 0xDD) {
+    if (wall_container(c, 1, &n)) return 1;
+    for (i=0; i<n; i++) {
+      if (wall_skip(c, depth+1)) return 1;
+    }
+    return 0;
+  }
+  if (tag == 0xC4 || tag == 0xC5 || tag == 0xC6) {
+    /* bin 8/16/32 */
+    uint32_t w = tag == 0xC4 ? 1 : tag == 0xC5 ? 2 : 4, len = 0;
+    c->p++;
+    if (wall_need(c, w)) return 1;
+    for (i=0; i<w; i++) len = (len << 8) | *c->p++;
+    if (wall_need(c, len)) return 1;
+    c->p += len;
+    return 0;
+  }
+  return 1 == wall_number(c, &value, &kind);
+}
+
+/* A signal of the params or continuous table while parsing the header */
+typedef struct {
+  const char *name;
+  uint32_t len;
+  uint32_t index; /* 0-based position in the sigs of the table */
+  const char *descr;
+  uint32_t descrLen;
+} wall_sig;
+
+typedef struct {
+  uint32_t nsigs;
+  wall_sig *sigs; /* sorted by name */
+  wall_cursor als;
+} wall_table;
+
+static int wall_sig_cmp(const void *a, const void *b)
+{
+  const wall_sig *s1 = (const wall_sig*) a, *s2 = (const wall_sig*) b;
+  int res = memcmp(s1->name, s2->name, s1->len < s2->len ? s1->len : s2->len);
+  return res ? res : (s1->len > s2->len) - (s1->len < s2->len);
+}
+
+static wall_sig* wall_find_sig(wall_table *table, const char *name, uint32_t len)
+{
+  wall_sig key;
+  key.name = name;
+  key.len = len;
+  return (wall_sig*) bsearch(&key, table->sigs, table->nsigs, sizeof(wall_sig), wall_sig_cmp);
+}
+
+/* Reads the tmeta of the continuous table */
+static int wall_read_tmeta(WallReader *reader, wall_cursor *c)
+{
+  uint32_t n, i, j, len;
+  const char *key, *str;
+  double value;
+  char kind;
+
+  if (wall_container(c, 0, &n)) return 1;
+  for (i=0; i<n; i++) {
+    if (wall_str(c, &key, &len)) return 1;
+    if (wall_str_is(key, len, "rowSize")) {
+      if (wall_number(c, &value, &kind)) return 1;
+      reader->rowSize = (uint32_t) value;
+    } else if (wall_str_is(key, len, "offsets")) {
+      if (wall_container(c, 1, &reader->nsignals) || wall_need(c, reader->nsignals)) return 1;
+      reader->offsets = (uint32_t*) malloc((reader->nsignals+1)*sizeof(uint32_t));
+      for (j=0; j<reader->nsignals; j++) {
+        if (wall_number(c, &value, &kind)) return 1;
+        reader->offsets[j] = (uint32_t) value;
+      }
+    } else if (wall_str_is(key, len, "kinds")) {
+      if (wall_str(c, &str, &len)) return 1;
+      reader->kinds = wall_strdup(str, len);
+    } else if (wall_skip(c, 0)) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/* Reads the signals of a table; the aliases are resolved once both tables are known */
+static int wall_read_table(WallReader *reader, wall_cursor *c, wall_table *table, int isCont)
+{
+  uint32_t n, i, j, len, m;
+  const char *key;
+
+  if (wall_container(c, 0, &n)) return 1;
+  for (i=0; i<n; i++) {
+    if (wall_str(c, &key, &len)) return 1;
+    if (isCont && wall_str_is(key, len, "tmeta")) {
+      if (wall_read_tmeta(reader, c)) return 1;
+    } else if (wall_str_is(key, len, "sigs")) {
+      if (wall_container(c, 1, &table->nsigs) || wall_need(c, table->nsigs)) return 1;
+      table->sigs = (wall_sig*) calloc(table->nsigs+1, sizeof(wall_sig));
+      for (j=0; j<table->nsigs; j++) {
+        if (wall_str(c, &table->sigs[j].name, &table->sigs[j].len)) return 1;
+        table->sigs[j].index = j;
+      }
+      qsort(table->sigs, table->nsigs, sizeof(wall_sig), wall_sig_cmp);
+    } else if (wall_str_is(key, len, "als")) {
+      table->als = *c;
+      if (wall_skip(c, 0)) return 1;
+    } else if (wall_str_is(key, len, "vmeta")) {
+      /* the descriptions; sigs come before vmeta */
+      if (wall_container(c, 0, &m)) return 1;
+      for (j=0; j<m; j++) {
+        const char *name;
+        uint32_t nameLen, k, nfields;
+        wall_sig *sig;
+        if (wall_str(c, &name, &nameLen) || wall_container(c, 0, &nfields)) return 1;
+        sig = wall_find_sig(table, name, nameLen);
+        for (k=0; k<nfields; k++) {
+          if (wall_str(c, &key, &len)) return 1;
+          if (sig && wall_str_is(key, len, "description")) {
+            if (wall_str(c, &sig->descr, &sig->descrLen)) return 1;
+          } else if (wall_skip(c, 0)) {
+            return 1;
+          }
+        }
+      }
+    } else if (wall_skip(c, 0)) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+static void wall_add_var(WallReader *reader, uint32_t *nvars, const char *name, uint32_t len,
+                         const char *descr, uint32_t descrLen, int isParam, int index)
+{
+  ModelicaMatVariable_t *var = &reader->allInfo[(*nvars)++];
+  var->name = wall_strdup(name, len);
+  var->descr = wall_strdup(descr ? descr : "", descr ? descrLen : 0);
+  var->isParam = isParam;
+  var->index = index;
+}
+
+/* The index of signal sig of a table in allInfo terms, 0 for strings */
+static int wall_var_index(WallReader *reader, const wall_sig *sig, int isParam)
+{
+  if (isParam) {
+    return (sig->index > 0 && reader->paramKinds[sig->index-1]) ? sig->index : 0;
+  }
+  return sig->index < reader->nsignals ? sig->index+1 : 0;
+}
+
+static int wall_add_aliases(WallReader *reader, uint32_t *nvars, wall_table *table, int isParam)
+{
+  wall_cursor c = table->als;
+  uint32_t n, i, j, m, len;
+  const char *key;
+
+  if (c.p == NULL) return 0;
+  if (wall_container(&c, 0, &n)) return 1;
+  for (i=0; i<n; i++) {
+    const char *name, *sigName = NULL, *type = NULL;
+    uint32_t nameLen, sigLen = 0, typeLen = 0;
+    wall_sig *sig;
+    int index;
+    if (wall_str(&c, &name, &nameLen) || wall_container(&c, 0, &m)) return 1;
+    for (j=0; j<m; j++) {
+      if (wall_str(&c, &key, &len)) return 1;
+      if (wall_str_is(key, len, "s")) {
+        if (wall_str(&c, &sigName, &sigLen)) return 1;
+      } else if (wall_str_is(key, len, "t")) {
+        if (wall_str(&c, &type, &typeLen)) return 1;
+      } else if (wall_skip(&c, 0)) {
+        return 1;
+      }
+    }
+    if (sigName == NULL || NULL == (sig = wall_find_sig(table, sigName, sigLen)) ||
+        0 == (index = wall_var_index(reader, sig, isParam))) {
+      continue;
+    }
+    wall_add_var(reader, nvars, name, nameLen, NULL, 0, isParam,
+                 (type && wall_str_is(type, typeLen, "inv")) ? -index : index);
+  }
+  return 0;
+}
+
+/* Reads the first bytes of the record at offset: its length and table name.
+ * Returns 0 on success. */
+static int wall_record(WallReader *reader, uint64_t offset, uint64_t fileSize, uint32_t *size, char table[16])
+{
+  unsigned char bytes[4+5+5+16];
+  uint32_t len;
+  if (offset + 4 + 5 + 5 > fileSize || wall_fseek(reader->file, offset, SEEK_SET) || wall_read(reader, bytes, 4+5+5)) {
+    return 1;
+  }
+  *size = wall_be32(bytes);
+  len = wall_be32(bytes+10);
+  if (offset + 4 + *size > fileSize || bytes[4] != 0xDF || wall_be32(bytes+5) != 1 || bytes[9] != 0xDB ||
+      len > 15 || wall_read(reader, table, len)) {
+    return 1;
+  }
+  table[len] = '\0';
+  return 0;
+}
+
+/* Decodes a record of the chunks table at the current file position */
+static int wall_read_chunk_record(WallReader *reader, WallChunk *chunk)
+{
+  unsigned char bytes[WALL_CHUNK_RECORD_SIZE];
+  const unsigned char *p = bytes + 4+5+5+strlen(WALL_CHUNK_TABLE)+5;
+  uint64_t bits;
+  if (wall_read(reader, bytes, WALL_CHUNK_RECORD_SIZE) || wall_be32(bytes) != WALL_CHUNK_RECORD_SIZE-4 ||
+      p[0] != 0xD3 || p[9] != 0xD3 || p[18] != 0xD3 || p[27] != 0xCB || p[36] != 0xCB) {
+    return 1;
+  }
+  memset(chunk, 0, sizeof(WallChunk));
+  chunk->offset = wall_be64(p+1);
+  chunk->size = wall_be64(p+10);
+  chunk->nrows = (uint32_t) wall_be64(p+19);
+  bits = wall_be64(p+28);
+  memcpy(&chunk->firstTime, &bits, sizeof(double));
+  bits = wall_be64(p+37);
+  memcpy(&chunk->lastTime, &bits, sizeof(double));
+  return 0;
+}
+
+/* Reads the time index at the end of the file; returns 0 on success */
+static int wall_read_index(WallReader *reader, uint64_t fileSize, uint64_t *paramOffset)
+{
+  unsigned char bytes[WALL_INDEX_RECORD_SIZE];
+  const unsigned char *p = bytes + 4+5+5+strlen(WALL_INDEX_TABLE)+5;
+  uint64_t offset, count, i;
+
+  if (fileSize < WALL_INDEX_RECORD_SIZE || wall_fseek(reader->file, fileSize-WALL_INDEX_RECORD_SIZE, SEEK_SET) ||
+      wall_read(reader, bytes, WALL_INDEX_RECORD_SIZE) || wall_be32(bytes) != WALL_INDEX_RECORD_SIZE-4 ||
+      memcmp(bytes+14, WALL_INDEX_TABLE, strlen(WALL_INDEX_TABLE)) ||
+      p[0] != 0xD3 || p[9] != 0xD3 || p[18] != 0xD3) {
+    return 1;
+  }
+  offset = wall_be64(p+1);
+  count = wall_be64(p+10);
+  *paramOffset = wall_be64(p+19);
+  if (offset + count*WALL_CHUNK_RECORD_SIZE + WALL_INDEX_RECORD_SIZE != fileSize || wall_fseek(reader->file, offset, SEEK_SET)) {
+    return 1;
+  }
+  reader->chunks = (WallChunk*) calloc(count+1, sizeof(WallChunk));
+  if (!reader->chunks) {
+    return 1;
+  }
+  for (i=0; i<count; i++) {
+    if (wall_read_chunk_record(reader, &reader->chunks[i]) ||
+        reader->chunks[i].offset + reader->chunks[i].size > offset) {
+      free(reader->chunks);
+      reader->chunks = NULL;
+      return 1;
+    }
+  }
+  reader->nchunks = (uint32_t) count;
+  return 0;
+}
+
+/* Reads the time of the row record at offset */
+static int wall_row_time(WallReader *reader, uint64_t offset, double *time)
+{
+  unsigned char bytes[9];
+  uint64_t bits;
+  if (wall_fseek(reader->file, offset + reader->offsets[0], SEEK_SET) || wall_read(reader, bytes, 9) || bytes[0] != 0xCB) {
+    return 1;
+  }
+  bits = wall_be64(bytes+1);
+  memcpy(time, &bits, sizeof(double));
+  return 0;
+}
+
+/* The simulation did not finish writing the file: follow the chunk records.
+ * The chunk that was being written when the simulation stopped has no row
+ * count yet; its complete rows are counted. */
+static void wall_scan_records(WallReader *reader, uint64_t offset, uint64_t fileSize, uint64_t *paramOffset)
+{
+  uint32_t maxChunks = 0, size;
+  char table[16];
+
+  while (0 == wall_record(reader, offset, fileSize, &size, table)) {
+    if (0 == strcmp(table, WALL_PARAM_TABLE)) {
+      *paramOffset = offset;
+    } else if (0 == strcmp(table, WALL_CHUNK_TABLE)) {
+      WallChunk *chunk;
+      if (reader->nchunks == maxChunks) {
+        uint32_t newMax = maxChunks ? 2*maxChunks : 64;
+        WallChunk *chunks = (WallChunk*) realloc(reader->chunks, (newMax+1)*sizeof(WallChunk));
+        if (!chunks) {
+          /* keep the chunks found so far */
+          break;
+        }
+        reader->chunks = chunks;
+        maxChunks = newMax;
+      }
+      chunk = &reader->chunks[reader->nchunks];
+      if (wall_fseek(reader->file, offset, SEEK_SET) || wall_read_chunk_record(reader, chunk)) {
+        break;
+      }
+      if (chunk->nrows == 0) {
+        /* the last chunk */
+        uint64_t row = chunk->offset;
+        uint32_t rowSize;
+        double time;
+        while (0 == wall_record(reader, row, fileSize, &rowSize, table) && 0 == strcmp(table, WALL_CONT_TABLE) &&
+               4 + rowSize >= reader->offsets[reader->nsignals-1] + 1 && 0 == wall_row_time(reader, row, &time)) {
+          if (chunk->nrows == 0) {
+            chunk->firstTime = time;
+          }
+          chunk->lastTime = time;
+          chunk->nrows++;
+          row += 4 + rowSize;
+        }
+        chunk->size = row - chunk->offset;
+        reader->nchunks += chunk->nrows > 0;
+        break;
+      }
+      if (chunk->offset + chunk->size > fileSize) {
+        break;
+      }
+      reader->nchunks++;
+      offset = chunk->offset + chunk->size;
+      continue;
+    } else if (0 != strcmp(table, WALL_CONT_TABLE)) {
+      break;
+    }
+    offset += 4 + size;
+  }
+}
+
+/* Reads the last parameter record */
+static int wall_read_params(WallReader *reader, uint64_t offset, uint64_t fileSize)
+{
+  uint32_t size, n, i;
+  char table[16];
+  unsigned char *bytes;
+  wall_cursor c;
+
+  if (offset == 0 || wall_record(reader, offset, fileSize, &size, table) || strcmp(table, WALL_PARAM_TABLE) ||
+      NULL == (bytes = wall_buffer(reader, 4+size)) || wall_fseek(reader->file, offset, SEEK_SET) ||
+      wall_read(reader, bytes, 4+size)) {
+    return 1;
+  }
+  c.p = bytes + 4+5+5+strlen(WALL_PARAM_TABLE);
+  c.end = bytes + 4+size;
+  if (wall_container(&c, 1, &n) || n != reader->nparam+1 || wall_skip(&c, 0)) {
+    return 1;
+  }
+  for (i=0; i<reader->nparam; i++) {
+    int res = wall_number(&c, &reader->params[i], &reader->paramKinds[i]);
+    if (res == 1) {
+      return 1;
+    } else if (res == 2) {
+      reader->paramKinds[i] = 0; /* strings are not stored as variables */
+    }
+  }
+  return 0;
+}
+
+const char* omc_new_wall_reader(const char *filename, WallReader *reader)
+{
+  unsigned char lengthBytes[4];
+  char magic[WALL_MAGIC_LENGTH];
+  unsigned char *header;
+  uint64_t dataStart, fileSize, paramOffset = 0;
+  uint32_t headerSize, n, i, len, nvars = 0;
+  wall_table params, cont;
+  wall_cursor c;
+  const char *key, *msg = NULL;
+
+  memset(reader, 0, sizeof(WallReader));
+  memset(&params, 0, sizeof(wall_table));
+  memset(&cont, 0, sizeof(wall_table));
+  reader->file = fopen(filename, "rb");
+  if (!reader->file) {
+    return strerror(errno);
+  }
+  reader->fileName = strdup(filename);
+
+  if (wall_read(reader, magic, WALL_MAGIC_LENGTH) || memcmp(magic, WALL_MAGIC, WALL_MAGIC_LENGTH)) {
+    omc_free_wall_reader(reader);
+    return "Not a recon wall file (wrong magic number)";
+  }
+  if (wall_read(reader, lengthBytes, 4) || (headerSize = wall_be32(lengthBytes)) > (1u<<30) ||
+      NULL == (header = (unsigned char*) malloc(headerSize)) ) {
+    omc_free_wall_reader(reader);
+    return "Corrupt header";
+  }
+  if (wall_read(reader, header, headerSize)) {
+    free(header);
+    omc_free_wall_reader(reader);
+    return "Corrupt header";
+  }
+  dataStart = WALL_MAGIC_LENGTH + 4 + headerSize;
+
+  /* the tables; the strings point into the header */
+  c.p = header;
+  c.end = header + headerSize;
+  if (wall_container(&c, 0, &n)) {
+    msg = "Corrupt header";
+  }
+  for (i=0; msg == NULL && i<n; i++) {
+    uint32_t ntabs, j;
+    if (wall_str(&c, &key, &len)) {
+      msg = "Corrupt header";
+    } else if (!wall_str_is(key, len, "tabs")) {
+      if (wall_skip(&c, 0)) msg = "Corrupt header";
+    } else if (wall_container(&c, 0, &ntabs)) {
+      msg = "Corrupt header";
+    } else for (j=0; msg == NULL && j<ntabs; j++) {
+      if (wall_str(&c, &key, &len)) {
+        msg = "Corrupt header";
+      } else if (wall_str_is(key, len, WALL_PARAM_TABLE)) {
+        if (wall_read_table(reader, &c, &params, 0)) msg = "Corrupt parameter table";
+      } else if (wall_str_is(key, len, WALL_CONT_TABLE)) {
+        if (wall_read_table(reader, &c, &cont, 1)) msg = "Corrupt continuous table";
+      } else if (wall_skip(&c, 0)) {
+        msg = "Corrupt header";
+      }
+    }
+  }
+  if (msg == NULL && (reader->offsets == NULL || reader->kinds == NULL || reader->nsignals == 0 ||
+      strlen(reader->kinds) != reader->nsignals || cont.nsigs < reader->nsignals || params.nsigs == 0)) {
+    msg = "The wall file has no time index (written by an older version?)";
+  }
+
+  if (msg == NULL) {
+    /* the chunk index */
+    wall_fseek(reader->file, 0, SEEK_END);
+    fileSize = wall_ftell(reader->file);
+    if (wall_read_index(reader, fileSize, &paramOffset)) {
+      wall_scan_records(reader, dataStart, fileSize, &paramOffset);
+    }
+    for (i=0; i<reader->nchunks; i++) {
+      reader->chunks[i].firstRow = reader->nrows;
+      reader->nrows += reader->chunks[i].nrows;
+    }
+
+    /* the parameters; string parameters are skipped */
+    reader->nparam = params.nsigs-1;
+    reader->params = (double*) calloc(reader->nparam+1, sizeof(double));
+    reader->paramKinds = (char*) calloc(reader->nparam+1, 1);
+    if (wall_read_params(reader, paramOffset, fileSize)) {
+      msg = "Could not read the parameters";
+    }
+  }
+
+  if (msg == NULL) {
+    /* the variables: signals, parameters and the aliases of both */
+    uint32_t maxVars = cont.nsigs + params.nsigs;
+    wall_cursor als;
+    for (i=0; i<2; i++) {
+      wall_table *table = i ? &params : &cont;
+      if (table->als.p == NULL) continue;
+      als = table->als;
+      if (0 == wall_container(&als, 0, &n)) maxVars += n;
+    }
+    reader->allInfo = (ModelicaMatVariable_t*) calloc(maxVars+1, sizeof(ModelicaMatVariable_t));
+    for (i=0; i<cont.nsigs; i++) {
+      wall_sig *sig = &cont.sigs[i];
+      int index = wall_var_index(reader, sig, 0);
+      if (index) {
+        wall_add_var(reader, &nvars, sig->name, sig->len, sig->descr, sig->descrLen, 0, index);
+      }
+    }
+    for (i=0; i<params.nsigs; i++) {
+      wall_sig *sig = &params.sigs[i];
+      int index = wall_var_index(reader, sig, 1);
+      if (index) {
+        wall_add_var(reader, &nvars, sig->name, sig->len, sig->descr, sig->descrLen, 1, index);
+      }
+    }
+    reader->nall = nvars;
+    if (wall_add_aliases(reader, &nvars, &cont, 0) || wall_add_aliases(reader, &nvars, &params, 1)) {
+      msg = "Corrupt variable information";
+    }
+    reader->nall = nvars;
+    qsort(reader->allInfo, reader->nall, sizeof(ModelicaMatVariable_t), omc_matlab4_comp_var);
+    reader->vars = (double**) calloc(2*reader->nsignals, sizeof(double*));
+  }
+
+  free(params.sigs);
+  free(cont.sigs);
+  free(header);
+  if (msg) {
+    omc_free_wall_reader(reader);
+  }
+  return msg;
+}
+
+void omc_free_wall_reader(WallReader *reader)
+{
+  uint32_t i;
+  if (reader->file) {
+    fclose(reader->file);
+  }
+  free(reader->fileName);
+  for (i=0; i<reader->nall && reader->allInfo; i++) {
+    free(reader->allInfo[i].name);
+    free(reader->allInfo[i].descr);
+  }
+  free(reader->allInfo);
+  free(reader->params);
+  free(reader->paramKinds);
+  free(reader->kinds);
+  free(reader->offsets);
+  free(reader->chunks);
+  for (i=0; i<2*reader->nsignals && reader->vars; i++) {
+    free(reader->vars[i]);
+  }
+  free(reader->vars);
+  free(reader->buffer);
+  memset(reader, 0, sizeof(WallReader));
+}
+
+ModelicaMatVariable_t *omc_wall_find_var(WallReader *reader, const char *varName)
+{
+  ModelicaMatVariable_t key;
+  ModelicaMatVariable_t *res;
+  char *omcName;
+
+  key.name = (char*) varName;
+  res = (ModelicaMatVariable_t*)bsearch(&key,reader->allInfo,reader->nall,sizeof(ModelicaMatVariable_t),omc_matlab4_comp_var);
+  if (res == NULL && 0==strcmp(varName, "Time")) {
+    key.name = "time";
+    res = (ModelicaMatVariable_t*)bsearch(&key,reader->allInfo,reader->nall,sizeof(ModelicaMatVariable_t),omc_matlab4_comp_var);
+  } else if (res == NULL && NULL != (omcName = openmodelicaStyleVariableName(varName))) {
+    key.name = omcName;
+    res = (ModelicaMatVariable_t*)bsearch(&key,reader->allInfo,reader->nall,sizeof(ModelicaMatVariable_t),omc_matlab4_comp_var);
+    free(omcName);
+  }
+  return res;
+}
+
+/* Decodes the value at the start of bytes; returns 0 on success */
+static int wall_decode_value(const unsigned char *bytes, const unsigned char *end, double *value)
+{
+  wall_cursor c;
+  char kind;
+  c.p = bytes;
+  c.end = end;
+  return wall_number(&c, value, &kind);
+}
+
+/* Reads signal ix (0-based) of the given chunk into vals; returns 0 on success */
+static int wall_read_chunk_signal(WallReader *reader, WallChunk *chunk, uint32_t ix, double *vals)
+{
+  uint32_t offset = reader->offsets[ix], i;
+  const unsigned char *row, *end;
+  unsigned char *bytes;
+
+  if (reader->rowSize > WALL_SEEK_ROW_SIZE) {
+    /* wide rows: only read the values */
+    unsigned char value[9];
+    for (i=0; i<chunk->nrows; i++) {
+      if (wall_fseek(reader->file, chunk->offset + (uint64_t)i*reader->rowSize + offset, SEEK_SET) ||
+          wall_read(reader, value, 9 + offset > reader->rowSize ? reader->rowSize - offset : 9) ||
+          wall_decode_value(value, value + 9, &vals[i])) {
+        return 1;
+      }
+    }
+    return 0;
+  }
+  bytes = wall_buffer(reader, chunk->size);
+  if ((chunk->size && bytes == NULL) || wall_fseek(reader->file, chunk->offset, SEEK_SET) || wall_read(reader, bytes, chunk->size)) {
+    return 1;
+  }
+  end = bytes + chunk->size;
+  for (i=0, row=bytes; i<chunk->nrows; i++) {
+    const unsigned char *next;
+    if (end - row < 4) {
+      return 1;
+    }
+    next = reader->rowSize ? row + reader->rowSize : row + 4 + wall_be32(row);
+    if (next > end || row + offset >= next || wall_decode_value(row + offset, next, &vals[i])) {
+      return 1;
+    }
+    row = next;
+  }
+  return 0;
+}
+
+static double wall_negate(char kind, double value)
+{
+  return kind == WALL_KIND_BOOLEAN ? (value == 0.0 ? 1.0 : 0.0) : -value;
+}
+
+double* omc_wall_read_vals(WallReader *reader, int varIndex)
+{
+  uint32_t absVarIndex = abs(varIndex), i;
+  uint32_t ix = (varIndex < 0 ? absVarIndex + reader->nsignals : absVarIndex) - 1;
+  double *vals;
+
+  if (absVarIndex == 0 || absVarIndex > reader->nsignals) {
+    return NULL;
+  }
+  if (reader->vars[ix]) {
+    return reader->vars[ix];
+  }
+  vals = (double*) malloc((reader->nrows+1)*sizeof(double));
+  if (varIndex < 0) {
+    double *posVals = omc_wall_read_vals(reader, absVarIndex);
+    if (posVals == NULL) {
+      free(vals);
+      return NULL;
+    }
+    for (i=0; i<reader->nrows; i++) {
+      vals[i] = wall_negate(reader->kinds[absVarIndex-1], posVals[i]);
+    }
+  } else {
+    for (i=0; i<reader->nchunks; i++) {
+      if (wall_read_chunk_signal(reader, &reader->chunks[i], ix, vals + reader->chunks[i].firstRow)) {
+        free(vals);
+        return NULL;
+      }
+    }
+  }
+  reader->vars[ix] = vals;
+  return vals;
+}
+
+double omc_wall_startTime(WallReader *reader)
+{
+  return reader->nchunks ? reader->chunks[0].firstTime : 0.0;
+}
+
+double omc_wall_stopTime(WallReader *reader)
+{
+  return reader->nchunks ? reader->chunks[reader->nchunks-1].lastTime : 0.0;
+}
+
+int omc_wall_find_chunk(WallReader *reader, double time)
+{
+  uint32_t lo, hi;
+  if (reader->nchunks == 0 || time > omc_wall_stopTime(reader) || time < omc_wall_startTime(reader)) {
+    return -1;
+  }
+  /* the last chunk starting at or before time; at events this gives the right limit */
+  lo = 0;
+  hi = reader->nchunks - 1;
+  while (lo < hi) {
+    uint32_t mid = lo + (hi-lo+1)/2;
+    if (reader->chunks[mid].firstTime <= time) {
+      lo = mid;
+    } else {
+      hi = mid - 1;
+    }
+  }
+  return lo;
+}
+
+int omc_wall_val(double *res, WallReader *reader, ModelicaMatVariable_t *var, double time)
+{
+  uint32_t absVarIndex = abs(var->index), n;
+  double *times, *vals, w1, w2;
+  int c, i1, i2, fail = 0;
+
+  if (var->isParam) {
+    *res = var->index < 0 ? wall_negate(reader->paramKinds[absVarIndex-1], reader->params[absVarIndex-1]) : reader->params[absVarIndex-1];
+    return 0;
+  }
+  if ((c = omc_wall_find_chunk(reader, time)) < 0) {
+    return 1;
+  }
+  /* time may lie between the last point of this chunk and the first of the next one */
+  n = reader->chunks[c].nrows + ((time > reader->chunks[c].lastTime && c+1 < (int)reader->nchunks) ? reader->chunks[c+1].nrows : 0);
+  times = (double*) malloc(2*n*sizeof(double));
+  vals = times + n;
+  fail = wall_read_chunk_signal(reader, &reader->chunks[c], 0, times) ||
+         wall_read_chunk_signal(reader, &reader->chunks[c], absVarIndex-1, vals);
+  if (!fail && n > reader->chunks[c].nrows) {
+    fail = wall_read_chunk_signal(reader, &reader->chunks[c+1], 0, times + reader->chunks[c].nrows) ||
+           wall_read_chunk_signal(reader, &reader->chunks[c+1], absVarIndex-1, vals + reader->chunks[c].nrows);
+  }
+  if (!fail) {
+    find_closest_points(time, times, n, &i1, &w1, &i2, &w2);
+    if (i2 == -1) {
+      *res = vals[i1];
+    } else if (i1 == -1) {
+      *res = vals[i2];
+    } else {
+      *res = w1*vals[i1] + w2*vals[i2];
+    }
+    if (var->index < 0) {
+      *res = wall_negate(reader->kinds[absVarIndex-1], *res);
+    }
+  }
+  free(times);
+  return fail;
+}
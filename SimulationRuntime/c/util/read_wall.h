@@ -0,0 +1,153 @@
+/*
+ * This file is part of OpenModelica.
+ *
+ * Copyright (c) 1998-CurrentYear, Open Source Modelica Consortium (OSMC),
+ * c/o Linköpings universitet, Department of Computer and Information Science,
+ * SE-58183 Linköping, Sweden.
+ *
+ * All rights reserved.
+ *
+ * THIS PROGRAM IS PROVIDED UNDER THE TERMS OF THE BSD NEW LICENSE OR THE
+ * GPL VERSION 3 LICENSE OR THE OSMC PUBLIC LICENSE (OSMC-PL) VERSION 1.2.
+ * ANY USE, REPRODUCTION OR DISTRIBUTION OF THIS PROGRAM CONSTITUTES
+ * RECIPIENT'S ACCEPTANCE OF THE OSMC PUBLIC LICENSE OR THE GPL VERSION 3,
+ * ACCORDING TO RECIPIENTS CHOICE.
+ *
+ * The OpenModelica software and the OSMC (Open Source Modelica Consortium)
+ * Public License (OSMC-PL) are obtained from OSMC, either from the above
+ * address, from the URLs: http://www.openmodelica.org or
+ * http://www.ida.liu.se/projects/OpenModelica, and in the OpenModelica
+ * distribution. GNU version 3 is obtained from:
+ * http://www.gnu.org/copyleft/gpl.html. The New BSD License is obtained from:
+ * http://www.opensource.org/licenses/BSD-3-Clause.
+ *
+ * This program is distributed WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, EXCEPT AS
+ * EXPRESSLY SET FORTH IN THE BY RECIPIENT SELECTED SUBSIDIARY LICENSE
+ * CONDITIONS OF OSMC-PL.
+ *
+ */
+
+
+/*
+ * Reader for the recon wall files (.wall) written by
+ * simulation/results/simulation_result_wall.cpp.
+ *
+ * A wall file is "recon:wall:v01", the big-endian u32 length of the msgpack
+ * header and a sequence of records; every record is the big-endian u32 length
+ * of its payload followed by the payload, a msgpack map {table: [values]}.
+ * See http://github.com/xogeny/recon for the general format.
+ *
+ * The files written by OpenModelica add a time index on top of that, using
+ * ordinary records of two extra tables:
+ *
+ *   "continuous"  the tmeta of the table contains "offsets", the byte offset
+ *                 of every numeric signal within a row record (strings are
+ *                 stored after all numeric signals and are not indexed),
+ *                 "kinds", one character 'r', 'i' or 'b' per numeric signal,
+ *                 and "rowSize", the size of every row record (0 if there are
+ *                 string signals and the size varies).
+ *   "chunks"      [offset, size, rows, firstTime, lastTime]; written in front
+ *                 of every chunk of consecutive "continuous" rows starting at
+ *                 offset and size bytes long. The record has a fixed size and
+ *                 is filled in when the chunk is complete; until then rows is 0.
+ *   "index"       [chunks, count, params]; the last record of a complete file.
+ *                 It is preceded by a copy of all count "chunks" records
+ *                 starting at offset chunks; params is the offset of the last
+ *                 "params" record.
+ *
+ * Every chunk is flushed to disk when it is complete. If the simulation did
+ * not finish, the reader follows the chunk records from the start of the data
+ * instead of reading the index; all chunks written before the crash and the
+ * complete rows of the last one are recovered.
+ */
+
+#ifndef OMC_READ_WALL_H
+#define OMC_READ_WALL_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include "read_matlab4.h"
+
+#define WALL_MAGIC "recon:wall:v01"
+#define WALL_MAGIC_LENGTH 14
+
+#define WALL_PARAM_TABLE "params"
+#define WALL_CONT_TABLE "continuous"
+#define WALL_CHUNK_TABLE "chunks"
+#define WALL_INDEX_TABLE "index"
+
+/* sizes of the fixed-size records, including the length in front */
+#define WALL_CHUNK_RECORD_SIZE 70
+#define WALL_INDEX_RECORD_SIZE 51
+
+#define WALL_KIND_REAL 'r'
+#define WALL_KIND_INTEGER 'i'
+#define WALL_KIND_BOOLEAN 'b'
+
+typedef struct {
+  uint64_t offset; /* file offset of the first row record */
+  uint64_t size;   /* bytes of row records */
+  uint32_t nrows;
+  uint32_t firstRow; /* index of the first time point in the whole result */
+  double firstTime, lastTime;
+} WallChunk;
+
+typedef struct {
+  FILE *file;
+  char *fileName;
+  uint32_t nall;
+  ModelicaMatVariable_t *allInfo; /* Sorted array of variables and their associated information */
+  uint32_t nparam;
+  double *params;
+  char *paramKinds;
+  uint32_t nsignals; /* numeric signals of the continuous table, the first one is the time */
+  char *kinds;
+  uint32_t *offsets;
+  uint32_t rowSize;
+  uint32_t nrows;
+  uint32_t nchunks;
+  WallChunk *chunks;
+  double **vars; /* read signals, NULL until read */
+  unsigned char *buffer;
+  size_t bufferSize;
+} WallReader;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Returns 0 on success; the error message on error.
+ * The internal data is free'd by omc_free_wall_reader.
+ */
+const char* omc_new_wall_reader(const char *filename, WallReader *reader);
+
+void omc_free_wall_reader(WallReader *reader);
+
+/* Returns a variable or NULL */
+ModelicaMatVariable_t *omc_wall_find_var(WallReader *reader, const char *varName);
+
+/* Returns all values of the variable with the given index (see omc_matlab4_read_vals).
+ * The returned data persists until the reader is closed; NULL on failure.
+ */
+double* omc_wall_read_vals(WallReader *reader, int varIndex);
+
+/* Returns the chunk containing the given time (the last one starting at or
+ * before it), or -1 if the time is outside the result.
+ */
+int omc_wall_find_chunk(WallReader *reader, double time);
+
+/* Interpolates the variable at the given time, only reading the chunks
+ * containing that time. Returns 0 on success.
+ */
+int omc_wall_val(double *res, WallReader *reader, ModelicaMatVariable_t *var, double time);
+
+double omc_wall_startTime(WallReader *reader);
+
+double omc_wall_stopTime(WallReader *reader);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif
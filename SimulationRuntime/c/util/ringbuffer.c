@@ -86,9 +86,13 @@ void expandRingBuffer(RINGBUFFER *rb)
   void *tmp = calloc(2*rb->bufferSize, rb->itemSize);
   assertStreamPrint(NULL, 0!=tmp, "out of memory");
 
-  for(i=0; i<rb->nElements; i++) {
-    memcpy(((char*)tmp)+(i*rb->itemSize), getRingData(rb, i), rb->itemSize);
+  /* the elements are [firstElement, bufferSize) and [0, nElements-i) */
+  i = rb->bufferSize - rb->firstElement;
+  if(i > rb->nElements) {
+    i = rb->nElements;
   }
+  memcpy(tmp, ((char*)rb->buffer)+(rb->firstElement*rb->itemSize), i*rb->itemSize);
+  memcpy(((char*)tmp)+(i*rb->itemSize), rb->buffer, (rb->nElements-i)*rb->itemSize);
 
   free(rb->buffer);
   rb->buffer = tmp;
@@ -153,3 +157,101 @@ void infoRingBuffer(RINGBUFFER *rb)
     messageClose(LOG_UTIL);
   }
 }
+
+POW2_RINGBUFFER *allocPow2RingBuffer(int bufferSize, int itemSize)
+{
+  POW2_RINGBUFFER *rb = (POW2_RINGBUFFER*)malloc(sizeof(POW2_RINGBUFFER));
+  unsigned int size = 1;
+  assertStreamPrint(NULL, 0 != rb, "out of memory");
+
+  while(size < (unsigned int) bufferSize) {
+    size <<= 1;
+  }
+  rb->first = 0;
+  rb->nElements = 0;
+  rb->mask = size - 1;
+  rb->itemSize = itemSize;
+  rb->buffer = (char*)calloc(size, rb->itemSize);
+  assertStreamPrint(NULL, 0 != rb->buffer, "out of memory");
+
+  return rb;
+}
+
+void freePow2RingBuffer(POW2_RINGBUFFER *rb)
+{
+  free(rb->buffer);
+  free(rb);
+}
+
+/* makes room for at least nElements elements */
+void expandPow2RingBuffer(POW2_RINGBUFFER *rb, unsigned int nElements)
+{
+  unsigned int size = rb->mask + 1, newSize = size;
+
+  while(newSize < nElements) {
+    newSize <<= 1;
+  }
+  if(newSize == size) {
+    return;
+  }
+
+  rb->buffer = (char*)realloc(rb->buffer, (size_t)newSize * rb->itemSize);
+  assertStreamPrint(NULL, 0 != rb->buffer, "out of memory");
+
+  /* move the wrapped around part behind the old end; it is shorter than the old size */
+  if(rb->first + rb->nElements > size) {
+    memcpy(rb->buffer + size * rb->itemSize, rb->buffer, (size_t)(rb->first + rb->nElements - size) * rb->itemSize);
+  }
+  rb->mask = newSize - 1;
+}
+
+void appendNPow2RingDatas(POW2_RINGBUFFER *rb, const void *values, int n)
+{
+  unsigned int pos, n1;
+
+  assert(0 <= n);
+  if(rb->nElements + n > rb->mask + 1) {
+    expandPow2RingBuffer(rb, rb->nElements + n);
+  }
+
+  pos = (rb->first + rb->nElements) & rb->mask;
+  n1 = rb->mask + 1 - pos;
+  if(n1 > (unsigned int) n) {
+    n1 = n;
+  }
+  memcpy(rb->buffer + pos * rb->itemSize, values, (size_t)n1 * rb->itemSize);
+  memcpy(rb->buffer, ((const char*)values) + n1 * rb->itemSize, (size_t)(n - n1) * rb->itemSize);
+  rb->nElements += n;
+}
+
+void dequeueNFirstPow2RingDatas(POW2_RINGBUFFER *rb, int n, void *values)
+{
+  assert(0 <= n && (unsigned int) n <= rb->nElements);
+
+  if(values) {
+    unsigned int n1 = rb->mask + 1 - rb->first;
+    if(n1 > (unsigned int) n) {
+      n1 = n;
+    }
+    memcpy(values, rb->buffer + rb->first * rb->itemSize, (size_t)n1 * rb->itemSize);
+    memcpy(((char*)values) + n1 * rb->itemSize, rb->buffer, (size_t)(n - n1) * rb->itemSize);
+  }
+
+  rb->first = (rb->first + n) & rb->mask;
+  rb->nElements -= n;
+}
+
+void pow2RingBufferSpans(POW2_RINGBUFFER *rb, void **span1, int *n1, void **span2, int *n2)
+{
+  unsigned int nFront = rb->mask + 1 - rb->first;
+
+  *span1 = rb->buffer + rb->first * rb->itemSize;
+  *span2 = rb->buffer;
+  if(nFront >= rb->nElements) {
+    *n1 = rb->nElements;
+    *n2 = 0;
+  } else {
+    *n1 = nFront;
+    *n2 = rb->nElements - nFront;
+  }
+}
@@ -31,6 +31,10 @@
 #ifndef _RINGBUFFER_H_
 #define _RINGBUFFER_H_
 
+#include <assert.h>
+#include <string.h>
+#include "omc_msvc.h"
+
 /*
  * This is an expanding ring buffer.
  * When it gets full, it doubles in size.
@@ -58,6 +62,52 @@ extern "C" {
 
   void infoRingBuffer(RINGBUFFER *rb);
 
+/*
+ * This is an expanding queue with a capacity that is a power of two, so an
+ * element is found with a mask instead of a modulo. Indexes are only checked
+ * by assert(), i.e. not if NDEBUG is defined.
+ * Elements are appended at the end and removed from the front; when it gets
+ * full, it doubles in size.
+ */
+  typedef struct POW2_RINGBUFFER
+  {
+    char *buffer;          /* buffer itself */
+    unsigned int itemSize; /* size of one item in bytes */
+    unsigned int first;    /* position of first element in buffer */
+    unsigned int nElements;/* number of elements in buffer */
+    unsigned int mask;     /* number of elements which could be stored in buffer - 1 */
+  } POW2_RINGBUFFER;
+
+  POW2_RINGBUFFER *allocPow2RingBuffer(int bufferSize, int itemSize);
+  void freePow2RingBuffer(POW2_RINGBUFFER *rb);
+  void expandPow2RingBuffer(POW2_RINGBUFFER *rb, unsigned int nElements);
+
+  /* appends n elements from the array values */
+  void appendNPow2RingDatas(POW2_RINGBUFFER *rb, const void *values, int n);
+  /* removes the first n elements, copies them to the array values unless it is NULL */
+  void dequeueNFirstPow2RingDatas(POW2_RINGBUFFER *rb, int n, void *values);
+  /* the elements are span1[0..n1-1] followed by span2[0..n2-1] */
+  void pow2RingBufferSpans(POW2_RINGBUFFER *rb, void **span1, int *n1, void **span2, int *n2);
+
+  static OMC_INLINE int pow2RingBufferLength(const POW2_RINGBUFFER *rb)
+  {
+    return rb->nElements;
+  }
+
+  static OMC_INLINE void *getPow2RingData(POW2_RINGBUFFER *rb, int i)
+  {
+    assert(0 <= i && (unsigned int) i < rb->nElements);
+    return rb->buffer + ((rb->first + i) & rb->mask) * rb->itemSize;
+  }
+
+  static OMC_INLINE void appendPow2RingData(POW2_RINGBUFFER *rb, const void *value)
+  {
+    if(rb->nElements > rb->mask)
+      expandPow2RingBuffer(rb, rb->nElements + 1);
+    memcpy(rb->buffer + ((rb->first + rb->nElements) & rb->mask) * rb->itemSize, value, rb->itemSize);
+    ++rb->nElements;
+  }
+
 #ifdef __cplusplus
 }
 #endif
@@ -39,11 +39,15 @@ const char *FLAG_NAME[FLAG_MAX+1] = {
   /* FLAG_CPU */                   "cpu",
   /* FLAG_CSV_OSTEP */             "csvOstep",
   /* FLAG_DASSL_JACOBIAN */        "dasslJacobian",
+  /* FLAG_DASSL_LINEAR_SOLVER */   "dasslLinearSolver",
   /* FLAG_DASSL_NO_RESTART */      "dasslnoRestart",
   /* FLAG_DASSL_NO_ROOTFINDING */  "dasslnoRootFinding",
+  /* FLAG_DELAY_INTERPOLATION */   "delayInterpolation",
   /* FLAG_EMIT_PROTECTED */        "emit_protected",
   /* FLAG_F */                     "f",
   /* FLAG_HELP */                  "help",
+  /* FLAG_IA_BATCH */              "iaBatch",
+  /* FLAG_IA_POLICY */             "iaPolicy",
   /* FLAG_IGNORE_HIDERESULT */     "ignoreHideResult",
   /* FLAG_IIF */                   "iif",
   /* FLAG_IIM */                   "iim",
@@ -58,17 +62,20 @@ const char *FLAG_NAME[FLAG_MAX+1] = {
   /* FLAG_IPOPT_JAC*/              "ipopt_jac",
   /* FLAG_IPOPT_MAX_ITER */        "ipopt_max_iter",
   /* FLAG_IPOPT_WARM_START */      "ipopt_warm_start",
+  /* FLAG_JACOBIAN_THREADS */      "jacobianThreads",
   /* FLAG_L */                     "l",
   /* FLAG_LOG_FORMAT */            "logFormat",
   /* FLAG_LS */                    "ls",
   /* FLAG_LS_IPOPT */              "ls_ipopt",
   /* FLAG_LV */                    "lv",
+  /* FLAG_MAT_BY_VARIABLE */       "matByVariable",
   /* FLAG_MAX_ORDER */             "maxIntegrationOrder",
   /* FLAG_MAX_STEP_SIZE */         "maxStepSize",
   /* FLAG_MEASURETIMEPLOTFORMAT */ "measureTimePlotFormat",
   /* FLAG_NEWTON_STRATEGY */       "newton",
   /* FLAG_NLS */                   "nls",
   /* FLAG_NLS_INFO */              "nlsInfo",
+  /* FLAG_NLS_LS */                "nlsLS",
   /* FLAG_NOEMIT */                "noemit",
   /* FLAG_NOEQUIDISTANT_GRID */    "noEquidistantTimeGrid",
   /* FLAG_NOEQUIDISTANT_OUT_FREQ*/ "noEquidistantOutputFrequency",
@@ -80,7 +87,9 @@ const char *FLAG_NAME[FLAG_MAX+1] = {
   /* FLAG_OUTPUT */                "output",
   /* FLAG_OVERRIDE */              "override",
   /* FLAG_OVERRIDE_FILE */         "overrideFile",
+  /* FLAG_PARALLEL_SYSTEMS */      "parallelSystems",
   /* FLAG_PORT */                  "port",
+  /* FLAG_QSS_ORDER */             "qssOrder",
   /* FLAG_R */                     "r",
   /* FLAG_S */                     "s",
   /* FLAG_UP_HESSIAN */            "keepHessian",
@@ -98,11 +107,15 @@ const char *FLAG_DESC[FLAG_MAX+1] = {
   /* FLAG_CPU */                   "dumps the cpu-time into the results-file",
   /* FLAG_CSV_OSTEP */             "value specifies csv-files for debuge values for optimizer step",
   /* FLAG_DASSL_JACOBIAN */        "selects the type of the jacobians that is used for the dassl solver.\n  dasslJacobian=[coloredNumerical (default) |numerical|internalNumerical|coloredSymbolical|symbolical].",
+  /* FLAG_DASSL_LINEAR_SOLVER */   "selects the linear solver of the dassl solver: dasslLinearSolver=[dense (default) |klu].",
   /* FLAG_DASSL_NO_RESTART */      "flag deactivates the restart of dassl after an event is performed.",
   /* FLAG_DASSL_NO_ROOTFINDING */  "flag deactivates the internal root finding procedure of dassl.",
+  /* FLAG_DELAY_INTERPOLATION */   "value specifies the interpolation of delay(): linear or hermite",
   /* FLAG_EMIT_PROTECTED */        "emits protected variables to the result-file",
   /* FLAG_F */                     "value specifies a new setup XML file to the generated simulation code",
   /* FLAG_HELP */                  "get detailed information that specifies the command-line flag",
+  /* FLAG_IA_BATCH */              "value specifies the number of time points per socket write of the ia result format",
+  /* FLAG_IA_POLICY */             "value specifies how the ia result format handles slow clients: block, drop or decimate",
   /* FLAG_IGNORE_HIDERESULT */     "ignore HideResult=true annotation",
   /* FLAG_IIF */                   "value specifies an external file for the initialization of the model",
   /* FLAG_IIM */                   "value specifies the initialization method",
@@ -117,17 +130,20 @@ const char *FLAG_DESC[FLAG_MAX+1] = {
   /* FLAG_IPOPT_JAC */             "value specifies the jacobian for Ipopt",
   /* FLAG_IPOPT_MAX_ITER */        "value specifies the max number of iteration for ipopt",
   /* FLAG_IPOPT_WARM_START */      "value specifies lvl for a warm start in ipopt: 1,2,3,...",
+  /* FLAG_JACOBIAN_THREADS */      "value specifies the number of threads for the colored jacobian of dassl",
   /* FLAG_L */                     "value specifies a time where the linearization of the model should be performed",
   /* FLAG_LOG_FORMAT */            "value specifies the log format of the executable. -logFormat=text (default) or -logFormat=xml",
   /* FLAG_LS */                    "value specifies the linear solver method",
   /* FLAG_LS_IPOPT */              "value specifies the linear solver method for ipopt",
   /* FLAG_LV */                    "[string list] value specifies the logging level",
+  /* FLAG_MAT_BY_VARIABLE */       "stores the variables of the mat result file contiguously, for faster reading of single variables",
   /* FLAG_MAX_ORDER */             "value specifies maximum integration order, used by dassl solver",
   /* FLAG_MAX_STEP_SIZE */         "value specifies maximum absolute step size, used by dassl solver",
   /* FLAG_MEASURETIMEPLOTFORMAT */ "value specifies the output format of the measure time functionality",
   /* FLAG_NEWTON_STRATEGY */       "value specifies the damping strategy for the newton solver",
   /* FLAG_NLS */                   "value specifies the nonlinear solver",
   /* FLAG_NLS_INFO */              "outputs detailed information about solving process of non-linear systems into csv files.",
+  /* FLAG_NLS_LS */                "selects the linear solver of the homotopy and hybrid nonlinear solvers: nlsLS=[dense (default) |klu].",
   /* FLAG_NOEMIT */                "do not emit any results to the result file",
   /* FLAG_NOEQUIDISTANT_GRID */    "stores results not in equidistant time grid as given by stepSize or numberOfIntervals, instead the variable step size of dassl is used.",
   /* FLAG_NOEQUIDISTANT_OUT_FREQ*/ "value controls the output frequency in noEquidistantTimeGrid mode",
@@ -139,7 +155,9 @@ const char *FLAG_DESC[FLAG_MAX+1] = {
   /* FLAG_OUTPUT */                "output the variables a, b and c at the end of the simulation to the standard output",
   /* FLAG_OVERRIDE */              "override the variables or the simulation settings in the XML setup file",
   /* FLAG_OVERRIDE_FILE */         "will override the variables or the simulation settings in the XML setup file with the values from the file",
+  /* FLAG_PARALLEL_SYSTEMS */      "value specifies the number of threads for the independent equation systems of the model",
   /* FLAG_PORT */                  "value specifies the port for simulation status (default disabled)",
+  /* FLAG_QSS_ORDER */             "value specifies the order of the QSS method (1 or 2)",
   /* FLAG_R */                     "value specifies a new result file than the default Model_res.mat",
   /* FLAG_S */                     "value specifies the solver",
   /* FLAG_UP_HESSIAN */            "value specifies the number of steps, which keep hessian matrix constant",
@@ -170,10 +188,22 @@ const char *FLAG_DETAILED_DESC[FLAG_MAX+1] = {
   "  * coloredSymbolical (colored symbolical Jacobian. Only usable if the simulation is compiled with --generateSymbolicJacobian or --generateSymbolicLinearization.\n"
   "  * numerical - numerical Jacobian.\n\n"
   "  * symbolical - symbolical Jacobian. Only usable if the simulation is compiled with --generateSymbolicJacobian or --generateSymbolicLinearization.",
+  /* FLAG_DASSL_LINEAR_SOLVER */
+  "  Selects the linear solver of the Newton iteration of the dassl solver:\n\n"
+  "  * dense (dense LU decomposition inside dassl - default)\n"
+  "  * klu (sparse LU decomposition with klu, used as preconditioner of the\n"
+  "    Krylov method of dassl; needs the sparsity pattern, i.e.\n"
+  "    dasslJacobian=coloredNumerical or coloredSymbolical)",
   /* FLAG_DASSL_NO_RESTART */
   "  Deactivates the restart of dassl after an event is performed.",
   /* FLAG_DASSL_NO_ROOTFINDING */
   "  Deactivates the internal root finding procedure of dassl.",
+  /* FLAG_DELAY_INTERPOLATION */
+  "  Value specifies how delay() interpolates between the stored values of the\n"
+  "  delayed expression:\n\n"
+  "  * linear (the default)\n"
+  "  * hermite (cubic Hermite interpolation using the derivatives estimated from\n"
+  "    the neighbouring values; more accurate if the steps are large)",
   /* FLAG_EMIT_PROTECTED */
   "  Emits protected variables to the result-file.",
   /* FLAG_F */
@@ -181,6 +211,15 @@ const char *FLAG_DETAILED_DESC[FLAG_MAX+1] = {
   /* FLAG_HELP */
   "  Get detailed information that specifies the command-line flag\n"
   "  For example, -help=f prints detailed information for command-line flag f.",
+  /* FLAG_IA_BATCH */
+  "  Value specifies the number of time points the ia result format collects\n"
+  "  before sending them to the client in one socket write. The default is 1.",
+  /* FLAG_IA_POLICY */
+  "  Value specifies what the ia result format does if the client reads the\n"
+  "  time points slower than they are produced:\n\n"
+  "  * block (wait for the client, the default)\n"
+  "  * drop (discard the time points until the client caught up)\n"
+  "  * decimate (send only every n-th time point, n adapts to the client)",
   /* FLAG_IGNORE_HIDERESULT */
   "  Emits also variables with HideResult=true annotation.",
   /* FLAG_IIF */
@@ -210,6 +249,11 @@ const char *FLAG_DETAILED_DESC[FLAG_MAX+1] = {
   "  Value specifies the max number of iteration for ipopt.",
   /* FLAG_IPOPT_WARM_START */
   "  Value specifies lvl for a warm start in ipopt: 1,2,3,...",
+  /* FLAG_JACOBIAN_THREADS */
+  "  Value specifies the number of threads which evaluate the color groups of the\n"
+  "  jacobian of dassl in parallel (dasslJacobian=coloredNumerical or\n"
+  "  coloredSymbolical). Every thread works on its own copy of the model data.\n"
+  "  The value is an Integer with default value 1 (no additional threads).",
   /* FLAG_L */
   "  Value specifies a time where the linearization of the model should be performed.",
   /* FLAG_LOG_FORMAT */
@@ -224,6 +268,11 @@ const char *FLAG_DETAILED_DESC[FLAG_MAX+1] = {
   /* FLAG_LV */
   "  Value (a comma-separated String list) specifies which logging levels to\n"
   "  enable. Multiple options can be enabled at the same time.",
+  /* FLAG_MAT_BY_VARIABLE */
+  "  Stores the result trajectories of the mat result file variable by variable\n"
+  "  (Dymosim binNormal layout) instead of time point by time point. The data\n"
+  "  is transposed when the simulation finishes, which makes reading a single\n"
+  "  variable from a large result file one sequential read.",
   /* FLAG_MAX_ORDER */
   "  Value specifies maximum integration order, used by dassl solver.",
   /* FLAG_MAX_STEP_SIZE */
@@ -245,6 +294,11 @@ const char *FLAG_DETAILED_DESC[FLAG_MAX+1] = {
   "  * mixed",
   /* FLAG_NLS_INFO */
   "  Outputs detailed information about solving process of non-linear systems into csv files.",
+  /* FLAG_NLS_LS */
+  "  Selects the linear solver of the homotopy and hybrid nonlinear solvers:\n\n"
+  "  * dense (dense LU decomposition with total pivoting - default)\n"
+  "  * klu (sparse LU decomposition of the colored analytical Jacobian with klu;\n"
+  "    only used for systems with an analytical Jacobian, the others stay dense)",
   /* FLAG_NOEMIT */
   "  Do not emit any results to the result file.",
   /* FLAG_NOEQUIDISTANT_GRID */
@@ -278,8 +332,18 @@ const char *FLAG_DETAILED_DESC[FLAG_MAX+1] = {
   "  Note that: -overrideFile CANNOT be used with -override.\n"
   "  Use when variables for -override are too many.\n"
   "  overrideFileName contains lines of the form: var1=start1",
+  /* FLAG_PARALLEL_SYSTEMS */
+  "  Value specifies the number of threads which evaluate the independent\n"
+  "  partitions of the ODE and algebraic equations concurrently, e.g. large\n"
+  "  algebraic loops that do not depend on each other. The model has to be\n"
+  "  compiled with -d=pthreads to generate the partitions as separate\n"
+  "  functions. The value is an Integer with default value 1 (sequential).",
   /* FLAG_PORT */
   "  Value specifies the port for simulation status (default disabled).",
+  /* FLAG_QSS_ORDER */
+  "  Value specifies the order of the quantized state system method used by\n"
+  "  -s=qss: 1 (QSS1, piecewise constant quantized states) or 2 (QSS2,\n"
+  "  piecewise linear quantized states). The default is 1.",
   /* FLAG_R */
   "  Value specifies the name of the output result file.\n"
   "  The default file-name is based on the model name and output format.\n"
@@ -303,11 +367,15 @@ const int FLAG_TYPE[FLAG_MAX] = {
   /* FLAG_CPU */                   FLAG_TYPE_FLAG,
   /* FLAG_CSV_OSTEP */             FLAG_TYPE_OPTION,
   /* FLAG_DASSL_JACOBIAN */        FLAG_TYPE_OPTION,
+  /* FLAG_DASSL_LINEAR_SOLVER */   FLAG_TYPE_OPTION,
   /* FLAG_DASSL_NO_RESTART */      FLAG_TYPE_FLAG,
   /* FLAG_DASSL_NO_ROOTFINDING */  FLAG_TYPE_FLAG,
+  /* FLAG_DELAY_INTERPOLATION */   FLAG_TYPE_OPTION,
   /* FLAG_EMIT_PROTECTED */        FLAG_TYPE_FLAG,
   /* FLAG_F */                     FLAG_TYPE_OPTION,
   /* FLAG_HELP */                  FLAG_TYPE_OPTION,
+  /* FLAG_IA_BATCH */              FLAG_TYPE_OPTION,
+  /* FLAG_IA_POLICY */             FLAG_TYPE_OPTION,
   /* FLAG_IGNORE_HIDERESULT */     FLAG_TYPE_FLAG,
   /* FLAG_IIF */                   FLAG_TYPE_OPTION,
   /* FLAG_IIM */                   FLAG_TYPE_OPTION,
@@ -322,17 +390,20 @@ const int FLAG_TYPE[FLAG_MAX] = {
   /* FLAG_IPOPT_JAC */             FLAG_TYPE_OPTION,
   /* FLAG_IPOPT_MAX_ITER */        FLAG_TYPE_OPTION,
   /* FLAG_IPOPT_WARM_START */      FLAG_TYPE_OPTION,
+  /* FLAG_JACOBIAN_THREADS */      FLAG_TYPE_OPTION,
   /* FLAG_L */                     FLAG_TYPE_OPTION,
   /* FLAG_LOG_FORMAT */            FLAG_TYPE_OPTION,
   /* FLAG_LS */                    FLAG_TYPE_OPTION,
   /* FLAG_LS_IPOPT */              FLAG_TYPE_OPTION,
   /* FLAG_LV */                    FLAG_TYPE_OPTION,
+  /* FLAG_MAT_BY_VARIABLE */       FLAG_TYPE_FLAG,
   /* FLAG_MAX_ORDER */             FLAG_TYPE_OPTION,
   /* FLAG_MAX_STEP_SIZE */         FLAG_TYPE_OPTION,
   /* FLAG_MEASURETIMEPLOTFORMAT */ FLAG_TYPE_OPTION,
   /* FLAG_NEWTON_STRATEGY */       FLAG_TYPE_OPTION,
   /* FLAG_NLS */                   FLAG_TYPE_OPTION,
   /* FLAG_NLS_INFO */              FLAG_TYPE_FLAG,
+  /* FLAG_NLS_LS */                FLAG_TYPE_OPTION,
   /* FLAG_NOEMIT */                FLAG_TYPE_FLAG,
   /* FLAG_NOEQUIDISTANT_GRID*/     FLAG_TYPE_FLAG,
   /* FLAG_NOEQUIDISTANT_OUT_FREQ*/ FLAG_TYPE_OPTION,
@@ -344,7 +415,9 @@ const int FLAG_TYPE[FLAG_MAX] = {
   /* FLAG_OUTPUT */                FLAG_TYPE_OPTION,
   /* FLAG_OVERRIDE */              FLAG_TYPE_OPTION,
   /* FLAG_OVERRIDE_FILE */         FLAG_TYPE_OPTION,
+  /* FLAG_PARALLEL_SYSTEMS */      FLAG_TYPE_OPTION,
   /* FLAG_PORT */                  FLAG_TYPE_OPTION,
+  /* FLAG_QSS_ORDER */             FLAG_TYPE_OPTION,
   /* FLAG_R */                     FLAG_TYPE_OPTION,
   /* FLAG_S */                     FLAG_TYPE_OPTION,
   /* FLAG_UP_HESSIAN */            FLAG_TYPE_OPTION,
@@ -384,7 +457,7 @@ const char *SOLVER_METHOD_DESC[S_MAX] = {
   "symEuler - symbolic implicit euler, [compiler flag +symEuler needed]",
   "symEulerSsc - symbolic implicit euler with step-size control, [compiler flag +symEuler needed]",
   "heun - Heun's method (Runge-Kutta fixed step, order 2)",
-  "qss - A QSS solver [experimental]"
+  "qss - A QSS solver, see -qssOrder"
 };
 
 const char *INIT_METHOD_NAME[IIM_MAX] = {
@@ -483,3 +556,21 @@ const char *NEWTONSTRATEGY_DESC[NEWTON_MAX+1] = {
 
   "NEWTON_MAX"
 };
+
+const char *NLS_LS_NAME[NLS_LS_MAX+1] = {
+  "NLS_LS_UNKNOWN",
+
+  /* NLS_LS_DENSE */        "dense",
+  /* NLS_LS_KLU */          "klu",
+
+  "NLS_LS_MAX"
+};
+
+const char *NLS_LS_DESC[NLS_LS_MAX+1] = {
+  "unknown",
+
+  /* NLS_LS_DENSE */        "dense LU decomposition with total pivoting - default",
+  /* NLS_LS_KLU */          "sparse LU decomposition of the analytical jacobian with klu",
+
+  "NLS_LS_MAX"
+};
@@ -47,11 +47,15 @@ enum _FLAG
   FLAG_CPU,
   FLAG_CSV_OSTEP,
   FLAG_DASSL_JACOBIAN,
+  FLAG_DASSL_LINEAR_SOLVER,
   FLAG_DASSL_NO_RESTART,
   FLAG_DASSL_NO_ROOTFINDING,
+  FLAG_DELAY_INTERPOLATION,
   FLAG_EMIT_PROTECTED,
   FLAG_F,
   FLAG_HELP,
+  FLAG_IA_BATCH,
+  FLAG_IA_POLICY,
   FLAG_IGNORE_HIDERESULT,
   FLAG_IIF,
   FLAG_IIM,
@@ -66,17 +70,20 @@ enum _FLAG
   FLAG_IPOPT_JAC,
   FLAG_IPOPT_MAX_ITER,
   FLAG_IPOPT_WARM_START,
+  FLAG_JACOBIAN_THREADS,
   FLAG_L,
   FLAG_LOG_FORMAT,
   FLAG_LS,
   FLAG_LS_IPOPT,
   FLAG_LV,
+  FLAG_MAT_BY_VARIABLE,
   FLAG_MAX_ORDER,
   FLAG_MAX_STEP_SIZE,
   FLAG_MEASURETIMEPLOTFORMAT,
   FLAG_NEWTON_STRATEGY,
   FLAG_NLS,
   FLAG_NLS_INFO,
+  FLAG_NLS_LS,
   FLAG_NOEMIT,
   FLAG_NOEQUIDISTANT_GRID,
   FLAG_NOEQUIDISTANT_OUT_FREQ,
@@ -88,7 +95,9 @@ enum _FLAG
   FLAG_OUTPUT,
   FLAG_OVERRIDE,
   FLAG_OVERRIDE_FILE,
+  FLAG_PARALLEL_SYSTEMS,
   FLAG_PORT,
+  FLAG_QSS_ORDER,
   FLAG_R,
   FLAG_S,
   FLAG_UP_HESSIAN,
@@ -196,12 +205,25 @@ enum NEWTON_STRATEGY
   NEWTON_MAX
 };
 
+enum NLS_LINEAR_SOLVER
+{
+  NLS_LS_UNKNOWN = 0,
+
+  NLS_LS_DENSE,
+  NLS_LS_KLU,
+
+  NLS_LS_MAX
+};
+
 extern const char *NLS_NAME[NLS_MAX+1];
 extern const char *NLS_DESC[NLS_MAX+1];
 
 extern const char *NEWTONSTRATEGY_NAME[NEWTON_MAX+1];
 extern const char *NEWTONSTRATEGY_DESC[NEWTON_MAX+1];
 
+extern const char *NLS_LS_NAME[NLS_LS_MAX+1];
+extern const char *NLS_LS_DESC[NLS_LS_MAX+1];
+
 #if defined(__cplusplus)
   }
 #endif
@@ -0,0 +1,159 @@
+/*
+ * This file is part of OpenModelica.
+ *
+ * Copyright (c) 1998-CurrentYear, Open Source Modelica Consortium (OSMC),
+ * c/o Linköpings universitet, Department of Computer and Information Science,
+ * SE-58183 Linköping, Sweden.
+ *
+ * All rights reserved.
+ *
+ * THIS PROGRAM IS PROVIDED UNDER THE TERMS OF THE BSD NEW LICENSE OR THE
+ * GPL VERSION 3 LICENSE OR THE OSMC PUBLIC LICENSE (OSMC-PL) VERSION 1.2.
+ * ANY USE, REPRODUCTION OR DISTRIBUTION OF THIS PROGRAM CONSTITUTES
+ * RECIPIENT'S ACCEPTANCE OF THE OSMC PUBLIC LICENSE OR THE GPL VERSION 3,
+ * ACCORDING TO RECIPIENTS CHOICE.
+ *
+ * The OpenModelica software and the OSMC (Open Source Modelica Consortium)
+ * Public License (OSMC-PL) are obtained from OSMC, either from the above
+ * address, from the URLs: http://www.openmodelica.org or
+ * http://www.ida.liu.se/projects/OpenModelica, and in the OpenModelica
+ * distribution. GNU version 3 is obtained from:
+ * http://www.gnu.org/copyleft/gpl.html. The New BSD License is obtained from:
+ * http://www.opensource.org/licenses/BSD-3-Clause.
+ *
+ * This program is distributed WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, EXCEPT AS
+ * EXPRESSLY SET FORTH IN THE BY RECIPIENT SELECTED SUBSIDIARY LICENSE
+ * CONDITIONS OF OSMC-PL.
+ *
+ */
+
+/*
+ * Microbenchmark of POW2_RINGBUFFER against RINGBUFFER, with rows of the
+ * size of the delay buffers (time, value and one more double):
+ *  - queue: append a row, remove the first one and read a row of a window
+ *    of 1000 rows, like delay() does every step
+ *  - get:   random reads within the window
+ *  - grow:  appending 1e6 rows to a buffer of size 1
+ * Usage: bench_ringbuffer [number of operations]; build it with -DNDEBUG,
+ * otherwise the index checks of POW2_RINGBUFFER are measured as well.
+ */
+
+#include "../ringbuffer.c"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/* the parts of omc_error used by ringbuffer.c */
+int useStream[SIM_LOG_MAX];
+static void benchMessageClose(int stream) { (void)stream; }
+void (*messageClose)(int stream) = benchMessageClose;
+
+void infoStreamPrint(int stream, int indentNext, const char *format, ...)
+{
+  (void)stream;
+  (void)indentNext;
+  (void)format;
+}
+
+void va_throwStreamPrint(threadData_t *threadData, const char *format, va_list ap)
+{
+  (void)threadData;
+  vfprintf(stderr, format, ap);
+  fprintf(stderr, "\n");
+  exit(1);
+}
+
+void throwStreamPrint(threadData_t *threadData, const char *format, ...)
+{
+  va_list ap;
+  va_start(ap, format);
+  va_throwStreamPrint(threadData, format, ap);
+}
+
+typedef struct ROW
+{
+  double time;
+  double value;
+  double extra;
+} ROW;
+
+#define WINDOW 1000
+#define GROW_ROWS 1000000
+#define GROW_REPEAT 20
+
+static double seconds(clock_t start)
+{
+  return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+int main(int argc, char **argv)
+{
+  const long n = argc > 1 ? atol(argv[1]) : 20000000;
+  RINGBUFFER *rb = allocRingBuffer(1024, sizeof(ROW));
+  POW2_RINGBUFFER *p2 = allocPow2RingBuffer(1024, sizeof(ROW));
+  ROW row = {0, 0, 0};
+  double sum = 0;
+  clock_t start;
+  long i;
+  int k;
+
+  for (i=0; i<WINDOW; i++) {
+    row.time = i;
+    appendRingData(rb, &row);
+    appendPow2RingData(p2, &row);
+  }
+
+  start = clock();
+  for (i=0; i<n; i++) {
+    row.time = i;
+    appendRingData(rb, &row);
+    dequeueNFirstRingDatas(rb, 1);
+    sum += ((ROW*)getRingData(rb, i % WINDOW))->time;
+  }
+  printf("queue RINGBUFFER       %6.1f ns/op\n", seconds(start)/n*1e9);
+
+  start = clock();
+  for (i=0; i<n; i++) {
+    row.time = i;
+    appendPow2RingData(p2, &row);
+    dequeueNFirstPow2RingDatas(p2, 1, NULL);
+    sum += ((ROW*)getPow2RingData(p2, i % WINDOW))->time;
+  }
+  printf("queue POW2_RINGBUFFER  %6.1f ns/op\n", seconds(start)/n*1e9);
+
+  start = clock();
+  for (i=0; i<n; i++) {
+    sum += ((ROW*)getRingData(rb, (i*7919) % WINDOW))->value;
+  }
+  printf("get   RINGBUFFER       %6.1f ns/op\n", seconds(start)/n*1e9);
+
+  start = clock();
+  for (i=0; i<n; i++) {
+    sum += ((ROW*)getPow2RingData(p2, (i*7919) % WINDOW))->value;
+  }
+  printf("get   POW2_RINGBUFFER  %6.1f ns/op\n", seconds(start)/n*1e9);
+
+  start = clock();
+  for (k=0; k<GROW_REPEAT; k++) {
+    RINGBUFFER *g = allocRingBuffer(1, sizeof(ROW));
+    for (i=0; i<GROW_ROWS; i++) appendRingData(g, &row);
+    freeRingBuffer(g);
+  }
+  printf("grow  RINGBUFFER       %6.2f ms\n", seconds(start)/GROW_REPEAT*1e3);
+
+  start = clock();
+  for (k=0; k<GROW_REPEAT; k++) {
+    POW2_RINGBUFFER *g = allocPow2RingBuffer(1, sizeof(ROW));
+    for (i=0; i<GROW_ROWS; i++) appendPow2RingData(g, &row);
+    freePow2RingBuffer(g);
+  }
+  printf("grow  POW2_RINGBUFFER  %6.2f ms\n", seconds(start)/GROW_REPEAT*1e3);
+
+  freeRingBuffer(rb);
+  freePow2RingBuffer(p2);
+
+  /* keep the reads from being optimized away */
+  return sum == -1.0;
+}
@@ -0,0 +1,282 @@
+/*
+ * This file is part of OpenModelica.
+ *
+ * Copyright (c) 1998-CurrentYear, Open Source Modelica Consortium (OSMC),
+ * c/o Linköpings universitet, Department of Computer and Information Science,
+ * SE-58183 Linköping, Sweden.
+ *
+ * All rights reserved.
+ *
+ * THIS PROGRAM IS PROVIDED UNDER THE TERMS OF THE BSD NEW LICENSE OR THE
+ * GPL VERSION 3 LICENSE OR THE OSMC PUBLIC LICENSE (OSMC-PL) VERSION 1.2.
+ * ANY USE, REPRODUCTION OR DISTRIBUTION OF THIS PROGRAM CONSTITUTES
+ * RECIPIENT'S ACCEPTANCE OF THE OSMC PUBLIC LICENSE OR THE GPL VERSION 3,
+ * ACCORDING TO RECIPIENTS CHOICE.
+ *
+ * The OpenModelica software and the OSMC (Open Source Modelica Consortium)
+ * Public License (OSMC-PL) are obtained from OSMC, either from the above
+ * address, from the URLs: http://www.openmodelica.org or
+ * http://www.ida.liu.se/projects/OpenModelica, and in the OpenModelica
+ * distribution. GNU version 3 is obtained from:
+ * http://www.gnu.org/copyleft/gpl.html. The New BSD License is obtained from:
+ * http://www.opensource.org/licenses/BSD-3-Clause.
+ *
+ * This program is distributed WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, EXCEPT AS
+ * EXPRESSLY SET FORTH IN THE BY RECIPIENT SELECTED SUBSIDIARY LICENSE
+ * CONDITIONS OF OSMC-PL.
+ *
+ */
+
+/*
+ * Behaviour of RINGBUFFER and POW2_RINGBUFFER: wrap-around, growth,
+ * dequeue, rotation and a random sequence of operations compared with a
+ * plain array. Returns 0 if everything is fine.
+ */
+
+#include "../ringbuffer.c"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/* the parts of omc_error used by ringbuffer.c */
+int useStream[SIM_LOG_MAX];
+static void testMessageClose(int stream) { (void)stream; }
+void (*messageClose)(int stream) = testMessageClose;
+
+void infoStreamPrint(int stream, int indentNext, const char *format, ...)
+{
+  (void)stream;
+  (void)indentNext;
+  (void)format;
+}
+
+void va_throwStreamPrint(threadData_t *threadData, const char *format, va_list ap)
+{
+  (void)threadData;
+  vfprintf(stderr, format, ap);
+  fprintf(stderr, "\n");
+  exit(99);
+}
+
+void throwStreamPrint(threadData_t *threadData, const char *format, ...)
+{
+  va_list ap;
+  va_start(ap, format);
+  va_throwStreamPrint(threadData, format, ap);
+}
+
+/* forward declarations */
+int test_RingBuffer_wrapAround();
+int test_RingBuffer_rotate();
+int test_Pow2RingBuffer_wrapAround();
+int test_Pow2RingBuffer_growth();
+int test_Pow2RingBuffer_bulk();
+int test_Pow2RingBuffer_random(unsigned int seed);
+
+/* main */
+int main()
+{
+  /* return code */
+  int rc;
+
+  if ( (rc = test_RingBuffer_wrapAround()) != 0) return 1000+rc;
+  if ( (rc = test_RingBuffer_rotate()) != 0) return 1100+rc;
+
+  if ( (rc = test_Pow2RingBuffer_wrapAround()) != 0) return 2000+rc;
+  if ( (rc = test_Pow2RingBuffer_growth()) != 0) return 2100+rc;
+  if ( (rc = test_Pow2RingBuffer_bulk()) != 0) return 2200+rc;
+
+  /* Random Test */
+  if ( (rc = test_Pow2RingBuffer_random(1)) != 0) return 3000+rc;
+  if ( (rc = test_Pow2RingBuffer_random(4711)) != 0) return 3100+rc;
+
+  /* everything OK */
+  return 0;
+}
+
+int test_RingBuffer_wrapAround()
+{
+  RINGBUFFER *rb = allocRingBuffer(4, sizeof(int));
+  int i, value;
+
+  /* fill, remove two elements and append again, so that the elements wrap around */
+  for (i=0; i<4; i++) appendRingData(rb, &i);
+  dequeueNFirstRingDatas(rb, 2);
+  for (i=4; i<6; i++) appendRingData(rb, &i);
+  if (ringBufferLength(rb) != 4) return 1;
+  for (i=0; i<4; i++) if (*(int*)getRingData(rb, i) != i+2) return 2;
+
+  /* grow while wrapped around */
+  for (value=6; value<20; value++) appendRingData(rb, &value);
+  if (ringBufferLength(rb) != 18) return 3;
+  for (i=0; i<18; i++) if (*(int*)getRingData(rb, i) != i+2) return 4;
+
+  dequeueNFirstRingDatas(rb, 17);
+  if (ringBufferLength(rb) != 1 || *(int*)getRingData(rb, 0) != 19) return 5;
+
+  freeRingBuffer(rb);
+
+  /* everything is fine */
+  return 0;
+}
+
+int test_RingBuffer_rotate()
+{
+  RINGBUFFER *rb = allocRingBuffer(3, sizeof(int));
+  void *lookup[3];
+  int i;
+
+  for (i=0; i<3; i++) appendRingData(rb, &i);
+
+  /* the last element becomes the first one, as for the localData */
+  rotateRingBuffer(rb, 1, lookup);
+  if (*(int*)getRingData(rb, 0) != 2) return 1;
+  if (*(int*)getRingData(rb, 1) != 0) return 2;
+  if (*(int*)getRingData(rb, 2) != 1) return 3;
+  for (i=0; i<3; i++) if (lookup[i] != getRingData(rb, i)) return 4;
+
+  rotateRingBuffer(rb, 2, NULL);
+  for (i=0; i<3; i++) if (*(int*)getRingData(rb, i) != i) return 5;
+
+  freeRingBuffer(rb);
+
+  /* everything is fine */
+  return 0;
+}
+
+int test_Pow2RingBuffer_wrapAround()
+{
+  POW2_RINGBUFFER *rb = allocPow2RingBuffer(3, sizeof(int));
+  int i;
+
+  /* the capacity is rounded up to a power of two */
+  if (rb->mask != 3) return 1;
+
+  for (i=0; i<4; i++) appendPow2RingData(rb, &i);
+  dequeueNFirstPow2RingDatas(rb, 3, NULL);
+  for (i=4; i<7; i++) appendPow2RingData(rb, &i);
+  if (rb->mask != 3) return 2;
+  if (pow2RingBufferLength(rb) != 4) return 3;
+  for (i=0; i<4; i++) if (*(int*)getPow2RingData(rb, i) != i+3) return 4;
+
+  freePow2RingBuffer(rb);
+
+  /* everything is fine */
+  return 0;
+}
+
+int test_Pow2RingBuffer_growth()
+{
+  POW2_RINGBUFFER *rb = allocPow2RingBuffer(4, sizeof(double));
+  double value;
+  int i;
+
+  /* wrap around, then grow several times */
+  for (i=0; i<4; i++) { value = i; appendPow2RingData(rb, &value); }
+  dequeueNFirstPow2RingDatas(rb, 3, NULL);
+  for (i=4; i<100; i++) { value = i; appendPow2RingData(rb, &value); }
+  if (rb->mask != 127) return 1;
+  if (pow2RingBufferLength(rb) != 97) return 2;
+  for (i=0; i<97; i++) if (*(double*)getPow2RingData(rb, i) != i+3) return 3;
+
+  /* growing an empty buffer */
+  dequeueNFirstPow2RingDatas(rb, 97, NULL);
+  expandPow2RingBuffer(rb, 1000);
+  if (rb->mask != 1023 || pow2RingBufferLength(rb) != 0) return 4;
+
+  freePow2RingBuffer(rb);
+
+  /* everything is fine */
+  return 0;
+}
+
+int test_Pow2RingBuffer_bulk()
+{
+  POW2_RINGBUFFER *rb = allocPow2RingBuffer(8, sizeof(int));
+  int values[10], out[10];
+  void *span1, *span2;
+  int n1, n2, i;
+
+  for (i=0; i<10; i++) values[i] = 100+i;
+
+  /* bulk append and dequeue across the end of the buffer */
+  appendNPow2RingDatas(rb, values, 6);
+  dequeueNFirstPow2RingDatas(rb, 5, out);
+  for (i=0; i<5; i++) if (out[i] != 100+i) return 1;
+  appendNPow2RingDatas(rb, values, 5);
+  if (pow2RingBufferLength(rb) != 6) return 2;
+  if (*(int*)getPow2RingData(rb, 0) != 105) return 3;
+  for (i=1; i<6; i++) if (*(int*)getPow2RingData(rb, i) != 99+i) return 4;
+
+  /* the contents as two spans */
+  pow2RingBufferSpans(rb, &span1, &n1, &span2, &n2);
+  if (n1 != 3 || n2 != 3) return 5;
+  if (((int*)span1)[0] != 105 || ((int*)span1)[2] != 101) return 6;
+  if (((int*)span2)[0] != 102 || ((int*)span2)[2] != 104) return 7;
+
+  dequeueNFirstPow2RingDatas(rb, 6, out);
+  if (out[0] != 105 || out[5] != 104) return 8;
+
+  /* bulk append that has to grow the buffer */
+  appendNPow2RingDatas(rb, values, 10);
+  if (rb->mask != 15 || pow2RingBufferLength(rb) != 10) return 9;
+  for (i=0; i<10; i++) if (*(int*)getPow2RingData(rb, i) != 100+i) return 10;
+
+  pow2RingBufferSpans(rb, &span1, &n1, &span2, &n2);
+  if (n1 + n2 != 10) return 11;
+
+  freePow2RingBuffer(rb);
+
+  /* everything is fine */
+  return 0;
+}
+
+/* appends and removes random numbers of elements and compares the buffer
+ * with a plain array holding the same elements */
+int test_Pow2RingBuffer_random(unsigned int seed)
+{
+  const int nMax = 5000;
+  POW2_RINGBUFFER *rb = allocPow2RingBuffer(1, sizeof(int));
+  int *ref = (int*) malloc(nMax*sizeof(int));
+  int *tmp = (int*) malloc(nMax*sizeof(int));
+  int first = 0, last = 0; /* ref[first..last-1] are the elements */
+  int step, i, rc = 0;
+
+  srand(seed);
+  for (step=0; step<2000 && !rc; step++) {
+    int n = rand() % 17;
+    switch (rand() % 3) {
+    case 0: /* single elements */
+      for (i=0; i<n && last<nMax; i++, last++) {
+        ref[last] = last;
+        appendPow2RingData(rb, &ref[last]);
+      }
+      break;
+    case 1: /* bulk */
+      if (last+n > nMax) n = nMax-last;
+      for (i=0; i<n; i++) ref[last+i] = last+i;
+      appendNPow2RingDatas(rb, ref+last, n);
+      last += n;
+      break;
+    default:
+      if (n > last-first) n = last-first;
+      if (rand() % 2) {
+        dequeueNFirstPow2RingDatas(rb, n, tmp);
+        for (i=0; i<n; i++) if (tmp[i] != ref[first+i]) rc = 3;
+      } else {
+        dequeueNFirstPow2RingDatas(rb, n, NULL);
+      }
+      first += n;
+    }
+    if (pow2RingBufferLength(rb) != last-first) rc = 1;
+    for (i=first; i<last && !rc; i++) {
+      if (*(int*)getPow2RingData(rb, i-first) != ref[i]) rc = 2;
+    }
+  }
+
+  free(tmp);
+  free(ref);
+  freePow2RingBuffer(rb);
+  return rc;
+}
@@ -0,0 +1,140 @@
+/*
+ * This file is part of OpenModelica.
+ *
+ * Copyright (c) 1998-CurrentYear, Open Source Modelica Consortium (OSMC),
+ * c/o Linköpings universitet, Department of Computer and Information Science,
+ * SE-58183 Linköping, Sweden.
+ *
+ * All rights reserved.
+ *
+ * THIS PROGRAM IS PROVIDED UNDER THE TERMS OF THE BSD NEW LICENSE OR THE
+ * GPL VERSION 3 LICENSE OR THE OSMC PUBLIC LICENSE (OSMC-PL) VERSION 1.2.
+ * ANY USE, REPRODUCTION OR DISTRIBUTION OF THIS PROGRAM CONSTITUTES
+ * RECIPIENT'S ACCEPTANCE OF THE OSMC PUBLIC LICENSE OR THE GPL VERSION 3,
+ * ACCORDING TO RECIPIENTS CHOICE.
+ *
+ * The OpenModelica software and the OSMC (Open Source Modelica Consortium)
+ * Public License (OSMC-PL) are obtained from OSMC, either from the above
+ * address, from the URLs: http://www.openmodelica.org or
+ * http://www.ida.liu.se/projects/OpenModelica, and in the OpenModelica
+ * distribution. GNU version 3 is obtained from:
+ * http://www.gnu.org/copyleft/gpl.html. The New BSD License is obtained from:
+ * http://www.opensource.org/licenses/BSD-3-Clause.
+ *
+ * This program is distributed WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, EXCEPT AS
+ * EXPRESSLY SET FORTH IN THE BY RECIPIENT SELECTED SUBSIDIARY LICENSE
+ * CONDITIONS OF OSMC-PL.
+ *
+ */
+
+/*
+ * Behaviour of OMC_THREAD_POOL: every task of a job is run exactly once,
+ * the worker indices stay in range, the pool is reused for several jobs
+ * and a pool of size 1 runs the tasks on the calling thread. Returns 0 if
+ * everything is fine.
+ */
+
+#include "../omc_thread_pool.c"
+
+#include <stdio.h>
+#include <string.h>
+
+#define TEST_MAX_TASKS 1000
+
+typedef struct {
+  int nThreads;
+  int count[TEST_MAX_TASKS];
+  int badWorker;
+  pthread_t caller;
+  int ranOnOtherThread;
+  pthread_mutex_t mutex;
+} TEST_JOB;
+
+static void testTask(void *arg, int worker, int task)
+{
+  TEST_JOB *job = (TEST_JOB*) arg;
+
+  pthread_mutex_lock(&job->mutex);
+  job->count[task]++;
+  if (worker < 0 || worker >= job->nThreads) job->badWorker = 1;
+  if (!pthread_equal(pthread_self(), job->caller)) job->ranOnOtherThread = 1;
+  pthread_mutex_unlock(&job->mutex);
+}
+
+/* forward declarations */
+int test_ThreadPool_run(int nThreads);
+int test_ThreadPool_single();
+
+/* main */
+int main()
+{
+  /* return code */
+  int rc;
+
+  if ( (rc = test_ThreadPool_run(2)) != 0) return 1000+rc;
+  if ( (rc = test_ThreadPool_run(4)) != 0) return 1100+rc;
+  if ( (rc = test_ThreadPool_single()) != 0) return 2000+rc;
+
+  /* everything OK */
+  return 0;
+}
+
+int test_ThreadPool_run(int nThreads)
+{
+  OMC_THREAD_POOL *pool = omc_thread_pool_create(nThreads);
+  TEST_JOB job;
+  int i, nTasks;
+
+  if (!pool) return 1;
+  if (omc_thread_pool_size(pool) < 1 || omc_thread_pool_size(pool) > nThreads) return 2;
+
+  memset(&job, 0, sizeof(TEST_JOB));
+  job.nThreads = omc_thread_pool_size(pool);
+  job.caller = pthread_self();
+  pthread_mutex_init(&job.mutex, NULL);
+
+  /* the same pool runs many jobs of different size */
+  for (nTasks=0; nTasks<=TEST_MAX_TASKS; nTasks+=nTasks/2+1)
+  {
+    memset(job.count, 0, sizeof(job.count));
+    omc_thread_pool_run(pool, testTask, &job, nTasks);
+    for (i=0; i<nTasks; i++) if (job.count[i] != 1) return 3;
+    for (i=nTasks; i<TEST_MAX_TASKS; i++) if (job.count[i] != 0) return 4;
+  }
+  if (job.badWorker) return 5;
+
+  pthread_mutex_destroy(&job.mutex);
+  omc_thread_pool_free(pool);
+
+  /* everything is fine */
+  return 0;
+}
+
+int test_ThreadPool_single()
+{
+  OMC_THREAD_POOL *pool = omc_thread_pool_create(1);
+  TEST_JOB job;
+  int i;
+
+  if (omc_thread_pool_create(0) != NULL) return 1;
+  if (omc_thread_pool_size(pool) != 1) return 2;
+  if (omc_thread_pool_size(NULL) != 1) return 3;
+
+  memset(&job, 0, sizeof(TEST_JOB));
+  job.nThreads = 1;
+  job.caller = pthread_self();
+  pthread_mutex_init(&job.mutex, NULL);
+
+  /* without threads the tasks run on the calling thread, in order */
+  omc_thread_pool_run(pool, testTask, &job, 10);
+  omc_thread_pool_run(NULL, testTask, &job, 10);
+  for (i=0; i<10; i++) if (job.count[i] != 2) return 4;
+  if (job.badWorker || job.ranOnOtherThread) return 5;
+
+  pthread_mutex_destroy(&job.mutex);
+  omc_thread_pool_free(pool);
+
+  /* everything is fine */
+  return 0;
+}
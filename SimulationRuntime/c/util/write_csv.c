@@ -34,6 +34,7 @@
 
 #include "libcsv.h"
 #include "write_csv.h"
+#include "omc_dtoa.h"
 
 #define CSV_BUFFER_SIZE 1024
 
@@ -81,3 +82,14 @@ int omc_write_csv(OMC_WRITE_CSV* csvData, const void* csvLine){
 
   return 0;
 }
+
+int omc_write_csv_real(OMC_WRITE_CSV* csvData, double value){
+
+  char buffer[OMC_DTOA_BUFFER_SIZE];
+  int n = omc_dtoa_shortest(value, buffer);
+
+  /* numbers never need quoting */
+  fwrite(buffer, 1, n, csvData->handle);
+
+  return 0;
+}
@@ -55,6 +55,8 @@ OMC_WRITE_CSV*
 omc_write_csv_init(char filename[], char seperator, char quote);
 int omc_write_csv_free(OMC_WRITE_CSV* csvData);
 int omc_write_csv(OMC_WRITE_CSV* csvData, const void* csvLine);
+/* Writes the shortest representation of value that reads back exactly */
+int omc_write_csv_real(OMC_WRITE_CSV* csvData, double value);
 
 #ifdef __cplusplus
 } /* extern "C" */